@@ -25,10 +25,36 @@ SOURCES  += \
     sources/qwebservicemethod.cpp \
     sources/qwsdl.cpp \
     sources/qwebservice.cpp \
+    sources/qwebnetworkmanagerpool.cpp \
+    sources/qwebmethodcall.cpp \
+    sources/qwebcontentcodec.cpp \
+    sources/qwebtimerqueue.cpp \
+    sources/qwebclock.cpp \
+    sources/qwebretrypolicy.cpp \
+    sources/qwebcircuitbreaker.cpp \
+    sources/qwebratelimit.cpp \
+    sources/qwebloadbalancer.cpp \
+    sources/qwebconnectionwarmer.cpp \
+    sources/qwebworkerpool.cpp \
+    sources/qwebbatch.cpp \
+    sources/qwebresponsecache.cpp \
+    sources/qwebrequestwriter.cpp \
+    sources/qwebuploaddevice.cpp \
+    sources/qwebreplybuffer.cpp \
+    sources/qwebreplydecoder.cpp \
+    sources/qwebjsondocument.cpp \
 
 HEADERS  += headers/QWebService_global.h \
     headers/QWebService \
     headers/qwebmethod.h \
+    headers/qwebmethodcall.h \
+    headers/qwebretrypolicy.h \
+    headers/qwebcircuitbreaker.h \
+    headers/qwebratelimit.h \
+    headers/qwebloadbalancer.h \
+    headers/qwebbatch.h \
+    headers/qwebresponsecache.h \
+    headers/qwebjsondocument.h \
     headers/qwebservicemethod.h \
     headers/qwsdl.h \
     headers/qwebservice.h \
@@ -36,8 +62,33 @@ HEADERS  += headers/QWebService_global.h \
     headers/qwebservicemethod_p.h \
     headers/qwebservice_p.h \
     headers/qwsdl_p.h \
+    headers/qwebnetworkmanagerpool_p.h \
+    headers/qwebmethodcall_p.h \
+    headers/qwebcontentcodec_p.h \
+    headers/qwebtimerqueue_p.h \
+    headers/qwebclock_p.h \
+    headers/qwebretrypolicy_p.h \
+    headers/qwebcircuitbreaker_p.h \
+    headers/qwebratelimit_p.h \
+    headers/qwebloadbalancer_p.h \
+    headers/qwebconnectionwarmer_p.h \
+    headers/qwebmpscqueue_p.h \
+    headers/qwebworkerpool_p.h \
+    headers/qwebbatch_p.h \
+    headers/qwebresponsecache_p.h \
+    headers/qwebrequestwriter_p.h \
+    headers/qwebuploaddevice_p.h \
+    headers/qwebreplybuffer_p.h \
+    headers/qwebreplydecoder_p.h \
+    headers/qwebjsondocument_p.h \
     headers/QtWebServiceQml.h
 
+# zlib is used to compress requests and inflate replies (see QWebContentCodec).
+# On Windows, zlib bundled with Qt is used (QtCore exports its symbols).
+win32: INCLUDEPATH += $$[QT_INSTALL_PREFIX]/src/3rdparty/zlib
+else:symbian: LIBS += -llibz
+else: LIBS += -lz
+
 symbian {
     #Symbian specific definitions
     MMP_RULES += EXPORTUNFROZEN
@@ -9,6 +9,7 @@
 
 void registerQmlTypes() {
     qmlRegisterType<QWebMethod>("QtWebService", 0, 6, "WebMethod");
+    qmlRegisterType<QWebMethodCall>();
     qmlRegisterType<QWebServiceMethod>("QtWebService", 0, 6, "WebServiceMethod");
     qmlRegisterType<QWsdl>("QtWebService", 0, 6, "Wsdl");
 //    qmlRegisterType<QWebService>("QtWebService", 0, 6, "WebService");
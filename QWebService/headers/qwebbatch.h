@@ -0,0 +1,89 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBBATCH_H
+#define QWEBBATCH_H
+
+#include <QtCore/qobject.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qvariant.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qpair.h>
+#include <QtCore/qlist.h>
+#include "QWebService_global.h"
+
+class QWebService;
+class QWebBatchPrivate;
+
+typedef QPair<QString, QMap<QString, QVariant> > QWebBatchItem;
+
+class QWEBSERVICESHARED_EXPORT QWebBatch : public QObject
+{
+    Q_OBJECT
+    Q_ENUMS(Order)
+
+public:
+    enum Order
+    {
+        Unordered   = 0,
+        Ordered     = 1
+    };
+
+    enum { DefaultConcurrency = 4 };
+
+    ~QWebBatch();
+
+    int size() const;
+    int maxConcurrent() const;
+    Order order() const;
+
+    int runningCount() const;
+    int finishedCount() const;
+    int errorCount() const;
+    Q_INVOKABLE bool isFinished() const;
+
+    QByteArray reply(int index) const;
+    QString errorInfo(int index) const;
+
+    Q_INVOKABLE bool waitForFinished(int msecs = 30000);
+
+public slots:
+    void abort();
+
+signals:
+    void itemFinished(int index, const QByteArray &reply, const QString &errorInfo);
+    void finished();
+
+protected:
+    QWebBatchPrivate *d_ptr;
+
+private slots:
+    void start();
+    void callFinished();
+    void callDestroyed(QObject *call);
+
+private:
+    QWebBatch(QWebService *service, const QList<QWebBatchItem> &items,
+              int maxConcurrent, Order order);
+
+    friend class QWebService;
+    Q_DISABLE_COPY(QWebBatch)
+    Q_DECLARE_PRIVATE(QWebBatch)
+};
+
+#endif // QWEBBATCH_H
@@ -0,0 +1,57 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBBATCH_P_H
+#define QWEBBATCH_P_H
+
+#include <QtCore/qhash.h>
+#include <QtCore/qvector.h>
+#include <QtCore/qpointer.h>
+#include "qwebbatch.h"
+#include "qwebservice.h"
+
+class QWebBatchPrivate
+{
+    Q_DECLARE_PUBLIC(QWebBatch)
+
+public:
+    QWebBatchPrivate(QWebBatch *q) :
+        q_ptr(q), maxConcurrent(QWebBatch::DefaultConcurrency),
+        order(QWebBatch::Unordered), nextItem(0), nextReported(0),
+        finishedCount(0), errorCount(0) {}
+    QWebBatch *q_ptr;
+
+    void startCalls();
+    void complete(int index, const QByteArray &reply, const QString &errorInfo);
+
+    QPointer<QWebService> service;
+    QList<QWebBatchItem> items;
+    int maxConcurrent;
+    QWebBatch::Order order;
+    // Index of the next item to be invoked.
+    int nextItem;
+    // Index of the next item to be reported (in ordered mode).
+    int nextReported;
+    int finishedCount;
+    int errorCount;
+    QVector<bool> done;
+    QVector<QByteArray> replies;
+    QVector<QString> errors;
+    QHash<QObject *, int> running;
+};
+
+#endif // QWEBBATCH_P_H
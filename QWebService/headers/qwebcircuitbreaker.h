@@ -0,0 +1,58 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBCIRCUITBREAKER_H
+#define QWEBCIRCUITBREAKER_H
+
+#include <QtCore/qurl.h>
+#include <QtCore/qstring.h>
+#include "QWebService_global.h"
+
+class QWEBSERVICESHARED_EXPORT QWebCircuitBreaker
+{
+public:
+    enum State
+    {
+        Closed      = 0,
+        Open        = 1,
+        HalfOpen    = 2
+    };
+
+    struct QWEBSERVICESHARED_EXPORT Settings
+    {
+        Settings();
+
+        int windowSize;
+        int minimumCalls;
+        int failureRateThreshold;
+        int slowCallThreshold;
+        int slowCallRateThreshold;
+        int openDuration;
+        int halfOpenCalls;
+    };
+
+    static Settings settings();
+    static void setSettings(const Settings &settings);
+
+    static State state(const QUrl &host);
+    static void reset(const QUrl &host = QUrl());
+
+private:
+    QWebCircuitBreaker();
+};
+
+#endif // QWEBCIRCUITBREAKER_H
@@ -0,0 +1,61 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBCIRCUITBREAKER_P_H
+#define QWEBCIRCUITBREAKER_P_H
+
+#include <QtCore/qmutex.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qvector.h>
+#include "qwebcircuitbreaker.h"
+
+class QWebHostCircuit
+{
+public:
+    QWebHostCircuit();
+
+    void record(bool failed, bool slow);
+    void clearWindow();
+
+    QWebCircuitBreaker::State state;
+    // Ring buffer of recent calls: bit 0 - failed, bit 1 - slow.
+    QVector<quint8> window;
+    int windowIndex;
+    int windowCount;
+    int failures;
+    int slowCalls;
+    qint64 openedAt;
+    int halfOpenInFlight;
+    int halfOpenSuccesses;
+};
+
+class QWEBSERVICESHARED_EXPORT QWebCircuitBreakerPrivate
+{
+public:
+    enum Result
+    {
+        Success,
+        Failure,
+        Ignored
+    };
+
+    static QString key(const QUrl &host);
+    static bool acquire(const QString &key);
+    static void release(const QString &key, Result result, qint64 latency);
+};
+
+#endif // QWEBCIRCUITBREAKER_P_H
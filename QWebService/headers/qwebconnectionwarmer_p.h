@@ -0,0 +1,75 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBCONNECTIONWARMER_P_H
+#define QWEBCONNECTIONWARMER_P_H
+
+#include <QtNetwork/qhostinfo.h>
+#include <QtNetwork/qnetworkreply.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qurl.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include "QWebService_global.h"
+
+class QWEBSERVICESHARED_EXPORT QWebHostCache
+{
+public:
+    // Qt caches lookups for a minute, too.
+    enum { DefaultTimeToLive = 60000 };
+
+    static bool isFresh(const QString &hostName);
+    static void insert(const QHostInfo &info);
+    static void clear();
+
+    static int timeToLive();
+    static void setTimeToLive(int msecs);
+};
+
+class QWEBSERVICESHARED_EXPORT QWebConnectionWarmer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Target
+    {
+        QUrl url;
+        QString username;
+        QString password;
+    };
+
+    explicit QWebConnectionWarmer(QObject *parent = 0);
+    ~QWebConnectionWarmer();
+
+    void warm(const QList<Target> &targets, int connections);
+    int pendingLookups() const;
+    int pendingConnections() const;
+
+private slots:
+    void hostResolved(const QHostInfo &info);
+    void warmReplyFinished();
+
+private:
+    void openConnections(const Target &target, int connections);
+
+    // Targets waiting for lookup of their host, by lookup ID.
+    QHash<int, QList<Target> > lookups;
+    QHash<int, int> lookupConnections;
+    QList<QNetworkReply *> replies;
+};
+
+#endif // QWEBCONNECTIONWARMER_P_H
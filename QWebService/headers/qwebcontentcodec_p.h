@@ -0,0 +1,61 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBCONTENTCODEC_P_H
+#define QWEBCONTENTCODEC_P_H
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qstring.h>
+#include "QWebService_global.h"
+
+struct z_stream_s;
+
+class QWEBSERVICESHARED_EXPORT QWebContentCodec
+{
+public:
+    enum Encoding
+    {
+        Identity    = 0,
+        Gzip        = 1,
+        Deflate     = 2
+    };
+
+    QWebContentCodec();
+    ~QWebContentCodec();
+
+    static Encoding encoding(const QByteArray &contentEncoding);
+    static QByteArray gzip(const QByteArray &data);
+
+    void begin(Encoding encoding);
+    bool inflate(const QByteArray &input, QByteArray *output);
+    bool finish();
+    void end();
+
+    Encoding encoding() const;
+    QString errorString() const;
+
+private:
+    Q_DISABLE_COPY(QWebContentCodec)
+    bool initStream(const QByteArray &input);
+
+    Encoding m_encoding;
+    z_stream_s *stream;
+    bool streamEnded;
+    QString m_errorString;
+};
+
+#endif // QWEBCONTENTCODEC_P_H
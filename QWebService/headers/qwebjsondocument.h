@@ -0,0 +1,52 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBJSONDOCUMENT_H
+#define QWEBJSONDOCUMENT_H
+
+#include <QtCore/qshareddata.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qvariant.h>
+#include "QWebService_global.h"
+
+class QWebJsonDocumentData;
+
+class QWEBSERVICESHARED_EXPORT QWebJsonDocument
+{
+public:
+    QWebJsonDocument();
+    explicit QWebJsonDocument(const QByteArray &json);
+    QWebJsonDocument(const QWebJsonDocument &other);
+    QWebJsonDocument &operator=(const QWebJsonDocument &other);
+    ~QWebJsonDocument();
+
+    bool isValid() const;
+    QString errorString() const;
+    QByteArray data() const;
+
+    bool contains(const QString &path) const;
+    QVariant value(const QString &path) const;
+    QVariant toVariant() const;
+
+    static QVariant parse(const QByteArray &json, QString *errorString = 0);
+
+private:
+    QSharedDataPointer<QWebJsonDocumentData> d;
+};
+
+#endif // QWEBJSONDOCUMENT_H
@@ -0,0 +1,46 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBJSONDOCUMENT_P_H
+#define QWEBJSONDOCUMENT_P_H
+
+#include <QtCore/qshareddata.h>
+#include <QtCore/qvector.h>
+#include "qwebjsondocument.h"
+
+class QWebJsonDocumentData : public QSharedData
+{
+public:
+    QWebJsonDocumentData() {}
+
+    void index();
+    int find(const QString &path) const;
+    int skip(int token) const;
+    QVariant materialize(int *token, int depth, QString *errorString) const;
+    bool readString(int position, QString *result) const;
+    bool readScalar(int position, QVariant *result) const;
+
+    QByteArray json;
+    // Stage 1 result: positions of structural characters ({}[]:,) and of
+    // the first characters of strings, numbers and literals.
+    QVector<int> tokens;
+    // Index of the closing token of every opening one, -1 for the others.
+    QVector<int> closing;
+    QString errorString;
+};
+
+#endif // QWEBJSONDOCUMENT_P_H
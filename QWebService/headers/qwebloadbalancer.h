@@ -0,0 +1,64 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBLOADBALANCER_H
+#define QWEBLOADBALANCER_H
+
+#include <QtCore/qurl.h>
+#include <QtCore/qlist.h>
+#include "QWebService_global.h"
+
+class QWebLoadBalancerPrivate;
+
+class QWEBSERVICESHARED_EXPORT QWebLoadBalancer
+{
+public:
+    enum Strategy
+    {
+        RoundRobin          = 0,
+        LeastOutstanding    = 1,
+        PowerOfTwoChoices   = 2
+    };
+
+    explicit QWebLoadBalancer(Strategy strategy = RoundRobin);
+    explicit QWebLoadBalancer(const QList<QUrl> &endpoints, Strategy strategy = RoundRobin);
+    virtual ~QWebLoadBalancer();
+
+    Strategy strategy() const;
+    void setStrategy(Strategy strategy);
+    QList<QUrl> endpoints() const;
+    void setEndpoints(const QList<QUrl> &endpoints);
+
+    QUrl acquire();
+    void release(const QUrl &endpoint, int latency, bool failed = false);
+
+    int outstanding(const QUrl &endpoint) const;
+    double latency(const QUrl &endpoint) const;
+
+protected:
+    virtual int choose(const QList<int> &candidates);
+    int outstanding(int endpointIndex) const;
+    double latency(int endpointIndex) const;
+
+    QWebLoadBalancerPrivate *d_ptr;
+
+private:
+    Q_DISABLE_COPY(QWebLoadBalancer)
+    Q_DECLARE_PRIVATE(QWebLoadBalancer)
+};
+
+#endif // QWEBLOADBALANCER_H
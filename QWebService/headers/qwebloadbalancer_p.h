@@ -0,0 +1,53 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBLOADBALANCER_P_H
+#define QWEBLOADBALANCER_P_H
+
+#include <QtCore/qvector.h>
+#include <QtCore/qmutex.h>
+#include "qwebloadbalancer.h"
+
+class QWebEndpoint
+{
+public:
+    QWebEndpoint() : outstanding(0), latency(0), measured(false) {}
+
+    QUrl url;
+    int outstanding;
+    // Exponentially weighted moving average (in milliseconds).
+    double latency;
+    bool measured;
+};
+
+class QWebLoadBalancerPrivate
+{
+public:
+    // Weight of the newest latency sample in the moving average.
+    static const double LatencyWeight;
+    // Added to latency of failed calls (in milliseconds).
+    enum { FailurePenalty = 1000 };
+
+    int indexOf(const QUrl &endpoint) const;
+
+    mutable QMutex mutex;
+    QWebLoadBalancer::Strategy strategy;
+    QVector<QWebEndpoint> endpoints;
+    uint nextIndex;
+};
+
+#endif // QWEBLOADBALANCER_P_H
@@ -28,9 +28,16 @@
 #include <QtCore/qvariant.h>
 #include <QtCore/qmap.h>
 #include <QtCore/qbytearray.h>
+#include <QtCore/qiodevice.h>
 #include <QtCore/qdatetime.h>
 #include <QtCore/qcoreapplication.h>
 #include "QWebService_global.h"
+#include "qwebmethodcall.h"
+#include "qwebretrypolicy.h"
+#include "qwebcircuitbreaker.h"
+#include "qwebratelimit.h"
+#include "qwebresponsecache.h"
+#include "qwebjsondocument.h"
 
 class QWebMethodPrivate;
 
@@ -115,8 +122,57 @@ public:
     void setHttpMethod(HttpMethod method);
     bool setHttpMethod(const QString &newMethod);
 
-    Q_INVOKABLE bool invokeMethod(const QByteArray &requestData = QByteArray());
+    bool isStreamingEnabled() const;
+    void setStreamingEnabled(bool enabled);
+    QIODevice *streamDevice() const;
+    void setStreamDevice(QIODevice *device);
+    qint64 replySpillThreshold() const;
+    void setReplySpillThreshold(qint64 bytes);
+
+    bool isCompressionEnabled() const;
+    void setCompressionEnabled(bool enabled);
+    int compressionThreshold() const;
+    void setCompressionThreshold(int bytes);
+
+    qint64 requestBytes() const;
+    qint64 requestBytesSent() const;
+    qint64 replyBytes() const;
+    qint64 replyBytesReceived() const;
+    void resetByteCounters();
+
+    int timeout() const;
+    void setTimeout(int msecs);
+    Q_INVOKABLE void cancelAll();
+
+    QWebRetryPolicy retryPolicy() const;
+    void setRetryPolicy(const QWebRetryPolicy &policy);
+    bool isIdempotent() const;
+    void setIdempotent(bool idempotent);
+    bool isCircuitBreakerEnabled() const;
+    void setCircuitBreakerEnabled(bool enabled);
+    QWebRateLimit rateLimit() const;
+    void setRateLimit(const QWebRateLimit &limit);
+    bool isHedgingEnabled() const;
+    void setHedgingEnabled(bool enabled);
+    int hedgingDelay() const;
+    void setHedgingDelay(int msecs);
+    int hedgingBudget() const;
+    void setHedgingBudget(int percent);
+    QUrl hedgingHost() const;
+    void setHedgingHost(const QUrl &hostUrl);
+    int hedgedRequests() const;
+    int hedgesWon() const;
+    int latencyPercentile(int percentile) const;
+    int cacheTimeToLive() const;
+    void setCacheTimeToLive(int msecs);
+    bool isCoalescingEnabled() const;
+    void setCoalescingEnabled(bool enabled);
+    int coalescedCalls() const;
+
+    Q_INVOKABLE QWebMethodCall *invokeMethod(const QByteArray &requestData = QByteArray());
+    QWebMethodCall *invokeMethod(QIODevice *parameterData);
     QVariant replyReadParsed();
+    QWebJsonDocument replyReadJson();
     QByteArray replyReadRaw();
     Q_INVOKABLE QString replyRead();
 
@@ -126,6 +182,7 @@ public:
 
 signals:
     void replyReady(const QByteArray &reply);
+    void replyChunkReady(const QByteArray &chunk);
     void errorEncountered(const QString &errMessage);
 
     // For QObject properties:
@@ -140,6 +197,7 @@ signals:
 protected slots:
     void replyFinished(QNetworkReply *reply);
     void authReplyFinished(QNetworkReply *reply);
+    void authReplyFinished();
     void authenticationSlot(QNetworkReply *reply, QAuthenticator *authenticator);
 
 protected:
@@ -149,6 +207,11 @@ protected:
     QWebMethodPrivate *d_ptr;
 
 private:
+    friend class QWebMethodCall;
+    friend class QWebMethodCallPrivate;
+    friend class QWebServicePrivate;
+    friend class QWebWorker;
+    friend class QWebWorkerPool;
     Q_DECLARE_PRIVATE(QWebMethod)
 };
 
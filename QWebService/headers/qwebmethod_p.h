@@ -28,7 +28,17 @@
 #include <QtCore/qvariant.h>
 #include <QtCore/qmap.h>
 #include <QtCore/qbytearray.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qvector.h>
+#include <QtCore/qpointer.h>
+#include <QtCore/qsharedpointer.h>
 #include "qwebmethod.h"
+#include "qwebmethodcall_p.h"
+#include "qwebcontentcodec_p.h"
+#include "qwebratelimit_p.h"
+#include "qwebresponsecache_p.h"
+#include "qwebloadbalancer.h"
+#include "qwebnetworkmanagerpool_p.h"
 
 class QWebMethodPrivate
 {
@@ -39,9 +49,44 @@ public:
     QWebMethodPrivate(QWebMethod *q) : q_ptr(q) {}
     QWebMethod *q_ptr;
 
+    // Used by all blocking operations (in milliseconds).
+    enum { DefaultTimeout = 30000 };
+    // Smaller request bodies are not worth compressing (in bytes).
+    enum { DefaultCompressionThreshold = 1024 };
+    // Percent of requests that can be duplicated by hedging.
+    enum { DefaultHedgingBudget = 10 };
+    // Latencies of recent calls kept for percentiles, and the least
+    // number of them that gives a meaningful percentile.
+    enum { LatencySamples = 100, MinLatencySamples = 20 };
+    // Settings that a web service can set for all its methods.
+    enum Setting
+    {
+        CompressionSetting    = 0x1,
+        RetryPolicySetting    = 0x2,
+        CircuitBreakerSetting = 0x4,
+        CoalescingSetting     = 0x8
+    };
+
+    static bool waitForSignal(QObject *sender, const char *signal, int msecs);
+
     void init();
+    void copySettings(const QWebMethodPrivate *other);
+    QNetworkAccessManager *networkManager();
+    bool beginInvocation(QNetworkRequest *request);
+    QWebMethodCall *startCall(QWebMethodCall *call, const QByteArray &flightKey);
+    bool send(QWebMethodCall *call);
+    bool retry(QWebMethodCall *call);
+    QList<QSharedPointer<QWebTokenBucket> > rateLimitBuckets(const QUrl &host) const;
+    bool admit(QWebMethodCall *call);
+    bool admitNow(const QUrl &host);
+    QNetworkReply *sendRequest(QWebMethodCall *call, const QNetworkRequest &request);
+    int hedgeDelay() const;
+    bool hedge(QWebMethodCall *call);
+    void recordLatency(int msecs);
     void prepareRequestData();
-    QString convertReplyToUtf(const QString &textToConvert);
+    void compileTemplate();
+    void invalidateTemplate();
+    static QString convertReplyToUtf(const QString &textToConvert);
     bool enterErrorState(const QString &errMessage = QString());
 
     bool errorState;
@@ -58,10 +103,69 @@ public:
     QString m_username;
     QString m_password;
     QByteArray reply;
+    // Holds the file of a spilled reply mapped (see QWebReplyBuffer).
+    QWebReplyMapping replyMapping;
+    // Replies bigger than this are moved to a temporary file, 0 means never.
+    qint64 replySpillThreshold;
+    bool streaming;
+    // Owned by the user.
+    QPointer<QIODevice> streamDevice;
+    bool compression;
+    int compressionThreshold;
+    // Timeout of new calls (in milliseconds), 0 means none.
+    int timeout;
+    QWebRetryPolicy retryPolicy;
+    bool idempotent;
+    // Whether idempotent has been set explicitly.
+    bool idempotentSet;
+    bool circuitBreaker;
+    // Settings set explicitly on this method (see Setting), the web
+    // service does not override them.
+    int explicitSettings;
+    // Rate limits of this method, and of its web service (shared).
+    QSharedPointer<QWebTokenBucket> rateLimitBucket;
+    QSharedPointer<QWebTokenBucket> serviceRateLimitBucket;
+    // Set by the web service, when it has several endpoints.
+    QSharedPointer<QWebLoadBalancer> loadBalancer;
+    bool hedging;
+    // 0 means: use 95th percentile of recent latencies.
+    int hedgingDelay;
+    int hedgingBudget;
+    QUrl hedgingHost;
+    int requestsSent;
+    int hedgedRequests;
+    int hedgesWon;
+    // Ring buffer of latencies of recent successful calls (in milliseconds).
+    QVector<int> latencies;
+    int latencyIndex;
+    // Replies are cached for this long (in milliseconds), 0 means never.
+    int cacheTimeToLive;
+    bool coalescing;
+    int coalescedCalls;
+    // Byte counters, see QWebMethod::requestBytes().
+    qint64 requestBytes;
+    qint64 requestBytesSent;
+    qint64 replyBytes;
+    qint64 replyBytesReceived;
     QMap<QString, QVariant> parameters;
     QMap<QString, QVariant> returnValue;
+    // Shared, owned by QWebNetworkManagerPool.
     QNetworkAccessManager *manager;
+    QNetworkReply *authenticationReply;
+    // Calls waiting for their replies.
+    QHash<QNetworkReply *, QWebMethodCall *> calls;
+    // Coalesced calls, waiting for replies of identical calls.
+    QList<QWebMethodCall *> waitingCalls;
     QByteArray data;
+    // Constant parts of requests, made by compileTemplate().
+    bool templateValid;
+    QNetworkRequest requestTemplate;
+    QByteArray bodyPrefix;
+    QByteArray bodySuffix;
+    // Body made for the last parameters, reused while they do not change.
+    bool memoValid;
+    QMap<QString, QVariant> memoParameters;
+    QByteArray memoData;
 };
 
 #endif // QWEBMETHOD_P_H
@@ -0,0 +1,104 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBMETHODCALL_H
+#define QWEBMETHODCALL_H
+
+#include <QtNetwork/qnetworkreply.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qbytearray.h>
+#include "QWebService_global.h"
+
+class QWebMethod;
+class QWebMethodCallPrivate;
+
+class QWEBSERVICESHARED_EXPORT QWebMethodCall : public QObject
+{
+    Q_OBJECT
+    Q_ENUMS(Error)
+
+public:
+    enum Error
+    {
+        NoError          = 0,
+        NetworkError     = 1,
+        TimeoutError     = 2,
+        DeviceError      = 3,
+        DecodingError    = 4,
+        CancelledError   = 5,
+        CircuitOpenError = 6,
+        RateLimitedError = 7
+    };
+
+    ~QWebMethodCall();
+
+    int requestId() const;
+    QWebMethod *method() const;
+    QNetworkReply *networkReply() const;
+    QByteArray requestData() const;
+
+    bool autoDelete() const;
+    void setAutoDelete(bool autoDelete);
+
+    Q_INVOKABLE QByteArray replyReadRaw() const;
+    Q_INVOKABLE QString replyRead() const;
+
+    Q_INVOKABLE bool isFinished() const;
+    Q_INVOKABLE bool isErrorState() const;
+    Error error() const;
+    Q_INVOKABLE QString errorInfo() const;
+
+    int attempts() const;
+
+    int timeout() const;
+    void setTimeout(int msecs);
+
+    Q_INVOKABLE bool waitForFinished(int msecs = 30000);
+
+public slots:
+    void abort();
+
+signals:
+    void replyReady(const QByteArray &reply);
+    void chunkReady(const QByteArray &chunk);
+    void errorEncountered(const QString &errMessage);
+    void finished();
+
+protected:
+    QWebMethodCallPrivate *d_ptr;
+
+private slots:
+    void networkReplyFinished();
+    void networkReplyReadyRead();
+    void deadlineExpired();
+    void sendDelayExpired();
+    void pendingErrorReady();
+    void pendingReplyReady();
+    void hedgeDelayExpired();
+    void hedgeReplyFinished();
+
+private:
+    QWebMethodCall(QWebMethod *method, const QByteArray &requestData);
+
+    friend class QWebMethod;
+    friend class QWebBatch;
+    friend class QWebWorker;
+    Q_DECLARE_PRIVATE(QWebMethodCall)
+};
+
+#endif // QWEBMETHODCALL_H
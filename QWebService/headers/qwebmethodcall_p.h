@@ -0,0 +1,143 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBMETHODCALL_P_H
+#define QWEBMETHODCALL_P_H
+
+#include <QtNetwork/qnetworkreply.h>
+#include <QtNetwork/qnetworkrequest.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qiodevice.h>
+#include <QtCore/qpointer.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qsharedpointer.h>
+#include "qwebmethodcall.h"
+#include "qwebcontentcodec_p.h"
+#include "qwebtimerqueue_p.h"
+#include "qwebcircuitbreaker_p.h"
+#include "qwebratelimit_p.h"
+#include "qwebloadbalancer.h"
+#include "qwebuploaddevice_p.h"
+#include "qwebreplybuffer_p.h"
+#include "qwebmethod.h"
+
+class QWebMethodCallPrivate
+{
+    Q_DECLARE_PUBLIC(QWebMethodCall)
+
+public:
+    QWebMethodCallPrivate(QWebMethodCall *q) : q_ptr(q) {}
+    QWebMethodCall *q_ptr;
+
+    void init(QWebMethod *method, const QByteArray &requestData);
+    void setNetworkReply(QNetworkReply *reply);
+    void setStreaming(QIODevice *device);
+    void setDecodingEnabled(bool enabled);
+    void readChunk();
+    bool finishDecoding();
+    void startTimer(int msecs);
+    void stopTimer();
+    void scheduleSend(int msecs);
+    void scheduleRetry(int msecs);
+    void refundTokens();
+    void startHedgeTimer(int msecs);
+    void setHedgeReply(QNetworkReply *reply);
+    void promoteHedge();
+    void stopHedging();
+    void failLater(QWebMethodCall::Error code, const QString &errMessage);
+    void finishLater(const QByteArray &replyData);
+    void deliver(const QByteArray &replyData);
+    static void finishFollowers(const QList<QPointer<QWebMethodCall> > &waiting,
+                                const QByteArray &replyData, const QWebReplyMapping &mapping,
+                                QWebMethodCall::Error code, const QString &errMessage);
+    static void promoteFollower(const QList<QPointer<QWebMethodCall> > &waiting,
+                                const QByteArray &key);
+    static QWebMethodCall *flightLeader(const QByteArray &key);
+    void startFlight(const QByteArray &key);
+    void endFlight();
+    void acquireCircuit(const QString &key);
+    void releaseCircuit(QWebCircuitBreakerPrivate::Result result);
+    void acquireEndpoint(const QSharedPointer<QWebLoadBalancer> &balancer);
+    void releaseEndpoint(QWebCircuitBreakerPrivate::Result result);
+    bool takeReply();
+    void finish(const QByteArray &replyData);
+    void abort(QWebMethodCall::Error errorCode, const QString &errMessage);
+    bool enterErrorState(QWebMethodCall::Error errorCode,
+                         const QString &errMessage = QString());
+
+    int requestId;
+    bool finished;
+    bool autoDelete;
+    QWebMethodCall::Error errorCode;
+    QString errorMessage;
+    QWebMethod *method;
+    QNetworkReply *networkReply;
+    QByteArray requestData;
+    QByteArray reply;
+    // Body collected as it arrives, and the file the reply is mapped from,
+    // when it has been spilled (see QWebMethod::setReplySpillThreshold()).
+    QWebReplyBuffer replyBuffer;
+    QWebReplyMapping replyMapping;
+    bool streaming;
+    QPointer<QIODevice> streamDevice;
+    bool decoding;
+    bool decodingStarted;
+    QWebContentCodec codec;
+    int timeout;
+    // Deadline in QWebTimerQueue, 0 when there is none.
+    int timerId;
+    // Everything needed to send the request again.
+    QNetworkRequest request;
+    QByteArray body;
+    // Body read from a device (see QWebMethod::invokeMethod(QIODevice *)),
+    // child of the call, or 0.
+    QWebUploadDevice *upload;
+    QWebMethod::HttpMethod httpMethod;
+    int attempts;
+    int retryDelay;
+    int sendTimerId;
+    bool chunksDelivered;
+    // Bookkeeping of the current attempt (circuit breaker, latency).
+    QString circuitKey;
+    bool circuitAcquired;
+    qint64 sentAt;
+    // Endpoint of the current attempt, chosen by the load balancer.
+    QSharedPointer<QWebLoadBalancer> balancer;
+    QUrl endpoint;
+    // Duplicate request, racing the original one (see QWebMethod::setHedgingEnabled()).
+    QNetworkReply *hedgeReply;
+    int hedgeTimerId;
+    // Rate limit tokens taken by a request waiting for its turn.
+    bool admitted;
+    QList<QSharedPointer<QWebTokenBucket> > reservedTokens;
+    QWebMethodCall::Error pendingError;
+    QString pendingErrorMessage;
+    // Reply taken from QWebResponseCache, delivered by finishLater().
+    QByteArray pendingReply;
+    // Key in QWebResponseCache, empty when the reply is not cached.
+    QByteArray cacheKey;
+    // Identical calls waiting for the reply of this one (see
+    // QWebMethod::setCoalescingEnabled()), and their key.
+    QList<QPointer<QWebMethodCall> > followers;
+    QByteArray flightKey;
+    // True while the call waits for an identical one, and is listed
+    // in QWebMethodPrivate::waitingCalls.
+    bool following;
+};
+
+#endif // QWEBMETHODCALL_P_H
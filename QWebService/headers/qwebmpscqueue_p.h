@@ -0,0 +1,100 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBMPSCQUEUE_P_H
+#define QWEBMPSCQUEUE_P_H
+
+#include <QtCore/qatomic.h>
+
+/*!
+    \class QWebMpscQueue
+    \internal
+    \brief Lock-free, unbounded queue with many producers and one consumer.
+
+    Any thread can enqueue() values, only one thread at a time can
+    dequeue() them. Producers never wait for each other, nor for the consumer:
+    enqueuing is a single atomic exchange. Based on the intrusive queue
+    by Dmitry Vyukov, with a stub node, so that the queue is never empty
+    internally.
+
+    dequeue() can miss a value that is being enqueued at the same moment;
+    it is returned by the next dequeue(). Producers should wake the consumer
+    up after enqueue() returns (see QWebWorker::enqueue()).
+  */
+template <typename T>
+class QWebMpscQueue
+{
+public:
+    QWebMpscQueue() : tail(new Node)
+    {
+        head = tail;
+    }
+
+    ~QWebMpscQueue()
+    {
+        T value;
+        while (dequeue(&value)) {}
+        delete tail;
+    }
+
+    // Can be called from any thread.
+    void enqueue(const T &value)
+    {
+        Node *node = new Node(value);
+        Node *previous = head.fetchAndStoreOrdered(node);
+        previous->next.fetchAndStoreRelease(node);
+    }
+
+    // Can be called from the consumer thread only.
+    bool dequeue(T *value)
+    {
+        Node *next = tail->next.fetchAndAddAcquire(0);
+        if (!next)
+            return false;
+
+        *value = next->value;
+        next->value = T();
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+    // Can be called from the consumer thread only.
+    bool isEmpty() const
+    {
+        return (tail->next.fetchAndAddAcquire(0) == 0);
+    }
+
+private:
+    Q_DISABLE_COPY(QWebMpscQueue)
+
+    struct Node
+    {
+        Node() : next(0) {}
+        explicit Node(const T &nodeValue) : next(0), value(nodeValue) {}
+
+        QAtomicPointer<Node> next;
+        T value;
+    };
+
+    // Last enqueued node, shared by producers.
+    QAtomicPointer<Node> head;
+    // Stub node, owned by the consumer. Its successor is the first value.
+    Node *tail;
+};
+
+#endif // QWEBMPSCQUEUE_P_H
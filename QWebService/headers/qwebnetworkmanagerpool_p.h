@@ -0,0 +1,50 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBNETWORKMANAGERPOOL_P_H
+#define QWEBNETWORKMANAGERPOOL_P_H
+
+#include <QtNetwork/qnetworkaccessmanager.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qurl.h>
+#include <QtCore/qhash.h>
+#include "QWebService_global.h"
+
+class QWebNetworkManagerPoolData
+{
+public:
+    QWebNetworkManagerPoolData() {}
+    ~QWebNetworkManagerPoolData();
+
+    QHash<QString, QNetworkAccessManager *> managers;
+};
+
+class QWEBSERVICESHARED_EXPORT QWebNetworkManagerPool
+{
+public:
+    static QNetworkAccessManager *manager(const QUrl &hostUrl,
+                                          const QString &username = QString(),
+                                          const QString &password = QString());
+    static int count();
+
+private:
+    static QString key(const QUrl &hostUrl, const QString &username,
+                       const QString &password);
+    static QWebNetworkManagerPoolData *localData();
+};
+
+#endif // QWEBNETWORKMANAGERPOOL_P_H
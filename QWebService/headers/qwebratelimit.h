@@ -0,0 +1,52 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBRATELIMIT_H
+#define QWEBRATELIMIT_H
+
+#include <QtCore/qshareddata.h>
+#include <QtCore/qurl.h>
+#include "QWebService_global.h"
+
+class QWebRateLimitData;
+
+class QWEBSERVICESHARED_EXPORT QWebRateLimit
+{
+public:
+    QWebRateLimit();
+    explicit QWebRateLimit(double callsPerSecond, int burst = 1, int maxDelay = -1);
+    QWebRateLimit(const QWebRateLimit &other);
+    QWebRateLimit &operator=(const QWebRateLimit &other);
+    ~QWebRateLimit();
+
+    bool isEnabled() const;
+
+    double callsPerSecond() const;
+    void setCallsPerSecond(double rate);
+    int burst() const;
+    void setBurst(int calls);
+    int maxDelay() const;
+    void setMaxDelay(int msecs);
+
+    static QWebRateLimit hostLimit(const QUrl &host);
+    static void setHostLimit(const QUrl &host, const QWebRateLimit &limit);
+
+private:
+    QSharedDataPointer<QWebRateLimitData> d;
+};
+
+#endif // QWEBRATELIMIT_H
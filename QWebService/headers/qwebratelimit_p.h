@@ -0,0 +1,56 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBRATELIMIT_P_H
+#define QWEBRATELIMIT_P_H
+
+#include <QtCore/qshareddata.h>
+#include <QtCore/qsharedpointer.h>
+#include <QtCore/qmutex.h>
+#include "qwebratelimit.h"
+
+class QWebRateLimitData : public QSharedData
+{
+public:
+    QWebRateLimitData() : callsPerSecond(0), burst(1), maxDelay(-1) {}
+
+    double callsPerSecond;
+    int burst;
+    int maxDelay;
+};
+
+class QWEBSERVICESHARED_EXPORT QWebTokenBucket
+{
+public:
+    explicit QWebTokenBucket(const QWebRateLimit &limit);
+
+    QWebRateLimit limit() const;
+    int reserve();
+    void refund();
+
+    static QSharedPointer<QWebTokenBucket> hostBucket(const QUrl &host);
+
+private:
+    Q_DISABLE_COPY(QWebTokenBucket)
+
+    mutable QMutex mutex;
+    QWebRateLimit m_limit;
+    double tokens;
+    qint64 lastRefill;
+};
+
+#endif // QWEBRATELIMIT_P_H
@@ -0,0 +1,58 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBREPLYBUFFER_P_H
+#define QWEBREPLYBUFFER_P_H
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qsharedpointer.h>
+#include <QtCore/qtemporaryfile.h>
+#include "QWebService_global.h"
+
+// Keeps a spilled reply mapped, for as long as any holder exists.
+typedef QSharedPointer<QTemporaryFile> QWebReplyMapping;
+
+class QWEBSERVICESHARED_EXPORT QWebReplyBuffer
+{
+public:
+    explicit QWebReplyBuffer(qint64 spillThreshold = 0);
+
+    qint64 spillThreshold() const;
+    void setSpillThreshold(qint64 bytes);
+
+    bool append(const QByteArray &chunk);
+    bool take(QByteArray *data, QWebReplyMapping *mapping);
+    void clear();
+    static QByteArray detached(const QByteArray &data, const QWebReplyMapping &mapping);
+
+    qint64 size() const;
+    bool isSpilled() const;
+    QString errorString() const;
+
+private:
+    Q_DISABLE_COPY(QWebReplyBuffer)
+    bool spill();
+
+    qint64 m_spillThreshold;
+    QByteArray memory;
+    QWebReplyMapping file;
+    qint64 m_size;
+    QString m_errorString;
+};
+
+#endif // QWEBREPLYBUFFER_P_H
@@ -0,0 +1,45 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBREPLYDECODER_P_H
+#define QWEBREPLYDECODER_P_H
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qvariant.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qxmlstream.h>
+#include "QWebService_global.h"
+
+class QWEBSERVICESHARED_EXPORT QWebReplyDecoder
+{
+public:
+    static QVariant decode(const QByteArray &reply, const QString &targetNamespace,
+                           const QMap<QString, QVariant> &returnValue,
+                           QString *errorString = 0);
+    static QVariant convert(const QString &text, const QVariant &type);
+
+private:
+    QWebReplyDecoder();
+    static bool isNil(const QXmlStreamReader &reader);
+    static QVariant readElement(QXmlStreamReader &reader);
+    static QVariant readTyped(QXmlStreamReader &reader, const QVariant &type);
+    static void insertValue(QVariantMap *values, const QString &name,
+                            const QVariant &value, bool array);
+};
+
+#endif // QWEBREPLYDECODER_P_H
@@ -0,0 +1,63 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBREQUESTWRITER_P_H
+#define QWEBREQUESTWRITER_P_H
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qvariant.h>
+#include <QtCore/qmap.h>
+#include "QWebService_global.h"
+#include "qwebmethod.h"
+
+class QWEBSERVICESHARED_EXPORT QWebRequestWriter
+{
+public:
+    enum Escaping
+    {
+        NoEscaping      = 0,
+        XmlEscaping     = 1,
+        JsonEscaping    = 2,
+        FormEscaping    = 3
+    };
+
+    static QByteArray write(QWebMethod::Protocol protocol, const QString &methodName,
+                            const QString &targetNamespace,
+                            const QMap<QString, QVariant> &parameters);
+
+    static QByteArray prefix(QWebMethod::Protocol protocol, const QString &methodName,
+                             const QString &targetNamespace);
+    static QByteArray suffix(QWebMethod::Protocol protocol, const QString &methodName);
+    static int parametersSize(QWebMethod::Protocol protocol,
+                              const QMap<QString, QVariant> &parameters);
+    static char *writeParameters(char *out, QWebMethod::Protocol protocol,
+                                 const QMap<QString, QVariant> &parameters);
+
+    static int utf8Size(const QString &text, Escaping escaping);
+    static char *writeUtf8(char *out, const QString &text, Escaping escaping);
+    static QByteArray toUtf8(const QString &text, Escaping escaping);
+
+    static int jsonSize(const QVariant &value);
+    static char *writeJson(char *out, const QVariant &value);
+    static QByteArray toJson(const QVariant &value);
+
+private:
+    QWebRequestWriter();
+};
+
+#endif // QWEBREQUESTWRITER_P_H
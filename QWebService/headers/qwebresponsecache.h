@@ -0,0 +1,45 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBRESPONSECACHE_H
+#define QWEBRESPONSECACHE_H
+
+#include "QWebService_global.h"
+
+class QWEBSERVICESHARED_EXPORT QWebResponseCache
+{
+public:
+    enum { DefaultMaxSize = 4 * 1024 * 1024 };
+
+    static int maxSize();
+    static void setMaxSize(int bytes);
+    static bool isCompressionEnabled();
+    static void setCompressionEnabled(bool enabled);
+
+    static int count();
+    static int size();
+    static void clear();
+
+    static int hits();
+    static int misses();
+    static void resetCounters();
+
+private:
+    QWebResponseCache();
+};
+
+#endif // QWEBRESPONSECACHE_H
@@ -0,0 +1,52 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBRESPONSECACHE_P_H
+#define QWEBRESPONSECACHE_P_H
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qurl.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qvariant.h>
+#include "qwebresponsecache.h"
+#include "qwebmethod.h"
+
+class QWebCachedResponse
+{
+public:
+    QWebCachedResponse() : compressed(false), expiresAt(0) {}
+
+    QByteArray body;
+    bool compressed;
+    qint64 expiresAt;
+};
+
+class QWEBSERVICESHARED_EXPORT QWebResponseCachePrivate
+{
+public:
+    static QByteArray key(const QUrl &host, QWebMethod::Protocol protocol,
+                          QWebMethod::HttpMethod httpMethod,
+                          const QString &username, const QString &password,
+                          const QString &methodName, const QString &targetNamespace,
+                          const QMap<QString, QVariant> &parameters,
+                          const QByteArray &requestData);
+    static bool lookup(const QByteArray &key, QByteArray *reply);
+    static void insert(const QByteArray &key, const QByteArray &reply, int timeToLive);
+};
+
+#endif // QWEBRESPONSECACHE_P_H
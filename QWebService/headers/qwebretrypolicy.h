@@ -0,0 +1,59 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBRETRYPOLICY_H
+#define QWEBRETRYPOLICY_H
+
+#include <QtNetwork/qnetworkreply.h>
+#include <QtCore/qshareddata.h>
+#include <QtCore/qlist.h>
+#include "QWebService_global.h"
+
+class QWebRetryPolicyData;
+
+class QWEBSERVICESHARED_EXPORT QWebRetryPolicy
+{
+public:
+    QWebRetryPolicy();
+    explicit QWebRetryPolicy(int maxAttempts, int baseDelay = 100,
+                             int maxDelay = 10000);
+    QWebRetryPolicy(const QWebRetryPolicy &other);
+    QWebRetryPolicy &operator=(const QWebRetryPolicy &other);
+    ~QWebRetryPolicy();
+
+    bool isEnabled() const;
+
+    int maxAttempts() const;
+    void setMaxAttempts(int attempts);
+    int baseDelay() const;
+    void setBaseDelay(int msecs);
+    int maxDelay() const;
+    void setMaxDelay(int msecs);
+
+    QList<QNetworkReply::NetworkError> retryErrors() const;
+    void setRetryErrors(const QList<QNetworkReply::NetworkError> &errors);
+    QList<int> retryStatusCodes() const;
+    void setRetryStatusCodes(const QList<int> &statusCodes);
+
+    bool shouldRetry(QNetworkReply::NetworkError error, int httpStatus) const;
+    int nextDelay(int previousDelay) const;
+
+private:
+    QSharedDataPointer<QWebRetryPolicyData> d;
+};
+
+#endif // QWEBRETRYPOLICY_H
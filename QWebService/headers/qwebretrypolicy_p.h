@@ -0,0 +1,38 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBRETRYPOLICY_P_H
+#define QWEBRETRYPOLICY_P_H
+
+#include <QtCore/qshareddata.h>
+#include "qwebretrypolicy.h"
+
+class QWebRetryPolicyData : public QSharedData
+{
+public:
+    QWebRetryPolicyData();
+
+    static int randomBetween(int low, int high);
+
+    int maxAttempts;
+    int baseDelay;
+    int maxDelay;
+    QList<QNetworkReply::NetworkError> retryErrors;
+    QList<int> retryStatusCodes;
+};
+
+#endif // QWEBRETRYPOLICY_P_H
@@ -22,6 +22,8 @@
 #include "QWebService_global.h"
 #include "qwebmethod.h"
 #include "qwsdl.h"
+#include "qwebloadbalancer.h"
+#include "qwebbatch.h"
 
 class QWebServicePrivate;
 
@@ -54,7 +56,11 @@ public:
     void addMethod(const QString &methodName, QWebMethod *newMethod);
     void removeMethod(const QString &methodName);
     Q_INVOKABLE bool invokeMethod(const QString &methodName, const QByteArray &data = 0);
+    QWebBatch *invokeBatch(const QList<QWebBatchItem> &items,
+                           int maxConcurrent = QWebBatch::DefaultConcurrency,
+                           QWebBatch::Order order = QWebBatch::Unordered);
     Q_INVOKABLE QString replyRead(const QString &methodName);
+    Q_INVOKABLE void cancelAll(const QString &methodName = QString());
 
     QUrl hostUrl() const;
     QString host() const;
@@ -65,6 +71,27 @@ public:
     Q_INVOKABLE void setWsdl(QWsdl *newWsdl);
     void resetWsdl(QWsdl *newWsdl = 0);
 
+    bool isCompressionEnabled() const;
+    void setCompressionEnabled(bool enabled);
+    QWebRetryPolicy retryPolicy() const;
+    void setRetryPolicy(const QWebRetryPolicy &policy);
+    bool isCircuitBreakerEnabled() const;
+    void setCircuitBreakerEnabled(bool enabled);
+    bool isCoalescingEnabled() const;
+    void setCoalescingEnabled(bool enabled);
+    QWebRateLimit rateLimit() const;
+    void setRateLimit(const QWebRateLimit &limit);
+    QWebLoadBalancer *loadBalancer() const;
+    void setLoadBalancer(QWebLoadBalancer *balancer);
+    int warmConnections() const;
+    void setWarmConnections(int connections);
+    Q_INVOKABLE void warmUp();
+    int workerThreads() const;
+    void setWorkerThreads(int count);
+    int submit(const QString &methodName, const QMap<QString, QVariant> &parameters,
+               QObject *receiver, const char *member,
+               const QByteArray &data = QByteArray());
+
     bool isErrorState();
     QString errorInfo() const;
 
@@ -21,6 +21,9 @@
 #include "qwebservice.h"
 #include "qwebmethod.h"
 #include "qwsdl.h"
+#include "qwebratelimit_p.h"
+#include "qwebconnectionwarmer_p.h"
+#include "qwebworkerpool_p.h"
 
 class QWebServicePrivate
 {
@@ -28,11 +31,21 @@ class QWebServicePrivate
     Q_DECLARE_PUBLIC(QWebService)
 
 public:
-    QWebServicePrivate() {}
-    QWebServicePrivate(QWebService *q) : q_ptr(q) {}
+    QWebServicePrivate() :
+        compression(false), circuitBreaker(false), coalescing(false),
+        explicitSettings(0), wsdlEndpoints(false), warmConnections(0), warmer(0),
+        workerPool(0) {}
+    QWebServicePrivate(QWebService *q) :
+        q_ptr(q), compression(false), circuitBreaker(false), coalescing(false),
+        explicitSettings(0), wsdlEndpoints(false), warmConnections(0), warmer(0),
+        workerPool(0) {}
     QWebService *q_ptr;
 
     void init();
+    void applySettings(QWebMethod *method);
+    void updateEndpoints();
+    QList<QUrl> wsdlUrls() const;
+    void warmUp(int connections);
     bool enterErrorState(const QString &errMessage = QString());
 
     bool errorState;
@@ -42,6 +55,24 @@ public:
     QWsdl *wsdl;
     // This is general, but should work for custom classes.
     QMap<QString, QWebMethod *> *methods;
+    bool compression;
+    QWebRetryPolicy retryPolicy;
+    bool circuitBreaker;
+    bool coalescing;
+    // Settings set explicitly on the service (see QWebMethodPrivate::Setting),
+    // only these are pushed to its methods.
+    int explicitSettings;
+    // Shared by all methods of the service.
+    QSharedPointer<QWebTokenBucket> rateLimitBucket;
+    // Shared by all methods of the service, and by their calls in flight.
+    QSharedPointer<QWebLoadBalancer> loadBalancer;
+    // Whether endpoints of the balancer have been taken from WSDL.
+    bool wsdlEndpoints;
+    int warmConnections;
+    // Created when needed, child of the web service.
+    QWebConnectionWarmer *warmer;
+    // Worker threads, 0 when methods run in the thread of the service.
+    QWebWorkerPool *workerPool;
 };
 
 #endif // QWEBSERVICE_P_H
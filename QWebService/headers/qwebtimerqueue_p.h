@@ -0,0 +1,66 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBTIMERQUEUE_P_H
+#define QWEBTIMERQUEUE_P_H
+
+#include <QtCore/qobject.h>
+#include <QtCore/qbasictimer.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qpointer.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qmap.h>
+#include "QWebService_global.h"
+
+class QWEBSERVICESHARED_EXPORT QWebTimerQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    static QWebTimerQueue *instance();
+
+    int schedule(int msecs, QObject *receiver, const char *member);
+    bool cancel(int id);
+    int count() const;
+    qint64 now() const;
+
+protected:
+    void timerEvent(QTimerEvent *event);
+
+private:
+    QWebTimerQueue();
+    void restartTimer();
+
+    struct Entry
+    {
+        qint64 deadline;
+        QPointer<QObject> receiver;
+        QByteArray member;
+    };
+
+    // Sorted by deadline, values are entry ids.
+    QMultiMap<qint64, int> deadlines;
+    QHash<int, Entry> entries;
+    QBasicTimer timer;
+    // Deadline the timer is currently set for, or -1.
+    qint64 timerDeadline;
+    QElapsedTimer clock;
+    int lastId;
+};
+
+#endif // QWEBTIMERQUEUE_P_H
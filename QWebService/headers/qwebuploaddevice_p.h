@@ -0,0 +1,57 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBUPLOADDEVICE_P_H
+#define QWEBUPLOADDEVICE_P_H
+
+#include <QtCore/qiodevice.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qpointer.h>
+#include "QWebService_global.h"
+
+class QWEBSERVICESHARED_EXPORT QWebUploadDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    QWebUploadDevice(const QByteArray &head, QIODevice *content, const QByteArray &tail,
+                     QObject *parent = 0);
+
+    bool isSequential() const;
+    qint64 size() const;
+    bool seek(qint64 pos);
+    bool atEnd() const;
+    qint64 bytesAvailable() const;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 maxSize);
+
+private:
+    QByteArray m_head;
+    QPointer<QIODevice> m_content;
+    // Position of the content device when this device was opened.
+    qint64 contentStart;
+    QByteArray m_tail;
+    // Read position, in the whole request body.
+    qint64 offset;
+    // Bytes of content read so far (for sequential content).
+    qint64 contentRead;
+    bool contentEnded;
+};
+
+#endif // QWEBUPLOADDEVICE_P_H
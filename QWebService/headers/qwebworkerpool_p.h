@@ -0,0 +1,107 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QWEBWORKERPOOL_P_H
+#define QWEBWORKERPOOL_P_H
+
+#include <QtCore/qobject.h>
+#include <QtCore/qthread.h>
+#include <QtCore/qatomic.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qvariant.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qsharedpointer.h>
+#include <QtCore/qmutex.h>
+#include "qwebmpscqueue_p.h"
+#include "qwebmethod.h"
+
+class QWebMethodPrivate;
+
+class QWebInvocation
+{
+public:
+    QWebInvocation() : requestId(0), receiver(0) {}
+
+    int requestId;
+    // Copy of settings of the submitted web method, published by the thread
+    // of the web service (see QWebWorkerPool::publish()). Workers only read
+    // it, the method itself is never touched by them.
+    QSharedPointer<const QWebMethodPrivate> settings;
+    QMap<QString, QVariant> parameters;
+    QByteArray data;
+    QObject *receiver;
+    QByteArray member;
+};
+
+class QWEBSERVICESHARED_EXPORT QWebWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    QWebWorker();
+    ~QWebWorker();
+
+    void enqueue(QWebInvocation *invocation);
+
+public slots:
+    void drain();
+    void shutdown();
+
+private slots:
+    void callFinished();
+
+private:
+    QWebMethod *methodFor(const QWebInvocation *invocation);
+    void deliver(QWebInvocation *invocation, const QByteArray &reply,
+                 const QString &errorInfo);
+
+    QWebMpscQueue<QWebInvocation *> queue;
+    // 1 when drain() has been posted, and has not started yet.
+    QAtomicInt wakeUpPending;
+    // Copies of web methods by their names, living in the worker thread.
+    QHash<QString, QWebMethod *> clones;
+    QHash<QWebMethodCall *, QWebInvocation *> running;
+};
+
+class QWEBSERVICESHARED_EXPORT QWebWorkerPool
+{
+public:
+    explicit QWebWorkerPool(int threadCount);
+    ~QWebWorkerPool();
+
+    int threadCount() const;
+    void publish(const QString &methodName, QWebMethod *method);
+    void unpublishAll();
+    int submit(const QString &methodName, const QMap<QString, QVariant> &parameters,
+               const QByteArray &data, QObject *receiver, const char *member);
+
+private:
+    Q_DISABLE_COPY(QWebWorkerPool)
+
+    // Settings of web methods by their names in the web service. The lock
+    // is only held to copy a pointer.
+    QMutex settingsMutex;
+    QHash<QString, QSharedPointer<const QWebMethodPrivate> > settings;
+
+    QList<QThread *> threads;
+    QList<QWebWorker *> workers;
+    QAtomicInt nextWorker;
+};
+
+#endif // QWEBWORKERPOOL_P_H
@@ -55,6 +55,9 @@ public:
     QString webServiceName() const;
     QString host() const;
     QUrl hostUrl() const;    
+    QList<QUrl> hostUrls() const;
+    QList<QUrl> hostUrls(QWebMethod::Protocol protocol,
+                         QWebMethod::HttpMethod httpMethod = QWebMethod::Post) const;
     QString targetNamespace() const;
 
     QString errorInfo() const;
@@ -23,8 +23,12 @@
 #include <QtCore/qmap.h>
 #include <QtCore/qstring.h>
 #include <QtCore/qstringlist.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qpair.h>
 #include <QtCore/qdatetime.h>
 #include "qwebservicemethod.h"
+#include "qwebnetworkmanagerpool_p.h"
+#include "qwebmethod_p.h"
 #include "qwsdl.h"
 
 class QWsdlPrivate
@@ -54,6 +58,14 @@ public:
     bool errorState;
     bool replyReceived;
     QUrl m_hostUrl;
+    // Addresses of all service ports, in order of appearance.
+    QList<QUrl> m_hostUrls;
+    // Address of each port, with its binding: "soap", "soap12", the verb
+    // of an HTTP binding ("GET", "POST"), or "http" when it is unknown.
+    QList<QPair<QUrl, QString> > m_ports;
+    // Verbs of HTTP bindings, by binding name.
+    QHash<QString, QString> bindingVerbs;
+    QString currentBinding;
     QString errorMessage;
     QString m_wsdlFilePath;
     QString m_webServiceName;
@@ -0,0 +1,357 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <QtCore/qtimer.h>
+#include "../headers/qwebbatch_p.h"
+#include "../headers/qwebmethod_p.h"
+
+/*!
+    \class QWebBatch
+    \brief Runs a list of web method calls, with bounded concurrency.
+
+    Batches are created by QWebService::invokeBatch(). Each item of a batch
+    names a web method of the service, and parameters to call it with.
+    At most maxConcurrent() calls of a batch are in flight at the same time;
+    whenever one of them finishes, the next item is invoked. This keeps
+    a large number of lookups from flooding the host (and the connection
+    pool of QNetworkAccessManager), without serializing them:
+    \code
+    QList<QWebBatchItem> items;
+    foreach (const QString &band, bands) {
+        QMap<QString, QVariant> params;
+        params.insert("bandName", band);
+        items.append(qMakePair(QString("getBandDescription"), params));
+    }
+
+    QWebBatch *batch = service->invokeBatch(items, 8);
+    connect(batch, SIGNAL(itemFinished(int,QByteArray,QString)),
+            this, SLOT(descriptionReady(int,QByteArray,QString)));
+    connect(batch, SIGNAL(finished()), batch, SLOT(deleteLater()));
+    \endcode
+
+    itemFinished() is emitted for every item, and finished() once, after all
+    items are done. With QWebBatch::Ordered, items are reported in the order
+    they have been given in, even if their replies come in a different one.
+
+    Calls are started when control returns to the event loop, so signals
+    can be connected right after the batch is created. A batch is a child
+    of its web service. Replies and errors of all items are kept
+    until the batch is deleted.
+  */
+
+/*!
+    \enum QWebBatch::Order
+
+    Order, in which results of the items are reported.
+
+    \value Unordered
+           Each item is reported as soon as it finishes (default).
+    \value Ordered
+           Items are reported in the order of the list given to
+           QWebService::invokeBatch(). Finished items wait for all
+           items before them.
+  */
+
+/*!
+    \fn QWebBatch::itemFinished(int index, const QByteArray &reply, const QString &errorInfo)
+
+    Signal emitted when item at \a index has finished, with its \a reply.
+    If the item has failed, \a errorInfo describes the error.
+  */
+
+/*!
+    \fn QWebBatch::finished()
+
+    Signal emitted when all items of the batch are finished (and reported).
+  */
+
+/*!
+    \internal
+
+    Constructs a batch of \a items, run by \a service, with at most
+    \a maxConcurrent calls at a time, reported in \a order.
+  */
+QWebBatch::QWebBatch(QWebService *service, const QList<QWebBatchItem> &items,
+                     int maxConcurrent, Order order) :
+    QObject(service), d_ptr(new QWebBatchPrivate(this))
+{
+    Q_D(QWebBatch);
+    d->service = service;
+    d->items = items;
+    d->maxConcurrent = qMax(maxConcurrent, 1);
+    d->order = order;
+    d->done.fill(false, items.size());
+    d->replies.resize(items.size());
+    d->errors.resize(items.size());
+
+    QTimer::singleShot(0, this, SLOT(start()));
+}
+
+/*!
+    Destroys the batch. Calls still in progress are aborted.
+  */
+QWebBatch::~QWebBatch()
+{
+    Q_D(QWebBatch);
+    QList<QObject *> calls = d->running.keys();
+    d->running.clear();
+    foreach (QObject *call, calls) {
+        call->disconnect(this);
+        static_cast<QWebMethodCall *>(call)->abort();
+    }
+
+    delete d_ptr;
+}
+
+/*!
+    Returns number of items in the batch.
+  */
+int QWebBatch::size() const
+{
+    Q_D(const QWebBatch);
+    return d->items.size();
+}
+
+/*!
+    Returns maximal number of calls the batch runs at the same time.
+  */
+int QWebBatch::maxConcurrent() const
+{
+    Q_D(const QWebBatch);
+    return d->maxConcurrent;
+}
+
+/*!
+    Returns the order, in which items are reported.
+  */
+QWebBatch::Order QWebBatch::order() const
+{
+    Q_D(const QWebBatch);
+    return d->order;
+}
+
+/*!
+    Returns number of calls of this batch, that are in progress now.
+  */
+int QWebBatch::runningCount() const
+{
+    Q_D(const QWebBatch);
+    return d->running.size();
+}
+
+/*!
+    Returns number of items, that are finished (including failed ones).
+  */
+int QWebBatch::finishedCount() const
+{
+    Q_D(const QWebBatch);
+    return d->finishedCount;
+}
+
+/*!
+    Returns number of items, that have failed.
+  */
+int QWebBatch::errorCount() const
+{
+    Q_D(const QWebBatch);
+    return d->errorCount;
+}
+
+/*!
+    Returns true if all items are finished.
+  */
+bool QWebBatch::isFinished() const
+{
+    Q_D(const QWebBatch);
+    return (d->finishedCount == d->items.size());
+}
+
+/*!
+    Returns reply of item at \a index, or an empty array if it has not
+    finished yet.
+  */
+QByteArray QWebBatch::reply(int index) const
+{
+    Q_D(const QWebBatch);
+    return d->replies.value(index);
+}
+
+/*!
+    Returns error information of item at \a index, or an empty string
+    if it has not failed.
+  */
+QString QWebBatch::errorInfo(int index) const
+{
+    Q_D(const QWebBatch);
+    return d->errors.value(index);
+}
+
+/*!
+    Blocks until all items are finished, or until \a msecs milliseconds have
+    passed (-1 means no time limit). Waiting is done in a local event loop.
+    Returns true if the batch has finished in time; calls still running
+    are not aborted otherwise.
+  */
+bool QWebBatch::waitForFinished(int msecs)
+{
+    if (isFinished())
+        return true;
+
+    QPointer<QWebBatch> guard(this);
+    QWebMethodPrivate::waitForSignal(this, SIGNAL(finished()), msecs);
+    return !guard.isNull() && isFinished();
+}
+
+/*!
+    Cancels the batch. Items that have not been started yet fail without
+    being sent, and calls in progress are aborted. itemFinished() is still
+    emitted for all of them, followed by finished().
+  */
+void QWebBatch::abort()
+{
+    Q_D(QWebBatch);
+    const QString message(QLatin1String("Batch has been cancelled."));
+    while (d->nextItem < d->items.size())
+        d->complete(d->nextItem++, QByteArray(), message);
+
+    // Aborted calls emit finished(), which completes their items.
+    foreach (QObject *call, d->running.keys())
+        static_cast<QWebMethodCall *>(call)->abort();
+}
+
+/*!
+    \internal
+
+    Private slot, starts first calls of the batch.
+  */
+void QWebBatch::start()
+{
+    Q_D(QWebBatch);
+    if (d->items.isEmpty()) {
+        emit finished();
+        return;
+    }
+
+    d->startCalls();
+}
+
+/*!
+    \internal
+
+    Private slot, connected to QWebMethodCall::finished() of the calls
+    of this batch. Completes the item, and invokes the next one.
+  */
+void QWebBatch::callFinished()
+{
+    Q_D(QWebBatch);
+    QWebMethodCall *call = qobject_cast<QWebMethodCall *>(sender());
+    if (!call || !d->running.contains(call))
+        return;
+
+    int index = d->running.take(call);
+    d->complete(index, call->replyReadRaw(),
+                call->isErrorState() ? call->errorInfo() : QString());
+    d->startCalls();
+}
+
+/*!
+    \internal
+
+    Private slot, completes item of a \a call, which has been deleted
+    before it finished (for example, together with its web method).
+  */
+void QWebBatch::callDestroyed(QObject *call)
+{
+    Q_D(QWebBatch);
+    if (!d->running.contains(call))
+        return;
+
+    d->complete(d->running.take(call), QByteArray(),
+                QLatin1String("Call has been deleted."));
+    d->startCalls();
+}
+
+/*!
+    \internal
+
+    Invokes items, until the concurrency limit is reached.
+  */
+void QWebBatchPrivate::startCalls()
+{
+    Q_Q(QWebBatch);
+    while ((running.size() < maxConcurrent) && (nextItem < items.size())) {
+        int index = nextItem++;
+        const QWebBatchItem &item = items.at(index);
+        QWebMethod *method = service ? service->method(item.first) : 0;
+        if (!method) {
+            complete(index, QByteArray(), QLatin1String("Web method ")
+                     + item.first + QLatin1String(" does not exist."));
+            continue;
+        }
+
+        // Request data is prepared right away, so parameters of the method
+        // are restored as soon as the item is invoked. Empty parameters are
+        // set as well, or those of the method would be sent.
+        QMap<QString, QVariant> previous = method->parameterNamesTypes();
+        bool swapped = (item.second != previous);
+        if (swapped)
+            method->setParameters(item.second);
+        QWebMethodCall *call = method->invokeMethod();
+        if (swapped)
+            method->setParameters(previous);
+        if (!call) {
+            complete(index, QByteArray(), method->errorInfo());
+            continue;
+        }
+
+        running.insert(call, index);
+        QObject::connect(call, SIGNAL(finished()), q, SLOT(callFinished()));
+        QObject::connect(call, SIGNAL(destroyed(QObject*)),
+                         q, SLOT(callDestroyed(QObject*)));
+    }
+}
+
+/*!
+    \internal
+
+    Stores result (\a reply and \a errorInfo) of item at \a index, and reports
+    all items that can be reported now.
+  */
+void QWebBatchPrivate::complete(int index, const QByteArray &reply,
+                                const QString &errorInfo)
+{
+    Q_Q(QWebBatch);
+    done[index] = true;
+    replies[index] = reply;
+    errors[index] = errorInfo;
+    ++finishedCount;
+    if (!errorInfo.isEmpty())
+        ++errorCount;
+
+    if (order == QWebBatch::Unordered) {
+        emit q->itemFinished(index, reply, errorInfo);
+    } else {
+        while ((nextReported < items.size()) && done.at(nextReported)) {
+            emit q->itemFinished(nextReported, replies.at(nextReported),
+                                 errors.at(nextReported));
+            ++nextReported;
+        }
+    }
+
+    if (finishedCount == items.size())
+        emit q->finished();
+}
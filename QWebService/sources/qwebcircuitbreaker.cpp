@@ -0,0 +1,307 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "../headers/qwebcircuitbreaker_p.h"
+#include "../headers/qwebclock_p.h"
+
+/*!
+    \class QWebCircuitBreaker
+    \brief Stops sending requests to hosts that keep failing.
+
+    When a server goes down, every new request still opens a connection
+    and waits for a timeout, tying up sockets and the code waiting for
+    the replies. Circuit breaker watches recent calls made to each host
+    (identified by scheme, host name and port), and when too many of them
+    fail, or are too slow, it opens the circuit: further calls to that host
+    fail immediately, with QWebMethodCall::CircuitOpenError.
+
+    After Settings::openDuration, the circuit becomes half-open, and lets
+    a few trial calls through. If they succeed, the circuit is closed again,
+    otherwise it opens for another period.
+
+    Breaker is shared by all web methods of the process, but it is used only
+    by methods that have it enabled (see QWebMethod::setCircuitBreakerEnabled()
+    and QWebService::setCircuitBreakerEnabled()).
+
+    Server errors (HTTP 5xx), connection problems and timeouts count as
+    failures. Client errors (HTTP 4xx) and cancelled calls do not.
+  */
+
+/*!
+    \enum QWebCircuitBreaker::State
+
+    \value Closed
+           Calls are sent normally.
+    \value Open
+           Calls fail immediately.
+    \value HalfOpen
+           A limited number of trial calls is sent, to check whether
+           the host has recovered.
+  */
+
+/*!
+    \class QWebCircuitBreaker::Settings
+    \brief Thresholds used by QWebCircuitBreaker.
+
+    \list
+        \o windowSize - number of recent calls taken into account (20),
+        \o minimumCalls - number of calls needed to make a decision (10),
+        \o failureRateThreshold - percentage of failed calls that opens
+           the circuit (50),
+        \o slowCallThreshold - duration (in milliseconds) above which
+           a call is slow, 0 turns slow call detection off (0),
+        \o slowCallRateThreshold - percentage of slow calls that opens
+           the circuit (100),
+        \o openDuration - time (in milliseconds) the circuit stays open (5000),
+        \o halfOpenCalls - number of trial calls in half-open state (1).
+    \endlist
+  */
+
+/*!
+    Constructs default settings.
+  */
+QWebCircuitBreaker::Settings::Settings() :
+    windowSize(20), minimumCalls(10), failureRateThreshold(50),
+    slowCallThreshold(0), slowCallRateThreshold(100), openDuration(5000),
+    halfOpenCalls(1)
+{
+}
+
+/*!
+    \internal
+
+    Registry of circuits of all hosts, shared by all threads.
+  */
+class QWebCircuitBreakerRegistry
+{
+public:
+    QMutex mutex;
+    QWebCircuitBreaker::Settings settings;
+    QHash<QString, QWebHostCircuit> circuits;
+};
+
+Q_GLOBAL_STATIC(QWebCircuitBreakerRegistry, breakerRegistry)
+
+/*!
+    \internal
+
+    Constructs a closed circuit.
+  */
+QWebHostCircuit::QWebHostCircuit() :
+    state(QWebCircuitBreaker::Closed), windowIndex(0), windowCount(0),
+    failures(0), slowCalls(0), openedAt(0), halfOpenInFlight(0),
+    halfOpenSuccesses(0)
+{
+}
+
+/*!
+    \internal
+
+    Adds result of a call (\a failed, \a slow) to the window,
+    replacing the oldest one when the window is full.
+  */
+void QWebHostCircuit::record(bool failed, bool slow)
+{
+    if (window.isEmpty())
+        return;
+
+    if (windowCount == window.size()) {
+        quint8 oldest = window.at(windowIndex);
+        failures -= (oldest & 0x1);
+        slowCalls -= ((oldest >> 1) & 0x1);
+    } else {
+        windowCount++;
+    }
+
+    window[windowIndex] = quint8((failed ? 0x1 : 0) | (slow ? 0x2 : 0));
+    windowIndex = (windowIndex + 1) % window.size();
+    failures += (failed ? 1 : 0);
+    slowCalls += (slow ? 1 : 0);
+}
+
+/*!
+    \internal
+
+    Forgets all recorded calls.
+  */
+void QWebHostCircuit::clearWindow()
+{
+    window.fill(0);
+    windowIndex = 0;
+    windowCount = 0;
+    failures = 0;
+    slowCalls = 0;
+}
+
+/*!
+    Returns current settings.
+  */
+QWebCircuitBreaker::Settings QWebCircuitBreaker::settings()
+{
+    QWebCircuitBreakerRegistry *registry = breakerRegistry();
+    QMutexLocker locker(&registry->mutex);
+    return registry->settings;
+}
+
+/*!
+    Sets new \a settings. All circuits are reset.
+  */
+void QWebCircuitBreaker::setSettings(const Settings &settings)
+{
+    QWebCircuitBreakerRegistry *registry = breakerRegistry();
+    QMutexLocker locker(&registry->mutex);
+    registry->settings = settings;
+    registry->circuits.clear();
+}
+
+/*!
+    Returns state of the circuit of \a host. Open circuit, whose open
+    period has passed, is reported as half-open.
+  */
+QWebCircuitBreaker::State QWebCircuitBreaker::state(const QUrl &host)
+{
+    QString hostKey = QWebCircuitBreakerPrivate::key(host);
+    QWebCircuitBreakerRegistry *registry = breakerRegistry();
+    QMutexLocker locker(&registry->mutex);
+
+    if (!registry->circuits.contains(hostKey))
+        return Closed;
+
+    const QWebHostCircuit &circuit = registry->circuits[hostKey];
+    if ((circuit.state == Open)
+            && (QWebClock::now() - circuit.openedAt >= registry->settings.openDuration)) {
+        return HalfOpen;
+    }
+
+    return circuit.state;
+}
+
+/*!
+    Closes the circuit of \a host, and forgets its history. When \a host
+    is empty, all circuits are reset.
+  */
+void QWebCircuitBreaker::reset(const QUrl &host)
+{
+    QWebCircuitBreakerRegistry *registry = breakerRegistry();
+    QMutexLocker locker(&registry->mutex);
+
+    if (host.isEmpty())
+        registry->circuits.clear();
+    else
+        registry->circuits.remove(QWebCircuitBreakerPrivate::key(host));
+}
+
+/*!
+    \internal
+
+    Returns key of the circuit of \a host.
+  */
+QString QWebCircuitBreakerPrivate::key(const QUrl &host)
+{
+    return host.scheme().toLower() + QLatin1String("://")
+            + host.host().toLower() + QLatin1Char(':')
+            + QString::number(host.port());
+}
+
+/*!
+    \internal
+
+    Asks for permission to send a request to host with \a key. Returns false
+    if the circuit is open. When true is returned, release() has to be
+    called once the request is done.
+  */
+bool QWebCircuitBreakerPrivate::acquire(const QString &key)
+{
+    QWebCircuitBreakerRegistry *registry = breakerRegistry();
+    QMutexLocker locker(&registry->mutex);
+
+    QHash<QString, QWebHostCircuit>::iterator i = registry->circuits.find(key);
+    if (i == registry->circuits.end())
+        return true;
+
+    QWebHostCircuit &circuit = i.value();
+    if (circuit.state == QWebCircuitBreaker::Open) {
+        if (QWebClock::now() - circuit.openedAt < registry->settings.openDuration)
+            return false;
+
+        circuit.state = QWebCircuitBreaker::HalfOpen;
+        circuit.halfOpenInFlight = 0;
+        circuit.halfOpenSuccesses = 0;
+    }
+
+    if (circuit.state == QWebCircuitBreaker::HalfOpen) {
+        if (circuit.halfOpenInFlight >= registry->settings.halfOpenCalls)
+            return false;
+
+        circuit.halfOpenInFlight++;
+    }
+
+    return true;
+}
+
+/*!
+    \internal
+
+    Records \a result of a request to host with \a key, that took \a latency
+    milliseconds, and changes the state of the circuit when needed.
+  */
+void QWebCircuitBreakerPrivate::release(const QString &key, Result result, qint64 latency)
+{
+    QWebCircuitBreakerRegistry *registry = breakerRegistry();
+    QMutexLocker locker(&registry->mutex);
+    const QWebCircuitBreaker::Settings &settings = registry->settings;
+
+    QWebHostCircuit &circuit = registry->circuits[key];
+    if (circuit.window.size() != settings.windowSize) {
+        circuit.window.resize(qMax(settings.windowSize, 1));
+        circuit.clearWindow();
+    }
+
+    bool failed = (result == Failure);
+    bool slow = (settings.slowCallThreshold > 0) && (latency >= settings.slowCallThreshold);
+
+    if (circuit.state == QWebCircuitBreaker::HalfOpen) {
+        circuit.halfOpenInFlight = qMax(circuit.halfOpenInFlight - 1, 0);
+        if (result == Ignored)
+            return;
+
+        if (failed || slow) {
+            circuit.state = QWebCircuitBreaker::Open;
+            circuit.openedAt = QWebClock::now();
+        } else if (++circuit.halfOpenSuccesses >= settings.halfOpenCalls) {
+            circuit.state = QWebCircuitBreaker::Closed;
+            circuit.clearWindow();
+        }
+        return;
+    }
+
+    // Late replies of calls sent before the circuit has opened are ignored.
+    if ((result == Ignored) || (circuit.state == QWebCircuitBreaker::Open))
+        return;
+
+    circuit.record(failed, slow);
+    if (circuit.windowCount < settings.minimumCalls)
+        return;
+
+    if ((circuit.failures * 100 >= settings.failureRateThreshold * circuit.windowCount)
+            || ((settings.slowCallThreshold > 0)
+                && (circuit.slowCalls * 100 >= settings.slowCallRateThreshold * circuit.windowCount))) {
+        circuit.state = QWebCircuitBreaker::Open;
+        circuit.openedAt = QWebClock::now();
+        circuit.clearWindow();
+    }
+}
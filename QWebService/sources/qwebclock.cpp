@@ -0,0 +1,49 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <QtCore/qelapsedtimer.h>
+#include "../headers/qwebclock_p.h"
+
+/*!
+    \class QWebClock
+    \internal
+    \brief Monotonic clock shared by the whole library.
+
+    Circuit breaker, rate limits, response cache, host cache and latency
+    tracking all measure time with this clock. It is started once, when
+    the library is loaded, and is read without any lock: QElapsedTimer
+    is not modified by elapsed().
+  */
+
+class QWebClockStart
+{
+public:
+    QWebClockStart() { timer.start(); }
+
+    QElapsedTimer timer;
+};
+
+static QWebClockStart clockStart;
+
+/*!
+    Returns time (in milliseconds) elapsed since the library was loaded.
+    Can be called from any thread.
+  */
+qint64 QWebClock::now()
+{
+    return clockStart.timer.elapsed();
+}
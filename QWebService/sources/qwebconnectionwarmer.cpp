@@ -0,0 +1,247 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <QtNetwork/qnetworkaccessmanager.h>
+#include <QtCore/qmutex.h>
+#include "../headers/qwebconnectionwarmer_p.h"
+#include "../headers/qwebnetworkmanagerpool_p.h"
+#include "../headers/qwebclock_p.h"
+
+/*!
+    \class QWebHostCache
+    \internal
+    \brief Process-wide throttle of host lookups made by warming.
+
+    Remembers when each host has been resolved, so that warming does not
+    look up the same host again and again: a host is looked up again only
+    when timeToLive() has passed. Addresses themselves are not kept here.
+    Lookups are done with QHostInfo, which fills Qt's own cache, and
+    QNetworkAccessManager connects to addresses from that cache (it has
+    its own, fixed, time to live of a minute).
+  */
+
+class QWebHostCacheData
+{
+public:
+    QWebHostCacheData() : timeToLive(QWebHostCache::DefaultTimeToLive) {}
+
+    QMutex mutex;
+    // Time each host has to be looked up again at, by host name.
+    QHash<QString, qint64> expires;
+    int timeToLive;
+};
+
+Q_GLOBAL_STATIC(QWebHostCacheData, hostCacheData)
+
+/*!
+    Returns true if \a hostName has been resolved, and its entry
+    has not expired yet.
+  */
+bool QWebHostCache::isFresh(const QString &hostName)
+{
+    QWebHostCacheData *data = hostCacheData();
+    qint64 now = QWebClock::now();
+    QMutexLocker locker(&data->mutex);
+    return data->expires.value(hostName.toLower(), 0) > now;
+}
+
+/*!
+    Records a lookup (\a info). Failed lookups are not recorded.
+  */
+void QWebHostCache::insert(const QHostInfo &info)
+{
+    if ((info.error() != QHostInfo::NoError) || info.addresses().isEmpty())
+        return;
+
+    QWebHostCacheData *data = hostCacheData();
+    qint64 now = QWebClock::now();
+    QMutexLocker locker(&data->mutex);
+
+    data->expires.insert(info.hostName().toLower(), now + data->timeToLive);
+}
+
+/*!
+    Forgets all resolved hosts.
+  */
+void QWebHostCache::clear()
+{
+    QWebHostCacheData *data = hostCacheData();
+    QMutexLocker locker(&data->mutex);
+    data->expires.clear();
+}
+
+/*!
+    Returns how long (in milliseconds) warming does not look up a resolved
+    host again. It does not change addresses that calls connect to.
+  */
+int QWebHostCache::timeToLive()
+{
+    QWebHostCacheData *data = hostCacheData();
+    QMutexLocker locker(&data->mutex);
+    return data->timeToLive;
+}
+
+/*!
+    Sets how long (\a msecs) warming does not look up a resolved host
+    again. Applies to hosts resolved from now on.
+  */
+void QWebHostCache::setTimeToLive(int msecs)
+{
+    QWebHostCacheData *data = hostCacheData();
+    QMutexLocker locker(&data->mutex);
+    data->timeToLive = qMax(msecs, 0);
+}
+
+/*!
+    \class QWebConnectionWarmer
+    \internal
+    \brief Resolves hosts and opens keep-alive connections in advance.
+
+    The first call to a host pays for DNS lookup, TCP connection and TLS
+    handshake. Warmer does all of that before the first call: it resolves
+    the host (unless QWebHostCache has it already), and sends HEAD requests
+    through the network manager that web methods use for that host (see
+    QWebNetworkManagerPool). Each request opens a connection, that is then
+    kept alive, and reused by the calls. QNetworkAccessManager opens at most
+    6 connections to a host.
+
+    Used by QWebService, see QWebService::setWarmConnections().
+  */
+
+/*!
+    Constructs the warmer with \a parent.
+  */
+QWebConnectionWarmer::QWebConnectionWarmer(QObject *parent) :
+    QObject(parent)
+{
+}
+
+/*!
+    Aborts lookups and requests that are still in progress.
+  */
+QWebConnectionWarmer::~QWebConnectionWarmer()
+{
+    foreach (int lookupId, lookups.keys())
+        QHostInfo::abortHostLookup(lookupId);
+
+    foreach (QNetworkReply *reply, replies) {
+        disconnect(reply, 0, this, 0);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+/*!
+    Opens \a connections connections to each of \a targets, resolving their
+    hosts first, when necessary. Targets without a network host
+    (like local files) are skipped.
+  */
+void QWebConnectionWarmer::warm(const QList<Target> &targets, int connections)
+{
+    if (connections <= 0)
+        return;
+
+    QHash<QString, QList<Target> > byHost;
+    foreach (const Target &target, targets) {
+        QString scheme = target.url.scheme().toLower();
+        if (target.url.host().isEmpty()
+                || ((scheme != QLatin1String("http")) && (scheme != QLatin1String("https")))) {
+            continue;
+        }
+
+        if (QWebHostCache::isFresh(target.url.host()))
+            openConnections(target, connections);
+        else
+            byHost[target.url.host()].append(target);
+    }
+
+    foreach (const QString &hostName, byHost.keys()) {
+        int lookupId = QHostInfo::lookupHost(hostName, this, SLOT(hostResolved(QHostInfo)));
+        lookups.insert(lookupId, byHost.value(hostName));
+        lookupConnections.insert(lookupId, connections);
+    }
+}
+
+/*!
+    Returns number of host lookups in progress.
+  */
+int QWebConnectionWarmer::pendingLookups() const
+{
+    return lookups.size();
+}
+
+/*!
+    Returns number of warming requests in progress.
+  */
+int QWebConnectionWarmer::pendingConnections() const
+{
+    return replies.size();
+}
+
+/*!
+    \internal
+
+    Stores result of the lookup (\a info), and opens connections to targets
+    that have been waiting for it. Hosts that could not be resolved are
+    skipped: calls will report the error.
+  */
+void QWebConnectionWarmer::hostResolved(const QHostInfo &info)
+{
+    QList<Target> targets = lookups.take(info.lookupId());
+    int connections = lookupConnections.take(info.lookupId());
+    if (info.error() != QHostInfo::NoError)
+        return;
+
+    QWebHostCache::insert(info);
+    foreach (const Target &target, targets)
+        openConnections(target, connections);
+}
+
+/*!
+    \internal
+
+    Discards the reply of a warming request. Its connection stays open.
+  */
+void QWebConnectionWarmer::warmReplyFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply)
+        return;
+
+    replies.removeAll(reply);
+    reply->deleteLater();
+}
+
+/*!
+    \internal
+
+    Sends \a connections HEAD requests to \a target at once, so that each
+    of them opens its own connection.
+  */
+void QWebConnectionWarmer::openConnections(const Target &target, int connections)
+{
+    QNetworkAccessManager *manager = QWebNetworkManagerPool::manager(target.url, target.username,
+                                                                     target.password);
+    QNetworkRequest request(target.url);
+    request.setOriginatingObject(this);
+
+    for (int i = 0; i < connections; ++i) {
+        QNetworkReply *reply = manager->head(request);
+        connect(reply, SIGNAL(finished()), this, SLOT(warmReplyFinished()));
+        replies.append(reply);
+    }
+}
@@ -0,0 +1,258 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <string.h>
+#include <zlib.h>
+#include "../headers/qwebcontentcodec_p.h"
+
+/*!
+    \class QWebContentCodec
+    \internal
+    \brief Compresses request bodies, and inflates compressed replies.
+
+    gzip() compresses a whole request body in one go. Replies are inflated
+    incrementally: begin() is called with encoding taken from
+    Content-Encoding header of the reply, and then inflate() is called with
+    every piece of data that arrives. This way, compressed replies can be
+    streamed (see QWebMethod::setStreamingEnabled()).
+
+    Both "gzip" and "deflate" encodings are supported. For "deflate",
+    zlib-wrapped and raw streams are accepted, as many servers send the latter.
+  */
+
+/*!
+    \enum QWebContentCodec::Encoding
+
+    \value Identity
+           Data is not compressed.
+    \value Gzip
+           Data is compressed with gzip.
+    \value Deflate
+           Data is compressed with deflate.
+  */
+
+// Size of the buffer used for a single inflate() run.
+static const int InflateBufferSize = 16384;
+
+/*!
+    Constructs an idle codec.
+  */
+QWebContentCodec::QWebContentCodec() :
+    m_encoding(Identity), stream(0), streamEnded(false)
+{
+}
+
+/*!
+    Releases the zlib stream, if any.
+  */
+QWebContentCodec::~QWebContentCodec()
+{
+    end();
+}
+
+/*!
+    Returns encoding specified by \a contentEncoding (a value of
+    Content-Encoding HTTP header). Unknown encodings are reported as
+    QWebContentCodec::Identity.
+  */
+QWebContentCodec::Encoding QWebContentCodec::encoding(const QByteArray &contentEncoding)
+{
+    QByteArray value = contentEncoding.trimmed().toLower();
+    if ((value == "gzip") || (value == "x-gzip"))
+        return Gzip;
+    else if (value == "deflate")
+        return Deflate;
+
+    return Identity;
+}
+
+/*!
+    Returns \a data compressed with gzip, or an empty array on failure.
+  */
+QByteArray QWebContentCodec::gzip(const QByteArray &data)
+{
+    z_stream deflateStream;
+    memset(&deflateStream, 0, sizeof(deflateStream));
+    // 16 added to window bits selects gzip wrapper, instead of zlib one.
+    if (deflateInit2(&deflateStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                     MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return QByteArray();
+    }
+
+    QByteArray result;
+    // deflateBound() does not include gzip header and trailer.
+    result.resize(int(deflateBound(&deflateStream, uLong(data.size()))) + 32);
+
+    deflateStream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    deflateStream.avail_in = uInt(data.size());
+    deflateStream.next_out = reinterpret_cast<Bytef *>(result.data());
+    deflateStream.avail_out = uInt(result.size());
+
+    int status = deflate(&deflateStream, Z_FINISH);
+    if (status == Z_STREAM_END)
+        result.resize(int(deflateStream.total_out));
+    else
+        result.clear();
+
+    deflateEnd(&deflateStream);
+    return result;
+}
+
+/*!
+    Prepares the codec for inflating data compressed with \a encoding.
+    Any stream that has been in progress is discarded.
+  */
+void QWebContentCodec::begin(Encoding encoding)
+{
+    end();
+    m_encoding = encoding;
+}
+
+/*!
+    Inflates \a input, and appends the result to \a output. Data with
+    QWebContentCodec::Identity encoding is appended unchanged.
+
+    Returns false when \a input is not a valid compressed stream. See
+    errorString() for details.
+  */
+bool QWebContentCodec::inflate(const QByteArray &input, QByteArray *output)
+{
+    if (m_encoding == Identity) {
+        output->append(input);
+        return true;
+    }
+
+    if (!m_errorString.isEmpty())
+        return false;
+
+    // Anything following the end of stream is ignored.
+    if (input.isEmpty() || streamEnded)
+        return true;
+
+    if (!stream && !initStream(input))
+        return false;
+
+    char buffer[InflateBufferSize];
+    stream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.constData()));
+    stream->avail_in = uInt(input.size());
+
+    do {
+        stream->next_out = reinterpret_cast<Bytef *>(buffer);
+        stream->avail_out = InflateBufferSize;
+
+        int status = ::inflate(stream, Z_NO_FLUSH);
+        if ((status == Z_NEED_DICT) || (status == Z_DATA_ERROR)
+                || (status == Z_MEM_ERROR) || (status == Z_STREAM_ERROR)) {
+            m_errorString = QString(QLatin1String("Could not inflate the reply: ")
+                                    + QLatin1String(stream->msg ? stream->msg : "unknown error"));
+            return false;
+        }
+
+        output->append(buffer, InflateBufferSize - int(stream->avail_out));
+
+        if (status == Z_STREAM_END) {
+            streamEnded = true;
+            break;
+        } else if (status == Z_BUF_ERROR) {
+            // No progress is possible until more input arrives.
+            break;
+        }
+    } while ((stream->avail_in > 0) || (stream->avail_out == 0));
+
+    return true;
+}
+
+/*!
+    Checks that the compressed stream has ended, after all input has been
+    given to inflate(). Returns false when the input ended before the stream
+    did (a reply has been cut off), or when inflating failed. See
+    errorString() for details.
+
+    Data with QWebContentCodec::Identity encoding, and empty input,
+    always end properly.
+  */
+bool QWebContentCodec::finish()
+{
+    if (!m_errorString.isEmpty())
+        return false;
+
+    if ((m_encoding == Identity) || !stream || streamEnded)
+        return true;
+
+    m_errorString = QLatin1String("Could not inflate the reply: compressed data is truncated.");
+    return false;
+}
+
+/*!
+    Releases the zlib stream, and returns the codec to idle state.
+  */
+void QWebContentCodec::end()
+{
+    if (stream) {
+        inflateEnd(stream);
+        delete stream;
+        stream = 0;
+    }
+
+    m_encoding = Identity;
+    streamEnded = false;
+    m_errorString.clear();
+}
+
+/*!
+    Returns encoding set with begin().
+  */
+QWebContentCodec::Encoding QWebContentCodec::encoding() const
+{
+    return m_encoding;
+}
+
+/*!
+    Returns description of the last error, or an empty string.
+  */
+QString QWebContentCodec::errorString() const
+{
+    return m_errorString;
+}
+
+/*!
+    \internal
+
+    Initialises zlib stream. For QWebContentCodec::Deflate encoding,
+    first byte of \a input is used to tell zlib-wrapped stream from a raw one.
+    Returns false on failure.
+  */
+bool QWebContentCodec::initStream(const QByteArray &input)
+{
+    int windowBits = MAX_WBITS + 16;
+    if (m_encoding == Deflate) {
+        uchar first = uchar(input.at(0));
+        bool zlibHeader = ((first & 0x0f) == Z_DEFLATED) && ((first >> 4) + 8 <= MAX_WBITS);
+        windowBits = zlibHeader ? MAX_WBITS : -MAX_WBITS;
+    }
+
+    stream = new z_stream;
+    memset(stream, 0, sizeof(z_stream));
+    if (inflateInit2(stream, windowBits) != Z_OK) {
+        delete stream;
+        stream = 0;
+        m_errorString = QLatin1String("Could not initialise zlib.");
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,724 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <string.h>
+#include <limits.h>
+#include "../headers/qwebjsondocument_p.h"
+
+/*!
+    \class QWebJsonDocument
+    \brief Parses JSON replies into QVariantMap and QVariantList values.
+
+    Parsing is done in two stages. First, the whole document is scanned
+    once, and positions of all structural characters (braces, brackets,
+    colons and commas) and of all values are recorded in an index; matching
+    braces and brackets are paired on the way. This scan looks at every
+    byte, but does almost nothing with most of them: text of strings,
+    the bulk of a typical reply, is skipped 8 bytes at a time. Then, values
+    are materialized from the index: strings are decoded, numbers converted,
+    and QVariantMap and QVariantList values are built.
+
+    toVariant() (or static parse()) materializes the whole document.
+    value() materializes only the value found at a path, for example
+    "items[2].name": objects and arrays on the way are walked through the
+    index, and skipped members and items are never decoded. For a big reply
+    of which only a few values are needed, this costs little more than the
+    scan itself.
+
+    \code
+    QWebJsonDocument json(method->replyReadRaw());
+    int points = json.value("member.points").toInt();
+    QVariantList posts = json.value("posts").toList();
+    \endcode
+
+    Integral numbers become int (or qlonglong, when they do not fit in int),
+    other numbers become double. null becomes invalid QVariant.
+
+    \sa QWebMethod::replyReadJson(), QWebMethod::replyReadParsed()
+  */
+
+enum CharacterClass
+{
+    ScalarCharacter = 0,
+    Whitespace      = 1,
+    Structural      = 2,
+    Quote           = 3
+};
+
+// Objects and arrays nested deeper than this are rejected, so that
+// recursion does not exhaust the stack.
+static const int MaxDepth = 512;
+
+// CharacterClass of every byte.
+static const uchar characterClasses[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+/*!
+    \internal
+
+    Returns true if any of 8 bytes of \a word is a quote or a backslash.
+  */
+static inline bool hasStringSpecial(quint64 word)
+{
+    const quint64 ones = Q_UINT64_C(0x0101010101010101);
+    const quint64 highs = Q_UINT64_C(0x8080808080808080);
+    quint64 quotes = word ^ (ones * '"');
+    quint64 backslashes = word ^ (ones * '\\');
+    return ((((quotes - ones) & ~quotes) | ((backslashes - ones) & ~backslashes)) & highs) != 0;
+}
+
+/*!
+    \internal
+
+    Returns position after the end of the string in \a data (of \a size
+    bytes), which starts at \a position (just after the opening quote),
+    or -1 if the string is not terminated.
+  */
+static int skipString(const char *data, int position, int size)
+{
+    int i = position;
+    for (;;) {
+        while (i + 8 <= size) {
+            quint64 word;
+            memcpy(&word, data + i, 8);
+            if (hasStringSpecial(word))
+                break;
+            i += 8;
+        }
+
+        while ((i < size) && (data[i] != '"') && (data[i] != '\\'))
+            ++i;
+        if (i >= size)
+            return -1;
+        if (data[i] == '"')
+            return i + 1;
+        // Escaped character.
+        i += 2;
+    }
+}
+
+/*!
+    \internal
+
+    Reads 4 hexadecimal digits from \a data (\a available bytes) into
+    \a code.
+  */
+static bool readHex(const char *data, int available, uint *code)
+{
+    if (available < 4)
+        return false;
+
+    uint result = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = data[i];
+        result <<= 4;
+        if ((c >= '0') && (c <= '9'))
+            result |= uint(c - '0');
+        else if ((c >= 'a') && (c <= 'f'))
+            result |= uint(c - 'a' + 10);
+        else if ((c >= 'A') && (c <= 'F'))
+            result |= uint(c - 'A' + 10);
+        else
+            return false;
+    }
+
+    *code = result;
+    return true;
+}
+
+/*!
+    \internal
+
+    Appends \a code point to \a utf8.
+  */
+static void appendUtf8(QByteArray *utf8, uint code)
+{
+    if (code < 0x80) {
+        utf8->append(char(code));
+    } else if (code < 0x800) {
+        utf8->append(char(0xc0 | (code >> 6)));
+        utf8->append(char(0x80 | (code & 0x3f)));
+    } else if (code < 0x10000) {
+        utf8->append(char(0xe0 | (code >> 12)));
+        utf8->append(char(0x80 | ((code >> 6) & 0x3f)));
+        utf8->append(char(0x80 | (code & 0x3f)));
+    } else {
+        utf8->append(char(0xf0 | (code >> 18)));
+        utf8->append(char(0x80 | ((code >> 12) & 0x3f)));
+        utf8->append(char(0x80 | ((code >> 6) & 0x3f)));
+        utf8->append(char(0x80 | (code & 0x3f)));
+    }
+}
+
+static inline bool isDigit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+/*!
+    \internal
+
+    Stage 1: builds the index of tokens and pairs braces and brackets.
+    Sets errorString when strings are not terminated, or braces and
+    brackets do not match.
+  */
+void QWebJsonDocumentData::index()
+{
+    const char *data = json.constData();
+    const int size = json.size();
+    QVector<int> open;
+    int i = 0;
+    while (i < size) {
+        const uchar c = uchar(data[i]);
+        switch (characterClasses[c]) {
+        case Whitespace:
+            ++i;
+            break;
+        case Quote:
+            tokens.append(i);
+            closing.append(-1);
+            i = skipString(data, i + 1, size);
+            if (i < 0) {
+                errorString = QString(QLatin1String("Unterminated string at offset %1."))
+                        .arg(tokens.last());
+                return;
+            }
+            break;
+        case Structural:
+            tokens.append(i);
+            closing.append(-1);
+            if ((c == '{') || (c == '[')) {
+                open.append(tokens.size() - 1);
+            } else if ((c == '}') || (c == ']')) {
+                char expected = (c == '}') ? '{' : '[';
+                if (open.isEmpty() || (data[tokens.at(open.last())] != expected)) {
+                    errorString = QString(QLatin1String("Unexpected '%1' at offset %2."))
+                            .arg(QLatin1Char(char(c))).arg(i);
+                    return;
+                }
+                closing[open.last()] = tokens.size() - 1;
+                open.remove(open.size() - 1);
+            }
+            ++i;
+            break;
+        default:
+            tokens.append(i);
+            closing.append(-1);
+            while ((i < size) && (characterClasses[uchar(data[i])] == ScalarCharacter))
+                ++i;
+        }
+    }
+
+    if (!open.isEmpty())
+        errorString = QLatin1String("Unterminated object or array.");
+    else if (tokens.isEmpty())
+        errorString = QLatin1String("Document is empty.");
+}
+
+/*!
+    \internal
+
+    Returns index of the token of the value at \a path, or -1 if there
+    is none.
+  */
+int QWebJsonDocumentData::find(const QString &path) const
+{
+    if (!errorString.isEmpty())
+        return -1;
+
+    const char *data = json.constData();
+    const int length = path.length();
+    int token = 0;
+    int i = 0;
+    while (i < length) {
+        if (path.at(i) == QLatin1Char('.')) {
+            ++i;
+        } else if (path.at(i) == QLatin1Char('[')) {
+            int close = path.indexOf(QLatin1Char(']'), i);
+            bool ok = false;
+            int item = (close < 0) ? -1 : path.mid(i + 1, close - i - 1).toInt(&ok);
+            if (!ok || (item < 0) || (data[tokens.at(token)] != '['))
+                return -1;
+            i = close + 1;
+
+            int end = closing.at(token);
+            int t = token + 1;
+            for (int k = 0; (k < item) && (t < end); ++k) {
+                t = skip(t);
+                if ((t >= end) || (data[tokens.at(t)] != ','))
+                    return -1;
+                ++t;
+            }
+            if (t >= end)
+                return -1;
+            token = t;
+        } else {
+            int next = i;
+            while ((next < length) && (path.at(next) != QLatin1Char('.'))
+                   && (path.at(next) != QLatin1Char('[')))
+                ++next;
+            QByteArray name = path.mid(i, next - i).toUtf8();
+            i = next;
+            if (data[tokens.at(token)] != '{')
+                return -1;
+
+            int end = closing.at(token);
+            int t = token + 1;
+            int found = -1;
+            while ((found < 0) && (t < end)) {
+                int position = tokens.at(t);
+                if ((data[position] != '"') || (t + 2 >= end)
+                        || (data[tokens.at(t + 1)] != ':')) {
+                    return -1;
+                }
+
+                // Keys without escapes are compared as they are.
+                int keyEnd = skipString(data, position + 1, json.size()) - 1;
+                int keyLength = keyEnd - position - 1;
+                if (memchr(data + position + 1, '\\', keyLength)) {
+                    QString key;
+                    if (readString(position, &key) && (key.toUtf8() == name))
+                        found = t + 2;
+                } else if ((keyLength == name.size())
+                           && (memcmp(data + position + 1, name.constData(), keyLength) == 0)) {
+                    found = t + 2;
+                }
+
+                t = skip(t + 2);
+                if ((t < end) && (data[tokens.at(t)] != ','))
+                    return -1;
+                ++t;
+            }
+            if (found < 0)
+                return -1;
+            token = found;
+        }
+    }
+
+    return token;
+}
+
+/*!
+    \internal
+
+    Returns index of the token after the value starting at \a token.
+  */
+int QWebJsonDocumentData::skip(int token) const
+{
+    int close = closing.at(token);
+    return (close >= 0) ? (close + 1) : (token + 1);
+}
+
+/*!
+    \internal
+
+    Stage 2: returns the value starting at \a token, nested \a depth levels
+    deep, and moves \a token after it. Sets \a errorString (which has to be
+    empty) when the value is not valid.
+  */
+QVariant QWebJsonDocumentData::materialize(int *token, int depth, QString *errorString) const
+{
+    const char *data = json.constData();
+    if (*token >= tokens.size()) {
+        *errorString = QLatin1String("Unexpected end of document.");
+        return QVariant();
+    }
+
+    const int position = tokens.at(*token);
+    const char c = data[position];
+    if (((c == '{') || (c == '[')) && (depth >= MaxDepth)) {
+        *errorString = QString(QLatin1String("Nesting too deep at offset %1.")).arg(position);
+        return QVariant();
+    } else if ((c == '{') || (c == '[')) {
+        const bool object = (c == '{');
+        const int end = closing.at(*token);
+        QVariantMap map;
+        QVariantList list;
+        int t = *token + 1;
+        while (t < end) {
+            QString key;
+            if (object) {
+                if ((data[tokens.at(t)] != '"') || !readString(tokens.at(t), &key)
+                        || (t + 2 >= end) || (data[tokens.at(t + 1)] != ':')) {
+                    *errorString = QString(QLatin1String("Expected member at offset %1."))
+                            .arg(tokens.at(t));
+                    return QVariant();
+                }
+                t += 2;
+            }
+
+            QVariant value = materialize(&t, depth + 1, errorString);
+            if (!errorString->isEmpty())
+                return QVariant();
+            if (object)
+                map.insert(key, value);
+            else
+                list.append(value);
+
+            if (t < end) {
+                if ((data[tokens.at(t)] != ',') || (t + 1 >= end)) {
+                    *errorString = QString(QLatin1String("Unexpected '%1' at offset %2."))
+                            .arg(QLatin1Char(data[tokens.at(t)])).arg(tokens.at(t));
+                    return QVariant();
+                }
+                ++t;
+            }
+        }
+
+        *token = end + 1;
+        if (object)
+            return map;
+        return list;
+    }
+
+    ++*token;
+    QVariant result;
+    bool ok = false;
+    if (c == '"') {
+        QString text;
+        ok = readString(position, &text);
+        result = text;
+    } else if (characterClasses[uchar(c)] == ScalarCharacter) {
+        ok = readScalar(position, &result);
+    }
+
+    if (!ok) {
+        *errorString = QString(QLatin1String("Invalid value at offset %1.")).arg(position);
+        return QVariant();
+    }
+
+    return result;
+}
+
+/*!
+    \internal
+
+    Decodes the string starting at \a position (at the opening quote) into
+    \a result. Returns false if it contains invalid escape sequences.
+  */
+bool QWebJsonDocumentData::readString(int position, QString *result) const
+{
+    const char *data = json.constData();
+    const char *begin = data + position + 1;
+    const int length = skipString(data, position + 1, json.size()) - position - 2;
+    if (!memchr(begin, '\\', length)) {
+        *result = QString::fromUtf8(begin, length);
+        return true;
+    }
+
+    QByteArray utf8;
+    utf8.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        if (begin[i] != '\\') {
+            utf8.append(begin[i]);
+            continue;
+        }
+
+        if (++i >= length)
+            return false;
+
+        switch (begin[i]) {
+        case '"':
+        case '\\':
+        case '/':
+            utf8.append(begin[i]);
+            break;
+        case 'b':
+            utf8.append('\b');
+            break;
+        case 'f':
+            utf8.append('\f');
+            break;
+        case 'n':
+            utf8.append('\n');
+            break;
+        case 'r':
+            utf8.append('\r');
+            break;
+        case 't':
+            utf8.append('\t');
+            break;
+        case 'u': {
+            uint code = 0;
+            if (!readHex(begin + i + 1, length - i - 1, &code))
+                return false;
+            i += 4;
+
+            // Surrogate pair is written as two escapes.
+            uint low = 0;
+            if ((code >= 0xd800) && (code < 0xdc00) && (i + 2 < length)
+                    && (begin[i + 1] == '\\') && (begin[i + 2] == 'u')
+                    && readHex(begin + i + 3, length - i - 3, &low)
+                    && (low >= 0xdc00) && (low < 0xe000)) {
+                code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                i += 6;
+            }
+
+            // Unpaired surrogates are replaced.
+            if ((code >= 0xd800) && (code < 0xe000))
+                code = 0xfffd;
+            appendUtf8(&utf8, code);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+
+    *result = QString::fromUtf8(utf8.constData(), utf8.size());
+    return true;
+}
+
+/*!
+    \internal
+
+    Reads the number or literal starting at \a position into \a result.
+    Returns false if it is neither.
+  */
+bool QWebJsonDocumentData::readScalar(int position, QVariant *result) const
+{
+    const char *data = json.constData();
+    const int size = json.size();
+    int end = position;
+    while ((end < size) && (characterClasses[uchar(data[end])] == ScalarCharacter))
+        ++end;
+
+    const char *p = data + position;
+    const int length = end - position;
+    if ((length == 4) && (memcmp(p, "true", 4) == 0)) {
+        *result = true;
+        return true;
+    } else if ((length == 5) && (memcmp(p, "false", 5) == 0)) {
+        *result = false;
+        return true;
+    } else if ((length == 4) && (memcmp(p, "null", 4) == 0)) {
+        *result = QVariant();
+        return true;
+    }
+
+    // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    int i = (p[0] == '-') ? 1 : 0;
+    if ((i >= length) || !isDigit(p[i])
+            || ((p[i] == '0') && (i + 1 < length) && isDigit(p[i + 1]))) {
+        return false;
+    }
+
+    // Integers of up to 18 digits always fit in qint64.
+    quint64 magnitude = 0;
+    int digits = 0;
+    for (; (i < length) && isDigit(p[i]); ++i, ++digits)
+        magnitude = magnitude * 10 + uint(p[i] - '0');
+
+    bool integral = true;
+    if ((i < length) && (p[i] == '.')) {
+        integral = false;
+        if ((++i >= length) || !isDigit(p[i]))
+            return false;
+        while ((i < length) && isDigit(p[i]))
+            ++i;
+    }
+    if ((i < length) && ((p[i] == 'e') || (p[i] == 'E'))) {
+        integral = false;
+        ++i;
+        if ((i < length) && ((p[i] == '+') || (p[i] == '-')))
+            ++i;
+        if ((i >= length) || !isDigit(p[i]))
+            return false;
+        while ((i < length) && isDigit(p[i]))
+            ++i;
+    }
+    if (i != length)
+        return false;
+
+    if (integral && (digits <= 18)) {
+        qint64 value = (p[0] == '-') ? -qint64(magnitude) : qint64(magnitude);
+        if ((value >= INT_MIN) && (value <= INT_MAX))
+            *result = int(value);
+        else
+            *result = qlonglong(value);
+        return true;
+    }
+
+    bool ok = false;
+    *result = QByteArray(p, length).toDouble(&ok);
+    return ok;
+}
+
+/*!
+    Constructs an empty, invalid document.
+  */
+QWebJsonDocument::QWebJsonDocument() :
+    d(new QWebJsonDocumentData)
+{
+    d->errorString = QLatin1String("Document is empty.");
+}
+
+/*!
+    Constructs a document from \a json (UTF-8), and indexes it. Values
+    are materialized when they are read.
+  */
+QWebJsonDocument::QWebJsonDocument(const QByteArray &json) :
+    d(new QWebJsonDocumentData)
+{
+    d->json = json;
+    d->index();
+}
+
+/*!
+    Constructs a copy of \a other. Copies share the data and the index.
+  */
+QWebJsonDocument::QWebJsonDocument(const QWebJsonDocument &other) :
+    d(other.d)
+{
+}
+
+/*!
+    Assigns \a other to this document.
+  */
+QWebJsonDocument &QWebJsonDocument::operator=(const QWebJsonDocument &other)
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+    Destroys the document.
+  */
+QWebJsonDocument::~QWebJsonDocument()
+{
+}
+
+/*!
+    Returns true if the structure of the document is valid: strings are
+    terminated, and braces and brackets match. Values themselves are checked
+    only when they are materialized, so a document can still turn out to be
+    invalid in toVariant().
+
+    \sa errorString()
+  */
+bool QWebJsonDocument::isValid() const
+{
+    return d->errorString.isEmpty();
+}
+
+/*!
+    Returns description of structural errors found in the document.
+
+    \sa isValid()
+  */
+QString QWebJsonDocument::errorString() const
+{
+    return d->errorString;
+}
+
+/*!
+    Returns JSON text of the document.
+  */
+QByteArray QWebJsonDocument::data() const
+{
+    return d->json;
+}
+
+/*!
+    Returns true if there is a value at \a path (see value()). Nothing
+    is materialized.
+  */
+bool QWebJsonDocument::contains(const QString &path) const
+{
+    return (d->find(path) >= 0);
+}
+
+/*!
+    Returns the value at \a path, or invalid QVariant if there is none,
+    or if it is not valid. Only this value is materialized.
+
+    Path is made of names of object members, separated by dots, and
+    of indexes of array items, in brackets: "posts[0].title". Empty path
+    means the whole document.
+
+    \sa toVariant()
+  */
+QVariant QWebJsonDocument::value(const QString &path) const
+{
+    int token = d->find(path);
+    if (token < 0)
+        return QVariant();
+
+    QString errorString;
+    QVariant result = d->materialize(&token, 0, &errorString);
+    if (!errorString.isEmpty())
+        return QVariant();
+    return result;
+}
+
+/*!
+    Materializes the whole document, and returns it (usually as QVariantMap
+    or QVariantList). Returns invalid QVariant if the document is not valid.
+
+    \sa parse(), value()
+  */
+QVariant QWebJsonDocument::toVariant() const
+{
+    return parse(d->json);
+}
+
+/*!
+    Parses \a json, and returns the whole document (usually as QVariantMap
+    or QVariantList). Returns invalid QVariant, and sets \a errorString,
+    if the document is not valid.
+  */
+QVariant QWebJsonDocument::parse(const QByteArray &json, QString *errorString)
+{
+    QWebJsonDocumentData data;
+    data.json = json;
+    data.index();
+
+    QVariant result;
+    QString error = data.errorString;
+    if (error.isEmpty()) {
+        int token = 0;
+        result = data.materialize(&token, 0, &error);
+        if (error.isEmpty() && (token != data.tokens.size())) {
+            error = QString(QLatin1String("Unexpected data at offset %1."))
+                    .arg(data.tokens.at(token));
+        }
+    }
+
+    if (!error.isEmpty()) {
+        if (errorString)
+            *errorString = error;
+        return QVariant();
+    }
+
+    return result;
+}
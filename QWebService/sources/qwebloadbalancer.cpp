@@ -0,0 +1,327 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "../headers/qwebloadbalancer_p.h"
+#include "../headers/qwebcircuitbreaker.h"
+#include "../headers/qwebretrypolicy_p.h"
+
+/*!
+    \class QWebLoadBalancer
+    \brief Spreads calls across several endpoints of the same web service.
+
+    A web service is often run as a few replicas, and its WSDL lists
+    an address for each of them (see QWsdl::hostUrls()). QWebService sends
+    each request to the endpoint returned by acquire(), and reports the
+    result with release(), so the balancer knows how many calls are in
+    flight to each endpoint, and how fast each endpoint answers.
+
+    Endpoints with an open circuit (see QWebCircuitBreaker) are skipped,
+    unless all of them are open.
+
+    Strategies:
+    \list
+        \o RoundRobin - endpoints are used in turn,
+        \o LeastOutstanding - endpoint with the least calls in flight is used,
+        \o PowerOfTwoChoices - two random endpoints are compared, and the one
+           with lower latency (moving average, weighted by the number of calls
+           in flight) is used. It reacts to slow replicas quickly, without
+           sending all the traffic to the fastest one.
+    \endlist
+
+    Custom strategies can be written by overriding choose().
+
+    \sa QWebService::setLoadBalancer()
+  */
+
+/*!
+    \enum QWebLoadBalancer::Strategy
+
+    \value RoundRobin
+           Endpoints are used in turn.
+    \value LeastOutstanding
+           Endpoint with the least calls in flight is used.
+    \value PowerOfTwoChoices
+           Better of two random endpoints (by moving average of latency
+           and calls in flight) is used.
+  */
+
+const double QWebLoadBalancerPrivate::LatencyWeight = 0.3;
+
+/*!
+    Constructs a balancer using \a strategy, without endpoints.
+  */
+QWebLoadBalancer::QWebLoadBalancer(Strategy strategy) :
+    d_ptr(new QWebLoadBalancerPrivate)
+{
+    Q_D(QWebLoadBalancer);
+    d->strategy = strategy;
+    d->nextIndex = 0;
+}
+
+/*!
+    Constructs a balancer using \a strategy, that spreads calls across
+    \a endpoints.
+  */
+QWebLoadBalancer::QWebLoadBalancer(const QList<QUrl> &endpoints, Strategy strategy) :
+    d_ptr(new QWebLoadBalancerPrivate)
+{
+    Q_D(QWebLoadBalancer);
+    d->strategy = strategy;
+    d->nextIndex = 0;
+    setEndpoints(endpoints);
+}
+
+/*!
+    Destroys the balancer.
+  */
+QWebLoadBalancer::~QWebLoadBalancer()
+{
+    delete d_ptr;
+}
+
+/*!
+    Returns the strategy of the balancer.
+
+    \sa setStrategy()
+  */
+QWebLoadBalancer::Strategy QWebLoadBalancer::strategy() const
+{
+    Q_D(const QWebLoadBalancer);
+    QMutexLocker locker(&d->mutex);
+    return d->strategy;
+}
+
+/*!
+    Sets the \a strategy of the balancer.
+
+    \sa strategy()
+  */
+void QWebLoadBalancer::setStrategy(Strategy strategy)
+{
+    Q_D(QWebLoadBalancer);
+    QMutexLocker locker(&d->mutex);
+    d->strategy = strategy;
+}
+
+/*!
+    Returns the endpoints of the balancer.
+
+    \sa setEndpoints()
+  */
+QList<QUrl> QWebLoadBalancer::endpoints() const
+{
+    Q_D(const QWebLoadBalancer);
+    QMutexLocker locker(&d->mutex);
+    QList<QUrl> result;
+    foreach (const QWebEndpoint &endpoint, d->endpoints)
+        result.append(endpoint.url);
+    return result;
+}
+
+/*!
+    Sets the \a endpoints of the balancer. Statistics of endpoints that
+    were already known are kept.
+
+    \sa endpoints()
+  */
+void QWebLoadBalancer::setEndpoints(const QList<QUrl> &endpoints)
+{
+    Q_D(QWebLoadBalancer);
+    QMutexLocker locker(&d->mutex);
+    QVector<QWebEndpoint> updated;
+    foreach (const QUrl &url, endpoints) {
+        int index = d->indexOf(url);
+        if (index != -1) {
+            updated.append(d->endpoints.at(index));
+        } else {
+            QWebEndpoint endpoint;
+            endpoint.url = url;
+            updated.append(endpoint);
+        }
+    }
+
+    d->endpoints = updated;
+    d->nextIndex = 0;
+}
+
+/*!
+    Returns the endpoint for the next call, and counts the call as being
+    in flight. Every acquire() has to be followed by release().
+    Returns an empty URL when there are no endpoints.
+
+    \sa release()
+  */
+QUrl QWebLoadBalancer::acquire()
+{
+    Q_D(QWebLoadBalancer);
+    QMutexLocker locker(&d->mutex);
+    if (d->endpoints.isEmpty())
+        return QUrl();
+
+    QList<int> candidates;
+    for (int i = 0; i < d->endpoints.size(); ++i) {
+        if (QWebCircuitBreaker::state(d->endpoints.at(i).url) != QWebCircuitBreaker::Open)
+            candidates.append(i);
+    }
+
+    // Better to try a failing host than not to try at all.
+    if (candidates.isEmpty()) {
+        for (int i = 0; i < d->endpoints.size(); ++i)
+            candidates.append(i);
+    }
+
+    int index = choose(candidates);
+    if ((index < 0) || (index >= d->endpoints.size()))
+        index = candidates.first();
+
+    d->endpoints[index].outstanding++;
+    return d->endpoints.at(index).url;
+}
+
+/*!
+    Reports that a call to \a endpoint has finished, after \a latency
+    milliseconds. \a failed calls count as slower than they were.
+    Negative \a latency means that the call has not been measured
+    (for example, it has been cancelled).
+
+    \sa acquire()
+  */
+void QWebLoadBalancer::release(const QUrl &endpoint, int latency, bool failed)
+{
+    Q_D(QWebLoadBalancer);
+    QMutexLocker locker(&d->mutex);
+    int index = d->indexOf(endpoint);
+    if (index == -1)
+        return;
+
+    QWebEndpoint &target = d->endpoints[index];
+    target.outstanding = qMax(target.outstanding - 1, 0);
+    if (latency < 0)
+        return;
+
+    double sample = latency;
+    if (failed)
+        sample += QWebLoadBalancerPrivate::FailurePenalty;
+
+    if (!target.measured) {
+        target.latency = sample;
+        target.measured = true;
+    } else {
+        target.latency += QWebLoadBalancerPrivate::LatencyWeight * (sample - target.latency);
+    }
+}
+
+/*!
+    Returns the number of calls in flight to \a endpoint.
+  */
+int QWebLoadBalancer::outstanding(const QUrl &endpoint) const
+{
+    Q_D(const QWebLoadBalancer);
+    QMutexLocker locker(&d->mutex);
+    int index = d->indexOf(endpoint);
+    return (index == -1) ? 0 : d->endpoints.at(index).outstanding;
+}
+
+/*!
+    Returns the moving average of latency of \a endpoint (in milliseconds),
+    or 0 if no call to it has finished yet.
+  */
+double QWebLoadBalancer::latency(const QUrl &endpoint) const
+{
+    Q_D(const QWebLoadBalancer);
+    QMutexLocker locker(&d->mutex);
+    int index = d->indexOf(endpoint);
+    return (index == -1) ? 0 : d->endpoints.at(index).latency;
+}
+
+/*!
+    Returns index of the endpoint (see endpoints()) that should get
+    the next call. \a candidates holds indexes of endpoints that can be used,
+    and is never empty.
+
+    Override this method to implement a custom strategy. It is called with
+    the balancer locked, so it must not call public methods of the balancer;
+    use the protected overloads of outstanding() and latency() instead.
+  */
+int QWebLoadBalancer::choose(const QList<int> &candidates)
+{
+    Q_D(QWebLoadBalancer);
+    int count = candidates.size();
+    if (d->strategy == RoundRobin)
+        return candidates.at(int(d->nextIndex++ % uint(count)));
+
+    if (d->strategy == LeastOutstanding) {
+        // Starting point rotates, so that ties are spread evenly.
+        int start = int(d->nextIndex++ % uint(count));
+        int best = candidates.at(start);
+        for (int i = 1; i < count; ++i) {
+            int index = candidates.at((start + i) % count);
+            if (outstanding(index) < outstanding(best))
+                best = index;
+        }
+        return best;
+    }
+
+    if (count == 1)
+        return candidates.first();
+
+    int first = QWebRetryPolicyData::randomBetween(0, count - 1);
+    int second = QWebRetryPolicyData::randomBetween(0, count - 2);
+    if (second >= first)
+        ++second;
+
+    int a = candidates.at(first);
+    int b = candidates.at(second);
+    // Unmeasured endpoints cost nothing, so they get probed soon.
+    double costA = latency(a) * (outstanding(a) + 1);
+    double costB = latency(b) * (outstanding(b) + 1);
+    return (costB < costA) ? b : a;
+}
+
+/*!
+    Returns the number of calls in flight to endpoint at \a endpointIndex.
+    Does not lock the balancer, see choose().
+  */
+int QWebLoadBalancer::outstanding(int endpointIndex) const
+{
+    Q_D(const QWebLoadBalancer);
+    return d->endpoints.at(endpointIndex).outstanding;
+}
+
+/*!
+    Returns the moving average of latency of endpoint at \a endpointIndex.
+    Does not lock the balancer, see choose().
+  */
+double QWebLoadBalancer::latency(int endpointIndex) const
+{
+    Q_D(const QWebLoadBalancer);
+    return d->endpoints.at(endpointIndex).latency;
+}
+
+/*!
+    \internal
+
+    Returns index of \a endpoint, or -1.
+  */
+int QWebLoadBalancerPrivate::indexOf(const QUrl &endpoint) const
+{
+    for (int i = 0; i < endpoints.size(); ++i) {
+        if (endpoints.at(i).url == endpoint)
+            return i;
+    }
+    return -1;
+}
@@ -15,7 +15,14 @@
 **
 ****************************************************************************/
 
+#include <string.h>
+#include <QtCore/qeventloop.h>
+#include <QtCore/qtimer.h>
+#include <QtCore/qalgorithms.h>
 #include "../headers/qwebmethod_p.h"
+#include "../headers/qwebrequestwriter_p.h"
+#include "../headers/qwebreplydecoder_p.h"
+#include "../headers/qwebclock_p.h"
 
 /*!
     \class QWebMethod
@@ -49,6 +56,10 @@
     You then have to wait for replyReady(QVariant) signal, or check for reply
     using isReplyReady() convenience method.
 
+    Each invokeMethod() returns a QWebMethodCall object, which holds the reply
+    and error information of that single request. This way, a single
+    QWebMethod can have many requests in flight at the same time.
+
     To send a REST message with (for example) JSON body, pass
     (QWebMethod::Rest | QWebMethod::Json) as protocol flag. Additionally,
     specify HTTP method to be used (POST, GET, PUT, DELETE).
@@ -62,25 +73,17 @@
            useful constructors and methods, including a synchronous static
            sendMessage() method
         \o use static QWebServiceMethod::invokeMethod()
-        \o subclass QWebMethod, and add a static invokeMethod() method with
-           a "waiting loop"
-        \o wait for replyReady() signal in a "waiting loop". You can use isReplyReady()
-           for that
+        \o wait for the call to finish, using QWebMethodCall::waitForFinished()
     \endlist
 
-    Here's a waiting loop snippet:
+    Here's a waiting snippet:
     \code
     QWebMethod qsm;
     ...
-    qsm.invokeMethod();
-    forever {
-        if (qsm.isReplyReady()) {
-            return qsm.replyRead();
-        } else {
-            qApp->processEvents(); // Ensures that application remains responive
-                                   // to events (prevents freezing).
-        }
-    }
+    QWebMethodCall *call = qsm.invokeMethod();
+    // Waits in a local event loop, application remains responsive.
+    if (call && call->waitForFinished(10000))
+        return qsm.replyRead();
     \endcode
 
     If you want to save some time on configuration in your code, you can
@@ -181,6 +184,7 @@ QWebMethod::QWebMethod(QObject *parent, Protocol protocol, HttpMethod method) :
     QObject(parent), d_ptr(new QWebMethodPrivate)
 {
     Q_D(QWebMethod);
+    d->q_ptr = this;
     d->init();
     setProtocol(protocol);
     setHttpMethod(method);
@@ -198,6 +202,7 @@ QWebMethod::QWebMethod(const QUrl &url, Protocol protocol,
     QObject(parent), d_ptr(new QWebMethodPrivate)
 {
     Q_D(QWebMethod);
+    d->q_ptr = this;
     d->init();
     setProtocol(protocol);
     setHttpMethod(method);
@@ -214,18 +219,25 @@ QWebMethod::QWebMethod(QWebMethodPrivate &dd, Protocol protocol,
     QObject(parent), d_ptr(&dd)
 {
     Q_D(QWebMethod);
+    d->q_ptr = this;
     d->init();
     setProtocol(protocol);
     setHttpMethod(httpMethod);
 }
 
 /*!
-    Deletes internal pointers.
+    Destroys the web method and aborts all calls that are still in progress.
+    Network manager is shared with other web methods
+    (see QWebNetworkManagerPool), so it is not deleted here.
   */
 QWebMethod::~QWebMethod()
 {
     Q_D(QWebMethod);
-    delete d->manager;
+    // Pending calls need the web method when they are destroyed. Waiting
+    // calls go first, so that none of them is sent in place of a deleted one.
+    while (!d->waitingCalls.isEmpty())
+        delete d->waitingCalls.first();
+    qDeleteAll(d->calls.values());
 }
 
 /*!
@@ -242,6 +254,15 @@ QWebMethod::~QWebMethod()
     is ready for reading.
   */
 
+/*!
+    \fn QWebMethod::replyChunkReady(const QByteArray &chunk)
+
+    Signal emitted in streaming mode, when a \a chunk of a reply arrives.
+    It is emitted for all calls of this web method.
+
+    \sa setStreamingEnabled()
+  */
+
 /*!
     \fn QWebMethod::hostChanged()
 
@@ -317,6 +338,7 @@ void QWebMethod::setHost(const QString &newHost)
 {
     Q_D(QWebMethod);
     d->m_hostUrl.setPath(newHost);
+    d->invalidateTemplate();
     emit hostChanged();
 }
 
@@ -330,6 +352,7 @@ void QWebMethod::setHost(const QUrl &newHost)
 {
     Q_D(QWebMethod);
     d->m_hostUrl = newHost;
+    d->invalidateTemplate();
     emit hostUrlChanged();
 }
 
@@ -429,10 +452,10 @@ bool QWebMethod::authenticate(const QUrl &customAuthString)
 
     d->authenticationPerformed = true;
     d->authenticationReplyReceived = false;
-    connect(d->manager, SIGNAL(finished(QNetworkReply*)),
-            this, SLOT(authReplyFinished(QNetworkReply*)));
-    connect(d->manager, SIGNAL(authenticationRequired(QNetworkReply*,QAuthenticator*)),
-            this, SLOT(authenticationSlot(QNetworkReply*,QAuthenticator*)));
+    QNetworkAccessManager *manager = d->networkManager();
+    connect(manager, SIGNAL(authenticationRequired(QNetworkReply*,QAuthenticator*)),
+            this, SLOT(authenticationSlot(QNetworkReply*,QAuthenticator*)),
+            Qt::UniqueConnection);
 
     QNetworkRequest rqst(QUrl::fromUserInput(
                              QString(QLatin1String("http://")
@@ -440,11 +463,14 @@ bool QWebMethod::authenticate(const QUrl &customAuthString)
                                      + QLatin1String("/"))));
     rqst.setHeader(QNetworkRequest::ContentTypeHeader,
                    QLatin1String("application/x-www-form-urlencoded"));
+    rqst.setOriginatingObject(this);
 
     QByteArray paramBytes = customAuthString.toString().mid(1).toLatin1();
     paramBytes.replace("/", "%2F");
 //    qDebug() << paramBytes;
-    d->manager->post(rqst, paramBytes);
+    d->authenticationReply = manager->post(rqst, paramBytes);
+    connect(d->authenticationReply, SIGNAL(finished()),
+            this, SLOT(authReplyFinished()));
     return true;
 }
 
@@ -464,6 +490,7 @@ void QWebMethod::setMethodName(const QString &newName)
 {
     Q_D(QWebMethod);
     d->m_methodName = newName;
+    d->invalidateTemplate();
     emit nameChanged();
 }
 
@@ -493,6 +520,10 @@ QMap<QString, QVariant> QWebMethod::parameterNamesTypes() const
     Sets method's parameters (\a params).
     This also includes their names (as map key).
 
+    Values can be QVariantMap, QVariantHash, QVariantList and QStringList,
+    at any depth. In SOAP and XML, maps become nested elements and lists
+    repeated elements. In JSON, they become objects and arrays.
+
     \sa parameterNamesTypes(), parameterNames()
   */
 void QWebMethod::setParameters(const QMap<QString, QVariant> &params)
@@ -558,6 +589,7 @@ void QWebMethod::setTargetNamespace(const QString &tNamespace)
 {
     Q_D(QWebMethod);
     d->m_targetNamespace = tNamespace;
+    d->invalidateTemplate();
     emit targetNamespaceChanged();
 }
 
@@ -629,12 +661,14 @@ bool QWebMethod::setProtocol(Protocol prot)
         else
             d->protocolUsed = prot;
 
+        d->invalidateTemplate();
         emit protocolChanged();
         return true;
     } else {
 //        d->enterErrorState(QLatin1String("Wrong protocol is set. You have "
 //                                            "combined exclusive flags."));
         d->protocolUsed = Soap12;
+        d->invalidateTemplate();
         emit protocolChanged();
         return false;
     }
@@ -761,472 +795,1680 @@ bool QWebMethod::setHttpMethod(const QString &newMethod)
 }
 
 /*!
-    Invokes the method asynchronously, assuming that all neccessary data was
-    specified earlier. Optionally, a QByteArray (\a requestData) can be
-    specified - it will override standard data encapsulation (preparation,
-    see prepareRequestData()), and send the byte array without any changes.
+    Returns true if replies are delivered in chunks, as they arrive.
 
-    If synchronous operation is needed, you can:
-    \list
-        \o use static QWebServiceMethod::invokeMethod()
-        \o subclass QWebMethod, and add a static invokeMethod() method with
-           a "waiting loop"
-        \o wait for replyReady() signal in a "waiting loop"
-    \endlist
+    \sa setStreamingEnabled(), streamDevice()
+  */
+bool QWebMethod::isStreamingEnabled() const
+{
+    Q_D(const QWebMethod);
+    return d->streaming;
+}
 
-    Here's a waiting loop snippet:
-    \code
-    QWebMethod qsm;
-    ...
-    qsm.invokeMethod();
-    forever {
-        if (qsm.isReplyReady()) {
-            return qsm.replyRead();
-        } else {
-            // Ensures that application remains responive to events (prevents freezing).
-            qApp->processEvents();
-        }
-    }
-    \endcode
+/*!
+    Turns streaming mode on or off (\a enabled). Default is off.
 
-    Returns true on success.
+    In streaming mode, every piece of reply body is passed on as soon as
+    it arrives: QWebMethod::replyChunkReady() and QWebMethodCall::chunkReady()
+    are emitted, and the chunk is written to streamDevice(), if one is set.
+    The reply is not stored, so peak memory does not depend on the size of
+    the reply, and the data can be processed while it is still being
+    downloaded. Consequently, replyRead() and QWebMethodCall::replyRead()
+    return empty strings for such calls, and replyReady() carries an empty
+    array. finished() signal of the call marks the end of the reply.
 
-    \sa setParameters(), setProtocol(), setTargetNamespace()
+    Setting applies to calls made after it is changed.
+
+    \sa isStreamingEnabled(), setStreamDevice()
   */
-bool QWebMethod::invokeMethod(const QByteArray &requestData)
+void QWebMethod::setStreamingEnabled(bool enabled)
 {
     Q_D(QWebMethod);
-    connect(d->manager, SIGNAL(authenticationRequired(QNetworkReply*,QAuthenticator*)),
-            this, SLOT(authenticationSlot(QNetworkReply*,QAuthenticator*)));
-
-    if ((d->authenticationPerformed == true)
-            && (d->authenticationReplyReceived == false)) {
-        forever {
-            if (d->authenticationReplyReceived) {
-                disconnect(d->manager, SIGNAL(finished(QNetworkReply*)),
-                           this, SLOT(authReplyFinished(QNetworkReply*)));
-                break;
-            } else {
-                QCoreApplication::instance()->processEvents();
-            }
-        }
-    } else if ((d->authenticationPerformed == true)
-               && (d->authenticationReplyReceived == true)) {
-        disconnect(d->manager, SIGNAL(finished(QNetworkReply*)),
-                   this, SLOT(authReplyFinished(QNetworkReply*)));
-    }
+    d->streaming = enabled;
+}
 
-    connect(d->manager, SIGNAL(finished(QNetworkReply*)),
-            this, SLOT(replyFinished(QNetworkReply*)));
+/*!
+    Returns the device that replies are streamed to, or 0.
 
-    QNetworkRequest request;
-    request.setUrl(d->m_hostUrl);
-
-    if (d->protocolUsed & Soap) {
-        request.setHeader(QNetworkRequest::ContentTypeHeader,
-                          QVariant(QLatin1String("application/soap+xml; charset=utf-8")));
-    } else if (d->protocolUsed & Json) {
-        request.setHeader(QNetworkRequest::ContentTypeHeader,
-                          QVariant(QLatin1String("application/json; charset=utf-8")));
-    } else if (d->protocolUsed & Http) {
-        request.setHeader(QNetworkRequest::ContentTypeHeader,
-                          QVariant(QLatin1String("Content-Type: application/x-www-form-urlencoded")));
-    } else if (d->protocolUsed & Xml) {
-        request.setHeader(QNetworkRequest::ContentTypeHeader,
-                          QVariant(QLatin1String("application/xml; charset=utf-8")));
-    }
+    \sa setStreamDevice()
+  */
+QIODevice *QWebMethod::streamDevice() const
+{
+    Q_D(const QWebMethod);
+    return d->streamDevice;
+}
 
-    if (d->protocolUsed & Soap10)
-        request.setRawHeader(QByteArray("SOAPAction"),
-                             QByteArray(d->m_hostUrl.toString().toAscii()));
+/*!
+    Sets the \a device that reply chunks are written to, and turns
+    streaming mode on when \a device is not 0. The device has to be open
+    for writing, and is not owned by the web method. If writing to it
+    fails, the call is aborted with QWebMethodCall::DeviceError.
 
-    if (requestData.isNull() || requestData.isEmpty())
-        d->prepareRequestData();
-    else
-        d->data = requestData;
+    \sa streamDevice(), setStreamingEnabled()
+  */
+void QWebMethod::setStreamDevice(QIODevice *device)
+{
+    Q_D(QWebMethod);
+    d->streamDevice = device;
+    if (device)
+        d->streaming = true;
+}
 
-    // OPTIONAL - FOR TESTING:
-//    qDebug() << request.url().toString();
-//    qDebug() << QString(d->data);
-    // ENDOF: OPTIONAL - FOR TESTING
+/*!
+    Returns size (in bytes) above which replies are moved to a temporary
+    file, or 0 if they are always kept in memory.
 
-    if (d->protocolUsed & Rest) {
-        if (d->httpMethodUsed == Post)
-            d->manager->post(request, d->data);
-        else if (d->httpMethodUsed == Get)
-            d->manager->get(request);
-        else if (d->httpMethodUsed == Put)
-            d->manager->put(request, d->data);
-        else if (d->httpMethodUsed == Delete)
-            d->manager->deleteResource(request);
-    } else {
-        d->manager->post(request, d->data);
-    }
+    \sa setReplySpillThreshold()
+  */
+qint64 QWebMethod::replySpillThreshold() const
+{
+    Q_D(const QWebMethod);
+    return d->replySpillThreshold;
+}
 
-    return true;
+/*!
+    Sets size (in bytes) above which replies are moved to a temporary file
+    to \a bytes. Default is 0: replies are always kept in memory, which can
+    exhaust it when a reply turns out to be unexpectedly big.
+
+    Reply is collected in memory while it arrives. Once it grows past
+    \a bytes, it is written to a temporary file, and so is the rest of it.
+    When the call finishes, the file is memory-mapped, and replyRead() and
+    replyReadParsed() read through the mapping, so only pages that are being
+    read need to be resident, however big the reply is. The file is removed
+    when both the web method and the call let go of the reply (when the next
+    reply arrives, or when they are deleted).
+
+    Raw replies handed out (by replyReadRaw(), replyReadJson(),
+    QWebMethodCall::replyReadRaw(), replyReady() signals with receivers,
+    and QWebBatch) are copies in memory, which stay valid after the file
+    is removed. Mapped replies are not stored in QWebResponseCache.
+    To process a reply without keeping it at all, use streaming mode
+    instead.
+
+    A call is aborted with QWebMethodCall::DeviceError when the temporary
+    file cannot be written or mapped.
+
+    \sa replySpillThreshold(), setStreamDevice()
+  */
+void QWebMethod::setReplySpillThreshold(qint64 bytes)
+{
+    Q_D(QWebMethod);
+    d->replySpillThreshold = qMax(bytes, qint64(0));
 }
 
 /*!
-    After making asynchronous call, and getting the replyReady() signal,
-    this method can be used to read the reply.
+    Returns true if compression of requests and replies is enabled.
 
-    This method returns QString with complete and exact reply from server.
-    If other data format is needed, other methods can be used:
-    \list
-    \o for parsed reply, stored in QVariant - replyReadParsed()
-    \o for raw, unprocessed reply - replyReadRaw()
-    \endlist
+    \sa setCompressionEnabled()
+  */
+bool QWebMethod::isCompressionEnabled() const
+{
+    Q_D(const QWebMethod);
+    return d->compression;
+}
 
-    \sa replyReadParsed(), replyReadRaw()
+/*!
+    Turns compression on or off (\a enabled). Default is off.
+
+    When compression is on, request bodies that are at least
+    compressionThreshold() bytes long are sent compressed with gzip
+    (with Content-Encoding header set), and the server is told that it can
+    send gzip or deflate compressed replies. Replies are inflated as they
+    arrive, so this works together with streaming mode. Everything
+    is transparent: QWebMethodCall::requestData() and all reply reading
+    methods operate on uncompressed data.
+
+    Note that not all servers accept compressed requests.
+
+    \sa setCompressionThreshold(), requestBytesSent(), replyBytesReceived()
   */
-QString QWebMethod::replyRead()
+void QWebMethod::setCompressionEnabled(bool enabled)
 {
     Q_D(QWebMethod);
-    // Clears reply received bool.
-    d->replyReceived = false;
-    QString replyString(d->reply);
-    replyString = d->convertReplyToUtf(replyString);
-    // OPTIONAL - FOR TESTING:
-//    qDebug() << replyString;
-    // ENDOF: OPTIONAL - FOR TESTING
-    return replyString;
+    d->compression = enabled;
+    d->explicitSettings |= QWebMethodPrivate::CompressionSetting;
 }
 
 /*!
-    After making asynchronous call, and getting the replyReady() signal,
-    this method can be used to read the reply.
+    Returns the minimal size of a request body (in bytes) that will be
+    compressed. Default is 1024.
 
-    Returns parsed data (with type specified in WSDL or by user, wrapped
-    in QVariant). Tries to parse the reply automatically, but specifying
-    reply name and type using setReturnValue() might help a lot (this is
-    relevant mostly for SOAP).
+    \sa setCompressionThreshold()
+  */
+int QWebMethod::compressionThreshold() const
+{
+    Q_D(const QWebMethod);
+    return d->compressionThreshold;
+}
 
-    Web APIs usually return a lot of data
-    in one go, this method is likely to get lost in it. It expects a simple
-    reply (say, you request 2 + 2, and get SOAP-enveloped reply - it will
-    work fine then, but not necessarily if WS returns a lot of additional
-    information).
+/*!
+    Sets the minimal size of a request body (in \a bytes) that will be
+    compressed. Small bodies do not benefit from compression.
 
-    \sa replyRead(), replyReadRaw()
+    \sa compressionThreshold(), setCompressionEnabled()
   */
-QVariant QWebMethod::replyReadParsed()
+void QWebMethod::setCompressionThreshold(int bytes)
 {
     Q_D(QWebMethod);
-    // Clears reply received bool.
-    d->replyReceived = false;
-    QVariant result;
-    QByteArray replyBytes = d->reply;
-    QString replyString = d->convertReplyToUtf(replyBytes);
+    d->compressionThreshold = bytes;
+}
 
-    // It's not done properly, anyway.
-    // Should return type specified in replyValue.
-    if (d->protocolUsed & Soap || d->protocolUsed & Xml) {
-        QString tempBegin = QString(QLatin1String("<")
-                                    + d->m_methodName);
-//                                    + QLatin1String("Result>"));
-        int replyBeginIndex = replyString.indexOf(tempBegin, 0,
-                                                  Qt::CaseSensitive);
-        replyBeginIndex += tempBegin.length();
-
-        QString tempFinish = QString(QLatin1String("</")
-                                     + d->m_methodName);
-//                                     + QLatin1String("Result>"));
-        int replyFinishIndex = replyString.indexOf(tempFinish,
-                                                   replyBeginIndex,
-                                                   Qt::CaseSensitive);
-
-        if (replyBeginIndex == -1)
-            replyBytes = 0;
-        if (replyFinishIndex == -1)
-            replyFinishIndex = replyString.length();
-
-        if (d->returnValue.isEmpty()) {
-            result = (QVariant) replyString.mid(replyBeginIndex,
-                                                replyFinishIndex - replyBeginIndex);
-        } else {
-            // This attempts to prepare a complete list of replies, if enough data is
-            // specified in returnValue QMap.
-            QString replyCore = replyString.mid(replyBeginIndex,
-                                                replyFinishIndex - replyBeginIndex);
-
-            // Need to add replyCore splitting into specific return values.
-            QList<QVariant> parsedReturns;
-            QStringList returnsSplitted;
-            // This is an optimistic algorithm, it assumes that
-            // returnValue QMap is right.
-            foreach (QString s, d->returnValue.keys()) {
-                if (replyCore.contains(s)) {
-                    // Get tag beginning index.
-                    int tempIndex = replyCore.indexOf(s, 0, Qt::CaseSensitive);
-                    // Get tag ending index.
-                    int tempBeginIndex = replyCore.indexOf(">", tempIndex, Qt::CaseSensitive) + 1;
-                    // Get closing tag index.
-                    tempIndex = replyCore.indexOf("</", tempBeginIndex, Qt::CaseSensitive);
-
-                    QString value = replyCore.mid(tempBeginIndex, tempBeginIndex - tempIndex).trimmed();
-                    returnsSplitted.append(value);
-                }
-            }
+/*!
+    Returns number of bytes of request bodies prepared by this web method,
+    before compression.
 
-            int i = 0;
-            foreach (QString s, d->returnValue.keys()) {
-                QString type = d->returnValue.value(s).typeName();
-
-                if (type == QLatin1String("int")) {
-                    parsedReturns.append(QVariant(returnsSplitted.at(i).toInt()));
-                } else if (type == QLatin1String("float")) {
-                    parsedReturns.append(QVariant(returnsSplitted.at(i).toFloat()));
-                } else if (type == QLatin1String("double")) {
-                    parsedReturns.append(QVariant(returnsSplitted.at(i).toDouble()));
-                } else if (type == QLatin1String("bool")) {
-                    if (returnsSplitted.at(i).toLower() == QLatin1String("true"))
-                        parsedReturns.append(QVariant(true));
-                    else if (returnsSplitted.at(i).toLower() == QLatin1String("false"))
-                        parsedReturns.append(QVariant(true));
-                } else if (type == QLatin1String("QDateTime")) {
-                    ;
-                } else if ((type == QLatin1String("QString"))
-                           || (type == QLatin1String("QChar"))) {
-                    parsedReturns.append(QVariant(returnsSplitted.at(i)));
-                } else if (type == QLatin1String("QStringList")) {
-                    // Prepare QStringLists
-                } else {
-                    parsedReturns.append(returnsSplitted.at(i));
-                }
-
-                i++;
-            }
+    Together with requestBytesSent(), replyBytes() and replyBytesReceived(),
+    it can be used to measure savings made by compression.
 
-            if (parsedReturns.size() > 1)
-                result = parsedReturns;
-            else
-                result = parsedReturns.first();
-        }
-    } else if (d->protocolUsed & Json) {
-        // Parse JSON if you dare. Qt5 will have JSON parser, I could implement that then.. maybe.
-        // Writing own parser right now seems pointless.
-    } else { // Fallback - return QString. Will also be used for HTTP, which is bad.
-        result = replyString;
-    }
+    \sa resetByteCounters(), setCompressionEnabled()
+  */
+qint64 QWebMethod::requestBytes() const
+{
+    Q_D(const QWebMethod);
+    return d->requestBytes;
+}
+
+/*!
+    Returns number of bytes of request bodies sent by this web method,
+    after compression.
 
-    return replyBytes;
+    \sa requestBytes()
+  */
+qint64 QWebMethod::requestBytesSent() const
+{
+    Q_D(const QWebMethod);
+    return d->requestBytesSent;
 }
 
 /*!
-    After making asynchronous call, and getting the replyReady() signal,
-    this method can be used to read the reply.
+    Returns number of bytes of reply bodies received by this web method,
+    after inflating.
 
-    Returns the raw data acquired from server.
+    \sa replyBytesReceived(), requestBytes()
+  */
+qint64 QWebMethod::replyBytes() const
+{
+    Q_D(const QWebMethod);
+    return d->replyBytes;
+}
 
-    \sa replyRead(), replyReadParsed()
+/*!
+    Returns number of bytes of reply bodies received by this web method,
+    as they were sent by the server. When compression is off, network
+    manager may inflate the replies by itself, and this number is the same
+    as replyBytes().
+
+    \sa replyBytes(), requestBytes()
   */
-QByteArray QWebMethod::replyReadRaw()
+qint64 QWebMethod::replyBytesReceived() const
+{
+    Q_D(const QWebMethod);
+    return d->replyBytesReceived;
+}
+
+/*!
+    Sets all byte counters to 0.
+
+    \sa requestBytes()
+  */
+void QWebMethod::resetByteCounters()
 {
     Q_D(QWebMethod);
-    // Clears reply received bool.
-    d->replyReceived = false;
-    return d->reply;
+    d->requestBytes = 0;
+    d->requestBytesSent = 0;
+    d->replyBytes = 0;
+    d->replyBytesReceived = 0;
 }
 
 /*!
-    Returns QString with error message in case an error occured. Otherwise,
-    returns empty string.
+    Returns the timeout (in milliseconds) given to new calls,
+    or 0 if they have no deadline.
 
-    \sa isErrorState()
+    \sa setTimeout()
   */
-QString QWebMethod::errorInfo() const
+int QWebMethod::timeout() const
 {
     Q_D(const QWebMethod);
-    return d->errorMessage;
+    return d->timeout;
 }
 
 /*!
-    Returns true if there was an error, false otherwise. Details about
-    an error can be read with getErrorInfo().
+    Sets the timeout (\a msecs) given to calls made by invokeMethod().
+    A call that does not finish in time is aborted, and enters error state
+    with QWebMethodCall::TimeoutError. The web method also emits
+    errorEncountered() then. Default is 0, which means that calls wait
+    for their replies as long as the network allows.
 
-    \sa errorInfo()
+    Timeout of a single call can be changed with QWebMethodCall::setTimeout().
+    Deadlines of all calls are tracked by a single timer, so they are cheap
+    even with thousands of calls in flight.
+
+    \sa timeout(), cancelAll()
   */
-bool QWebMethod::isErrorState() const
+void QWebMethod::setTimeout(int msecs)
 {
-    Q_D(const QWebMethod);
-    return d->errorState;
+    Q_D(QWebMethod);
+    d->timeout = qMax(msecs, 0);
 }
 
 /*!
-    Returns true if reply was received,
-    and is ready to be read.
+    Aborts all calls of this web method that are still in progress,
+    including coalesced calls waiting for identical ones. They finish
+    with QWebMethodCall::CancelledError.
+
+    \sa QWebMethodCall::abort(), QWebService::cancelAll()
   */
-bool QWebMethod::isReplyReady() const
+void QWebMethod::cancelAll()
+{
+    Q_D(QWebMethod);
+    // Aborted calls remove themselves from the lists. Waiting calls go
+    // first, so that none of them is sent in place of a cancelled one.
+    foreach (QWebMethodCall *call, d->waitingCalls)
+        call->abort();
+    foreach (QWebMethodCall *call, d->calls.values())
+        call->abort();
+}
+
+/*!
+    Returns the retry policy of this web method. By default, it is
+    disabled.
+
+    \sa setRetryPolicy()
+  */
+QWebRetryPolicy QWebMethod::retryPolicy() const
 {
     Q_D(const QWebMethod);
-    return d->replyReceived;
+    return d->retryPolicy;
 }
 
 /*!
-    Protected slot, which processes
-    the reply (\a netReply) from the server.
-    Emits the replyReady() signal.
+    Sets the retry \a policy. Failed calls of this web method are
+    repeated according to it, provided that the method is idempotent
+    (see isIdempotent()). A call that is being retried stays unfinished,
+    so its timeout (see setTimeout()) covers all of its attempts.
+
+    Streamed calls are not repeated once any part of the reply has been
+    passed on.
+
+    \sa retryPolicy(), QWebMethodCall::attempts()
   */
-void QWebMethod::replyFinished(QNetworkReply *netReply)
+void QWebMethod::setRetryPolicy(const QWebRetryPolicy &policy)
 {
     Q_D(QWebMethod);
-    d->reply = netReply->readAll();
-    d->replyReceived = true;
-    emit replyReady(d->reply);
-    netReply->deleteLater();
+    d->retryPolicy = policy;
+    d->explicitSettings |= QWebMethodPrivate::RetryPolicySetting;
 }
 
 /*!
-    TEMP Auth METHOD. HIGHLY EXPERIMENTAL.
-    Checks for body of \a reply to determine correctness of authentication.
+    Returns true if invoking this method more than once has the same effect
+    as invoking it once. Only idempotent methods are retried.
+
+    Unless set with setIdempotent(), REST methods using GET, PUT and DELETE
+    are idempotent, and all other methods (including all SOAP methods)
+    are not.
+
+    \sa setIdempotent(), setRetryPolicy()
   */
-void QWebMethod::authReplyFinished(QNetworkReply *reply)
+bool QWebMethod::isIdempotent() const
+{
+    Q_D(const QWebMethod);
+    if (d->idempotentSet)
+        return d->idempotent;
+
+    return ((d->protocolUsed & Rest) && (d->httpMethodUsed != Post));
+}
+
+/*!
+    Marks this web method as \a idempotent (or not). Use it to allow
+    retrying SOAP operations that are known to be safe, like queries.
+
+    \sa isIdempotent()
+  */
+void QWebMethod::setIdempotent(bool idempotent)
 {
     Q_D(QWebMethod);
-    d->authenticationReplyReceived = true;
-    QByteArray array = reply->readAll();
-    if (!array.isEmpty())
-    {
-        d->enterErrorState(QLatin1String("Login incorrect."));
-    }
-//    else        qDebug() << "Login correct";
-    reply->deleteLater();
+    d->idempotent = idempotent;
+    d->idempotentSet = true;
 }
 
 /*!
-    Internal method used to authenticate the communication.
-    Use setCredentials() or setUsername() and setPassword()
-    to specify the data.
+    Returns true if calls of this web method go through the circuit breaker.
 
-    This is a fallback method of QNAM. Typically, authenticate()
-    should be used.
+    \sa setCircuitBreakerEnabled()
+  */
+bool QWebMethod::isCircuitBreakerEnabled() const
+{
+    Q_D(const QWebMethod);
+    return d->circuitBreaker;
+}
 
-    Fills the \a authenticator object. Does not use \a reply.
+/*!
+    Turns the circuit breaker on or off (\a enabled) for calls of this
+    web method. Default is off.
+
+    With circuit breaker on, results of calls are reported to
+    QWebCircuitBreaker, and calls to a host that fails too often are not
+    sent at all: they finish with QWebMethodCall::CircuitOpenError.
+
+    \sa QWebCircuitBreaker, QWebService::setCircuitBreakerEnabled()
   */
-void QWebMethod::authenticationSlot(QNetworkReply *reply,
-                                    QAuthenticator *authenticator)
+void QWebMethod::setCircuitBreakerEnabled(bool enabled)
 {
     Q_D(QWebMethod);
-    if (d->authenticationError)
-    {
-        d->enterErrorState(QString(QLatin1String("Authentication error! ")
-                                   + reply->readAll()));
-        return;
-    }
-
-    authenticator->setUser(d->m_username);
-    authenticator->setPassword(d->m_password);
-    d->authenticationError = true;
-    reply->deleteLater();
+    d->circuitBreaker = enabled;
+    d->explicitSettings |= QWebMethodPrivate::CircuitBreakerSetting;
 }
 
 /*!
-    Performs genral initialisation of the object.
-    Sets default variable values, initializes network manager,
-    connects reply signals. Calls virtual method, configure().
+    Returns the rate limit of this web method. By default, it is disabled.
+
+    \sa setRateLimit()
   */
-void QWebMethodPrivate::init()
+QWebRateLimit QWebMethod::rateLimit() const
 {
-    replyReceived = false;
-    authenticationReplyReceived = false;
-    errorState = false;
-    authenticationError = false;
-    authenticationPerformed = false;
+    Q_D(const QWebMethod);
+    if (d->rateLimitBucket.isNull())
+        return QWebRateLimit();
 
-    manager = new QNetworkAccessManager;
+    return d->rateLimitBucket->limit();
 }
 
 /*!
-    Private function, invoked by invokeMethod(). Modifies QByteArray data,
-    so that it is consistent with protocol and HTTP method specification.
-    It uses QMap<QString, QVariant> parameters to fill data object's body.
-    Can be overriden by creating custom QByteArray and passing it to
-    sendMessage().
+    Sets the rate \a limit of this web method. Calls above the limit wait
+    for their turn, or fail with QWebMethodCall::RateLimitedError, see
+    QWebRateLimit. Limits of the web service (QWebService::setRateLimit())
+    and of the host (QWebRateLimit::setHostLimit()) apply, too.
 
-    \sa invokeMethod()
+    Setting a limit starts with a full bucket. Disabled \a limit removes
+    the limit of this method.
+
+    \sa rateLimit()
   */
-void QWebMethodPrivate::prepareRequestData()
+void QWebMethod::setRateLimit(const QWebRateLimit &limit)
 {
-    data.clear();
-    QString header, body, footer;
-    // Replace with something OS-independent, or seriously rethink.
-    QString endl = QLatin1String("\r\n");
+    Q_D(QWebMethod);
+    if (limit.isEnabled())
+        d->rateLimitBucket = QSharedPointer<QWebTokenBucket>(new QWebTokenBucket(limit));
+    else
+        d->rateLimitBucket.clear();
+}
 
-    if (protocolUsed & QWebMethod::Soap) {
-        if (protocolUsed & QWebMethod::Soap12) {
-            header = QString(QLatin1String("<?xml version=\"1.0\" encoding=\"utf-8\"?> ")
-                     + endl + QLatin1String(" <soap12:Envelope "
-                     "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
-                     "xmlns:xsd=\"http://www.w3.org/2001/XMLSchema\" "
-                     "xmlns:soap12=\"http://www.w3.org/2003/05/soap-envelope\"> ") + endl +
-                     QLatin1String(" <soap12:Body> ") + endl);
-
-            footer = QString(QLatin1String("</soap12:Body> ")
-                             + endl
-                             + QLatin1String("</soap12:Envelope>"));
-        } else if (protocolUsed & QWebMethod::Soap10) {
-            header = QString(QLatin1String("<?xml version=\"1.0\" encoding=\"utf-8\"?> ")
-                     + endl + QLatin1String(" <soap:Envelope "
-                     "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
-                     "xmlns:xsd=\"http://www.w3.org/2001/XMLSchema\" "
-                     "xmlns:soap=\"http://www.w3.org/2003/05/soap-envelope\"> ") + endl +
-                     QLatin1String(" <soap:Body> ") + endl);
-
-            footer = QString(QLatin1String("</soap:Body> ")
-                             + endl
-                             + QLatin1String("</soap:Envelope>"));
-        }
+/*!
+    Returns true if slow calls of this web method are hedged.
 
-        body = QString(QLatin1String("\t<") + m_methodName
-                       + QLatin1String(" xmlns=\"")
-                       + m_targetNamespace
-                       + QLatin1String("\"> ") + endl);
-
-        foreach (const QString currentKey, parameters.keys()) {
-            QVariant qv = parameters.value(currentKey);
-            // Currently, this does not handle nested lists
-            body += QString(QLatin1String("\t\t<") + currentKey
-                            + QLatin1String(">")
-                            + qv.toString()
-                            + QLatin1String("</") + currentKey
-                            + QLatin1String("> ") + endl);
-        }
+    \sa setHedgingEnabled()
+  */
+bool QWebMethod::isHedgingEnabled() const
+{
+    Q_D(const QWebMethod);
+    return d->hedging;
+}
 
-        body += QString(QLatin1String("\t</")
-                        + m_methodName
-                        + QLatin1String("> ") + endl);
-    } else if (protocolUsed & QWebMethod::Http) {
-        foreach (const QString currentKey, parameters.keys()) {
-            QVariant qv = parameters.value(currentKey);
-            // Currently, this does not handle nested lists
-            body += QString(currentKey + QLatin1String("=")
-                            + qv.toString() + QLatin1String("&"));
-        }
-        body.chop(1);
-    } else if (protocolUsed & QWebMethod::Json) {
-        body += QString(QLatin1String("{") + endl);
-        foreach (const QString currentKey, parameters.keys()) {
-            QVariant qv = parameters.value(currentKey);
-            // Currently, this does not handle nested lists
-            body += QString(QLatin1String("{") + endl
-                            + QLatin1String("\t\"") + currentKey
-                            + QLatin1String("\" : \"")
-                            + qv.toString()
-                            + QLatin1String("\"") + endl);
-        }
-        body += QLatin1String("}");
-    } else if (protocolUsed & QWebMethod::Xml) {
-        foreach (const QString currentKey, parameters.keys()) {
-            QVariant qv = parameters.value(currentKey);
-            // Currently, this does not handle nested lists
-            body += QString(QLatin1String("\t\t<") + currentKey
-                            + QLatin1String(">") + qv.toString()
-                            + QLatin1String("</") + currentKey
-                            + QLatin1String("> ") + endl);
-        }
-    }
+/*!
+    Turns hedging on or off (\a enabled). Default is off.
+
+    When a call of a hedged method does not finish within hedgingDelay(),
+    a duplicate request is sent (to hedgingHost(), if it is set). The first
+    successful reply finishes the call, and the other request is aborted.
+    This cuts the tail latency, at the cost of extra load, which is kept
+    within hedgingBudget().
 
-    data.append(QString(header + body + footer).toLatin1());
+    Only idempotent methods are hedged (see isIdempotent()), and only
+    when streaming is off.
+
+    \sa hedgedRequests(), hedgesWon()
+  */
+void QWebMethod::setHedgingEnabled(bool enabled)
+{
+    Q_D(QWebMethod);
+    d->hedging = enabled;
+}
+
+/*!
+    Returns the time (in milliseconds) after which a duplicate request
+    is sent. 0 (default) means that the 95th percentile of latencies of
+    recent calls is used (see latencyPercentile()); calls are not hedged
+    until enough of them have been made.
+
+    \sa setHedgingDelay()
+  */
+int QWebMethod::hedgingDelay() const
+{
+    Q_D(const QWebMethod);
+    return d->hedgingDelay;
+}
+
+/*!
+    Sets the time (\a msecs) after which a duplicate request is sent.
+
+    \sa hedgingDelay()
+  */
+void QWebMethod::setHedgingDelay(int msecs)
+{
+    Q_D(QWebMethod);
+    d->hedgingDelay = qMax(msecs, 0);
+}
+
+/*!
+    Returns the largest number of duplicate requests, in percents of all
+    requests sent by this web method. Default is 10.
+
+    \sa setHedgingBudget()
+  */
+int QWebMethod::hedgingBudget() const
+{
+    Q_D(const QWebMethod);
+    return d->hedgingBudget;
+}
+
+/*!
+    Sets the hedging budget (\a percent of all requests sent).
+
+    \sa hedgingBudget()
+  */
+void QWebMethod::setHedgingBudget(int percent)
+{
+    Q_D(QWebMethod);
+    d->hedgingBudget = qBound(0, percent, 100);
+}
+
+/*!
+    Returns the URL that duplicate requests are sent to. By default, it is
+    empty, and duplicates go to the host of the web method.
+
+    \sa setHedgingHost()
+  */
+QUrl QWebMethod::hedgingHost() const
+{
+    Q_D(const QWebMethod);
+    return d->hedgingHost;
+}
+
+/*!
+    Sets an alternate endpoint (\a hostUrl), that duplicate requests are
+    sent to. It should serve the same web service.
+
+    \sa hedgingHost()
+  */
+void QWebMethod::setHedgingHost(const QUrl &hostUrl)
+{
+    Q_D(QWebMethod);
+    d->hedgingHost = hostUrl;
+}
+
+/*!
+    Returns the number of duplicate requests sent by this web method.
+
+    \sa hedgesWon(), setHedgingEnabled()
+  */
+int QWebMethod::hedgedRequests() const
+{
+    Q_D(const QWebMethod);
+    return d->hedgedRequests;
+}
+
+/*!
+    Returns the number of calls finished by the duplicate request.
+
+    \sa hedgedRequests()
+  */
+int QWebMethod::hedgesWon() const
+{
+    Q_D(const QWebMethod);
+    return d->hedgesWon;
+}
+
+/*!
+    Returns how long (in milliseconds) replies of this web method are kept
+    in QWebResponseCache. Default is 0: replies are not cached.
+
+    \sa setCacheTimeToLive()
+  */
+int QWebMethod::cacheTimeToLive() const
+{
+    Q_D(const QWebMethod);
+    return d->cacheTimeToLive;
+}
+
+/*!
+    Turns caching of replies on, and sets their time to live to \a msecs
+    (0 turns caching off). Use it only for operations that read data, and
+    do not change it.
+
+    Successful replies are stored in QWebResponseCache, under a key made
+    of the host, method name, target namespace and parameters (or raw
+    request data). Calls with the same key are answered from the cache
+    until the reply expires: the call finishes, and replyReady() is emitted,
+    when control returns to the event loop, with no network traffic.
+    Replies are not cached in streaming mode.
+
+    \sa cacheTimeToLive(), QWebResponseCache
+  */
+void QWebMethod::setCacheTimeToLive(int msecs)
+{
+    Q_D(QWebMethod);
+    d->cacheTimeToLive = qMax(msecs, 0);
+}
+
+/*!
+    Returns true if identical calls in flight share one request.
+
+    \sa setCoalescingEnabled()
+  */
+bool QWebMethod::isCoalescingEnabled() const
+{
+    Q_D(const QWebMethod);
+    return d->coalescing;
+}
+
+/*!
+    Turns coalescing of identical calls on or off (\a enabled). Default
+    is off. Use it only for operations that read data.
+
+    When a call is made while an identical one (with the same host, method
+    name, target namespace and parameters, made in the same thread,
+    by any web method with coalescing enabled) is still in flight, no new
+    request is sent. The new call waits for the reply of the first one,
+    and finishes with the same reply, or the same error. When the first
+    call is cancelled, times out or is deleted, a waiting call sends its
+    own request instead, and the others wait for it. Many callers
+    asking for the same data at once (for example, right after
+    a cached reply expires) then cost a single request.
+
+    Calls are not coalesced in streaming mode.
+
+    \sa coalescedCalls(), setCacheTimeToLive()
+  */
+void QWebMethod::setCoalescingEnabled(bool enabled)
+{
+    Q_D(QWebMethod);
+    d->coalescing = enabled;
+    d->explicitSettings |= QWebMethodPrivate::CoalescingSetting;
+}
+
+/*!
+    Returns the number of calls of this web method, that have waited for
+    an identical call, instead of sending their own request.
+
+    \sa setCoalescingEnabled()
+  */
+int QWebMethod::coalescedCalls() const
+{
+    Q_D(const QWebMethod);
+    return d->coalescedCalls;
+}
+
+/*!
+    Returns the given \a percentile (for example, 95) of latencies of recent
+    successful calls of this web method (in milliseconds), or -1 if not
+    enough calls have been made yet.
+
+    \sa setHedgingDelay()
+  */
+int QWebMethod::latencyPercentile(int percentile) const
+{
+    Q_D(const QWebMethod);
+    if (d->latencies.size() < QWebMethodPrivate::MinLatencySamples)
+        return -1;
+
+    QVector<int> sorted(d->latencies);
+    qSort(sorted);
+    int index = (qBound(0, percentile, 100) * (sorted.size() - 1)) / 100;
+    return sorted.at(index);
+}
+
+/*!
+    Invokes the method asynchronously, assuming that all neccessary data was
+    specified earlier. Optionally, a QByteArray (\a requestData) can be
+    specified - it will override standard data encapsulation (preparation,
+    see prepareRequestData()), and send the byte array without any changes.
+
+    Request data is prepared immediately, so parameters can be changed
+    and the method invoked again, before the first reply arrives. Each
+    invocation is represented by a separate QWebMethodCall, which can be
+    used to read the reply of that particular request. Last received reply
+    is also available through replyRead().
+
+    If synchronous operation is needed, you can:
+    \list
+        \o use static QWebServiceMethod::invokeMethod()
+        \o wait for the returned call, using QWebMethodCall::waitForFinished()
+    \endlist
+
+    Here's a waiting snippet:
+    \code
+    QWebMethod qsm;
+    ...
+    QWebMethodCall *call = qsm.invokeMethod();
+    // Waits in a local event loop, application remains responsive.
+    if (call && call->waitForFinished(10000))
+        return qsm.replyRead();
+    \endcode
+
+    Returns the call object (owned by this web method, see QWebMethodCall),
+    or 0 on failure.
+
+    \sa setParameters(), setProtocol(), setTargetNamespace()
+  */
+QWebMethodCall *QWebMethod::invokeMethod(const QByteArray &requestData)
+{
+    Q_D(QWebMethod);
+    QNetworkRequest request;
+    if (!d->beginInvocation(&request))
+        return 0;
+
+    if (requestData.isNull() || requestData.isEmpty())
+        d->prepareRequestData();
+    else
+        d->data = requestData;
+
+    // OPTIONAL - FOR TESTING:
+//    qDebug() << request.url().toString();
+//    qDebug() << QString(d->data);
+    // ENDOF: OPTIONAL - FOR TESTING
+
+    QByteArray cacheKey;
+    QByteArray flightKey;
+    if (((d->cacheTimeToLive > 0) || d->coalescing) && !d->streaming) {
+        QByteArray key = QWebResponseCachePrivate::key(d->m_hostUrl, d->protocolUsed,
+                                                       d->httpMethodUsed, d->m_username,
+                                                       d->m_password, d->m_methodName,
+                                                       d->m_targetNamespace, d->parameters,
+                                                       requestData);
+        if (d->cacheTimeToLive > 0) {
+            cacheKey = key;
+            QByteArray cachedReply;
+            if (QWebResponseCachePrivate::lookup(cacheKey, &cachedReply)) {
+                QWebMethodCall *call = new QWebMethodCall(this, d->data);
+                call->d_func()->finishLater(cachedReply);
+                return call;
+            }
+        }
+
+        if (d->coalescing) {
+            // Same key as the cache: calls of other users, or with another
+            // protocol, never share a request.
+            flightKey = key;
+        }
+    }
+
+    bool sendsBody = !((d->protocolUsed & Rest)
+                       && ((d->httpMethodUsed == Get) || (d->httpMethodUsed == Delete)));
+    QByteArray body = d->data;
+    if (d->compression) {
+        // Setting Accept-Encoding stops QNAM from inflating the reply,
+        // it is done in QWebMethodCall, as data arrives.
+        request.setRawHeader("Accept-Encoding", "gzip, deflate");
+        if (sendsBody && (body.size() >= d->compressionThreshold)) {
+            QByteArray compressed = QWebContentCodec::gzip(body);
+            if (!compressed.isEmpty() && (compressed.size() < body.size())) {
+                body = compressed;
+                request.setRawHeader("Content-Encoding", "gzip");
+            }
+        }
+    }
+
+    QWebMethodCall *call = new QWebMethodCall(this, d->data);
+    QWebMethodCallPrivate *callData = call->d_func();
+    callData->request = request;
+    callData->body = body;
+    callData->httpMethod = (d->protocolUsed & Rest) ? d->httpMethodUsed : Post;
+    if (d->streaming)
+        callData->setStreaming(d->streamDevice);
+    if (d->compression)
+        callData->setDecodingEnabled(true);
+    callData->cacheKey = cacheKey;
+    if (!flightKey.isEmpty()) {
+        QWebMethodCall *leader = QWebMethodCallPrivate::flightLeader(flightKey);
+        if (leader) {
+            // Request is kept, the call sends it when the leader is
+            // cancelled (see QWebMethodCallPrivate::promoteFollower()).
+            leader->d_func()->followers.append(call);
+            callData->following = true;
+            d->waitingCalls.append(call);
+            d->coalescedCalls++;
+            if (d->timeout > 0)
+                call->setTimeout(d->timeout);
+            return call;
+        }
+    }
+
+    return d->startCall(call, flightKey);
+}
+
+/*!
+    \overload
+
+    Invokes the method with parameters read from \a parameterData, instead
+    of the parameters set with setParameters(). Use it to upload data too
+    big to be held in memory: the body of the request is read from the device
+    in small pieces, as it is sent.
+
+    Data read from the device has to be already formatted for the protocol
+    (for example, XML elements of parameters, for SOAP). With SOAP,
+    the envelope and the element of the method are written around it;
+    with other protocols, the device provides the whole body.
+
+    The device has to be open, and must not be deleted before the call
+    is finished. Reading starts at its current position. When the device
+    is random-access (a QFile, for example), the size of the body is known
+    in advance, and it is sent with a Content-Length header. Such calls can
+    also be retried (see setRetryPolicy()). Sequential devices are read
+    until their end, and are buffered by QNetworkAccessManager before they
+    are sent, because Qt does not support chunked uploads. Requests read from
+    a device are neither compressed, nor duplicated by hedging.
+
+    Returns the call object, or 0 on failure.
+
+    \sa setParameters()
+  */
+QWebMethodCall *QWebMethod::invokeMethod(QIODevice *parameterData)
+{
+    Q_D(QWebMethod);
+    if (!parameterData || !parameterData->isReadable()) {
+        d->enterErrorState(QLatin1String("Error: parameter device is not readable."));
+        return 0;
+    }
+
+    QNetworkRequest request;
+    if (!d->beginInvocation(&request))
+        return 0;
+
+    QWebMethodCall *call = new QWebMethodCall(this, QByteArray());
+    QWebMethodCallPrivate *callData = call->d_func();
+    callData->upload = new QWebUploadDevice(d->bodyPrefix, parameterData,
+                                            d->bodySuffix, call);
+    if (!callData->upload->isSequential())
+        request.setHeader(QNetworkRequest::ContentLengthHeader, callData->upload->size());
+    if (d->compression) {
+        request.setRawHeader("Accept-Encoding", "gzip, deflate");
+        callData->setDecodingEnabled(true);
+    }
+
+    callData->request = request;
+    callData->httpMethod = (d->protocolUsed & Rest) ? d->httpMethodUsed : Post;
+    if (d->streaming)
+        callData->setStreaming(d->streamDevice);
+    return d->startCall(call, QByteArray());
+}
+
+/*!
+    After making asynchronous call, and getting the replyReady() signal,
+    this method can be used to read the reply.
+
+    This method returns QString with complete and exact reply from server.
+    If other data format is needed, other methods can be used:
+    \list
+    \o for parsed reply, stored in QVariant - replyReadParsed()
+    \o for raw, unprocessed reply - replyReadRaw()
+    \endlist
+
+    \sa replyReadParsed(), replyReadRaw()
+  */
+QString QWebMethod::replyRead()
+{
+    Q_D(QWebMethod);
+    // Clears reply received bool.
+    d->replyReceived = false;
+    QString replyString(d->reply);
+    replyString = d->convertReplyToUtf(replyString);
+    // OPTIONAL - FOR TESTING:
+//    qDebug() << replyString;
+    // ENDOF: OPTIONAL - FOR TESTING
+    return replyString;
+}
+
+/*!
+    After making asynchronous call, and getting the replyReady() signal,
+    this method can be used to read the reply.
+
+    Returns parsed data (with types specified in WSDL or by user, wrapped
+    in QVariant). SOAP and XML replies are read once, with a pull parser
+    (QXmlStreamReader), which skips the SOAP envelope, and matches elements
+    of the response against return values set with setReturnValue(), by
+    their local names (namespace prefixes do not matter). Values are
+    converted to the declared types; QStringList and QVariantList values
+    are read from arrays (children of the element, or repeated elements).
+
+    With a single return value, it is returned directly; with several,
+    they are returned in a QVariantList, ordered by name. Without return
+    values, the response is decoded generically: text of an element becomes
+    a QString, an element with children becomes a QVariantMap, and
+    a response with a single child (typically <methodResult>) is unwrapped.
+
+    JSON replies are parsed into QVariantMap and QVariantList values (see
+    QWebJsonDocument). To read only a part of a big JSON reply, use
+    replyReadJson() instead.
+
+    When the reply is not well-formed, or is a SOAP fault, invalid QVariant
+    is returned, and the web method enters error state. Replies of other
+    protocols are returned as QString.
+
+    \sa replyRead(), replyReadRaw(), replyReadJson(), setReturnValue()
+  */
+QVariant QWebMethod::replyReadParsed()
+{
+    Q_D(QWebMethod);
+    // Clears reply received bool.
+    d->replyReceived = false;
+
+    if (d->protocolUsed & Soap || d->protocolUsed & Xml) {
+        QString errorString;
+        QVariant result = QWebReplyDecoder::decode(d->reply, d->m_targetNamespace,
+                                                   d->returnValue, &errorString);
+        if (!errorString.isEmpty())
+            d->enterErrorState(QLatin1String("Error: could not parse reply: ") + errorString);
+        return result;
+    }
+
+    if (d->protocolUsed & Json) {
+        QString errorString;
+        QVariant result = QWebJsonDocument::parse(d->reply, &errorString);
+        if (!errorString.isEmpty())
+            d->enterErrorState(QLatin1String("Error: could not parse reply: ") + errorString);
+        return result;
+    }
+
+    return QVariant(d->convertReplyToUtf(d->reply));
+}
+
+/*!
+    After making asynchronous call, and getting the replyReady() signal,
+    this method can be used to read the reply.
+
+    Returns the reply as a JSON document. The reply is indexed right away,
+    but its values are decoded only when they are read, so reading a few
+    values of a big reply is cheap:
+
+    \code
+    QWebJsonDocument json = method->replyReadJson();
+    QString title = json.value("member.title").toString();
+    \endcode
+
+    \sa replyReadParsed(), QWebJsonDocument
+  */
+QWebJsonDocument QWebMethod::replyReadJson()
+{
+    Q_D(QWebMethod);
+    // Clears reply received bool.
+    d->replyReceived = false;
+    return QWebJsonDocument(QWebReplyBuffer::detached(d->reply, d->replyMapping));
+}
+
+/*!
+    After making asynchronous call, and getting the replyReady() signal,
+    this method can be used to read the reply.
+
+    Returns the raw data acquired from server.
+
+    \sa replyRead(), replyReadParsed()
+  */
+QByteArray QWebMethod::replyReadRaw()
+{
+    Q_D(QWebMethod);
+    // Clears reply received bool.
+    d->replyReceived = false;
+    return QWebReplyBuffer::detached(d->reply, d->replyMapping);
+}
+
+/*!
+    Returns QString with error message in case an error occured. Otherwise,
+    returns empty string.
+
+    \sa isErrorState()
+  */
+QString QWebMethod::errorInfo() const
+{
+    Q_D(const QWebMethod);
+    return d->errorMessage;
+}
+
+/*!
+    Returns true if there was an error, false otherwise. Details about
+    an error can be read with getErrorInfo().
+
+    \sa errorInfo()
+  */
+bool QWebMethod::isErrorState() const
+{
+    Q_D(const QWebMethod);
+    return d->errorState;
+}
+
+/*!
+    Returns true if reply was received,
+    and is ready to be read.
+  */
+bool QWebMethod::isReplyReady() const
+{
+    Q_D(const QWebMethod);
+    return d->replyReceived;
+}
+
+/*!
+    Protected slot, which processes
+    the reply (\a netReply) from the server.
+    Finishes the QWebMethodCall bound to that reply,
+    and emits the replyReady() signal.
+
+    It is invoked by the call that owns \a netReply, when the reply is
+    finished. Each reply is connected to its call only, so the cost of
+    processing a reply does not depend on the number of calls made before.
+  */
+void QWebMethod::replyFinished(QNetworkReply *netReply)
+{
+    Q_D(QWebMethod);
+    // Replies of aborted calls are already taken off the list.
+    QWebMethodCall *call = d->calls.take(netReply);
+    if (!call)
+        return;
+
+    // Most of the body has been read already, as it arrived.
+    QWebMethodCallPrivate *callData = call->d_func();
+    callData->readChunk();
+    // Aborted, because the reply could not be inflated or streamed.
+    if (callData->finished)
+        return;
+
+    // Compressed reply that ends before its stream does has been cut off.
+    if ((netReply->error() == QNetworkReply::NoError) && !callData->finishDecoding())
+        return;
+
+    // Server errors and connection problems count as failures of the host,
+    // client errors do not.
+    int httpStatus = netReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool hostFailed = (httpStatus >= 500)
+            || ((httpStatus == 0) && (netReply->error() != QNetworkReply::NoError));
+    QWebCircuitBreakerPrivate::Result result = hostFailed ? QWebCircuitBreakerPrivate::Failure
+                                                          : QWebCircuitBreakerPrivate::Success;
+    callData->releaseCircuit(result);
+    callData->releaseEndpoint(result);
+    if (netReply->error() == QNetworkReply::NoError)
+        d->recordLatency(int(QWebClock::now() - callData->sentAt));
+
+    if (d->retry(call)) {
+        netReply->deleteLater();
+        return;
+    }
+
+    // Aborted, because the spilled reply could not be mapped.
+    if (!callData->takeReply())
+        return;
+
+    // Spilled replies are too big for the cache, and do not own their data.
+    if (!callData->cacheKey.isEmpty() && callData->replyMapping.isNull()
+            && (netReply->error() == QNetworkReply::NoError)) {
+        QWebResponseCachePrivate::insert(callData->cacheKey, callData->reply, d->cacheTimeToLive);
+    }
+
+    // Streamed replies are not stored.
+    d->reply = callData->reply;
+    d->replyMapping = callData->replyMapping;
+    d->replyReceived = true;
+    callData->finish(d->reply);
+    // Mapped reply is copied only when there is someone to keep it.
+    if (receivers(SIGNAL(replyReady(QByteArray))) > 0)
+        emit replyReady(QWebReplyBuffer::detached(d->reply, d->replyMapping));
+    netReply->deleteLater();
+}
+
+/*!
+    TEMP Auth METHOD. HIGHLY EXPERIMENTAL.
+    Checks for body of \a reply to determine correctness of authentication.
+  */
+void QWebMethod::authReplyFinished(QNetworkReply *reply)
+{
+    Q_D(QWebMethod);
+    if (!reply || (reply != d->authenticationReply))
+        return;
+
+    d->authenticationReply = 0;
+    d->authenticationReplyReceived = true;
+    QByteArray array = reply->readAll();
+    if (!array.isEmpty())
+    {
+        d->enterErrorState(QLatin1String("Login incorrect."));
+    }
+//    else        qDebug() << "Login correct";
+    reply->deleteLater();
+}
+
+/*!
+    Protected slot, connected to finished() signal of the authentication
+    reply. Calls authReplyFinished() with that reply.
+  */
+void QWebMethod::authReplyFinished()
+{
+    Q_D(QWebMethod);
+    authReplyFinished(d->authenticationReply);
+}
+
+/*!
+    Internal method used to authenticate the communication.
+    Use setCredentials() or setUsername() and setPassword()
+    to specify the data.
+
+    This is a fallback method of QNAM. Typically, authenticate()
+    should be used.
+
+    Fills the \a authenticator object. Does not use \a reply.
+  */
+void QWebMethod::authenticationSlot(QNetworkReply *reply,
+                                    QAuthenticator *authenticator)
+{
+    Q_D(QWebMethod);
+    if (reply->request().originatingObject() != this)
+        return;
+
+    if (d->authenticationError)
+    {
+        d->enterErrorState(QString(QLatin1String("Authentication error! ")
+                                   + reply->readAll()));
+        return;
+    }
+
+    authenticator->setUser(d->m_username);
+    authenticator->setPassword(d->m_password);
+    d->authenticationError = true;
+    reply->deleteLater();
+}
+
+/*!
+    \internal
+
+    Sends the request of \a call (again, when it is retried), and binds
+    the new network reply to it. Returns false on failure.
+
+    When circuit of the host is open, the request is not sent, and the call
+    fails with QWebMethodCall::CircuitOpenError, once control returns
+    to the event loop. The request waits for its turn when rate limits
+    apply, see admit().
+  */
+bool QWebMethodPrivate::send(QWebMethodCall *call)
+{
+    QWebMethodCallPrivate *callData = call->d_func();
+    if (!admit(call))
+        return true;
+
+    if (!loadBalancer.isNull())
+        callData->acquireEndpoint(loadBalancer);
+
+    if (circuitBreaker) {
+        QString circuitKey = QWebCircuitBreakerPrivate::key(callData->request.url());
+        if (!QWebCircuitBreakerPrivate::acquire(circuitKey)) {
+            callData->releaseEndpoint(QWebCircuitBreakerPrivate::Ignored);
+            callData->failLater(QWebMethodCall::CircuitOpenError,
+                                QString(QLatin1String("Circuit is open, host is failing: ")
+                                        + callData->request.url().host()));
+            return true;
+        }
+        callData->acquireCircuit(circuitKey);
+    }
+
+    QNetworkReply *netReply = sendRequest(call, callData->request);
+    if (!netReply) {
+        callData->releaseCircuit(QWebCircuitBreakerPrivate::Ignored);
+        callData->releaseEndpoint(QWebCircuitBreakerPrivate::Ignored);
+        return false;
+    }
+
+    callData->attempts++;
+    callData->sentAt = QWebClock::now();
+    callData->setNetworkReply(netReply);
+    calls.insert(netReply, call);
+    callData->startHedgeTimer(hedgeDelay());
+    return true;
+}
+
+/*!
+    \internal
+
+    Waits for authentication started earlier, if needed, and sets \a request
+    to the compiled request template. Returns false on failure.
+  */
+bool QWebMethodPrivate::beginInvocation(QNetworkRequest *request)
+{
+    Q_Q(QWebMethod);
+    if ((authenticationPerformed == true)
+            && (authenticationReplyReceived == false)) {
+        QNetworkReply *authReply = authenticationReply;
+        if (authReply && !waitForSignal(authReply, SIGNAL(finished()), DefaultTimeout)) {
+            // Aborting finishes the reply, authReplyFinished() cleans up.
+            authReply->abort();
+            enterErrorState(QLatin1String("Error: authentication timed out."));
+            return false;
+        }
+    }
+
+    // Manager is shared with other web methods, so the connection
+    // has to be made only once. Replies themselves are routed per request,
+    // see QWebMethodCallPrivate::setNetworkReply().
+    QObject::connect(networkManager(),
+                     SIGNAL(authenticationRequired(QNetworkReply*,QAuthenticator*)),
+                     q, SLOT(authenticationSlot(QNetworkReply*,QAuthenticator*)),
+                     Qt::UniqueConnection);
+
+    if (!templateValid)
+        compileTemplate();
+    *request = requestTemplate;
+    request->setOriginatingObject(q);
+    return true;
+}
+
+/*!
+    \internal
+
+    Sends new \a call, and lets identical calls wait for it, if \a flightKey
+    is not empty. Deletes the call, and returns 0, if it cannot be sent.
+  */
+QWebMethodCall *QWebMethodPrivate::startCall(QWebMethodCall *call, const QByteArray &flightKey)
+{
+    QWebMethodCallPrivate *callData = call->d_func();
+    if (!send(call)) {
+        delete call;
+        return 0;
+    }
+
+    if (!flightKey.isEmpty() && !callData->finished)
+        callData->startFlight(flightKey);
+    if (timeout > 0)
+        call->setTimeout(timeout);
+    return call;
+}
+
+/*!
+    \internal
+
+    Sends \a request with body of \a call, using HTTP method of the call.
+    Returns the network reply, or 0 on failure.
+  */
+QNetworkReply *QWebMethodPrivate::sendRequest(QWebMethodCall *call,
+                                              const QNetworkRequest &request)
+{
+    Q_Q(QWebMethod);
+    QWebMethodCallPrivate *callData = call->d_func();
+    QNetworkAccessManager *manager = networkManager();
+    // Endpoints chosen by the load balancer (and the hedging host) use
+    // their own managers, so that their warm connections are reused.
+    if (QWebCircuitBreakerPrivate::key(request.url())
+            != QWebCircuitBreakerPrivate::key(m_hostUrl)) {
+        manager = QWebNetworkManagerPool::manager(request.url(), m_username, m_password);
+        QObject::connect(manager, SIGNAL(authenticationRequired(QNetworkReply*,QAuthenticator*)),
+                         q, SLOT(authenticationSlot(QNetworkReply*,QAuthenticator*)),
+                         Qt::UniqueConnection);
+    }
+
+    QWebUploadDevice *upload = callData->upload;
+    // Body read from a device is sent again from its beginning.
+    if (upload && !upload->isSequential())
+        upload->reset();
+
+    QNetworkReply *netReply = 0;
+    if (callData->httpMethod == QWebMethod::Post) {
+        netReply = upload ? manager->post(request, upload)
+                          : manager->post(request, callData->body);
+    } else if (callData->httpMethod == QWebMethod::Get) {
+        netReply = manager->get(request);
+    } else if (callData->httpMethod == QWebMethod::Put) {
+        netReply = upload ? manager->put(request, upload)
+                          : manager->put(request, callData->body);
+    } else if (callData->httpMethod == QWebMethod::Delete) {
+        netReply = manager->deleteResource(request);
+    }
+
+    if (!netReply)
+        return 0;
+
+    if ((callData->httpMethod == QWebMethod::Post)
+            || (callData->httpMethod == QWebMethod::Put)) {
+        qint64 bodySize = upload ? (upload->isSequential() ? 0 : upload->size())
+                                 : callData->body.size();
+        requestBytes += upload ? bodySize : callData->requestData.size();
+        requestBytesSent += bodySize;
+    }
+
+    requestsSent++;
+    return netReply;
+}
+
+/*!
+    \internal
+
+    Returns time (in milliseconds) after which a duplicate of a request
+    is sent, or 0 if requests of this method are not hedged.
+  */
+int QWebMethodPrivate::hedgeDelay() const
+{
+    Q_Q(const QWebMethod);
+    // Streamed chunks are passed on as they arrive, so they cannot race.
+    if (!hedging || streaming || !q->isIdempotent())
+        return 0;
+
+    if (hedgingDelay > 0)
+        return hedgingDelay;
+
+    return qMax(q->latencyPercentile(95), 0);
+}
+
+/*!
+    \internal
+
+    Sends a duplicate of the request of \a call, unless the hedging budget
+    has been used up. Returns true if the duplicate has been sent.
+
+    Duplicates pass the same gates as other requests: they are not sent
+    to a host whose circuit is not closed, nor when a rate limit has
+    no token available right away (they are never queued).
+  */
+bool QWebMethodPrivate::hedge(QWebMethodCall *call)
+{
+    QWebMethodCallPrivate *callData = call->d_func();
+    // Upload device can be read by one request at a time.
+    if (!callData->networkReply || callData->hedgeReply || callData->upload)
+        return false;
+
+    if ((qint64(hedgedRequests) * 100) >= (qint64(hedgingBudget) * requestsSent))
+        return false;
+
+    QNetworkRequest request(callData->request);
+    if (hedgingHost.isValid())
+        request.setUrl(hedgingHost);
+
+    if (circuitBreaker && (QWebCircuitBreaker::state(request.url()) != QWebCircuitBreaker::Closed))
+        return false;
+
+    if (!admitNow(request.url()))
+        return false;
+
+    QNetworkReply *netReply = sendRequest(call, request);
+    if (!netReply)
+        return false;
+
+    hedgedRequests++;
+    callData->setHedgeReply(netReply);
+    return true;
+}
+
+/*!
+    \internal
+
+    Stores latency (\a msecs) of a successful call, for latencyPercentile().
+  */
+void QWebMethodPrivate::recordLatency(int msecs)
+{
+    if (latencies.size() < LatencySamples) {
+        latencies.append(msecs);
+        return;
+    }
+
+    latencies[latencyIndex] = msecs;
+    latencyIndex = (latencyIndex + 1) % LatencySamples;
+}
+
+/*!
+    \internal
+
+    Returns token buckets of all rate limits that apply to requests sent
+    to \a host: of this method, of its web service and of the host.
+  */
+QList<QSharedPointer<QWebTokenBucket> > QWebMethodPrivate::rateLimitBuckets(const QUrl &host) const
+{
+    QList<QSharedPointer<QWebTokenBucket> > buckets;
+    if (!rateLimitBucket.isNull())
+        buckets.append(rateLimitBucket);
+    if (!serviceRateLimitBucket.isNull())
+        buckets.append(serviceRateLimitBucket);
+    QSharedPointer<QWebTokenBucket> hostBucket = QWebTokenBucket::hostBucket(host);
+    if (!hostBucket.isNull())
+        buckets.append(hostBucket);
+    return buckets;
+}
+
+/*!
+    \internal
+
+    Takes tokens of all rate limits that apply to \a call (of this method,
+    of its web service and of the host). Returns true if the request can
+    be sent right away.
+
+    Otherwise, the request is scheduled to be sent when the last of its
+    tokens becomes available (send() is called again then, and the tokens
+    are already taken), or, when it would have to wait too long, the call
+    fails with QWebMethodCall::RateLimitedError.
+  */
+bool QWebMethodPrivate::admit(QWebMethodCall *call)
+{
+    QWebMethodCallPrivate *callData = call->d_func();
+    if (callData->admitted) {
+        // Tokens have been taken before the wait.
+        callData->admitted = false;
+        callData->reservedTokens.clear();
+        return true;
+    }
+
+    QList<QSharedPointer<QWebTokenBucket> > buckets = rateLimitBuckets(callData->request.url());
+    if (buckets.isEmpty())
+        return true;
+
+    int delay = 0;
+    QList<QSharedPointer<QWebTokenBucket> > reserved;
+    foreach (const QSharedPointer<QWebTokenBucket> &bucket, buckets) {
+        int bucketDelay = bucket->reserve();
+        if (bucketDelay < 0) {
+            foreach (const QSharedPointer<QWebTokenBucket> &taken, reserved)
+                taken->refund();
+            callData->failLater(QWebMethodCall::RateLimitedError,
+                                QString(QLatin1String("Rate limit exceeded, call to ")
+                                        + callData->request.url().host()
+                                        + QLatin1String(" has not been sent.")));
+            return false;
+        }
+
+        reserved.append(bucket);
+        delay = qMax(delay, bucketDelay);
+    }
+
+    if (delay == 0)
+        return true;
+
+    callData->admitted = true;
+    callData->reservedTokens = reserved;
+    callData->scheduleSend(delay);
+    return false;
+}
+
+/*!
+    \internal
+
+    Takes tokens of all rate limits that apply to a request sent to \a host,
+    only if all of them are available right away. Returns false (and takes
+    nothing) otherwise.
+  */
+bool QWebMethodPrivate::admitNow(const QUrl &host)
+{
+    QList<QSharedPointer<QWebTokenBucket> > reserved;
+    foreach (const QSharedPointer<QWebTokenBucket> &bucket, rateLimitBuckets(host)) {
+        int delay = bucket->reserve();
+        if (delay != 0) {
+            // Tokens reserved for later are taken as well.
+            if (delay > 0)
+                bucket->refund();
+            foreach (const QSharedPointer<QWebTokenBucket> &taken, reserved)
+                taken->refund();
+            return false;
+        }
+
+        reserved.append(bucket);
+    }
+
+    return true;
+}
+
+/*!
+    \internal
+
+    Checks whether failed \a call should be repeated, according to the retry
+    policy, and schedules the next attempt. Returns true if the call
+    is going to be retried.
+  */
+bool QWebMethodPrivate::retry(QWebMethodCall *call)
+{
+    Q_Q(QWebMethod);
+    QWebMethodCallPrivate *callData = call->d_func();
+    QNetworkReply *netReply = callData->networkReply;
+    if (!netReply || !retryPolicy.isEnabled() || !q->isIdempotent()
+            || (callData->attempts >= retryPolicy.maxAttempts())
+            || callData->chunksDelivered
+            || (callData->upload && callData->upload->isSequential())) {
+        return false;
+    }
+
+    int httpStatus = netReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (!retryPolicy.shouldRetry(netReply->error(), httpStatus))
+        return false;
+
+    callData->retryDelay = retryPolicy.nextDelay(callData->retryDelay);
+    callData->scheduleRetry(callData->retryDelay);
+    return true;
+}
+
+/*!
+    Performs genral initialisation of the object.
+    Sets default variable values. Network manager is taken from
+    QWebNetworkManagerPool when it is needed, see networkManager().
+  */
+void QWebMethodPrivate::init()
+{
+    replyReceived = false;
+    replySpillThreshold = 0;
+    streaming = false;
+    compression = false;
+    compressionThreshold = DefaultCompressionThreshold;
+    timeout = 0;
+    idempotent = false;
+    idempotentSet = false;
+    circuitBreaker = false;
+    explicitSettings = 0;
+    hedging = false;
+    hedgingDelay = 0;
+    hedgingBudget = DefaultHedgingBudget;
+    requestsSent = 0;
+    hedgedRequests = 0;
+    hedgesWon = 0;
+    latencyIndex = 0;
+    cacheTimeToLive = 0;
+    templateValid = false;
+    memoValid = false;
+    coalescing = false;
+    coalescedCalls = 0;
+    requestBytes = 0;
+    requestBytesSent = 0;
+    replyBytes = 0;
+    replyBytesReceived = 0;
+    authenticationReplyReceived = false;
+    errorState = false;
+    authenticationError = false;
+    authenticationPerformed = false;
+
+    manager = 0;
+    authenticationReply = 0;
+}
+
+/*!
+    \internal
+
+    Copies configuration of \a other web method: host, protocol, name,
+    parameters, credentials and reliability settings. Rate limits and
+    the load balancer are shared, not copied. Streaming is not copied,
+    because the stream device belongs to the thread of \a other.
+
+    Used by QWebWorker to run web methods in its thread.
+  */
+void QWebMethodPrivate::copySettings(const QWebMethodPrivate *other)
+{
+    protocolUsed = other->protocolUsed;
+    httpMethodUsed = other->httpMethodUsed;
+    m_hostUrl = other->m_hostUrl;
+    m_methodName = other->m_methodName;
+    m_targetNamespace = other->m_targetNamespace;
+    m_username = other->m_username;
+    m_password = other->m_password;
+    parameters = other->parameters;
+    returnValue = other->returnValue;
+    replySpillThreshold = other->replySpillThreshold;
+    compression = other->compression;
+    compressionThreshold = other->compressionThreshold;
+    timeout = other->timeout;
+    retryPolicy = other->retryPolicy;
+    idempotent = other->idempotent;
+    idempotentSet = other->idempotentSet;
+    circuitBreaker = other->circuitBreaker;
+    explicitSettings = other->explicitSettings;
+    rateLimitBucket = other->rateLimitBucket;
+    serviceRateLimitBucket = other->serviceRateLimitBucket;
+    loadBalancer = other->loadBalancer;
+    hedging = other->hedging;
+    hedgingDelay = other->hedgingDelay;
+    hedgingBudget = other->hedgingBudget;
+    hedgingHost = other->hedgingHost;
+    cacheTimeToLive = other->cacheTimeToLive;
+    invalidateTemplate();
+    coalescing = other->coalescing;
+}
+
+/*!
+    \internal
+
+    Blocks until \a sender emits \a signal, or until \a msecs milliseconds
+    have passed (-1 means no timeout). Waiting is done in a local event loop,
+    so it does not use the CPU, and events are still delivered. Also returns
+    when \a sender is destroyed.
+
+    Returns false if the time has run out.
+  */
+bool QWebMethodPrivate::waitForSignal(QObject *sender, const char *signal, int msecs)
+{
+    QEventLoop loop;
+    QTimer timer;
+    timer.setSingleShot(true);
+    QObject::connect(sender, signal, &loop, SLOT(quit()));
+    QObject::connect(sender, SIGNAL(destroyed()), &loop, SLOT(quit()));
+    QObject::connect(&timer, SIGNAL(timeout()), &loop, SLOT(quit()));
+
+    if (msecs >= 0)
+        timer.start(msecs);
+
+    loop.exec();
+    return ((msecs < 0) || timer.isActive());
+}
+
+/*!
+    \internal
+
+    Returns network manager shared by all web methods, which use the same
+    host and credentials in current thread. Sharing the manager allows
+    keep-alive connections to be reused across web methods.
+  */
+QNetworkAccessManager *QWebMethodPrivate::networkManager()
+{
+    manager = QWebNetworkManagerPool::manager(m_hostUrl, m_username, m_password);
+    return manager;
+}
+
+/*!
+    \internal
+
+    Returns true if \a parameters and \a other have the same keys, with
+    values of the same types and equal values. QVariant alone would find
+    1 and "1" equal, but they are written differently in JSON.
+  */
+static bool sameParameters(const QMap<QString, QVariant> &parameters,
+                           const QMap<QString, QVariant> &other)
+{
+    if (parameters.size() != other.size())
+        return false;
+
+    QMap<QString, QVariant>::const_iterator i = parameters.constBegin();
+    QMap<QString, QVariant>::const_iterator j = other.constBegin();
+    for (; i != parameters.constEnd(); ++i, ++j) {
+        if ((i.key() != j.key()) || (i.value().userType() != j.value().userType())
+                || (i.value() != j.value()))
+            return false;
+    }
+
+    return true;
+}
+
+/*!
+    Private function, invoked by invokeMethod(). Modifies QByteArray data,
+    so that it is consistent with protocol and HTTP method specification.
+    It uses QMap<QString, QVariant> parameters to fill data object's body,
+    written as UTF-8 by QWebRequestWriter.
+    Can be overriden by creating custom QByteArray and passing it to
+    sendMessage().
+
+    \sa invokeMethod()
+  */
+void QWebMethodPrivate::prepareRequestData()
+{
+    if (!templateValid)
+        compileTemplate();
+
+    if (memoValid && sameParameters(parameters, memoParameters)) {
+        data = memoData;
+        return;
+    }
+
+    // Previous body may still be shared with calls, so a new one is made.
+    QByteArray body;
+    body.resize(bodyPrefix.size()
+                + QWebRequestWriter::parametersSize(protocolUsed, parameters)
+                + bodySuffix.size());
+    char *out = body.data();
+    memcpy(out, bodyPrefix.constData(), bodyPrefix.size());
+    out = QWebRequestWriter::writeParameters(out + bodyPrefix.size(), protocolUsed,
+                                             parameters);
+    memcpy(out, bodySuffix.constData(), bodySuffix.size());
+
+    data = body;
+    memoParameters = parameters;
+    memoData = body;
+    memoValid = true;
+}
+
+/*!
+    \internal
+
+    Compiles the parts of requests that do not depend on parameters:
+    the network request (URL, Content-Type and SOAPAction headers),
+    and the body written before and after parameters (SOAP envelope,
+    and the element of the method). They are reused by all calls, until
+    the host, protocol, method name or target namespace changes.
+
+    \sa invalidateTemplate()
+  */
+void QWebMethodPrivate::compileTemplate()
+{
+    requestTemplate = QNetworkRequest(m_hostUrl);
+
+    if (protocolUsed & QWebMethod::Soap) {
+        requestTemplate.setHeader(QNetworkRequest::ContentTypeHeader,
+                                  QVariant(QLatin1String("application/soap+xml; charset=utf-8")));
+    } else if (protocolUsed & QWebMethod::Json) {
+        requestTemplate.setHeader(QNetworkRequest::ContentTypeHeader,
+                                  QVariant(QLatin1String("application/json; charset=utf-8")));
+    } else if (protocolUsed & QWebMethod::Http) {
+        requestTemplate.setHeader(QNetworkRequest::ContentTypeHeader,
+                                  QVariant(QLatin1String("application/x-www-form-urlencoded")));
+    } else if (protocolUsed & QWebMethod::Xml) {
+        requestTemplate.setHeader(QNetworkRequest::ContentTypeHeader,
+                                  QVariant(QLatin1String("application/xml; charset=utf-8")));
+    }
+
+    if (protocolUsed & QWebMethod::Soap10)
+        requestTemplate.setRawHeader(QByteArray("SOAPAction"),
+                                     QByteArray(m_hostUrl.toString().toAscii()));
+
+    bodyPrefix = QWebRequestWriter::prefix(protocolUsed, m_methodName, m_targetNamespace);
+    bodySuffix = QWebRequestWriter::suffix(protocolUsed, m_methodName);
+    templateValid = true;
+    memoValid = false;
+}
+
+/*!
+    \internal
+
+    Marks the request template (and the last body made with it) as outdated.
+    Called whenever the host, protocol, method name or target namespace
+    changes.
+  */
+void QWebMethodPrivate::invalidateTemplate()
+{
+    templateValid = false;
+    memoValid = false;
+    memoParameters.clear();
+    memoData.clear();
 }
 
 /*!
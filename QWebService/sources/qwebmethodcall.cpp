@@ -0,0 +1,1185 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <QtCore/qatomic.h>
+#include <QtCore/qpointer.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qthreadstorage.h>
+#include "../headers/qwebmethodcall_p.h"
+#include "../headers/qwebmethod_p.h"
+#include "../headers/qwebclock_p.h"
+
+/*!
+    \class QWebMethodCall
+    \brief Represents a single invocation of a QWebMethod.
+
+    Each call to QWebMethod::invokeMethod() returns a new QWebMethodCall.
+    It holds the request data, the reply and the error information of that
+    single request. Thanks to that, one configured QWebMethod can have many
+    requests in flight at the same time, and each reply can be matched
+    with the request that caused it:
+    \code
+    QWebMethodCall *call = method->invokeMethod();
+    connect(call, SIGNAL(replyReady(QByteArray)),
+            this, SLOT(processReply(QByteArray)));
+    \endcode
+
+    QWebMethod still stores the last received reply, and emits
+    QWebMethod::replyReady() for every finished call, so code that does not
+    need concurrency can keep ignoring call objects.
+
+    Failed calls of idempotent web methods can be repeated automatically,
+    see QWebMethod::setRetryPolicy(). While a call waits for the next
+    attempt, or for its turn under a rate limit (see QWebRateLimit),
+    it is not finished, and networkReply() returns 0.
+
+    A call can be given a deadline with setTimeout() (by default, timeout
+    of the web method is used, see QWebMethod::setTimeout()), and can be
+    cancelled at any time with abort().
+
+    Calls are children of their QWebMethod. By default, a call deletes itself
+    (using QObject::deleteLater()) after finished() signal is emitted, so the
+    reply has to be read in a slot connected to replyReady() or finished().
+    Use setAutoDelete() to keep the call alive - it will then be deleted
+    together with the web method, or when you delete it. Deleting a call that
+    has not finished yet aborts its request.
+  */
+
+/*!
+    \enum QWebMethodCall::Error
+
+    Describes the reason of the failure of a call.
+
+    \value NoError
+           Call has not failed.
+    \value NetworkError
+           Network request has failed. See errorInfo() for details.
+    \value TimeoutError
+           Call did not finish in time, and has been aborted.
+    \value DeviceError
+           Reply could not be written to the stream device, and the call
+           has been aborted. See QWebMethod::setStreamDevice().
+    \value DecodingError
+           Compressed reply could not be inflated, and the call has been
+           aborted. See QWebMethod::setCompressionEnabled().
+    \value CancelledError
+           Call has been cancelled with abort() or QWebMethod::cancelAll().
+    \value CircuitOpenError
+           Call has not been sent, because the host has been failing
+           recently. See QWebCircuitBreaker.
+    \value RateLimitedError
+           Call has not been sent, because it would have to wait too long
+           for its turn. See QWebRateLimit.
+  */
+
+/*!
+    \fn QWebMethodCall::replyReady(const QByteArray &reply)
+
+    Signal emitted when the \a reply of this call is ready for reading.
+  */
+
+/*!
+    \fn QWebMethodCall::chunkReady(const QByteArray &chunk)
+
+    Signal emitted in streaming mode, each time a \a chunk of the reply
+    arrives. See QWebMethod::setStreamingEnabled().
+  */
+
+/*!
+    \fn QWebMethodCall::errorEncountered(const QString &errMessage)
+
+    Signal emitted when this call fails. Carries \a errMessage for convenience.
+  */
+
+/*!
+    \fn QWebMethodCall::finished()
+
+    Signal emitted when the call is finished, whether it failed or not.
+    It is always the last signal emitted by a call.
+  */
+
+static QAtomicInt lastRequestId(0);
+
+// Calls in flight, that identical calls can wait for. Calls are bound
+// to their thread, so each thread has its own.
+static QThreadStorage<QHash<QByteArray, QWebMethodCall *> *> flightStorage;
+
+static QHash<QByteArray, QWebMethodCall *> *flights()
+{
+    if (!flightStorage.hasLocalData())
+        flightStorage.setLocalData(new QHash<QByteArray, QWebMethodCall *>);
+    return flightStorage.localData();
+}
+
+/*!
+    \internal
+
+    Constructs a call of web \a method, which sends \a requestData.
+    Calls are created by QWebMethod::invokeMethod() only.
+  */
+QWebMethodCall::QWebMethodCall(QWebMethod *method, const QByteArray &requestData) :
+    QObject(method), d_ptr(new QWebMethodCallPrivate(this))
+{
+    Q_D(QWebMethodCall);
+    d->init(method, requestData);
+}
+
+/*!
+    Destroys the call. If the request is still in progress, it is aborted.
+  */
+QWebMethodCall::~QWebMethodCall()
+{
+    Q_D(QWebMethodCall);
+    d->stopTimer();
+    if (d->sendTimerId != 0)
+        QWebTimerQueue::instance()->cancel(d->sendTimerId);
+    d->stopHedging();
+    d->refundTokens();
+    d->releaseCircuit(QWebCircuitBreakerPrivate::Ignored);
+    d->releaseEndpoint(QWebCircuitBreakerPrivate::Ignored);
+    QByteArray key = d->flightKey;
+    d->endFlight();
+    if (d->following)
+        d->method->d_func()->waitingCalls.removeAll(this);
+    if (d->networkReply) {
+        QNetworkReply *reply = d->networkReply;
+        d->networkReply = 0;
+        d->method->d_func()->calls.remove(reply);
+        reply->abort();
+        reply->deleteLater();
+    }
+
+    QList<QPointer<QWebMethodCall> > waiting = d->followers;
+    delete d_ptr;
+    // Calls waiting for this one send the request themselves.
+    QWebMethodCallPrivate::promoteFollower(waiting, key);
+}
+
+/*!
+    Returns identifier of this call. Identifiers are unique within
+    the process, which makes them useful for logging and for matching
+    requests with replies.
+  */
+int QWebMethodCall::requestId() const
+{
+    Q_D(const QWebMethodCall);
+    return d->requestId;
+}
+
+/*!
+    Returns web method that has been invoked.
+  */
+QWebMethod *QWebMethodCall::method() const
+{
+    Q_D(const QWebMethodCall);
+    return d->method;
+}
+
+/*!
+    Returns network reply bound to this call. Once the call is finished,
+    0 is returned.
+  */
+QNetworkReply *QWebMethodCall::networkReply() const
+{
+    Q_D(const QWebMethodCall);
+    return d->networkReply;
+}
+
+/*!
+    Returns data sent to the server in this call.
+  */
+QByteArray QWebMethodCall::requestData() const
+{
+    Q_D(const QWebMethodCall);
+    return d->requestData;
+}
+
+/*!
+    Returns true if the call deletes itself after it is finished.
+    Default is true.
+
+    \sa setAutoDelete()
+  */
+bool QWebMethodCall::autoDelete() const
+{
+    Q_D(const QWebMethodCall);
+    return d->autoDelete;
+}
+
+/*!
+    Sets whether the call should delete itself after it is finished
+    (\a autoDelete).
+
+    \sa autoDelete()
+  */
+void QWebMethodCall::setAutoDelete(bool autoDelete)
+{
+    Q_D(QWebMethodCall);
+    d->autoDelete = autoDelete;
+}
+
+/*!
+    Returns the raw reply of this call. Empty until the call is finished.
+
+    \sa replyRead(), isFinished()
+  */
+QByteArray QWebMethodCall::replyReadRaw() const
+{
+    Q_D(const QWebMethodCall);
+    return QWebReplyBuffer::detached(d->reply, d->replyMapping);
+}
+
+/*!
+    Returns the reply of this call as a QString, just like
+    QWebMethod::replyRead() does. Empty until the call is finished.
+
+    \sa replyReadRaw(), isFinished()
+  */
+QString QWebMethodCall::replyRead() const
+{
+    Q_D(const QWebMethodCall);
+    return QWebMethodPrivate::convertReplyToUtf(QString(d->reply));
+}
+
+/*!
+    Returns true if the call is finished (either successfully or not).
+  */
+bool QWebMethodCall::isFinished() const
+{
+    Q_D(const QWebMethodCall);
+    return d->finished;
+}
+
+/*!
+    Returns true if the call has failed.
+
+    \sa error(), errorInfo()
+  */
+bool QWebMethodCall::isErrorState() const
+{
+    Q_D(const QWebMethodCall);
+    return (d->errorCode != NoError);
+}
+
+/*!
+    Returns the reason of the failure, or QWebMethodCall::NoError.
+
+    \sa isErrorState(), errorInfo()
+  */
+QWebMethodCall::Error QWebMethodCall::error() const
+{
+    Q_D(const QWebMethodCall);
+    return d->errorCode;
+}
+
+/*!
+    Returns QString with error message in case an error occured. Otherwise,
+    returns empty string.
+
+    \sa isErrorState()
+  */
+QString QWebMethodCall::errorInfo() const
+{
+    Q_D(const QWebMethodCall);
+    return d->errorMessage;
+}
+
+/*!
+    Returns number of times the request of this call has been sent.
+    It is greater than 1 only if the call has been retried.
+
+    \sa QWebMethod::setRetryPolicy()
+  */
+int QWebMethodCall::attempts() const
+{
+    Q_D(const QWebMethodCall);
+    return d->attempts;
+}
+
+/*!
+    Returns the timeout of this call (in milliseconds), or 0 when the call
+    has no deadline.
+
+    \sa setTimeout()
+  */
+int QWebMethodCall::timeout() const
+{
+    Q_D(const QWebMethodCall);
+    return d->timeout;
+}
+
+/*!
+    Sets the deadline of this call to \a msecs milliseconds from now.
+    If the call does not finish by then, it is aborted, and enters error
+    state with QWebMethodCall::TimeoutError. Passing 0 removes the deadline.
+
+    Initial timeout is taken from the web method, see QWebMethod::setTimeout().
+    Does nothing if the call is already finished.
+
+    \sa timeout(), abort()
+  */
+void QWebMethodCall::setTimeout(int msecs)
+{
+    Q_D(QWebMethodCall);
+    if (d->finished)
+        return;
+
+    d->timeout = qMax(msecs, 0);
+    d->startTimer(d->timeout);
+}
+
+/*!
+    Aborts the call. Its network request is cancelled, and the call
+    finishes in error state, with QWebMethodCall::CancelledError.
+    Does nothing if the call is already finished.
+
+    \sa QWebMethod::cancelAll(), setTimeout()
+  */
+void QWebMethodCall::abort()
+{
+    Q_D(QWebMethodCall);
+    d->abort(CancelledError, QLatin1String("Call has been cancelled."));
+}
+
+/*!
+    Blocks until the call is finished, or until \a msecs milliseconds have
+    passed. If \a msecs is -1, this method does not time out.
+
+    Waiting is done in a local event loop, so it does not use the CPU
+    while the reply is on its way, and events of the application are still
+    delivered. If the call does not finish in time, it is aborted, and
+    enters error state with QWebMethodCall::TimeoutError.
+
+    Returns true if the call has finished in time. Note that a finished call
+    can still be in error state (for example, when the server was not
+    reachable) - use isErrorState() to check that.
+
+    A call with autoDelete() set is still valid right after this method
+    returns. It is deleted when control returns to the main event loop.
+  */
+bool QWebMethodCall::waitForFinished(int msecs)
+{
+    Q_D(QWebMethodCall);
+    if (d->finished)
+        return true;
+
+    QPointer<QWebMethodCall> guard(this);
+    bool inTime = QWebMethodPrivate::waitForSignal(this, SIGNAL(finished()), msecs);
+
+    if (guard.isNull())
+        return false;
+
+    if (!inTime && !d->finished) {
+        d->abort(TimeoutError, QString(QLatin1String("Call timed out after ")
+                                       + QString::number(msecs)
+                                       + QLatin1String(" ms.")));
+        return false;
+    }
+
+    return d->finished;
+}
+
+/*!
+    \internal
+
+    Private slot, connected to finished() signal of the network reply
+    bound to this call. Passes the reply to the web method, which reads it
+    and finishes this call.
+  */
+void QWebMethodCall::networkReplyFinished()
+{
+    Q_D(QWebMethodCall);
+    // Reply is unbound (and already finished) when the call has been aborted.
+    if (!d->networkReply)
+        return;
+
+    if (d->hedgeReply) {
+        if ((d->networkReply->error() != QNetworkReply::NoError)
+                && !d->hedgeReply->isFinished()) {
+            // Duplicate request can still succeed, so the failure is dropped.
+            QNetworkReply *netReply = d->networkReply;
+            d->networkReply = 0;
+            d->method->d_func()->calls.remove(netReply);
+            netReply->deleteLater();
+            return;
+        }
+
+        d->stopHedging();
+    }
+
+    d->method->replyFinished(d->networkReply);
+}
+
+/*!
+    \internal
+
+    Private slot, connected to readyRead() signal of the network reply.
+    Reads the newly arrived data.
+  */
+void QWebMethodCall::networkReplyReadyRead()
+{
+    Q_D(QWebMethodCall);
+    d->readChunk();
+}
+
+/*!
+    \internal
+
+    Private slot, invoked by QWebTimerQueue when deadline of the call passes.
+    Aborts the call with QWebMethodCall::TimeoutError.
+  */
+void QWebMethodCall::deadlineExpired()
+{
+    Q_D(QWebMethodCall);
+    d->timerId = 0;
+    if (d->finished)
+        return;
+
+    QString message(QLatin1String("Call timed out after ")
+                    + QString::number(d->timeout) + QLatin1String(" ms."));
+    // Web method is notified too, for code that does not use call objects.
+    d->method->d_func()->enterErrorState(message);
+    d->abort(TimeoutError, message);
+}
+
+/*!
+    \internal
+
+    Private slot, invoked by QWebTimerQueue when the delay before next
+    attempt (or the wait for a rate limit token) passes. Sends the request.
+  */
+void QWebMethodCall::sendDelayExpired()
+{
+    Q_D(QWebMethodCall);
+    d->sendTimerId = 0;
+    if (d->finished)
+        return;
+
+    if (!d->method->d_func()->send(this))
+        d->abort(NetworkError, QLatin1String("Could not send the request."));
+}
+
+/*!
+    \internal
+
+    Private slot, used to finish the call in error state set by failLater().
+  */
+void QWebMethodCall::pendingErrorReady()
+{
+    Q_D(QWebMethodCall);
+    if (d->finished)
+        return;
+
+    d->enterErrorState(d->pendingError, d->pendingErrorMessage);
+    d->finish(QByteArray());
+}
+
+/*!
+    \internal
+
+    Private slot, used to finish the call with the reply set by finishLater().
+    Reply is also stored in the web method, as if it came from the network.
+  */
+void QWebMethodCall::pendingReplyReady()
+{
+    Q_D(QWebMethodCall);
+    if (d->finished)
+        return;
+
+    QByteArray replyData = d->pendingReply;
+    d->pendingReply.clear();
+    d->deliver(replyData);
+}
+
+/*!
+    \internal
+
+    Private slot, invoked by QWebTimerQueue when the call has been waiting
+    for its reply longer than the hedging delay. Sends a duplicate request.
+  */
+void QWebMethodCall::hedgeDelayExpired()
+{
+    Q_D(QWebMethodCall);
+    d->hedgeTimerId = 0;
+    if (d->finished)
+        return;
+
+    d->method->d_func()->hedge(this);
+}
+
+/*!
+    \internal
+
+    Private slot, connected to finished() signal of the duplicate request.
+    The first successful reply wins, and the other request is aborted.
+    A failed duplicate is dropped, unless the original request has failed,
+    too.
+  */
+void QWebMethodCall::hedgeReplyFinished()
+{
+    Q_D(QWebMethodCall);
+    if (!d->hedgeReply)
+        return;
+
+    if ((d->hedgeReply->error() != QNetworkReply::NoError) && d->networkReply) {
+        d->stopHedging();
+        return;
+    }
+
+    d->promoteHedge();
+    d->method->replyFinished(d->networkReply);
+}
+
+/*!
+    \internal
+
+    Initialises the call of \a webMethod, that sends \a data.
+  */
+void QWebMethodCallPrivate::init(QWebMethod *webMethod, const QByteArray &data)
+{
+    requestId = lastRequestId.fetchAndAddOrdered(1) + 1;
+    finished = false;
+    autoDelete = true;
+    errorCode = QWebMethodCall::NoError;
+    method = webMethod;
+    networkReply = 0;
+    requestData = data;
+    streaming = false;
+    decoding = false;
+    decodingStarted = false;
+    timeout = 0;
+    timerId = 0;
+    httpMethod = QWebMethod::Post;
+    upload = 0;
+    replyBuffer.setSpillThreshold(webMethod->d_func()->replySpillThreshold);
+    attempts = 0;
+    retryDelay = 0;
+    sendTimerId = 0;
+    chunksDelivered = false;
+    circuitAcquired = false;
+    sentAt = 0;
+    hedgeReply = 0;
+    hedgeTimerId = 0;
+    admitted = false;
+    pendingError = QWebMethodCall::NoError;
+    following = false;
+}
+
+/*!
+    \internal
+
+    Binds the network \a reply to this call. Reply's own finished() signal
+    is used, instead of the one of the (shared) network manager, so that
+    the reply is delivered to this call only. Reply data is read as it
+    arrives, so that it can be inflated and streamed on the fly.
+  */
+void QWebMethodCallPrivate::setNetworkReply(QNetworkReply *reply)
+{
+    Q_Q(QWebMethodCall);
+    networkReply = reply;
+    if (!reply)
+        return;
+
+    QObject::connect(reply, SIGNAL(readyRead()), q, SLOT(networkReplyReadyRead()));
+    QObject::connect(reply, SIGNAL(finished()), q, SLOT(networkReplyFinished()));
+}
+
+/*!
+    \internal
+
+    Turns streaming mode on for this call. Reply chunks are also written
+    to \a device, if it is not 0.
+  */
+void QWebMethodCallPrivate::setStreaming(QIODevice *device)
+{
+    streaming = true;
+    streamDevice = device;
+}
+
+/*!
+    \internal
+
+    Turns inflating of compressed replies on or off (\a enabled).
+    Network manager does not inflate replies when Accept-Encoding
+    header is set by QWebMethod, so the call has to do it.
+  */
+void QWebMethodCallPrivate::setDecodingEnabled(bool enabled)
+{
+    decoding = enabled;
+}
+
+/*!
+    \internal
+
+    Reads all data available in the network reply, and inflates it when
+    necessary. In streaming mode, the data is written to the stream device,
+    and emitted as a chunk, otherwise it is added to the reply buffer.
+
+    Aborts the call when the data cannot be inflated, or when the device
+    (or the temporary file of the buffer) does not accept it.
+  */
+void QWebMethodCallPrivate::readChunk()
+{
+    Q_Q(QWebMethodCall);
+    if (!networkReply || (networkReply->bytesAvailable() <= 0))
+        return;
+
+    QWebMethodPrivate *methodData = method->d_func();
+    QByteArray chunk = networkReply->readAll();
+    methodData->replyBytesReceived += chunk.size();
+
+    if (decoding) {
+        if (!decodingStarted) {
+            codec.begin(QWebContentCodec::encoding(networkReply->rawHeader("Content-Encoding")));
+            decodingStarted = true;
+        }
+
+        QByteArray inflated;
+        if (!codec.inflate(chunk, &inflated)) {
+            abort(QWebMethodCall::DecodingError, codec.errorString());
+            return;
+        }
+
+        chunk = inflated;
+    }
+
+    methodData->replyBytes += chunk.size();
+
+    if (!streaming) {
+        if (!replyBuffer.append(chunk))
+            abort(QWebMethodCall::DeviceError, replyBuffer.errorString());
+        return;
+    }
+
+    // Retrying would deliver the same data again.
+    chunksDelivered = true;
+
+    if (streamDevice && (streamDevice->write(chunk) != chunk.size())) {
+        abort(QWebMethodCall::DeviceError,
+              QString(QLatin1String("Could not write reply to the stream device: ")
+                      + streamDevice->errorString()));
+        return;
+    }
+
+    emit q->chunkReady(chunk);
+    emit method->replyChunkReady(chunk);
+}
+
+/*!
+    \internal
+
+    Checks that the inflated reply is complete, once the network reply has
+    finished. Aborts the call, and returns false, when it is not.
+  */
+bool QWebMethodCallPrivate::finishDecoding()
+{
+    if (!decoding || !decodingStarted || codec.finish())
+        return true;
+
+    abort(QWebMethodCall::DecodingError, codec.errorString());
+    return false;
+}
+
+/*!
+    \internal
+
+    Sets the deadline of the call to \a msecs from now, replacing the
+    previous one. Deadline is removed when \a msecs is 0.
+  */
+void QWebMethodCallPrivate::startTimer(int msecs)
+{
+    Q_Q(QWebMethodCall);
+    stopTimer();
+    if (msecs > 0)
+        timerId = QWebTimerQueue::instance()->schedule(msecs, q, "deadlineExpired");
+}
+
+/*!
+    \internal
+
+    Removes the deadline of the call.
+  */
+void QWebMethodCallPrivate::stopTimer()
+{
+    if (timerId != 0) {
+        QWebTimerQueue::instance()->cancel(timerId);
+        timerId = 0;
+    }
+}
+
+/*!
+    \internal
+
+    Schedules sending of the request in \a msecs milliseconds.
+  */
+void QWebMethodCallPrivate::scheduleSend(int msecs)
+{
+    Q_Q(QWebMethodCall);
+    sendTimerId = QWebTimerQueue::instance()->schedule(msecs, q, "sendDelayExpired");
+}
+
+/*!
+    \internal
+
+    Unbinds the failed network reply, discards data read from it, and
+    schedules next attempt in \a msecs milliseconds.
+  */
+void QWebMethodCallPrivate::scheduleRetry(int msecs)
+{
+    Q_Q(QWebMethodCall);
+    if (networkReply) {
+        QObject::disconnect(networkReply, 0, q, 0);
+        networkReply = 0;
+    }
+
+    stopHedging();
+    replyBuffer.clear();
+    decodingStarted = false;
+    scheduleSend(msecs);
+}
+
+/*!
+    \internal
+
+    Returns rate limit tokens taken for a request that has not been sent.
+  */
+void QWebMethodCallPrivate::refundTokens()
+{
+    if (!admitted)
+        return;
+
+    admitted = false;
+    foreach (const QSharedPointer<QWebTokenBucket> &bucket, reservedTokens)
+        bucket->refund();
+    reservedTokens.clear();
+}
+
+/*!
+    \internal
+
+    Schedules a duplicate request in \a msecs milliseconds. Does nothing
+    if \a msecs is 0.
+  */
+void QWebMethodCallPrivate::startHedgeTimer(int msecs)
+{
+    Q_Q(QWebMethodCall);
+    if (hedgeTimerId != 0) {
+        QWebTimerQueue::instance()->cancel(hedgeTimerId);
+        hedgeTimerId = 0;
+    }
+
+    if (msecs > 0)
+        hedgeTimerId = QWebTimerQueue::instance()->schedule(msecs, q, "hedgeDelayExpired");
+}
+
+/*!
+    \internal
+
+    Binds the network \a reply of the duplicate request to this call.
+    Its data is not read until it wins, see promoteHedge().
+  */
+void QWebMethodCallPrivate::setHedgeReply(QNetworkReply *reply)
+{
+    Q_Q(QWebMethodCall);
+    hedgeReply = reply;
+    if (reply)
+        QObject::connect(reply, SIGNAL(finished()), q, SLOT(hedgeReplyFinished()));
+}
+
+/*!
+    \internal
+
+    Makes the duplicate request the one bound to this call. The original
+    request is aborted, and data read from it is discarded.
+  */
+void QWebMethodCallPrivate::promoteHedge()
+{
+    Q_Q(QWebMethodCall);
+    QWebMethodPrivate *methodData = method->d_func();
+    if (networkReply) {
+        QNetworkReply *netReply = networkReply;
+        networkReply = 0;
+        QObject::disconnect(netReply, 0, q, 0);
+        methodData->calls.remove(netReply);
+        netReply->abort();
+        netReply->deleteLater();
+    }
+
+    QObject::disconnect(hedgeReply, 0, q, 0);
+    networkReply = hedgeReply;
+    hedgeReply = 0;
+    methodData->calls.insert(networkReply, q);
+    methodData->hedgesWon++;
+    replyBuffer.clear();
+    decodingStarted = false;
+}
+
+/*!
+    \internal
+
+    Cancels the duplicate request, and its timer.
+  */
+void QWebMethodCallPrivate::stopHedging()
+{
+    Q_Q(QWebMethodCall);
+    if (hedgeTimerId != 0) {
+        QWebTimerQueue::instance()->cancel(hedgeTimerId);
+        hedgeTimerId = 0;
+    }
+
+    if (hedgeReply) {
+        QNetworkReply *netReply = hedgeReply;
+        hedgeReply = 0;
+        QObject::disconnect(netReply, 0, q, 0);
+        netReply->abort();
+        netReply->deleteLater();
+    }
+}
+
+/*!
+    \internal
+
+    Finishes the call in error state (\a code, \a errMessage), when control
+    returns to the event loop. Used when the call fails before it is
+    returned to the user, so that the signals can still be received.
+  */
+void QWebMethodCallPrivate::failLater(QWebMethodCall::Error code, const QString &errMessage)
+{
+    Q_Q(QWebMethodCall);
+    pendingError = code;
+    pendingErrorMessage = errMessage;
+    QMetaObject::invokeMethod(q, "pendingErrorReady", Qt::QueuedConnection);
+}
+
+/*!
+    \internal
+
+    Finishes the call with \a replyData, without sending anything, when
+    control returns to the event loop. Used for replies found
+    in QWebResponseCache.
+  */
+void QWebMethodCallPrivate::finishLater(const QByteArray &replyData)
+{
+    Q_Q(QWebMethodCall);
+    pendingReply = replyData;
+    QMetaObject::invokeMethod(q, "pendingReplyReady", Qt::QueuedConnection);
+}
+
+/*!
+    \internal
+
+    Finishes a call that has not been sent itself, with \a replyData.
+    Reply is also stored in the web method, as if it came from the network.
+  */
+void QWebMethodCallPrivate::deliver(const QByteArray &replyData)
+{
+    QWebMethod *webMethod = method;
+    webMethod->d_func()->reply = replyData;
+    webMethod->d_func()->replyMapping = replyMapping;
+    webMethod->d_func()->replyReceived = true;
+    finish(replyData);
+    if (webMethod->receivers(SIGNAL(replyReady(QByteArray))) > 0)
+        emit webMethod->replyReady(QWebReplyBuffer::detached(replyData, replyMapping));
+}
+
+/*!
+    \internal
+
+    Finishes \a waiting calls (followers of a coalesced call) with its reply
+    (\a replyData, mapped from a file held by \a mapping, if it has been
+    spilled), and its error (\a code, \a errMessage).
+  */
+void QWebMethodCallPrivate::finishFollowers(const QList<QPointer<QWebMethodCall> > &waiting,
+                                            const QByteArray &replyData,
+                                            const QWebReplyMapping &mapping,
+                                            QWebMethodCall::Error code,
+                                            const QString &errMessage)
+{
+    foreach (const QPointer<QWebMethodCall> &follower, waiting) {
+        if (follower.isNull() || follower->isFinished())
+            continue;
+
+        QWebMethodCallPrivate *followerData = follower->d_func();
+        followerData->replyMapping = mapping;
+        if (code != QWebMethodCall::NoError)
+            followerData->enterErrorState(code, errMessage);
+        followerData->deliver(replyData);
+    }
+}
+
+/*!
+    \internal
+
+    Sends the request of the first of \a waiting calls that is still
+    waiting, in place of a call with flight \a key that has been cancelled,
+    has timed out or has been deleted. Other calls wait for it then.
+    When an identical call has been made in the meantime, all of them
+    wait for that one instead.
+  */
+void QWebMethodCallPrivate::promoteFollower(const QList<QPointer<QWebMethodCall> > &waiting,
+                                            const QByteArray &key)
+{
+    QList<QPointer<QWebMethodCall> > rest = waiting;
+    while (!rest.isEmpty()) {
+        QPointer<QWebMethodCall> follower = rest.takeFirst();
+        if (follower.isNull() || follower->isFinished())
+            continue;
+
+        QWebMethodCall *leader = flightLeader(key);
+        if (leader) {
+            leader->d_func()->followers.append(follower);
+            leader->d_func()->followers += rest;
+            return;
+        }
+
+        QWebMethodCallPrivate *followerData = follower->d_func();
+        QWebMethodPrivate *methodData = followerData->method->d_func();
+        followerData->following = false;
+        methodData->waitingCalls.removeAll(follower.data());
+        followerData->followers = rest;
+        if (!methodData->send(follower)) {
+            followerData->abort(QWebMethodCall::NetworkError,
+                                QLatin1String("Request could not be sent."));
+            return;
+        }
+
+        if (!key.isEmpty() && !followerData->finished)
+            followerData->startFlight(key);
+        return;
+    }
+}
+
+/*!
+    \internal
+
+    Returns a call of this thread, that is in flight with \a key,
+    or 0 if there is none.
+  */
+QWebMethodCall *QWebMethodCallPrivate::flightLeader(const QByteArray &key)
+{
+    return flights()->value(key);
+}
+
+/*!
+    \internal
+
+    Registers this call as in flight with \a key, so that identical calls
+    can wait for its reply, instead of sending their own requests.
+  */
+void QWebMethodCallPrivate::startFlight(const QByteArray &key)
+{
+    Q_Q(QWebMethodCall);
+    flightKey = key;
+    flights()->insert(key, q);
+}
+
+/*!
+    \internal
+
+    Stops new calls from waiting for this one.
+  */
+void QWebMethodCallPrivate::endFlight()
+{
+    Q_Q(QWebMethodCall);
+    if (flightKey.isEmpty())
+        return;
+
+    QHash<QByteArray, QWebMethodCall *> *inFlight = flights();
+    if (inFlight->value(flightKey) == q)
+        inFlight->remove(flightKey);
+    flightKey.clear();
+}
+
+/*!
+    \internal
+
+    Marks the request as sent to circuit with \a key.
+  */
+void QWebMethodCallPrivate::acquireCircuit(const QString &key)
+{
+    circuitKey = key;
+    circuitAcquired = true;
+}
+
+/*!
+    \internal
+
+    Reports \a result of the request to the circuit breaker, if the request
+    has been counted by it.
+  */
+void QWebMethodCallPrivate::releaseCircuit(QWebCircuitBreakerPrivate::Result result)
+{
+    if (!circuitAcquired)
+        return;
+
+    circuitAcquired = false;
+    QWebCircuitBreakerPrivate::release(circuitKey, result,
+                                       QWebClock::now() - sentAt);
+}
+
+/*!
+    \internal
+
+    Takes the endpoint for the current attempt from \a loadBalancer,
+    and directs the request to it.
+  */
+void QWebMethodCallPrivate::acquireEndpoint(const QSharedPointer<QWebLoadBalancer> &loadBalancer)
+{
+    QUrl url = loadBalancer->acquire();
+    if (url.isEmpty())
+        return;
+
+    balancer = loadBalancer;
+    endpoint = url;
+    request.setUrl(url);
+}
+
+/*!
+    \internal
+
+    Reports \a result of the current attempt to the load balancer,
+    if the endpoint has been chosen by it.
+  */
+void QWebMethodCallPrivate::releaseEndpoint(QWebCircuitBreakerPrivate::Result result)
+{
+    if (balancer.isNull())
+        return;
+
+    int latency = -1;
+    if (result != QWebCircuitBreakerPrivate::Ignored)
+        latency = int(QWebClock::now() - sentAt);
+
+    balancer->release(endpoint, latency, (result == QWebCircuitBreakerPrivate::Failure));
+    balancer.clear();
+}
+
+/*!
+    \internal
+
+    Moves the body collected in the reply buffer to the reply. Aborts the call,
+    and returns false, if a spilled reply cannot be mapped.
+  */
+bool QWebMethodCallPrivate::takeReply()
+{
+    if (!replyBuffer.take(&reply, &replyMapping)) {
+        abort(QWebMethodCall::DeviceError, replyBuffer.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+    \internal
+
+    Stores \a replyData, checks bound network reply for errors, and emits
+    all signals of a finished call.
+  */
+void QWebMethodCallPrivate::finish(const QByteArray &replyData)
+{
+    Q_Q(QWebMethodCall);
+    reply = replyData;
+    finished = true;
+    stopTimer();
+    if (sendTimerId != 0) {
+        QWebTimerQueue::instance()->cancel(sendTimerId);
+        sendTimerId = 0;
+    }
+    stopHedging();
+    refundTokens();
+
+    if (networkReply && (networkReply->error() != QNetworkReply::NoError))
+        enterErrorState(QWebMethodCall::NetworkError, networkReply->errorString());
+    networkReply = 0;
+
+    if (following) {
+        following = false;
+        method->d_func()->waitingCalls.removeAll(q);
+    }
+
+    // Taken before the signals are emitted, the call can be deleted
+    // by their receivers.
+    QByteArray key = flightKey;
+    endFlight();
+    QList<QPointer<QWebMethodCall> > waiting = followers;
+    followers.clear();
+    QWebMethodCall::Error code = errorCode;
+    QString errMessage = errorMessage.trimmed();
+    QByteArray replyData = reply;
+    QWebReplyMapping mapping = replyMapping;
+    bool deleteSelf = autoDelete;
+    QPointer<QWebMethodCall> guard(q);
+
+    // Mapped reply is copied only when there is someone to keep it.
+    if (q->receivers(SIGNAL(replyReady(QByteArray))) > 0)
+        emit q->replyReady(QWebReplyBuffer::detached(replyData, mapping));
+    emit q->finished();
+
+    // Cancelling or timing out this call says nothing about the reply,
+    // so waiting calls do not share the error.
+    if ((code == QWebMethodCall::CancelledError) || (code == QWebMethodCall::TimeoutError))
+        promoteFollower(waiting, key);
+    else
+        finishFollowers(waiting, replyData, mapping, code, errMessage);
+    if (deleteSelf && !guard.isNull())
+        q->deleteLater();
+}
+
+/*!
+    \internal
+
+    Aborts the network request, and finishes the call in error state
+    (\a code, \a errMessage).
+  */
+void QWebMethodCallPrivate::abort(QWebMethodCall::Error code,
+                                  const QString &errMessage)
+{
+    if (finished)
+        return;
+
+    // Only timeouts say something about the health of the host.
+    QWebCircuitBreakerPrivate::Result result = (code == QWebMethodCall::TimeoutError)
+            ? QWebCircuitBreakerPrivate::Failure : QWebCircuitBreakerPrivate::Ignored;
+    releaseCircuit(result);
+    releaseEndpoint(result);
+    if (networkReply) {
+        QNetworkReply *netReply = networkReply;
+        networkReply = 0;
+        // Reply is not routed to the call after it is taken off the list.
+        method->d_func()->calls.remove(netReply);
+        netReply->abort();
+        netReply->deleteLater();
+    }
+
+    enterErrorState(code, errMessage);
+    finish(QByteArray());
+}
+
+/*!
+    \internal
+
+    Enters into error state with \a code and message \a errMessage.
+  */
+bool QWebMethodCallPrivate::enterErrorState(QWebMethodCall::Error code,
+                                            const QString &errMessage)
+{
+    Q_Q(QWebMethodCall);
+    errorCode = code;
+    errorMessage += QString(errMessage + QLatin1String(" "));
+    emit q->errorEncountered(errMessage);
+    return false;
+}
@@ -0,0 +1,122 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <QtCore/qthreadstorage.h>
+#include <QtCore/qcryptographichash.h>
+#include "../headers/qwebnetworkmanagerpool_p.h"
+
+/*!
+    \class QWebNetworkManagerPool
+    \internal
+    \brief Shares QNetworkAccessManagers between web methods.
+
+    Every QNetworkAccessManager keeps its own cache of open (keep-alive)
+    connections. Creating a manager for each QWebMethod means that methods
+    talking to the same host never reuse each other's TCP or TLS connections.
+
+    The pool holds one manager per thread, host and set of credentials.
+    QWebMethod, QWebServiceMethod and QWsdl all ask the pool for a manager,
+    instead of constructing their own. Managers are created lazily, in the
+    thread that asks for them (QNetworkAccessManager is bound to the thread it
+    lives in), and are deleted when that thread finishes.
+
+    Because a manager is shared, its finished() and authenticationRequired()
+    signals are delivered to all users of that manager. Users should connect
+    to finished() signal of each QNetworkReply instead. Requests have to
+    be marked with QNetworkRequest::setOriginatingObject(), so that each user
+    can recognise its own replies in authenticationRequired().
+  */
+
+static QThreadStorage<QWebNetworkManagerPoolData *> managerPoolStorage;
+
+/*!
+    \internal
+
+    Deletes all managers held by the pool of a finished thread.
+  */
+QWebNetworkManagerPoolData::~QWebNetworkManagerPoolData()
+{
+    qDeleteAll(managers);
+    managers.clear();
+}
+
+/*!
+    Returns network manager for \a hostUrl, to be used with \a username
+    and \a password. Only scheme, host and port of \a hostUrl are taken into
+    account, so all methods of a single web service get the same manager.
+
+    Returned manager lives in current thread, and is owned by the pool.
+    Do not delete it.
+  */
+QNetworkAccessManager *QWebNetworkManagerPool::manager(const QUrl &hostUrl,
+                                                       const QString &username,
+                                                       const QString &password)
+{
+    QWebNetworkManagerPoolData *data = localData();
+    QString managerKey = key(hostUrl, username, password);
+
+    QNetworkAccessManager *result = data->managers.value(managerKey);
+    if (!result) {
+        result = new QNetworkAccessManager;
+        data->managers.insert(managerKey, result);
+    }
+
+    return result;
+}
+
+/*!
+    Returns number of managers created in current thread.
+  */
+int QWebNetworkManagerPool::count()
+{
+    return localData()->managers.size();
+}
+
+/*!
+    \internal
+
+    Creates the pool key from \a hostUrl, \a username and \a password.
+    Password is hashed, so that it is not kept in plain text in the key.
+  */
+QString QWebNetworkManagerPool::key(const QUrl &hostUrl, const QString &username,
+                                    const QString &password)
+{
+    QString result = hostUrl.scheme().toLower() + QLatin1String("://")
+            + hostUrl.host().toLower() + QLatin1Char(':')
+            + QString::number(hostUrl.port());
+
+    if (!username.isEmpty() || !password.isEmpty()) {
+        result += QLatin1Char('\n') + username + QLatin1Char('\n')
+                + QLatin1String(QCryptographicHash::hash(password.toUtf8(),
+                                                         QCryptographicHash::Sha1).toHex());
+    }
+
+    return result;
+}
+
+/*!
+    \internal
+
+    Returns pool data of current thread, creating it when necessary.
+  */
+QWebNetworkManagerPoolData *QWebNetworkManagerPool::localData()
+{
+    if (!managerPoolStorage.hasLocalData())
+        managerPoolStorage.setLocalData(new QWebNetworkManagerPoolData);
+
+    return managerPoolStorage.localData();
+}
@@ -0,0 +1,294 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <math.h>
+#include <QtCore/qhash.h>
+#include "../headers/qwebratelimit_p.h"
+#include "../headers/qwebcircuitbreaker_p.h"
+#include "../headers/qwebclock_p.h"
+
+/*!
+    \class QWebRateLimit
+    \brief Describes how many calls can be sent in a period of time.
+
+    Rate limits are token buckets: a bucket holds up to burst() tokens,
+    and is refilled with callsPerSecond() tokens each second. Every request
+    takes one token. When the bucket is empty, the request waits until
+    a token is available, or fails with QWebMethodCall::RateLimitedError,
+    when it would have to wait longer than maxDelay().
+
+    Limits can be set for a single web method (QWebMethod::setRateLimit()),
+    for a web service (QWebService::setRateLimit(), shared by all of its
+    methods), and for a host (setHostLimit(), shared by the whole process).
+    A request has to get a token from each bucket that applies to it.
+
+    Waiting requests are woken up by a timer, set for the moment their
+    token becomes available, so the limit can be used up almost completely,
+    without polling, and without bursts above the limit. Retries
+    (see QWebMethod::setRetryPolicy()) take tokens, too.
+
+    \code
+    // 5 calls per second, up to 10 at once, queue for at most 2 seconds.
+    service->setRateLimit(QWebRateLimit(5, 10, 2000));
+    \endcode
+  */
+
+/*!
+    \internal
+
+    Process-wide registry of host buckets.
+  */
+class QWebRateLimitRegistry
+{
+public:
+    QMutex mutex;
+    QHash<QString, QSharedPointer<QWebTokenBucket> > hostBuckets;
+};
+
+Q_GLOBAL_STATIC(QWebRateLimitRegistry, rateLimitRegistry)
+
+/*!
+    Constructs a disabled limit.
+  */
+QWebRateLimit::QWebRateLimit() :
+    d(new QWebRateLimitData)
+{
+}
+
+/*!
+    Constructs a limit of \a callsPerSecond calls per second, allowing
+    \a burst calls at once. Calls wait for at most \a maxDelay milliseconds
+    for their turn (-1 means: as long as needed, 0 means: calls above
+    the limit fail immediately).
+  */
+QWebRateLimit::QWebRateLimit(double callsPerSecond, int burst, int maxDelay) :
+    d(new QWebRateLimitData)
+{
+    setCallsPerSecond(callsPerSecond);
+    setBurst(burst);
+    setMaxDelay(maxDelay);
+}
+
+/*!
+    Constructs a copy of \a other.
+  */
+QWebRateLimit::QWebRateLimit(const QWebRateLimit &other) :
+    d(other.d)
+{
+}
+
+/*!
+    Assigns \a other to this limit.
+  */
+QWebRateLimit &QWebRateLimit::operator=(const QWebRateLimit &other)
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+    Destroys the limit.
+  */
+QWebRateLimit::~QWebRateLimit()
+{
+}
+
+/*!
+    Returns true if the limit is set (callsPerSecond() is greater than 0).
+  */
+bool QWebRateLimit::isEnabled() const
+{
+    return (d->callsPerSecond > 0);
+}
+
+/*!
+    Returns number of calls allowed per second.
+
+    \sa setCallsPerSecond()
+  */
+double QWebRateLimit::callsPerSecond() const
+{
+    return d->callsPerSecond;
+}
+
+/*!
+    Sets number of calls allowed per second (\a rate). Values below 1
+    are allowed, for example 0.5 means one call every 2 seconds.
+
+    \sa callsPerSecond()
+  */
+void QWebRateLimit::setCallsPerSecond(double rate)
+{
+    d->callsPerSecond = qMax(rate, 0.0);
+}
+
+/*!
+    Returns number of calls that can be sent at once, after a period
+    of inactivity. Default is 1.
+
+    \sa setBurst()
+  */
+int QWebRateLimit::burst() const
+{
+    return d->burst;
+}
+
+/*!
+    Sets number of \a calls that can be sent at once.
+
+    \sa burst()
+  */
+void QWebRateLimit::setBurst(int calls)
+{
+    d->burst = qMax(calls, 1);
+}
+
+/*!
+    Returns the longest time (in milliseconds) a call waits for its turn.
+    -1 (default) means no limit, 0 means that calls above the limit are
+    rejected immediately.
+
+    \sa setMaxDelay()
+  */
+int QWebRateLimit::maxDelay() const
+{
+    return d->maxDelay;
+}
+
+/*!
+    Sets the longest time (\a msecs) a call waits for its turn.
+
+    \sa maxDelay()
+  */
+void QWebRateLimit::setMaxDelay(int msecs)
+{
+    d->maxDelay = qMax(msecs, -1);
+}
+
+/*!
+    Returns the limit set for \a host, or a disabled limit.
+
+    \sa setHostLimit()
+  */
+QWebRateLimit QWebRateLimit::hostLimit(const QUrl &host)
+{
+    QSharedPointer<QWebTokenBucket> bucket = QWebTokenBucket::hostBucket(host);
+    if (bucket.isNull())
+        return QWebRateLimit();
+
+    return bucket->limit();
+}
+
+/*!
+    Sets the \a limit for all calls sent to \a host (scheme, host name
+    and port are taken into account), by all web methods of the process.
+    Disabled \a limit removes the limit of the host.
+
+    \sa hostLimit()
+  */
+void QWebRateLimit::setHostLimit(const QUrl &host, const QWebRateLimit &limit)
+{
+    QString hostKey = QWebCircuitBreakerPrivate::key(host);
+    QWebRateLimitRegistry *registry = rateLimitRegistry();
+    QMutexLocker locker(&registry->mutex);
+
+    if (limit.isEnabled()) {
+        registry->hostBuckets.insert(hostKey, QSharedPointer<QWebTokenBucket>(
+                                         new QWebTokenBucket(limit)));
+    } else {
+        registry->hostBuckets.remove(hostKey);
+    }
+}
+
+/*!
+    \class QWebTokenBucket
+    \internal
+    \brief Thread-safe token bucket, implementing QWebRateLimit.
+
+    Tokens are reserved in advance: when the bucket is empty, reserve()
+    takes a token that will be available in the future (token count goes
+    below 0), and returns the time to wait for it. Each waiting request
+    knows exactly when it can be sent, so it needs a single wake-up.
+  */
+
+/*!
+    Constructs a full bucket for \a limit.
+  */
+QWebTokenBucket::QWebTokenBucket(const QWebRateLimit &limit) :
+    m_limit(limit), tokens(limit.burst()),
+    lastRefill(QWebClock::now())
+{
+}
+
+/*!
+    Returns the limit of the bucket.
+  */
+QWebRateLimit QWebTokenBucket::limit() const
+{
+    QMutexLocker locker(&mutex);
+    return m_limit;
+}
+
+/*!
+    Takes a token. Returns time (in milliseconds) to wait before the request
+    can be sent, or -1 when the request would have to wait longer than
+    QWebRateLimit::maxDelay() (no token is taken then).
+  */
+int QWebTokenBucket::reserve()
+{
+    qint64 now = QWebClock::now();
+    QMutexLocker locker(&mutex);
+
+    double rate = m_limit.callsPerSecond();
+    if (rate <= 0)
+        return 0;
+
+    tokens = qMin(tokens + ((now - lastRefill) * rate) / 1000.0, double(m_limit.burst()));
+    lastRefill = now;
+
+    int delay = 0;
+    if (tokens < 1.0)
+        delay = int(ceil(((1.0 - tokens) * 1000.0) / rate));
+
+    if ((m_limit.maxDelay() >= 0) && (delay > m_limit.maxDelay()))
+        return -1;
+
+    tokens -= 1.0;
+    return delay;
+}
+
+/*!
+    Returns a token, taken by a request that has not been sent
+    (for example, because it was cancelled while waiting).
+  */
+void QWebTokenBucket::refund()
+{
+    QMutexLocker locker(&mutex);
+    tokens = qMin(tokens + 1.0, double(m_limit.burst()));
+}
+
+/*!
+    Returns the bucket of \a host, or a null pointer, if the host has no
+    limit.
+  */
+QSharedPointer<QWebTokenBucket> QWebTokenBucket::hostBucket(const QUrl &host)
+{
+    QString hostKey = QWebCircuitBreakerPrivate::key(host);
+    QWebRateLimitRegistry *registry = rateLimitRegistry();
+    QMutexLocker locker(&registry->mutex);
+    return registry->hostBuckets.value(hostKey);
+}
@@ -0,0 +1,207 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <limits.h>
+#include "../headers/qwebreplybuffer_p.h"
+
+/*!
+    \class QWebReplyBuffer
+    \internal
+    \brief Collects body of a reply, and moves it to a temporary file when
+    it grows too big.
+
+    Pieces of the reply are appended as they arrive. While the reply is
+    smaller than spill threshold, it is kept in memory. Once it grows past
+    the threshold, everything is written to a temporary file, and so is
+    every following piece.
+
+    take() returns the reply. A reply kept in a file is memory-mapped, and
+    returned as a QByteArray that does not own its data (see
+    QByteArray::fromRawData()): pages are read from the file as they are
+    used, and can be dropped by the system at any time, so resident memory
+    stays bounded however big the reply is. The mapping lasts as long as any
+    copy of QWebReplyMapping returned with it exists.
+  */
+
+/*!
+    \typedef QWebReplyMapping
+    \internal
+
+    Shared pointer to the temporary file a reply is mapped from.
+  */
+
+/*!
+    Constructs an empty buffer, which spills to a file above
+    \a spillThreshold bytes (0 means never).
+  */
+QWebReplyBuffer::QWebReplyBuffer(qint64 spillThreshold) :
+    m_spillThreshold(qMax(spillThreshold, qint64(0))), m_size(0)
+{
+}
+
+/*!
+    Returns size (in bytes) above which the reply is moved to a temporary
+    file, or 0 when it is always kept in memory.
+  */
+qint64 QWebReplyBuffer::spillThreshold() const
+{
+    return m_spillThreshold;
+}
+
+/*!
+    Sets size (in bytes) above which the reply is moved to a temporary
+    file to \a bytes. 0 keeps it in memory. Applies to data appended later.
+  */
+void QWebReplyBuffer::setSpillThreshold(qint64 bytes)
+{
+    m_spillThreshold = qMax(bytes, qint64(0));
+}
+
+/*!
+    Appends \a chunk to the reply. Returns false if the temporary file
+    could not be created or written, errorString() says why.
+  */
+bool QWebReplyBuffer::append(const QByteArray &chunk)
+{
+    if (chunk.isEmpty())
+        return true;
+
+    m_size += chunk.size();
+    if (file.isNull()) {
+        if ((m_spillThreshold == 0) || (m_size <= m_spillThreshold)) {
+            memory.append(chunk);
+            return true;
+        }
+
+        if (!spill())
+            return false;
+    }
+
+    if (file->write(chunk) != chunk.size()) {
+        m_errorString = QLatin1String("Could not write reply to a temporary file: ")
+                + file->errorString();
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+    Moves the reply to \a data, and leaves the buffer empty. When the reply
+    has been spilled, \a data points into the mapped file, and \a mapping
+    keeps the mapping alive; otherwise \a mapping is set to null.
+
+    Returns false if the file could not be mapped, or if the reply is too
+    big to fit in a QByteArray.
+  */
+bool QWebReplyBuffer::take(QByteArray *data, QWebReplyMapping *mapping)
+{
+    *mapping = QWebReplyMapping();
+    if (file.isNull()) {
+        *data = memory;
+        clear();
+        return true;
+    }
+
+    if (m_size > INT_MAX) {
+        m_errorString = QLatin1String("Reply is too big to be mapped.");
+        *data = QByteArray();
+        clear();
+        return false;
+    }
+
+    uchar *address = file->flush() ? file->map(0, m_size) : 0;
+    if (!address) {
+        m_errorString = QLatin1String("Could not map reply from a temporary file: ")
+                + file->errorString();
+        *data = QByteArray();
+        clear();
+        return false;
+    }
+
+    *data = QByteArray::fromRawData(reinterpret_cast<const char *>(address), int(m_size));
+    *mapping = file;
+    clear();
+    return true;
+}
+
+/*!
+    Discards the reply. A file that is still mapped by a holder of
+    QWebReplyMapping is removed when the last holder lets it go.
+  */
+void QWebReplyBuffer::clear()
+{
+    memory = QByteArray();
+    file.clear();
+    m_size = 0;
+}
+
+/*!
+    Returns \a data, copied when it is mapped from a file held by \a mapping.
+    Mapped replies do not own their data, so they are copied before they
+    are handed out of the library.
+  */
+QByteArray QWebReplyBuffer::detached(const QByteArray &data, const QWebReplyMapping &mapping)
+{
+    if (mapping.isNull())
+        return data;
+
+    return QByteArray(data.constData(), data.size());
+}
+
+/*!
+    Returns size of the reply appended so far.
+  */
+qint64 QWebReplyBuffer::size() const
+{
+    return m_size;
+}
+
+/*!
+    Returns true if the reply has been moved to a temporary file.
+  */
+bool QWebReplyBuffer::isSpilled() const
+{
+    return !file.isNull();
+}
+
+/*!
+    Returns description of the last error.
+  */
+QString QWebReplyBuffer::errorString() const
+{
+    return m_errorString;
+}
+
+/*!
+    \internal
+
+    Creates the temporary file, and writes data collected in memory to it.
+  */
+bool QWebReplyBuffer::spill()
+{
+    QWebReplyMapping spillFile(new QTemporaryFile());
+    if (!spillFile->open() || (spillFile->write(memory) != memory.size())) {
+        m_errorString = QLatin1String("Could not write reply to a temporary file: ")
+                + spillFile->errorString();
+        return false;
+    }
+
+    file = spillFile;
+    memory = QByteArray();
+    return true;
+}
@@ -0,0 +1,322 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <QtCore/qdatetime.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qhash.h>
+#include "../headers/qwebreplydecoder_p.h"
+
+/*!
+    \class QWebReplyDecoder
+    \internal
+    \brief Decodes SOAP and XML replies into typed values.
+
+    decode() reads the reply once, with QXmlStreamReader. SOAP envelope,
+    header and body are skipped; the first element outside of them (the
+    document element, for plain XML) is the response of the method.
+
+    Without a schema, the response is decoded generically: an element
+    with text becomes a QString, and an element with children becomes
+    a QVariantMap of their values (children that occur many times become
+    a QVariantList). A response with a single child (typically
+    <methodResult>) is unwrapped.
+
+    With a schema (return value names and types, see
+    QWebMethod::setReturnValue()), descendants of the response are matched
+    against it by local name, so namespace prefixes do not matter. Elements
+    in other namespaces than the target namespace (or no namespace) are
+    ignored. Matched elements are converted to the declared types
+    (see convert()). Values declared as QStringList or QVariantList are
+    arrays: their items are children of the element, or repeated elements.
+  */
+
+static const char xsiNamespace[] = "http://www.w3.org/2001/XMLSchema-instance";
+static const char soap11Namespace[] = "http://schemas.xmlsoap.org/soap/envelope/";
+static const char soap12Namespace[] = "http://www.w3.org/2003/05/soap-envelope";
+
+/*!
+    Decodes \a reply, with return values described by \a returnValue
+    (names and types), expected in \a targetNamespace.
+
+    Returns the only return value, or a QVariantList with all of them, in
+    order of \a returnValue keys (invalid QVariant for values that are
+    missing). Without \a returnValue, returns the whole response decoded
+    generically.
+
+    Returns invalid QVariant, and sets \a errorString, when the reply is not
+    well-formed, or when it is a SOAP fault.
+  */
+QVariant QWebReplyDecoder::decode(const QByteArray &reply, const QString &targetNamespace,
+                                  const QMap<QString, QVariant> &returnValue,
+                                  QString *errorString)
+{
+    QXmlStreamReader reader(reply);
+    const QString soap11 = QLatin1String(soap11Namespace);
+    const QString soap12 = QLatin1String(soap12Namespace);
+
+    // Finds the response: first element outside of the envelope.
+    bool found = false;
+    while (!found && !reader.atEnd()) {
+        if (reader.readNext() != QXmlStreamReader::StartElement)
+            continue;
+
+        if ((reader.namespaceUri() != soap11) && (reader.namespaceUri() != soap12)) {
+            found = true;
+        } else if (reader.name() == QLatin1String("Header")) {
+            reader.skipCurrentElement();
+        } else if (reader.name() == QLatin1String("Fault")) {
+            QVariantMap fault = readElement(reader).toMap();
+            // SOAP 1.1 has faultstring, SOAP 1.2 has Reason/Text.
+            QString reason = fault.value(QLatin1String("faultstring")).toString();
+            if (reason.isEmpty()) {
+                reason = fault.value(QLatin1String("Reason")).toMap()
+                        .value(QLatin1String("Text")).toString();
+            }
+            if (errorString)
+                *errorString = QLatin1String("SOAP fault: ") + reason.trimmed();
+            return QVariant();
+        }
+    }
+
+    if (!found) {
+        if (errorString) {
+            *errorString = reader.hasError() ? reader.errorString()
+                                             : QString(QLatin1String("Reply is empty."));
+        }
+        return QVariant();
+    }
+
+    QVariant result;
+    if (returnValue.isEmpty()) {
+        result = readElement(reader);
+        if (result.type() == QVariant::Map) {
+            QVariantMap children = result.toMap();
+            if (children.size() == 1)
+                result = children.constBegin().value();
+        }
+    } else {
+        QVariantMap values;
+        int depth = 1;
+        while ((depth > 0) && !reader.atEnd()) {
+            QXmlStreamReader::TokenType token = reader.readNext();
+            if (token == QXmlStreamReader::EndElement) {
+                --depth;
+                continue;
+            } else if (token != QXmlStreamReader::StartElement) {
+                continue;
+            }
+
+            QString name = reader.name().toString();
+            QMap<QString, QVariant>::const_iterator type = returnValue.constFind(name);
+            bool inNamespace = targetNamespace.isEmpty() || reader.namespaceUri().isEmpty()
+                    || (reader.namespaceUri() == targetNamespace);
+            if ((type == returnValue.constEnd()) || !inNamespace) {
+                ++depth;
+                continue;
+            }
+
+            bool array = (type.value().type() == QVariant::StringList)
+                    || (type.value().type() == QVariant::List);
+            insertValue(&values, name, readTyped(reader, type.value()), array);
+        }
+
+        if (returnValue.size() == 1) {
+            result = values.value(returnValue.constBegin().key());
+        } else {
+            QVariantList list;
+            foreach (const QString &name, returnValue.keys())
+                list.append(values.value(name));
+            result = list;
+        }
+    }
+
+    if (reader.hasError()) {
+        if (errorString)
+            *errorString = reader.errorString();
+        return QVariant();
+    }
+
+    return result;
+}
+
+/*!
+    Converts \a text of an element to the type of \a type. Numbers are
+    read in C locale, dates and times in ISO 8601 format, QByteArray
+    in base64. Returns \a text if it cannot be converted.
+  */
+QVariant QWebReplyDecoder::convert(const QString &text, const QVariant &type)
+{
+    int typeId = type.userType();
+    switch (typeId) {
+    case QVariant::String:
+    case QVariant::Invalid:
+        return text;
+    case QMetaType::Float:
+        return qVariantFromValue(text.trimmed().toFloat());
+    case QVariant::Bool: {
+        QString value = text.trimmed();
+        return ((value == QLatin1String("true")) || (value == QLatin1String("1")));
+    }
+    case QVariant::Char:
+        return text.isEmpty() ? QChar() : text.at(0);
+    case QVariant::ByteArray:
+        return QByteArray::fromBase64(text.toLatin1());
+    case QVariant::DateTime:
+        return QDateTime::fromString(text.trimmed(), Qt::ISODate);
+    case QVariant::Date:
+        return QDate::fromString(text.trimmed(), Qt::ISODate);
+    case QVariant::Time:
+        return QTime::fromString(text.trimmed(), Qt::ISODate);
+    case QVariant::StringList:
+        return QStringList(text);
+    case QVariant::List:
+        return QVariantList() << text;
+    default:
+        break;
+    }
+
+    QVariant value(text.trimmed());
+    if (value.convert(QVariant::Type(typeId)))
+        return value;
+    return text;
+}
+
+/*!
+    \internal
+
+    Returns true if the current element is nil (xsi:nil="true").
+  */
+bool QWebReplyDecoder::isNil(const QXmlStreamReader &reader)
+{
+    QStringRef nil = reader.attributes().value(QLatin1String(xsiNamespace),
+                                               QLatin1String("nil"));
+    return (nil == QLatin1String("true")) || (nil == QLatin1String("1"));
+}
+
+/*!
+    \internal
+
+    Reads the current element, and returns its text, or a QVariantMap
+    of values of its children. Nil elements are returned as invalid
+    QVariant.
+  */
+QVariant QWebReplyDecoder::readElement(QXmlStreamReader &reader)
+{
+    if (isNil(reader)) {
+        reader.skipCurrentElement();
+        return QVariant();
+    }
+
+    QString text;
+    QVariantMap children;
+    // Repeated elements are collected apart, so that lists are not copied
+    // for every item.
+    QHash<QString, QVariantList> repeated;
+    while (!reader.atEnd()) {
+        QXmlStreamReader::TokenType token = reader.readNext();
+        if (token == QXmlStreamReader::StartElement) {
+            QString name = reader.name().toString();
+            QVariant value = readElement(reader);
+            QVariantMap::const_iterator existing = children.constFind(name);
+            if (existing == children.constEnd()) {
+                children.insert(name, value);
+            } else {
+                QVariantList &list = repeated[name];
+                if (list.isEmpty())
+                    list.append(existing.value());
+                list.append(value);
+            }
+        } else if (token == QXmlStreamReader::Characters) {
+            text += reader.text();
+        } else if (token == QXmlStreamReader::EndElement) {
+            break;
+        }
+    }
+
+    if (children.isEmpty())
+        return text;
+
+    QHash<QString, QVariantList>::const_iterator i;
+    for (i = repeated.constBegin(); i != repeated.constEnd(); ++i)
+        children.insert(i.key(), i.value());
+    return children;
+}
+
+/*!
+    \internal
+
+    Reads the current element, and converts it to the type of \a type.
+    Arrays (QStringList, QVariantList) are made of children of the element,
+    or of its text, if it has no children.
+  */
+QVariant QWebReplyDecoder::readTyped(QXmlStreamReader &reader, const QVariant &type)
+{
+    if (isNil(reader)) {
+        reader.skipCurrentElement();
+        return QVariant();
+    }
+
+    if ((type.type() != QVariant::StringList) && (type.type() != QVariant::List)
+            && (type.type() != QVariant::Map)) {
+        return convert(reader.readElementText(QXmlStreamReader::SkipChildElements), type);
+    }
+
+    QVariant value = readElement(reader);
+    if (type.type() == QVariant::Map)
+        return value;
+    if (value.type() != QVariant::Map)
+        return convert(value.toString(), type);
+
+    QVariantList items;
+    QMapIterator<QString, QVariant> i(value.toMap());
+    while (i.hasNext()) {
+        i.next();
+        if (i.value().type() == QVariant::List)
+            items += i.value().toList();
+        else
+            items.append(i.value());
+    }
+
+    if (type.type() == QVariant::List)
+        return items;
+
+    QStringList strings;
+    foreach (const QVariant &item, items)
+        strings.append(item.toString());
+    return strings;
+}
+
+/*!
+    \internal
+
+    Stores \a value under \a name in \a values. When the name is already
+    present, the value is appended to it, if it is an \a array, and
+    ignored otherwise.
+  */
+void QWebReplyDecoder::insertValue(QVariantMap *values, const QString &name,
+                                   const QVariant &value, bool array)
+{
+    QVariantMap::iterator existing = values->find(name);
+    if (existing == values->end()) {
+        values->insert(name, value);
+    } else if (array) {
+        if (existing.value().type() == QVariant::StringList)
+            existing.value() = existing.value().toStringList() + value.toStringList();
+        else
+            existing.value() = existing.value().toList() + value.toList();
+    }
+}
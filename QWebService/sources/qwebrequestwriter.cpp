@@ -0,0 +1,853 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <string.h>
+#include <QtCore/qnumeric.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qhash.h>
+#include "../headers/qwebrequestwriter_p.h"
+
+/*!
+    \class QWebRequestWriter
+    \internal
+    \brief Serializes requests of web methods straight to UTF-8.
+
+    Request bodies used to be built with QString concatenation, and converted
+    with QString::toLatin1() at the end. That made several full copies of
+    the body (and many reallocations on the way), and replaced all characters
+    outside of Latin-1 with question marks.
+
+    The writer measures the body first (utf8Size(), parametersSize()), so the
+    result is allocated once, with its final size, and then encodes all text
+    directly into it, as UTF-8, escaping it as required by the protocol:
+    XML entities for SOAP and XML, JSON string escapes for JSON,
+    and percent-encoding for HTTP forms.
+
+    Constant parts of a request (envelope and method element) are made by
+    prefix() and suffix(), parameters by writeParameters().
+
+    Parameters holding maps and lists are written recursively: as nested
+    elements in SOAP and XML, as objects and arrays in JSON.
+  */
+
+static const char soap12Header[] =
+        "<?xml version=\"1.0\" encoding=\"utf-8\"?>\r\n"
+        "<soap12:Envelope xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
+        "xmlns:xsd=\"http://www.w3.org/2001/XMLSchema\" "
+        "xmlns:soap12=\"http://www.w3.org/2003/05/soap-envelope\">\r\n"
+        "<soap12:Body>\r\n";
+static const char soap12Footer[] = "</soap12:Body>\r\n</soap12:Envelope>";
+static const char soap10Header[] =
+        "<?xml version=\"1.0\" encoding=\"utf-8\"?>\r\n"
+        "<soap:Envelope xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
+        "xmlns:xsd=\"http://www.w3.org/2001/XMLSchema\" "
+        "xmlns:soap=\"http://www.w3.org/2003/05/soap-envelope\">\r\n"
+        "<soap:Body>\r\n";
+static const char soap10Footer[] = "</soap:Body>\r\n</soap:Envelope>";
+static const char hexDigits[] = "0123456789ABCDEF";
+
+/*!
+    \internal
+
+    Returns size of ASCII character \a ch, escaped with \a escaping.
+  */
+static inline int escapedSize(uchar ch, QWebRequestWriter::Escaping escaping)
+{
+    switch (escaping) {
+    case QWebRequestWriter::XmlEscaping:
+        switch (ch) {
+        case '&': return 5;
+        case '<': return 4;
+        case '>': return 4;
+        case '"': return 6;
+        default: return 1;
+        }
+    case QWebRequestWriter::JsonEscaping:
+        if ((ch == '"') || (ch == '\\') || (ch == '\b') || (ch == '\f')
+                || (ch == '\n') || (ch == '\r') || (ch == '\t'))
+            return 2;
+        return (ch < 0x20) ? 6 : 1;
+    case QWebRequestWriter::FormEscaping:
+        if (((ch >= 'a') && (ch <= 'z')) || ((ch >= 'A') && (ch <= 'Z'))
+                || ((ch >= '0') && (ch <= '9')) || (ch == '-') || (ch == '.')
+                || (ch == '_') || (ch == '~') || (ch == ' '))
+            return 1;
+        return 3;
+    default:
+        return 1;
+    }
+}
+
+/*!
+    \internal
+
+    Writes ASCII character \a ch, escaped with \a escaping, to \a out.
+    Returns the position after the written bytes.
+  */
+static inline char *writeEscaped(char *out, uchar ch, QWebRequestWriter::Escaping escaping)
+{
+    switch (escaping) {
+    case QWebRequestWriter::XmlEscaping:
+        switch (ch) {
+        case '&': memcpy(out, "&amp;", 5); return out + 5;
+        case '<': memcpy(out, "&lt;", 4); return out + 4;
+        case '>': memcpy(out, "&gt;", 4); return out + 4;
+        case '"': memcpy(out, "&quot;", 6); return out + 6;
+        default: *out = char(ch); return out + 1;
+        }
+    case QWebRequestWriter::JsonEscaping:
+        switch (ch) {
+        case '"': memcpy(out, "\\\"", 2); return out + 2;
+        case '\\': memcpy(out, "\\\\", 2); return out + 2;
+        case '\b': memcpy(out, "\\b", 2); return out + 2;
+        case '\f': memcpy(out, "\\f", 2); return out + 2;
+        case '\n': memcpy(out, "\\n", 2); return out + 2;
+        case '\r': memcpy(out, "\\r", 2); return out + 2;
+        case '\t': memcpy(out, "\\t", 2); return out + 2;
+        default:
+            if (ch >= 0x20) {
+                *out = char(ch);
+                return out + 1;
+            }
+            memcpy(out, "\\u00", 4);
+            out[4] = hexDigits[ch >> 4];
+            out[5] = hexDigits[ch & 0xf];
+            return out + 6;
+        }
+    case QWebRequestWriter::FormEscaping:
+        if (ch == ' ') {
+            *out = '+';
+            return out + 1;
+        }
+        if (escapedSize(ch, escaping) == 1) {
+            *out = char(ch);
+            return out + 1;
+        }
+        out[0] = '%';
+        out[1] = hexDigits[ch >> 4];
+        out[2] = hexDigits[ch & 0xf];
+        return out + 3;
+    default:
+        *out = char(ch);
+        return out + 1;
+    }
+}
+
+/*!
+    \internal
+
+    Writes byte \a byte of a multi-byte UTF-8 sequence to \a out,
+    percent-encoded in forms (\a escaping).
+  */
+static inline char *writeByte(char *out, uchar byte, QWebRequestWriter::Escaping escaping)
+{
+    if (escaping != QWebRequestWriter::FormEscaping) {
+        *out = char(byte);
+        return out + 1;
+    }
+
+    out[0] = '%';
+    out[1] = hexDigits[byte >> 4];
+    out[2] = hexDigits[byte & 0xf];
+    return out + 3;
+}
+
+/*!
+    \internal
+
+    Returns number of bytes \a text takes in UTF-8, after escaping
+    it with \a escaping. Unpaired surrogates are replaced with U+FFFD.
+  */
+int QWebRequestWriter::utf8Size(const QString &text, Escaping escaping)
+{
+    // Every byte of a multi-byte sequence takes 3 bytes in forms (%XX).
+    const int byteSize = (escaping == FormEscaping) ? 3 : 1;
+    int size = 0;
+    const QChar *ch = text.constData();
+    const QChar *end = ch + text.size();
+    for (; ch != end; ++ch) {
+        ushort u = ch->unicode();
+        if (u < 0x80) {
+            size += escapedSize(uchar(u), escaping);
+        } else if (u < 0x800) {
+            size += 2 * byteSize;
+        } else if (QChar::isHighSurrogate(u) && ((ch + 1) != end)
+                   && QChar::isLowSurrogate((ch + 1)->unicode())) {
+            size += 4 * byteSize;
+            ++ch;
+        } else {
+            size += 3 * byteSize;
+        }
+    }
+
+    return size;
+}
+
+/*!
+    \internal
+
+    Writes \a text to \a out, as UTF-8 escaped with \a escaping. \a out has
+    to have room for utf8Size() bytes. Returns the position after
+    the written text.
+  */
+char *QWebRequestWriter::writeUtf8(char *out, const QString &text, Escaping escaping)
+{
+    const QChar *ch = text.constData();
+    const QChar *end = ch + text.size();
+    for (; ch != end; ++ch) {
+        uint u = ch->unicode();
+        if (u < 0x80) {
+            out = writeEscaped(out, uchar(u), escaping);
+            continue;
+        }
+
+        if (u < 0x800) {
+            out = writeByte(out, uchar(0xc0 | (u >> 6)), escaping);
+        } else {
+            if (QChar::isHighSurrogate(u) && ((ch + 1) != end)
+                    && QChar::isLowSurrogate((ch + 1)->unicode())) {
+                u = QChar::surrogateToUcs4(ushort(u), (ch + 1)->unicode());
+                ++ch;
+                out = writeByte(out, uchar(0xf0 | (u >> 18)), escaping);
+                out = writeByte(out, uchar(0x80 | ((u >> 12) & 0x3f)), escaping);
+            } else {
+                // Unpaired surrogate.
+                if ((u >= 0xd800) && (u <= 0xdfff))
+                    u = QChar::ReplacementCharacter;
+                out = writeByte(out, uchar(0xe0 | (u >> 12)), escaping);
+            }
+            out = writeByte(out, uchar(0x80 | ((u >> 6) & 0x3f)), escaping);
+        }
+        out = writeByte(out, uchar(0x80 | (u & 0x3f)), escaping);
+    }
+
+    return out;
+}
+
+/*!
+    \internal
+
+    Returns \a text converted to UTF-8, and escaped with \a escaping.
+  */
+QByteArray QWebRequestWriter::toUtf8(const QString &text, Escaping escaping)
+{
+    QByteArray result;
+    result.resize(utf8Size(text, escaping));
+    writeUtf8(result.data(), text, escaping);
+    return result;
+}
+
+/*!
+    \internal
+
+    Returns number of decimal digits of \a value.
+  */
+static inline int digitCount(quint64 value)
+{
+    int digits = 1;
+    for (; value >= 10; value /= 10)
+        ++digits;
+    return digits;
+}
+
+/*!
+    \internal
+
+    Writes decimal digits of \a value to \a out. Returns the position
+    after them.
+  */
+static inline char *writeDigits(char *out, quint64 value)
+{
+    char *end = out + digitCount(value);
+    char *digit = end;
+    do {
+        *--digit = char('0' + (value % 10));
+        value /= 10;
+    } while (value != 0);
+    return end;
+}
+
+/*!
+    \internal
+
+    Returns magnitude of integer \a value, and sets \a negative.
+  */
+static inline quint64 magnitude(const QVariant &value, bool *negative)
+{
+    if (value.type() == QVariant::ULongLong) {
+        *negative = false;
+        return value.toULongLong();
+    }
+
+    qint64 number = value.toLongLong();
+    *negative = (number < 0);
+    // Written this way, so that the minimum value does not overflow.
+    return *negative ? (quint64(-(number + 1)) + 1) : quint64(number);
+}
+
+/*!
+    \internal
+
+    Returns true if \a value is an integer, written to JSON as digits.
+  */
+static inline bool isJsonInteger(const QVariant &value)
+{
+    switch (value.type()) {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*!
+    \internal
+
+    Returns true if \a value is a floating point number. Infinities and NaN
+    cannot be written to JSON, they are written as null.
+  */
+static inline bool isJsonReal(const QVariant &value)
+{
+    return (value.type() == QVariant::Double) || (value.userType() == QMetaType::Float);
+}
+
+/*!
+    \internal
+
+    Returns number of bytes taken by members of \a map (a QVariantMap,
+    or a QVariantHash), written as a JSON object.
+  */
+template <typename Map>
+static int jsonObjectSize(const Map &map)
+{
+    // {"key":value,"key":value}
+    int size = 2 + qMax(map.size() - 1, 0);
+    typename Map::const_iterator i = map.constBegin();
+    for (; i != map.constEnd(); ++i) {
+        size += QWebRequestWriter::utf8Size(i.key(), QWebRequestWriter::JsonEscaping) + 3
+                + QWebRequestWriter::jsonSize(i.value());
+    }
+    return size;
+}
+
+/*!
+    \internal
+
+    Writes members of \a map as a JSON object to \a out. Returns
+    the position after it.
+  */
+template <typename Map>
+static char *writeJsonObject(char *out, const Map &map)
+{
+    *out++ = '{';
+    typename Map::const_iterator i = map.constBegin();
+    for (; i != map.constEnd(); ++i) {
+        if (i != map.constBegin())
+            *out++ = ',';
+        *out++ = '"';
+        out = QWebRequestWriter::writeUtf8(out, i.key(), QWebRequestWriter::JsonEscaping);
+        memcpy(out, "\":", 2);
+        out = QWebRequestWriter::writeJson(out + 2, i.value());
+    }
+    *out++ = '}';
+    return out;
+}
+
+/*!
+    \internal
+
+    Returns number of bytes \a value takes, written as JSON by writeJson().
+  */
+int QWebRequestWriter::jsonSize(const QVariant &value)
+{
+    switch (value.type()) {
+    case QVariant::Map:
+        return jsonObjectSize(*reinterpret_cast<const QVariantMap *>(value.constData()));
+    case QVariant::Hash:
+        return jsonObjectSize(*reinterpret_cast<const QVariantHash *>(value.constData()));
+    case QVariant::List: {
+        const QVariantList &list = *reinterpret_cast<const QVariantList *>(value.constData());
+        int size = 2 + qMax(list.size() - 1, 0);
+        foreach (const QVariant &item, list)
+            size += jsonSize(item);
+        return size;
+    }
+    case QVariant::StringList: {
+        const QStringList &list = *reinterpret_cast<const QStringList *>(value.constData());
+        int size = 2 + qMax(list.size() - 1, 0);
+        foreach (const QString &item, list)
+            size += utf8Size(item, JsonEscaping) + 2;
+        return size;
+    }
+    case QVariant::Bool:
+        return value.toBool() ? 4 : 5;
+    default:
+        break;
+    }
+
+    if (isJsonInteger(value)) {
+        bool negative = false;
+        quint64 number = magnitude(value, &negative);
+        return digitCount(number) + (negative ? 1 : 0);
+    } else if (isJsonReal(value)) {
+        double number = value.toDouble();
+        return qIsFinite(number) ? QByteArray::number(number, 'g', 15).size() : 4;
+    } else if (value.isNull()) {
+        return 4;
+    }
+
+    return utf8Size(value.toString(), JsonEscaping) + 2;
+}
+
+/*!
+    \internal
+
+    Writes \a value to \a out as JSON, recursively: QVariantMap and
+    QVariantHash become objects, QVariantList and QStringList arrays.
+    Numbers and booleans are written as such, null and invalid values as
+    null, and everything else as a string. \a out has to have room for
+    jsonSize() bytes. Returns the position after the written value.
+  */
+char *QWebRequestWriter::writeJson(char *out, const QVariant &value)
+{
+    switch (value.type()) {
+    case QVariant::Map:
+        return writeJsonObject(out, *reinterpret_cast<const QVariantMap *>(value.constData()));
+    case QVariant::Hash:
+        return writeJsonObject(out, *reinterpret_cast<const QVariantHash *>(value.constData()));
+    case QVariant::List: {
+        const QVariantList &list = *reinterpret_cast<const QVariantList *>(value.constData());
+        *out++ = '[';
+        for (int i = 0; i < list.size(); ++i) {
+            if (i > 0)
+                *out++ = ',';
+            out = writeJson(out, list.at(i));
+        }
+        *out++ = ']';
+        return out;
+    }
+    case QVariant::StringList: {
+        const QStringList &list = *reinterpret_cast<const QStringList *>(value.constData());
+        *out++ = '[';
+        for (int i = 0; i < list.size(); ++i) {
+            if (i > 0)
+                *out++ = ',';
+            *out++ = '"';
+            out = writeUtf8(out, list.at(i), JsonEscaping);
+            *out++ = '"';
+        }
+        *out++ = ']';
+        return out;
+    }
+    case QVariant::Bool:
+        if (value.toBool()) {
+            memcpy(out, "true", 4);
+            return out + 4;
+        }
+        memcpy(out, "false", 5);
+        return out + 5;
+    default:
+        break;
+    }
+
+    if (isJsonInteger(value)) {
+        bool negative = false;
+        quint64 number = magnitude(value, &negative);
+        if (negative)
+            *out++ = '-';
+        return writeDigits(out, number);
+    } else if (isJsonReal(value) && qIsFinite(value.toDouble())) {
+        QByteArray number = QByteArray::number(value.toDouble(), 'g', 15);
+        memcpy(out, number.constData(), number.size());
+        return out + number.size();
+    } else if (isJsonReal(value) || value.isNull()) {
+        memcpy(out, "null", 4);
+        return out + 4;
+    }
+
+    *out++ = '"';
+    out = writeUtf8(out, value.toString(), JsonEscaping);
+    *out++ = '"';
+    return out;
+}
+
+/*!
+    \internal
+
+    Returns \a value written as JSON (see writeJson()). The result
+    is allocated once.
+  */
+QByteArray QWebRequestWriter::toJson(const QVariant &value)
+{
+    QByteArray result;
+    result.resize(jsonSize(value));
+    char *out = writeJson(result.data(), value);
+    Q_ASSERT(out == result.constData() + result.size());
+    Q_UNUSED(out);
+    return result;
+}
+
+static int xmlElementSize(const QString &name, const QVariant &value, int depth);
+static char *writeXmlElement(char *out, const QString &name, const QVariant &value, int depth);
+
+/*!
+    \internal
+
+    Returns number of bytes taken by element \a name holding \a text,
+    indented by \a depth tabs.
+  */
+static inline int xmlTextSize(const QString &name, const QString &text, int depth)
+{
+    // <name>text</name>\r\n
+    return depth + 2 * QWebRequestWriter::utf8Size(name, QWebRequestWriter::NoEscaping) + 7
+            + QWebRequestWriter::utf8Size(text, QWebRequestWriter::XmlEscaping);
+}
+
+/*!
+    \internal
+
+    Writes element \a name holding \a text, indented by \a depth tabs,
+    to \a out. Returns the position after it.
+  */
+static inline char *writeXmlText(char *out, const QString &name, const QString &text, int depth)
+{
+    memset(out, '\t', depth);
+    out[depth] = '<';
+    out = QWebRequestWriter::writeUtf8(out + depth + 1, name, QWebRequestWriter::NoEscaping);
+    *out++ = '>';
+    out = QWebRequestWriter::writeUtf8(out, text, QWebRequestWriter::XmlEscaping);
+    memcpy(out, "</", 2);
+    out = QWebRequestWriter::writeUtf8(out + 2, name, QWebRequestWriter::NoEscaping);
+    memcpy(out, ">\r\n", 3);
+    return out + 3;
+}
+
+/*!
+    \internal
+
+    Returns true if \a value, a map, a hash or a list, is not empty.
+  */
+static inline bool hasXmlChildren(const QVariant &value)
+{
+    switch (value.type()) {
+    case QVariant::Map:
+        return !reinterpret_cast<const QVariantMap *>(value.constData())->isEmpty();
+    case QVariant::Hash:
+        return !reinterpret_cast<const QVariantHash *>(value.constData())->isEmpty();
+    case QVariant::List:
+        return !reinterpret_cast<const QVariantList *>(value.constData())->isEmpty();
+    case QVariant::StringList:
+        return !reinterpret_cast<const QStringList *>(value.constData())->isEmpty();
+    default:
+        return false;
+    }
+}
+
+/*!
+    \internal
+
+    Returns number of bytes taken by child elements of \a value, indented
+    by \a depth tabs. Members of a map or a hash are named by their keys,
+    items of a list are called "item".
+  */
+static int xmlChildrenSize(const QVariant &value, int depth)
+{
+    int size = 0;
+    if (value.type() == QVariant::Map) {
+        const QVariantMap &map = *reinterpret_cast<const QVariantMap *>(value.constData());
+        for (QVariantMap::const_iterator i = map.constBegin(); i != map.constEnd(); ++i)
+            size += xmlElementSize(i.key(), i.value(), depth);
+    } else if (value.type() == QVariant::Hash) {
+        const QVariantHash &hash = *reinterpret_cast<const QVariantHash *>(value.constData());
+        for (QVariantHash::const_iterator i = hash.constBegin(); i != hash.constEnd(); ++i)
+            size += xmlElementSize(i.key(), i.value(), depth);
+    } else {
+        size = xmlElementSize(QLatin1String("item"), value, depth);
+    }
+    return size;
+}
+
+/*!
+    \internal
+
+    Writes child elements of \a value (see xmlChildrenSize()) to \a out.
+    Returns the position after them.
+  */
+static char *writeXmlChildren(char *out, const QVariant &value, int depth)
+{
+    if (value.type() == QVariant::Map) {
+        const QVariantMap &map = *reinterpret_cast<const QVariantMap *>(value.constData());
+        for (QVariantMap::const_iterator i = map.constBegin(); i != map.constEnd(); ++i)
+            out = writeXmlElement(out, i.key(), i.value(), depth);
+    } else if (value.type() == QVariant::Hash) {
+        const QVariantHash &hash = *reinterpret_cast<const QVariantHash *>(value.constData());
+        for (QVariantHash::const_iterator i = hash.constBegin(); i != hash.constEnd(); ++i)
+            out = writeXmlElement(out, i.key(), i.value(), depth);
+    } else {
+        out = writeXmlElement(out, QLatin1String("item"), value, depth);
+    }
+    return out;
+}
+
+/*!
+    \internal
+
+    Returns number of bytes taken by element \a name holding child elements
+    of \a value, indented by \a depth tabs.
+  */
+static int xmlParentSize(const QString &name, const QVariant &value, int depth)
+{
+    if (!hasXmlChildren(value))
+        return xmlTextSize(name, QString(), depth);
+
+    // <name>\r\n children </name>\r\n
+    return 2 * depth + 2 * QWebRequestWriter::utf8Size(name, QWebRequestWriter::NoEscaping) + 9
+            + xmlChildrenSize(value, depth + 1);
+}
+
+/*!
+    \internal
+
+    Writes element \a name holding child elements of \a value to \a out.
+    Returns the position after it.
+  */
+static char *writeXmlParent(char *out, const QString &name, const QVariant &value, int depth)
+{
+    if (!hasXmlChildren(value))
+        return writeXmlText(out, name, QString(), depth);
+
+    memset(out, '\t', depth);
+    out[depth] = '<';
+    out = QWebRequestWriter::writeUtf8(out + depth + 1, name, QWebRequestWriter::NoEscaping);
+    memcpy(out, ">\r\n", 3);
+    out = writeXmlChildren(out + 3, value, depth + 1);
+    memset(out, '\t', depth);
+    memcpy(out + depth, "</", 2);
+    out = QWebRequestWriter::writeUtf8(out + depth + 2, name, QWebRequestWriter::NoEscaping);
+    memcpy(out, ">\r\n", 3);
+    return out + 3;
+}
+
+/*!
+    \internal
+
+    Returns number of bytes taken by \a value, written as element \a name,
+    indented by \a depth tabs, by writeXmlElement().
+  */
+static int xmlElementSize(const QString &name, const QVariant &value, int depth)
+{
+    switch (value.type()) {
+    case QVariant::Map:
+    case QVariant::Hash:
+        return xmlParentSize(name, value, depth);
+    case QVariant::List: {
+        const QVariantList &list = *reinterpret_cast<const QVariantList *>(value.constData());
+        int size = 0;
+        foreach (const QVariant &item, list) {
+            bool nested = (item.type() == QVariant::List) || (item.type() == QVariant::StringList);
+            size += nested ? xmlParentSize(name, item, depth)
+                           : xmlElementSize(name, item, depth);
+        }
+        return size;
+    }
+    case QVariant::StringList: {
+        const QStringList &list = *reinterpret_cast<const QStringList *>(value.constData());
+        int size = 0;
+        foreach (const QString &item, list)
+            size += xmlTextSize(name, item, depth);
+        return size;
+    }
+    default:
+        return xmlTextSize(name, value.toString(), depth);
+    }
+}
+
+/*!
+    \internal
+
+    Writes \a value to \a out as element \a name, indented by \a depth
+    tabs, recursively: members of QVariantMap and QVariantHash become child
+    elements named by their keys, and items of QVariantList and QStringList
+    become repeated \a name elements (a list inside a list is written as
+    one \a name element holding "item" elements). Other values are written
+    as text. Returns the position after the written elements.
+
+    Child elements have no prefix, so in SOAP they are qualified with
+    the target namespace, declared as default by the method element.
+  */
+static char *writeXmlElement(char *out, const QString &name, const QVariant &value, int depth)
+{
+    switch (value.type()) {
+    case QVariant::Map:
+    case QVariant::Hash:
+        return writeXmlParent(out, name, value, depth);
+    case QVariant::List: {
+        const QVariantList &list = *reinterpret_cast<const QVariantList *>(value.constData());
+        foreach (const QVariant &item, list) {
+            bool nested = (item.type() == QVariant::List) || (item.type() == QVariant::StringList);
+            out = nested ? writeXmlParent(out, name, item, depth)
+                         : writeXmlElement(out, name, item, depth);
+        }
+        return out;
+    }
+    case QVariant::StringList: {
+        const QStringList &list = *reinterpret_cast<const QStringList *>(value.constData());
+        foreach (const QString &item, list)
+            out = writeXmlText(out, name, item, depth);
+        return out;
+    }
+    default:
+        return writeXmlText(out, name, value.toString(), depth);
+    }
+}
+
+/*!
+    \internal
+
+    Returns constant part of the request written before parameters,
+    for a web method using \a protocol, called \a methodName,
+    in \a targetNamespace.
+  */
+QByteArray QWebRequestWriter::prefix(QWebMethod::Protocol protocol, const QString &methodName,
+                                     const QString &targetNamespace)
+{
+    QByteArray result;
+    if (!(protocol & QWebMethod::Soap))
+        return result;
+
+    const char *header = (protocol & QWebMethod::Soap12) ? soap12Header : soap10Header;
+    int headerSize = int(qstrlen(header));
+    result.resize(headerSize + 2 + utf8Size(methodName, NoEscaping) + 8
+                  + utf8Size(targetNamespace, XmlEscaping) + 4);
+    char *out = result.data();
+    memcpy(out, header, headerSize);
+    out += headerSize;
+    memcpy(out, "\t<", 2);
+    out = writeUtf8(out + 2, methodName, NoEscaping);
+    memcpy(out, " xmlns=\"", 8);
+    out = writeUtf8(out + 8, targetNamespace, XmlEscaping);
+    memcpy(out, "\">\r\n", 4);
+    return result;
+}
+
+/*!
+    \internal
+
+    Returns constant part of the request written after parameters,
+    for a web method using \a protocol, called \a methodName.
+  */
+QByteArray QWebRequestWriter::suffix(QWebMethod::Protocol protocol, const QString &methodName)
+{
+    QByteArray result;
+    if (!(protocol & QWebMethod::Soap))
+        return result;
+
+    const char *footer = (protocol & QWebMethod::Soap12) ? soap12Footer : soap10Footer;
+    int footerSize = int(qstrlen(footer));
+    result.resize(3 + utf8Size(methodName, NoEscaping) + 3 + footerSize);
+    char *out = result.data();
+    memcpy(out, "\t</", 3);
+    out = writeUtf8(out + 3, methodName, NoEscaping);
+    memcpy(out, ">\r\n", 3);
+    memcpy(out + 3, footer, footerSize);
+    return result;
+}
+
+/*!
+    \internal
+
+    Returns number of bytes taken by \a parameters, written
+    for \a protocol by writeParameters().
+  */
+int QWebRequestWriter::parametersSize(QWebMethod::Protocol protocol,
+                                      const QMap<QString, QVariant> &parameters)
+{
+    int size = 0;
+    QMap<QString, QVariant>::const_iterator i = parameters.constBegin();
+    if (protocol & (QWebMethod::Soap | QWebMethod::Xml)) {
+        // \t\t<key>value</key>\r\n, or nested elements
+        for (; i != parameters.constEnd(); ++i)
+            size += xmlElementSize(i.key(), i.value(), 2);
+    } else if (protocol & QWebMethod::Http) {
+        // key=value&key=value
+        for (; i != parameters.constEnd(); ++i) {
+            size += utf8Size(i.key(), FormEscaping) + 1
+                    + utf8Size(i.value().toString(), FormEscaping) + 1;
+        }
+        size = qMax(size - 1, 0);
+    } else if (protocol & QWebMethod::Json) {
+        size = jsonObjectSize(parameters);
+    }
+
+    return size;
+}
+
+/*!
+    \internal
+
+    Writes \a parameters, formatted for \a protocol, to \a out. \a out has
+    to have room for parametersSize() bytes. Returns the position after
+    the written parameters.
+  */
+char *QWebRequestWriter::writeParameters(char *out, QWebMethod::Protocol protocol,
+                                         const QMap<QString, QVariant> &parameters)
+{
+    QMap<QString, QVariant>::const_iterator i = parameters.constBegin();
+    if (protocol & (QWebMethod::Soap | QWebMethod::Xml)) {
+        for (; i != parameters.constEnd(); ++i)
+            out = writeXmlElement(out, i.key(), i.value(), 2);
+    } else if (protocol & QWebMethod::Http) {
+        for (; i != parameters.constEnd(); ++i) {
+            if (i != parameters.constBegin())
+                *out++ = '&';
+            out = writeUtf8(out, i.key(), FormEscaping);
+            *out++ = '=';
+            out = writeUtf8(out, i.value().toString(), FormEscaping);
+        }
+    } else if (protocol & QWebMethod::Json) {
+        out = writeJsonObject(out, parameters);
+    }
+
+    return out;
+}
+
+/*!
+    \internal
+
+    Returns complete request body of a web method using \a protocol, called
+    \a methodName, in \a targetNamespace, with \a parameters. The body
+    is allocated once.
+  */
+QByteArray QWebRequestWriter::write(QWebMethod::Protocol protocol, const QString &methodName,
+                                    const QString &targetNamespace,
+                                    const QMap<QString, QVariant> &parameters)
+{
+    QByteArray head = prefix(protocol, methodName, targetNamespace);
+    QByteArray tail = suffix(protocol, methodName);
+
+    QByteArray result;
+    result.resize(head.size() + parametersSize(protocol, parameters) + tail.size());
+    char *out = result.data();
+    memcpy(out, head.constData(), head.size());
+    out = writeParameters(out + head.size(), protocol, parameters);
+    memcpy(out, tail.constData(), tail.size());
+    Q_ASSERT(out + tail.size() == result.constData() + result.size());
+    return result;
+}
@@ -0,0 +1,283 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <QtCore/qmutex.h>
+#include <QtCore/qcache.h>
+#include <QtCore/qdatastream.h>
+#include <QtCore/qcryptographichash.h>
+#include "../headers/qwebresponsecache_p.h"
+#include "../headers/qwebcontentcodec_p.h"
+#include "../headers/qwebclock_p.h"
+
+/*!
+    \class QWebResponseCache
+    \brief In-memory cache of replies of read-only web methods.
+
+    SOAP calls are sent with POST, so HTTP caches never store their replies,
+    even when the operation only reads data (like getGenreList()). Web methods
+    with a cache time to live (see QWebMethod::setCacheTimeToLive()) store
+    their successful replies here. Calls with the same host, method name,
+    target namespace and parameters are then answered from the cache, without
+    any network traffic, until the reply expires.
+
+    The cache is shared by all web methods of the process (and all threads).
+    Its size is limited by maxSize(); when it is full, least recently used
+    replies are removed first. Replies can be stored compressed, to fit more
+    of them in the same memory, see setCompressionEnabled().
+  */
+
+/*!
+    \internal
+
+    Cache of all web methods, shared by all threads.
+  */
+class QWebResponseCacheRegistry
+{
+public:
+    QWebResponseCacheRegistry() :
+        compression(false), hits(0), misses(0)
+    {
+        responses.setMaxCost(QWebResponseCache::DefaultMaxSize);
+    }
+
+    QMutex mutex;
+    // Cost of each response is the size of its stored body.
+    QCache<QByteArray, QWebCachedResponse> responses;
+    bool compression;
+    int hits;
+    int misses;
+};
+
+Q_GLOBAL_STATIC(QWebResponseCacheRegistry, cacheRegistry)
+
+/*!
+    Returns maximal size (in bytes) of replies stored in the cache.
+    Default is 4 MiB.
+  */
+int QWebResponseCache::maxSize()
+{
+    QWebResponseCacheRegistry *registry = cacheRegistry();
+    QMutexLocker locker(&registry->mutex);
+    return registry->responses.maxCost();
+}
+
+/*!
+    Sets maximal size of the cache to \a bytes. If the cache is bigger,
+    least recently used replies are removed.
+  */
+void QWebResponseCache::setMaxSize(int bytes)
+{
+    QWebResponseCacheRegistry *registry = cacheRegistry();
+    QMutexLocker locker(&registry->mutex);
+    registry->responses.setMaxCost(qMax(bytes, 0));
+}
+
+/*!
+    Returns true if replies are stored compressed. Default is false.
+  */
+bool QWebResponseCache::isCompressionEnabled()
+{
+    QWebResponseCacheRegistry *registry = cacheRegistry();
+    QMutexLocker locker(&registry->mutex);
+    return registry->compression;
+}
+
+/*!
+    Turns compression of stored replies on or off (\a enabled). Compressed
+    replies take less memory, but have to be inflated on each hit. Replies
+    that do not get smaller are stored as they are. Replies already
+    in the cache are not changed.
+  */
+void QWebResponseCache::setCompressionEnabled(bool enabled)
+{
+    QWebResponseCacheRegistry *registry = cacheRegistry();
+    QMutexLocker locker(&registry->mutex);
+    registry->compression = enabled;
+}
+
+/*!
+    Returns number of replies in the cache (including expired ones, which
+    have not been removed yet).
+  */
+int QWebResponseCache::count()
+{
+    QWebResponseCacheRegistry *registry = cacheRegistry();
+    QMutexLocker locker(&registry->mutex);
+    return registry->responses.count();
+}
+
+/*!
+    Returns size (in bytes) of replies stored in the cache.
+  */
+int QWebResponseCache::size()
+{
+    QWebResponseCacheRegistry *registry = cacheRegistry();
+    QMutexLocker locker(&registry->mutex);
+    return registry->responses.totalCost();
+}
+
+/*!
+    Removes all replies from the cache.
+  */
+void QWebResponseCache::clear()
+{
+    QWebResponseCacheRegistry *registry = cacheRegistry();
+    QMutexLocker locker(&registry->mutex);
+    registry->responses.clear();
+}
+
+/*!
+    Returns number of calls answered from the cache.
+
+    \sa misses(), resetCounters()
+  */
+int QWebResponseCache::hits()
+{
+    QWebResponseCacheRegistry *registry = cacheRegistry();
+    QMutexLocker locker(&registry->mutex);
+    return registry->hits;
+}
+
+/*!
+    Returns number of calls of caching web methods, that had to be sent,
+    because their reply was not in the cache, or has expired.
+
+    \sa hits(), resetCounters()
+  */
+int QWebResponseCache::misses()
+{
+    QWebResponseCacheRegistry *registry = cacheRegistry();
+    QMutexLocker locker(&registry->mutex);
+    return registry->misses;
+}
+
+/*!
+    Sets hits() and misses() counters to 0.
+  */
+void QWebResponseCache::resetCounters()
+{
+    QWebResponseCacheRegistry *registry = cacheRegistry();
+    QMutexLocker locker(&registry->mutex);
+    registry->hits = 0;
+    registry->misses = 0;
+}
+
+/*!
+    \internal
+
+    Returns cache key of a call to \a host, of \a methodName in
+    \a targetNamespace, with \a parameters. When raw \a requestData is sent
+    instead of parameters, it is used in their place.
+
+    The same parameters are sent differently with another \a protocol
+    or \a httpMethod, and the reply may depend on the user, so these
+    (with \a username and \a password) are part of the key too. Key is
+    a hash, credentials can not be read back from it.
+
+    Parameters are kept in a QMap, so they are always serialized in the same
+    order, and equal parameters give equal keys.
+  */
+QByteArray QWebResponseCachePrivate::key(const QUrl &host, QWebMethod::Protocol protocol,
+                                         QWebMethod::HttpMethod httpMethod,
+                                         const QString &username, const QString &password,
+                                         const QString &methodName,
+                                         const QString &targetNamespace,
+                                         const QMap<QString, QVariant> &parameters,
+                                         const QByteArray &requestData)
+{
+    QByteArray canonical;
+    QDataStream stream(&canonical, QIODevice::WriteOnly);
+    stream << host << int(protocol) << int(httpMethod) << username << password
+           << methodName << targetNamespace;
+    if (requestData.isEmpty())
+        stream << parameters;
+    else
+        stream << requestData;
+
+    return QCryptographicHash::hash(canonical, QCryptographicHash::Sha1);
+}
+
+/*!
+    \internal
+
+    Looks for a reply stored under \a key, and writes it to \a reply.
+    Returns false (and counts a miss) if there is no such reply,
+    or it has expired.
+  */
+bool QWebResponseCachePrivate::lookup(const QByteArray &key, QByteArray *reply)
+{
+    QWebResponseCacheRegistry *registry = cacheRegistry();
+    QWebCachedResponse response;
+    {
+        QMutexLocker locker(&registry->mutex);
+        // Marks the response as the most recently used one.
+        QWebCachedResponse *cached = registry->responses.object(key);
+        if (cached && (cached->expiresAt <= QWebClock::now())) {
+            registry->responses.remove(key);
+            cached = 0;
+        }
+
+        if (!cached) {
+            ++registry->misses;
+            return false;
+        }
+
+        ++registry->hits;
+        response = *cached;
+    }
+
+    if (!response.compressed) {
+        *reply = response.body;
+        return true;
+    }
+
+    // Inflated outside of the lock.
+    QWebContentCodec codec;
+    codec.begin(QWebContentCodec::Gzip);
+    reply->clear();
+    bool inflated = codec.inflate(response.body, reply) && codec.finish();
+    codec.end();
+    return inflated;
+}
+
+/*!
+    \internal
+
+    Stores \a reply under \a key, for \a timeToLive milliseconds. Replies
+    bigger than the whole cache are not stored.
+  */
+void QWebResponseCachePrivate::insert(const QByteArray &key, const QByteArray &reply,
+                                      int timeToLive)
+{
+    QWebResponseCacheRegistry *registry = cacheRegistry();
+    bool compression = QWebResponseCache::isCompressionEnabled();
+
+    QWebCachedResponse *response = new QWebCachedResponse;
+    response->body = reply;
+    if (compression) {
+        QByteArray compressed = QWebContentCodec::gzip(reply);
+        if (!compressed.isEmpty() && (compressed.size() < reply.size())) {
+            response->body = compressed;
+            response->compressed = true;
+        }
+    }
+    response->expiresAt = QWebClock::now() + timeToLive;
+
+    QMutexLocker locker(&registry->mutex);
+    // Takes ownership, even when the response is too big to be stored.
+    registry->responses.insert(key, response, qMax(response->body.size(), 1));
+}
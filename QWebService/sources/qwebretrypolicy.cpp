@@ -0,0 +1,274 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <stdlib.h>
+#include <QtCore/qthreadstorage.h>
+#include <QtCore/qthread.h>
+#include <QtCore/qdatetime.h>
+#include "../headers/qwebretrypolicy_p.h"
+
+/*!
+    \class QWebRetryPolicy
+    \brief Describes when and how often failed calls are repeated.
+
+    A retry policy can be set on QWebMethod (QWebMethod::setRetryPolicy()),
+    or on all methods of a QWebService (QWebService::setRetryPolicy()).
+    When a call fails with one of retryErrors(), or the server replies with
+    one of retryStatusCodes(), the request is sent again, up to maxAttempts()
+    times in total. Calls are repeated only for idempotent web methods,
+    see QWebMethod::isIdempotent().
+
+    Delays between attempts grow exponentially, with decorrelated jitter:
+    each delay is a random value between baseDelay() and three times
+    the previous delay, capped at maxDelay(). Randomness keeps clients
+    that failed at the same moment from retrying all at once, and
+    overloading a recovering server again.
+
+    \code
+    QWebRetryPolicy policy(5, 200, 5000);
+    method->setRetryPolicy(policy);
+    \endcode
+
+    Default constructed policy is disabled (allows one attempt only).
+  */
+
+/*!
+    \internal
+
+    Initialises the policy with default values: one attempt, transient
+    network errors, and HTTP status codes 408, 429, 502, 503 and 504.
+  */
+QWebRetryPolicyData::QWebRetryPolicyData() :
+    maxAttempts(1), baseDelay(100), maxDelay(10000)
+{
+    retryErrors << QNetworkReply::ConnectionRefusedError
+                << QNetworkReply::RemoteHostClosedError
+                << QNetworkReply::TimeoutError
+                << QNetworkReply::TemporaryNetworkFailureError
+                << QNetworkReply::ProxyConnectionRefusedError
+                << QNetworkReply::ProxyConnectionClosedError
+                << QNetworkReply::ProxyTimeoutError;
+    retryStatusCodes << 408 << 429 << 502 << 503 << 504;
+}
+
+static QThreadStorage<bool *> randomSeeded;
+
+/*!
+    \internal
+
+    Returns a random number between \a low and \a high (inclusive).
+    qrand() is seeded once in each thread, with time and thread address,
+    so that different threads and processes do not draw the same delays.
+  */
+int QWebRetryPolicyData::randomBetween(int low, int high)
+{
+    if (!randomSeeded.hasLocalData()) {
+        randomSeeded.setLocalData(new bool(true));
+        qsrand(uint(QDateTime::currentMSecsSinceEpoch())
+               ^ uint(quintptr(QThread::currentThread())));
+    }
+
+    if (high <= low)
+        return low;
+
+    return low + int((qint64(qrand()) * (qint64(high) - low + 1)) / (qint64(RAND_MAX) + 1));
+}
+
+/*!
+    Constructs a disabled policy.
+  */
+QWebRetryPolicy::QWebRetryPolicy() :
+    d(new QWebRetryPolicyData)
+{
+}
+
+/*!
+    Constructs a policy, that allows \a maxAttempts attempts in total, with
+    delays between \a baseDelay and \a maxDelay milliseconds. Default
+    errors and status codes are retried.
+  */
+QWebRetryPolicy::QWebRetryPolicy(int maxAttempts, int baseDelay, int maxDelay) :
+    d(new QWebRetryPolicyData)
+{
+    setMaxAttempts(maxAttempts);
+    setBaseDelay(baseDelay);
+    setMaxDelay(maxDelay);
+}
+
+/*!
+    Constructs a copy of \a other.
+  */
+QWebRetryPolicy::QWebRetryPolicy(const QWebRetryPolicy &other) :
+    d(other.d)
+{
+}
+
+/*!
+    Assigns \a other to this policy.
+  */
+QWebRetryPolicy &QWebRetryPolicy::operator=(const QWebRetryPolicy &other)
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+    Destroys the policy.
+  */
+QWebRetryPolicy::~QWebRetryPolicy()
+{
+}
+
+/*!
+    Returns true if the policy allows more than one attempt.
+  */
+bool QWebRetryPolicy::isEnabled() const
+{
+    return (d->maxAttempts > 1);
+}
+
+/*!
+    Returns maximal number of attempts (including the first one).
+    Default is 1.
+
+    \sa setMaxAttempts()
+  */
+int QWebRetryPolicy::maxAttempts() const
+{
+    return d->maxAttempts;
+}
+
+/*!
+    Sets maximal number of \a attempts (including the first one).
+
+    \sa maxAttempts()
+  */
+void QWebRetryPolicy::setMaxAttempts(int attempts)
+{
+    d->maxAttempts = qMax(attempts, 1);
+}
+
+/*!
+    Returns the shortest delay between attempts (in milliseconds).
+    Default is 100.
+
+    \sa setBaseDelay(), nextDelay()
+  */
+int QWebRetryPolicy::baseDelay() const
+{
+    return d->baseDelay;
+}
+
+/*!
+    Sets the shortest delay between attempts (\a msecs).
+
+    \sa baseDelay()
+  */
+void QWebRetryPolicy::setBaseDelay(int msecs)
+{
+    d->baseDelay = qMax(msecs, 0);
+}
+
+/*!
+    Returns the longest delay between attempts (in milliseconds).
+    Default is 10000.
+
+    \sa setMaxDelay(), nextDelay()
+  */
+int QWebRetryPolicy::maxDelay() const
+{
+    return d->maxDelay;
+}
+
+/*!
+    Sets the longest delay between attempts (\a msecs).
+
+    \sa maxDelay()
+  */
+void QWebRetryPolicy::setMaxDelay(int msecs)
+{
+    d->maxDelay = qMax(msecs, 0);
+}
+
+/*!
+    Returns network errors, which cause a retry. By default, these are
+    errors caused by connection problems and timeouts.
+
+    \sa setRetryErrors(), retryStatusCodes()
+  */
+QList<QNetworkReply::NetworkError> QWebRetryPolicy::retryErrors() const
+{
+    return d->retryErrors;
+}
+
+/*!
+    Sets network \a errors, which cause a retry.
+
+    \sa retryErrors()
+  */
+void QWebRetryPolicy::setRetryErrors(const QList<QNetworkReply::NetworkError> &errors)
+{
+    d->retryErrors = errors;
+}
+
+/*!
+    Returns HTTP status codes, which cause a retry. By default, these are
+    408, 429, 502, 503 and 504.
+
+    \sa setRetryStatusCodes(), retryErrors()
+  */
+QList<int> QWebRetryPolicy::retryStatusCodes() const
+{
+    return d->retryStatusCodes;
+}
+
+/*!
+    Sets HTTP \a statusCodes, which cause a retry.
+
+    \sa retryStatusCodes()
+  */
+void QWebRetryPolicy::setRetryStatusCodes(const QList<int> &statusCodes)
+{
+    d->retryStatusCodes = statusCodes;
+}
+
+/*!
+    Returns true if a reply with network \a error and \a httpStatus
+    (0 if there was no HTTP reply) should be retried. Number of attempts
+    is not taken into account.
+  */
+bool QWebRetryPolicy::shouldRetry(QNetworkReply::NetworkError error, int httpStatus) const
+{
+    if ((httpStatus != 0) && d->retryStatusCodes.contains(httpStatus))
+        return true;
+
+    return ((error != QNetworkReply::NoError) && d->retryErrors.contains(error));
+}
+
+/*!
+    Returns delay before the next attempt, given the \a previousDelay
+    (0 before the first retry). Uses decorrelated jitter: result is random,
+    between baseDelay() and three times \a previousDelay, but not longer
+    than maxDelay().
+  */
+int QWebRetryPolicy::nextDelay(int previousDelay) const
+{
+    int previous = qMax(previousDelay, d->baseDelay);
+    qint64 high = qMin(qint64(previous) * 3, qint64(d->maxDelay));
+    int delay = QWebRetryPolicyData::randomBetween(d->baseDelay, int(qMax(high, qint64(d->baseDelay))));
+    return qMin(delay, d->maxDelay);
+}
@@ -16,6 +16,7 @@
 ****************************************************************************/
 
 #include "../headers/qwebservice_p.h"
+#include "../headers/qwebmethod_p.h"
 
 /*!
     \class QWebService
@@ -81,7 +82,7 @@
     \sa setWsdl(), addMethod()
   */
 QWebService::QWebService(QObject *parent)
-    : QObject(parent), d_ptr(new QWebServicePrivate)
+    : QObject(parent), d_ptr(new QWebServicePrivate(this))
 {
     Q_D(QWebService);
     d->wsdl = new QWsdl(this);
@@ -98,7 +99,7 @@ QWebService::QWebService(QObject *parent)
     \sa resetWsdl(), addMethod()
   */
 QWebService::QWebService(QWsdl *_wsdl, QObject *parent)
-    : QObject(parent), d_ptr(new QWebServicePrivate)
+    : QObject(parent), d_ptr(new QWebServicePrivate(this))
 {
     Q_D(QWebService);
     d->methods = new QMap<QString, QWebMethod *>();
@@ -116,7 +117,7 @@ QWebService::QWebService(QWsdl *_wsdl, QObject *parent)
     \sa setWsdl(), addMethod()
   */
 QWebService::QWebService(const QString &_hostname, QObject *parent)
-    : QObject(parent), d_ptr(new QWebServicePrivate)
+    : QObject(parent), d_ptr(new QWebServicePrivate(this))
 {
     Q_D(QWebService);
     d->m_hostUrl.setUrl(_hostname);
@@ -149,6 +150,8 @@ QWebService::QWebService(QWebServicePrivate &dd, QObject *parent) :
 QWebService::~QWebService()
 {
     Q_D(QWebService);
+    // Workers read settings of the methods.
+    delete d->workerPool;
     delete d->wsdl;
 }
 
@@ -309,6 +312,7 @@ void QWebService::addMethod(QWebMethod *newMethod)
 {
     Q_D(QWebService);
     d->methods->insert(newMethod->methodName(), newMethod);
+    d->applySettings(newMethod);
     connect(newMethod, SIGNAL(replyReady(QByteArray)),
             this, SLOT(receiveReply(QByteArray)));
     emit methodNamesChanged();
@@ -327,6 +331,7 @@ void QWebService::addMethod(const QString &methodName, QWebMethod *newMethod)
 {
     Q_D(QWebService);
     d->methods->insert(methodName, newMethod);
+    d->applySettings(newMethod);
     connect(newMethod, SIGNAL(replyReady(QByteArray)),
             this, SLOT(receiveReply(QByteArray)));
     emit methodNamesChanged();
@@ -345,6 +350,8 @@ void QWebService::removeMethod(const QString &methodName)
             this, SLOT(receiveReply(QByteArray)));
     delete d->methods->value(methodName);
     d->methods->remove(methodName);
+    if (d->workerPool)
+        d->workerPool->publish(methodName, 0);
     emit methodNamesChanged();
 }
 
@@ -361,7 +368,25 @@ void QWebService::removeMethod(const QString &methodName)
 bool QWebService::invokeMethod(const QString &methodName, const QByteArray &data)
 {
     Q_D(QWebService);
-    return d->methods->value(methodName)->invokeMethod(data);
+    return (d->methods->value(methodName)->invokeMethod(data) != 0);
+}
+
+/*!
+    Invokes a batch of \a items - pairs of web method name, and parameters
+    to call it with (empty parameters mean a call without parameters).
+    Parameters of the methods themselves are not changed.
+    At most \a maxConcurrent calls are in flight at the same time. Results
+    are reported by signals of the returned QWebBatch, in given \a order.
+
+    Calls start when control returns to the event loop. Returned batch
+    is a child of this web service.
+
+    \sa QWebBatch
+  */
+QWebBatch *QWebService::invokeBatch(const QList<QWebBatchItem> &items,
+                                    int maxConcurrent, QWebBatch::Order order)
+{
+    return new QWebBatch(this, items, maxConcurrent, order);
 }
 
 /*!
@@ -380,6 +405,23 @@ QString QWebService::replyRead(const QString &methodName)
     return d->methods->value(methodName)->replyRead();
 }
 
+/*!
+    Aborts all calls in progress of web method specified by \a methodName.
+    When \a methodName is empty, calls of all methods are aborted.
+
+    \sa QWebMethod::cancelAll()
+  */
+void QWebService::cancelAll(const QString &methodName)
+{
+    Q_D(QWebService);
+    if (methodName.isEmpty()) {
+        foreach (QWebMethod *method, *d->methods)
+            method->cancelAll();
+    } else if (d->methods->contains(methodName)) {
+        d->methods->value(methodName)->cancelAll();
+    }
+}
+
 /*!
     Returns QString with URL of the web service.
   */
@@ -434,12 +476,17 @@ void QWebService::setWsdl(QWsdl *newWsdl)
 {
     Q_D(QWebService);
     d->wsdl = newWsdl;
+    d->updateEndpoints();
     setName(d->wsdl->webServiceName());
     foreach (QString s, d->wsdl->methods()->keys()) {
         d->methods->insert(s, d->wsdl->methods()->value(s));
+        d->applySettings(d->methods->value(s));
         connect(d->methods->value(s), SIGNAL(replyReady(QByteArray)),
                 this, SLOT(receiveReply(QByteArray)));
     }
+
+    if (d->warmConnections > 0)
+        d->warmUp(d->warmConnections);
 }
 
 /*!
@@ -459,19 +506,340 @@ void QWebService::resetWsdl(QWsdl *newWsdl)
                     this, SLOT(receiveReply(QByteArray)));
         }
         d->methods->clear();
+        if (d->workerPool)
+            d->workerPool->unpublishAll();
         d->wsdl = new QWsdl(this);
+        d->updateEndpoints();
         setName();
     } else {
         d->wsdl = newWsdl;
+        d->updateEndpoints();
         d->methods->clear();
+        if (d->workerPool)
+            d->workerPool->unpublishAll();
 //        d->methods = d->wsdl->methods();
         foreach (QString s, d->wsdl->methods()->keys()) {
             d->methods->insert(s, d->wsdl->methods()->value(s));
+            d->applySettings(d->methods->value(s));
             connect(d->methods->value(s), SIGNAL(replyReady(QByteArray)),
                     this, SLOT(receiveReply(QByteArray)));
         }
         setName(d->wsdl->webServiceName());
     }
+
+    if (d->warmConnections > 0)
+        d->warmUp(d->warmConnections);
+}
+
+/*!
+    Returns true if compression is enabled for methods of this web service.
+
+    \sa setCompressionEnabled()
+  */
+bool QWebService::isCompressionEnabled() const
+{
+    Q_D(const QWebService);
+    return d->compression;
+}
+
+/*!
+    Turns compression of requests and replies on or off (\a enabled)
+    for all methods of this web service, including methods added later.
+    Methods that have set compression themselves keep their setting.
+    Default is off.
+
+    \sa QWebMethod::setCompressionEnabled()
+  */
+void QWebService::setCompressionEnabled(bool enabled)
+{
+    Q_D(QWebService);
+    d->compression = enabled;
+    d->explicitSettings |= QWebMethodPrivate::CompressionSetting;
+    foreach (QWebMethod *method, *d->methods)
+        d->applySettings(method);
+}
+
+/*!
+    Returns the retry policy of methods of this web service.
+
+    \sa setRetryPolicy()
+  */
+QWebRetryPolicy QWebService::retryPolicy() const
+{
+    Q_D(const QWebService);
+    return d->retryPolicy;
+}
+
+/*!
+    Sets the retry \a policy for all methods of this web service,
+    including methods added later. Only idempotent methods are retried.
+    Methods that have set a retry policy themselves keep it.
+
+    \sa QWebMethod::setRetryPolicy(), QWebMethod::setIdempotent()
+  */
+void QWebService::setRetryPolicy(const QWebRetryPolicy &policy)
+{
+    Q_D(QWebService);
+    d->retryPolicy = policy;
+    d->explicitSettings |= QWebMethodPrivate::RetryPolicySetting;
+    foreach (QWebMethod *method, *d->methods)
+        d->applySettings(method);
+}
+
+/*!
+    Returns true if methods of this web service use the circuit breaker.
+
+    \sa setCircuitBreakerEnabled()
+  */
+bool QWebService::isCircuitBreakerEnabled() const
+{
+    Q_D(const QWebService);
+    return d->circuitBreaker;
+}
+
+/*!
+    Turns the circuit breaker on or off (\a enabled) for all methods of
+    this web service, including methods added later. Methods that have
+    set it themselves keep their setting. Default is off.
+
+    \sa QWebCircuitBreaker, QWebMethod::setCircuitBreakerEnabled()
+  */
+void QWebService::setCircuitBreakerEnabled(bool enabled)
+{
+    Q_D(QWebService);
+    d->circuitBreaker = enabled;
+    d->explicitSettings |= QWebMethodPrivate::CircuitBreakerSetting;
+    foreach (QWebMethod *method, *d->methods)
+        d->applySettings(method);
+}
+
+/*!
+    Returns true if identical calls of methods of this web service share
+    one request.
+
+    \sa setCoalescingEnabled()
+  */
+bool QWebService::isCoalescingEnabled() const
+{
+    Q_D(const QWebService);
+    return d->coalescing;
+}
+
+/*!
+    Turns coalescing of identical calls on or off (\a enabled) for all
+    methods of this web service, including methods added later. Methods
+    that have set it themselves keep their setting. Default is off.
+
+    \sa QWebMethod::setCoalescingEnabled()
+  */
+void QWebService::setCoalescingEnabled(bool enabled)
+{
+    Q_D(QWebService);
+    d->coalescing = enabled;
+    d->explicitSettings |= QWebMethodPrivate::CoalescingSetting;
+    foreach (QWebMethod *method, *d->methods)
+        d->applySettings(method);
+}
+
+/*!
+    Returns the rate limit of this web service. By default, it is disabled.
+
+    \sa setRateLimit()
+  */
+QWebRateLimit QWebService::rateLimit() const
+{
+    Q_D(const QWebService);
+    if (d->rateLimitBucket.isNull())
+        return QWebRateLimit();
+
+    return d->rateLimitBucket->limit();
+}
+
+/*!
+    Sets the rate \a limit of this web service. The limit is shared by all
+    methods of the service (including methods added later): together, they
+    do not send more calls than the limit allows. Limits of single methods
+    can be set with QWebMethod::setRateLimit().
+
+    \sa rateLimit(), QWebRateLimit
+  */
+void QWebService::setRateLimit(const QWebRateLimit &limit)
+{
+    Q_D(QWebService);
+    if (limit.isEnabled())
+        d->rateLimitBucket = QSharedPointer<QWebTokenBucket>(new QWebTokenBucket(limit));
+    else
+        d->rateLimitBucket.clear();
+
+    foreach (QWebMethod *method, *d->methods)
+        d->applySettings(method);
+}
+
+/*!
+    Returns the load balancer used by methods of this web service, or 0.
+
+    \sa setLoadBalancer()
+  */
+QWebLoadBalancer *QWebService::loadBalancer() const
+{
+    Q_D(const QWebService);
+    return d->loadBalancer.data();
+}
+
+/*!
+    Sets the load \a balancer, that spreads calls of all methods of this
+    web service across its endpoints. Web service takes ownership
+    of the \a balancer. Passing 0 sends all calls to the host of each
+    method again.
+
+    When the \a balancer has no endpoints, addresses of WSDL ports with
+    SOAP 1.2 binding (used by methods read from WSDL) are set, and are
+    updated when WSDL changes (see QWsdl::hostUrls()). Such a balancer is
+    only used by methods, which can be sent to all of these addresses.
+    Calls are never spread across WSDL ports without a balancer being set.
+
+    \sa loadBalancer(), QWebLoadBalancer
+  */
+void QWebService::setLoadBalancer(QWebLoadBalancer *balancer)
+{
+    Q_D(QWebService);
+    if (balancer == d->loadBalancer.data())
+        return;
+
+    d->loadBalancer = QSharedPointer<QWebLoadBalancer>(balancer);
+    d->wsdlEndpoints = false;
+    if (balancer && balancer->endpoints().isEmpty()) {
+        balancer->setEndpoints(d->wsdlUrls());
+        d->wsdlEndpoints = true;
+    }
+
+    foreach (QWebMethod *method, *d->methods)
+        d->applySettings(method);
+
+    if (d->warmConnections > 0)
+        d->warmUp(d->warmConnections);
+}
+
+/*!
+    Returns number of connections opened in advance to each host of this
+    web service. Default is 0 (no warming).
+
+    \sa setWarmConnections(), warmUp()
+  */
+int QWebService::warmConnections() const
+{
+    Q_D(const QWebService);
+    return d->warmConnections;
+}
+
+/*!
+    Sets number of \a connections opened in advance to each host (and each
+    endpoint of the load balancer) of this web service. Hosts are resolved,
+    and connections are opened, right away, and each time WSDL is set,
+    so that first calls do not wait for DNS lookup, TCP connection and TLS
+    handshake. Hosts resolved in the last minute are not looked up again
+    (see QWebHostCache); Qt keeps resolved addresses for a minute, too.
+
+    At most 6 connections are opened to a single host.
+
+    \sa warmConnections(), warmUp()
+  */
+void QWebService::setWarmConnections(int connections)
+{
+    Q_D(QWebService);
+    d->warmConnections = qBound(0, connections, 6);
+    if (d->warmConnections > 0)
+        d->warmUp(d->warmConnections);
+}
+
+/*!
+    Resolves hosts of this web service, and opens connections to them
+    (warmConnections(), but at least one), without waiting for the first call.
+    Returns immediately, work is done in the background.
+
+    \sa setWarmConnections()
+  */
+void QWebService::warmUp()
+{
+    Q_D(QWebService);
+    d->warmUp(qMax(d->warmConnections, 1));
+}
+
+/*!
+    Returns number of worker threads of this web service, or 0 (default),
+    if all calls are made in the thread of the web service.
+
+    \sa setWorkerThreads(), submit()
+  */
+int QWebService::workerThreads() const
+{
+    Q_D(const QWebService);
+    return d->workerPool ? d->workerPool->threadCount() : 0;
+}
+
+/*!
+    Starts \a count worker threads, that make calls submitted with submit().
+    Each worker thread has its own event loop and network managers, so
+    many threads can call the web service at once, without queueing on
+    the event loop of a single thread. Passing 0 stops the workers; calls
+    in progress are aborted then.
+
+    Workers use copies of the web methods. Their settings are copied in
+    the thread of the web service: when workers are started, when methods
+    are added or service settings change, and whenever a call is submitted
+    from that thread. Calls submitted from other threads use the settings
+    copied last. Streaming is not used by workers.
+
+    \sa workerThreads(), submit()
+  */
+void QWebService::setWorkerThreads(int count)
+{
+    Q_D(QWebService);
+    if (count == workerThreads())
+        return;
+
+    delete d->workerPool;
+    d->workerPool = (count > 0) ? new QWebWorkerPool(count) : 0;
+    if (!d->workerPool)
+        return;
+
+    foreach (const QString &methodName, d->methods->keys())
+        d->workerPool->publish(methodName, d->methods->value(methodName));
+}
+
+/*!
+    Submits a call of web method \a methodName, with \a parameters (or with
+    raw \a data, if it is not empty), to a worker thread. This method
+    is thread-safe: it can be called from any thread, and it never waits
+    for the workers. Submitting threads only share a short lock, held
+    to find settings of the method (see setWorkerThreads()).
+
+    When the call is finished, \a member of \a receiver is invoked,
+    in the thread of the \a receiver, with the ID returned by this method,
+    the reply and error information (empty on success):
+    \code
+    service->submit("getBandName", params, this,
+                    SLOT(bandNameReady(int,QByteArray,QString)));
+    \endcode
+
+    Returns the ID of the call, or -1 if worker threads are off
+    (see setWorkerThreads()), or the method does not exist. \a receiver
+    must not be deleted before the result is delivered.
+
+    \sa setWorkerThreads()
+  */
+int QWebService::submit(const QString &methodName, const QMap<QString, QVariant> &parameters,
+                        QObject *receiver, const char *member, const QByteArray &data)
+{
+    Q_D(QWebService);
+    if (!d->workerPool)
+        return -1;
+
+    // Other threads must not read the method, they use published settings.
+    if (QThread::currentThread() == thread())
+        d->workerPool->publish(methodName, d->methods->value(methodName));
+
+    return d->workerPool->submit(methodName, parameters, data, receiver, member);
 }
 
 /*!
@@ -510,6 +878,110 @@ void QWebServicePrivate::init()
         return;
 }
 
+/*!
+    \internal
+
+    Applies settings common to all web methods of the service to \a method.
+  */
+void QWebServicePrivate::applySettings(QWebMethod *method)
+{
+    if (!method)
+        return;
+
+    QWebMethodPrivate *methodPrivate = method->d_func();
+    // Settings never set on the service are left alone, and so are
+    // settings the method has set itself.
+    int settings = explicitSettings & ~methodPrivate->explicitSettings;
+    if (settings & QWebMethodPrivate::CompressionSetting)
+        methodPrivate->compression = compression;
+    if (settings & QWebMethodPrivate::RetryPolicySetting)
+        methodPrivate->retryPolicy = retryPolicy;
+    if (settings & QWebMethodPrivate::CircuitBreakerSetting)
+        methodPrivate->circuitBreaker = circuitBreaker;
+    if (settings & QWebMethodPrivate::CoalescingSetting)
+        methodPrivate->coalescing = coalescing;
+    methodPrivate->serviceRateLimitBucket = rateLimitBucket;
+    // Ports with other bindings accept different messages, so endpoints
+    // taken from WSDL are only used by methods that match all of them.
+    if (wsdlEndpoints && !loadBalancer.isNull()
+            && (wsdl->hostUrls(method->protocol(), method->httpMethod())
+                != loadBalancer->endpoints())) {
+        methodPrivate->loadBalancer.clear();
+    } else {
+        methodPrivate->loadBalancer = loadBalancer;
+    }
+
+    if (workerPool)
+        workerPool->publish(methods->key(method), method);
+}
+
+/*!
+    \internal
+
+    Opens \a connections connections to every host that methods of this
+    web service send their requests to, using their credentials.
+  */
+void QWebServicePrivate::warmUp(int connections)
+{
+    Q_Q(QWebService);
+    QList<QWebConnectionWarmer::Target> targets;
+    QStringList keys;
+    foreach (QWebMethod *method, *methods) {
+        QWebMethodPrivate *methodData = method->d_func();
+        QList<QUrl> urls;
+        if (!loadBalancer.isNull())
+            urls = loadBalancer->endpoints();
+        if (urls.isEmpty())
+            urls.append(methodData->m_hostUrl);
+
+        foreach (const QUrl &url, urls) {
+            QString targetKey = QWebCircuitBreakerPrivate::key(url)
+                    + QLatin1Char('\n') + methodData->m_username;
+            if (keys.contains(targetKey))
+                continue;
+
+            keys.append(targetKey);
+            QWebConnectionWarmer::Target target;
+            target.url = url;
+            target.username = methodData->m_username;
+            target.password = methodData->m_password;
+            targets.append(target);
+        }
+    }
+
+    if (!warmer)
+        warmer = new QWebConnectionWarmer(q);
+    warmer->warm(targets, connections);
+}
+
+/*!
+    \internal
+
+    Updates endpoints of the load balancer, when it took them from the
+    previous WSDL. No balancer is created here: WSDL ports are often
+    different bindings of one service, not its replicas.
+  */
+void QWebServicePrivate::updateEndpoints()
+{
+    if (!wsdlEndpoints || loadBalancer.isNull())
+        return;
+
+    loadBalancer->setEndpoints(wsdlUrls());
+    foreach (QWebMethod *method, *methods)
+        applySettings(method);
+}
+
+/*!
+    \internal
+
+    Returns addresses of WSDL ports, that methods read from WSDL can be
+    sent to. These methods use SOAP 1.2 (see QWsdl).
+  */
+QList<QUrl> QWebServicePrivate::wsdlUrls() const
+{
+    return wsdl->hostUrls(QWebMethod::Soap12, QWebMethod::Post);
+}
+
 /*!
     \internal
 
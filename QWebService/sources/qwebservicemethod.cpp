@@ -150,7 +150,7 @@ QWebServiceMethod::QWebServiceMethod(QWebServiceMethodPrivate &d,
 bool QWebServiceMethod::invokeMethod(const QMap<QString, QVariant> &params)
 {
     setParameters(params);    
-    return invokeMethod();
+    return (invokeMethod() != 0);
 }
 
 /*!
@@ -161,7 +161,10 @@ bool QWebServiceMethod::invokeMethod(const QMap<QString, QVariant> &params)
     Protocol can optionally be specified by \a protocol (default is SOAP 1.2),
     as well as HTTP \a method (default is POST).
 
-    Returns with web service reply, once it is received. This is a blocking method.
+    Returns with web service reply, once it is received. This is a blocking method,
+    but it waits in a local event loop (see QWebMethodCall::waitForFinished()),
+    so it does not use the CPU while waiting. If the reply does not arrive
+    within 30 seconds, the request is aborted and an empty array is returned.
   */
 QByteArray QWebServiceMethod::invokeMethod(const QUrl &url,
                                           const QString &methodName,
@@ -173,13 +176,9 @@ QByteArray QWebServiceMethod::invokeMethod(const QUrl &url,
     QWebServiceMethod qsm(url.toString(), methodName, targetNamespace, params,
                           protocol, httpMethod, parent);
 
-    qsm.invokeMethod();
-    // TODO: ADD ERROR HANDLING!
-    forever {
-        if (qsm.isReplyReady()) {
-            return qsm.d_func()->reply;
-        } else {
-            qApp->processEvents();
-        }
-    }
+    QWebMethodCall *call = qsm.invokeMethod();
+    if (!call || !call->waitForFinished(QWebMethodPrivate::DefaultTimeout))
+        return QByteArray();
+
+    return qsm.d_func()->reply;
 }
@@ -0,0 +1,176 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <QtCore/qthreadstorage.h>
+#include <QtCore/qcoreevent.h>
+#include <QtCore/qlist.h>
+#include "../headers/qwebtimerqueue_p.h"
+
+/*!
+    \class QWebTimerQueue
+    \internal
+    \brief Tracks many deadlines with a single timer.
+
+    Starting a QTimer for each outstanding request does not scale well,
+    when thousands of requests are in flight. The queue keeps all deadlines
+    of a thread sorted in a map, and runs one QBasicTimer, set for the
+    earliest of them. Scheduling and cancelling a deadline take logarithmic
+    time, and the timer is restarted only when the earliest deadline changes.
+
+    There is one queue per thread (see instance()). When a deadline passes,
+    \a member slot of the receiver is invoked. Receivers that have been
+    deleted in the meantime are skipped.
+
+    Queue is used for call timeouts (QWebMethod::setTimeout()), and for all
+    other delayed actions of the library.
+  */
+
+static QThreadStorage<QWebTimerQueue *> timerQueueStorage;
+
+/*!
+    \internal
+
+    Constructs an empty queue.
+  */
+QWebTimerQueue::QWebTimerQueue() :
+    QObject(), timerDeadline(-1), lastId(0)
+{
+    clock.start();
+}
+
+/*!
+    Returns the queue of current thread, creating it when necessary.
+    The queue is deleted when the thread finishes.
+  */
+QWebTimerQueue *QWebTimerQueue::instance()
+{
+    if (!timerQueueStorage.hasLocalData())
+        timerQueueStorage.setLocalData(new QWebTimerQueue);
+
+    return timerQueueStorage.localData();
+}
+
+/*!
+    Schedules invocation of \a member slot (name only, without parameters
+    or SLOT() macro) of \a receiver, in \a msecs milliseconds.
+    Returns identifier of the deadline, which can be passed to cancel().
+  */
+int QWebTimerQueue::schedule(int msecs, QObject *receiver, const char *member)
+{
+    Entry entry;
+    entry.deadline = now() + qMax(msecs, 0);
+    entry.receiver = receiver;
+    entry.member = member;
+
+    int id = ++lastId;
+    entries.insert(id, entry);
+    deadlines.insert(entry.deadline, id);
+
+    if ((timerDeadline == -1) || (entry.deadline < timerDeadline))
+        restartTimer();
+
+    return id;
+}
+
+/*!
+    Removes deadline \a id from the queue. Returns false if there was no
+    such deadline (for example, because it has already passed).
+  */
+bool QWebTimerQueue::cancel(int id)
+{
+    QHash<int, Entry>::iterator entry = entries.find(id);
+    if (entry == entries.end())
+        return false;
+
+    qint64 deadline = entry->deadline;
+    entries.erase(entry);
+    deadlines.remove(deadline, id);
+
+    // Timer fires early at worst, so it is only restarted when the queue
+    // becomes empty.
+    if (deadlines.isEmpty())
+        restartTimer();
+
+    return true;
+}
+
+/*!
+    Returns number of deadlines waiting in the queue.
+  */
+int QWebTimerQueue::count() const
+{
+    return entries.size();
+}
+
+/*!
+    Returns time (in milliseconds) measured by the monotonic clock
+    of the queue. Deadlines are expressed in this time.
+  */
+qint64 QWebTimerQueue::now() const
+{
+    return clock.elapsed();
+}
+
+/*!
+    \internal
+
+    Invokes all receivers, whose deadlines have passed (\a event is the
+    timer event of the queue).
+  */
+void QWebTimerQueue::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() != timer.timerId()) {
+        QObject::timerEvent(event);
+        return;
+    }
+
+    qint64 currentTime = now();
+    QList<Entry> expired;
+    QMultiMap<qint64, int>::iterator i = deadlines.begin();
+    while ((i != deadlines.end()) && (i.key() <= currentTime)) {
+        expired.append(entries.take(i.value()));
+        i = deadlines.erase(i);
+    }
+
+    restartTimer();
+
+    // Receivers can schedule and cancel deadlines, so the queue has to be
+    // consistent before they are invoked.
+    foreach (const Entry &entry, expired) {
+        if (entry.receiver) {
+            QMetaObject::invokeMethod(entry.receiver, entry.member.constData(),
+                                      Qt::DirectConnection);
+        }
+    }
+}
+
+/*!
+    \internal
+
+    Sets the timer for the earliest deadline, or stops it.
+  */
+void QWebTimerQueue::restartTimer()
+{
+    if (deadlines.isEmpty()) {
+        timer.stop();
+        timerDeadline = -1;
+        return;
+    }
+
+    timerDeadline = deadlines.constBegin().key();
+    timer.start(int(qMax(timerDeadline - now(), qint64(0))), this);
+}
@@ -0,0 +1,192 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <string.h>
+#include "../headers/qwebuploaddevice_p.h"
+
+/*!
+    \class QWebUploadDevice
+    \internal
+    \brief Request body made of constant head and tail, and content read
+    from another device.
+
+    Used by QWebMethod::invokeMethod(QIODevice *) to send large parameters
+    without reading them into memory: QNetworkAccessManager reads the body
+    from this device, in small pieces, as the upload progresses.
+
+    When the content device is random-access (a file, for example),
+    so is the upload device: its size is known, and it can be rewound,
+    so the request can be sent again. Sequential content is read once.
+  */
+
+/*!
+    Constructs a device returning \a head, then everything that can be read
+    from \a content (starting at its current position), and then \a tail.
+    The content device has to be open, and outlive the upload device.
+  */
+QWebUploadDevice::QWebUploadDevice(const QByteArray &head, QIODevice *content,
+                                   const QByteArray &tail, QObject *parent) :
+    QIODevice(parent), m_head(head), m_content(content),
+    contentStart(content->isSequential() ? 0 : content->pos()), m_tail(tail),
+    offset(0), contentRead(0), contentEnded(false)
+{
+    // Data is buffered by the reader, another buffer would only copy it.
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    connect(content, SIGNAL(readyRead()), this, SIGNAL(readyRead()));
+}
+
+/*!
+    Returns true if the content device is sequential.
+  */
+bool QWebUploadDevice::isSequential() const
+{
+    return m_content.isNull() || m_content->isSequential();
+}
+
+/*!
+    Returns size of the whole body, if the content device is random-access.
+  */
+qint64 QWebUploadDevice::size() const
+{
+    if (isSequential())
+        return QIODevice::size();
+
+    return m_head.size() + (m_content->size() - contentStart) + m_tail.size();
+}
+
+/*!
+    Moves to position \a pos of the body. Only random-access bodies can
+    be rewound.
+  */
+bool QWebUploadDevice::seek(qint64 pos)
+{
+    if (isSequential() && (pos != offset))
+        return false;
+    if ((pos < 0) || (!isSequential() && (pos > size())))
+        return false;
+
+    QIODevice::seek(pos);
+    offset = pos;
+    if (!isSequential()) {
+        qint64 contentSize = m_content->size() - contentStart;
+        contentRead = qBound(qint64(0), pos - m_head.size(), contentSize);
+        contentEnded = (contentRead == contentSize) && (pos >= m_head.size());
+    }
+    return true;
+}
+
+/*!
+    Returns true if the whole body has been read.
+  */
+bool QWebUploadDevice::atEnd() const
+{
+    if (!isSequential())
+        return offset >= size();
+
+    return contentEnded && (offset >= m_head.size() + contentRead + m_tail.size());
+}
+
+/*!
+    Returns number of bytes that can be read without waiting.
+  */
+qint64 QWebUploadDevice::bytesAvailable() const
+{
+    if (!isSequential())
+        return QIODevice::bytesAvailable();
+
+    if (contentEnded)
+        return m_head.size() + contentRead + m_tail.size() - offset;
+
+    qint64 available = qMax(m_head.size() - offset, qint64(0));
+    if (!m_content.isNull())
+        available += m_content->bytesAvailable();
+    return available;
+}
+
+/*!
+    \internal
+
+    Reads up to \a maxSize bytes of the body into \a data.
+  */
+qint64 QWebUploadDevice::readData(char *data, qint64 maxSize)
+{
+    const qint64 headSize = m_head.size();
+    qint64 done = 0;
+
+    if (offset < headSize) {
+        qint64 chunk = qMin(maxSize, headSize - offset);
+        memcpy(data, m_head.constData() + offset, size_t(chunk));
+        done += chunk;
+        offset += chunk;
+    }
+
+    if ((done < maxSize) && !contentEnded) {
+        qint64 chunk = -1;
+        if (isSequential()) {
+            if (!m_content.isNull())
+                chunk = m_content->read(data + done, maxSize - done);
+            if ((chunk < 0) || ((chunk == 0) && m_content->atEnd()))
+                contentEnded = true;
+        } else {
+            qint64 contentLeft = (m_content->size() - contentStart) - (offset - headSize);
+            if (contentLeft > 0) {
+                qint64 contentPos = contentStart + offset - headSize;
+                if ((m_content->pos() == contentPos) || m_content->seek(contentPos))
+                    chunk = m_content->read(data + done, qMin(maxSize - done, contentLeft));
+                if (chunk < 0)
+                    return done ? done : qint64(-1);
+                contentEnded = (chunk >= contentLeft);
+            } else {
+                contentEnded = true;
+            }
+        }
+
+        if (chunk > 0) {
+            done += chunk;
+            offset += chunk;
+            contentRead += chunk;
+        }
+
+        // More content will come later (or after a short read).
+        if (!contentEnded)
+            return done;
+    }
+
+    qint64 tailOffset = offset - headSize - contentRead;
+    if ((done < maxSize) && (tailOffset < m_tail.size())) {
+        qint64 chunk = qMin(maxSize - done, m_tail.size() - tailOffset);
+        memcpy(data + done, m_tail.constData() + tailOffset, size_t(chunk));
+        done += chunk;
+        offset += chunk;
+    }
+
+    if ((done == 0) && atEnd())
+        return -1;
+    return done;
+}
+
+/*!
+    \internal
+
+    Upload device is read-only.
+  */
+qint64 QWebUploadDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
@@ -0,0 +1,279 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebService library.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <QtCore/qmetaobject.h>
+#include "../headers/qwebworkerpool_p.h"
+#include "../headers/qwebmethod_p.h"
+
+/*!
+    \class QWebWorkerPool
+    \internal
+    \brief Runs web methods of a QWebService in dedicated threads.
+
+    QWebMethod is bound to the thread it has been created in, so normally
+    all network work of a web service is done by the event loop of a single
+    thread. With worker threads enabled (see QWebService::setWorkerThreads()),
+    the pool owns a number of threads, each running a QWebWorker.
+
+    Invocations can be submitted from any thread. They are distributed over
+    the workers in turn, and passed to them through lock-free queues
+    (QWebMpscQueue), so submitting threads never block each other. Results
+    are delivered to the receiver, in its own thread, with a queued call.
+  */
+
+static QAtomicInt lastInvocationId(0);
+
+/*!
+    Starts \a threadCount worker threads.
+  */
+QWebWorkerPool::QWebWorkerPool(int threadCount) :
+    nextWorker(0)
+{
+    for (int i = 0; i < qMax(threadCount, 1); ++i) {
+        QThread *thread = new QThread;
+        QWebWorker *worker = new QWebWorker;
+        worker->moveToThread(thread);
+        thread->start();
+        threads.append(thread);
+        workers.append(worker);
+    }
+}
+
+/*!
+    Stops all worker threads. Calls in progress are aborted, and their
+    results are not delivered.
+  */
+QWebWorkerPool::~QWebWorkerPool()
+{
+    for (int i = 0; i < threads.size(); ++i) {
+        // Network managers of the thread are deleted when it finishes,
+        // so calls have to be gone by then.
+        QMetaObject::invokeMethod(workers.at(i), "shutdown", Qt::BlockingQueuedConnection);
+        threads.at(i)->wait();
+        delete workers.at(i);
+        delete threads.at(i);
+    }
+}
+
+/*!
+    Returns number of worker threads.
+  */
+int QWebWorkerPool::threadCount() const
+{
+    return threads.size();
+}
+
+/*!
+    Copies settings of \a method, used by invocations of \a methodName
+    submitted from now on. Passing 0 removes the method. Must be called
+    in the thread of the \a method, nobody else reads it.
+  */
+void QWebWorkerPool::publish(const QString &methodName, QWebMethod *method)
+{
+    QSharedPointer<const QWebMethodPrivate> snapshot;
+    if (method) {
+        QWebMethodPrivate *copy = new QWebMethodPrivate;
+        copy->init();
+        copy->copySettings(method->d_func());
+        snapshot = QSharedPointer<const QWebMethodPrivate>(copy);
+    }
+
+    QMutexLocker locker(&settingsMutex);
+    if (snapshot.isNull())
+        settings.remove(methodName);
+    else
+        settings.insert(methodName, snapshot);
+}
+
+/*!
+    Removes settings of all methods, submitting them fails until they are
+    published again.
+  */
+void QWebWorkerPool::unpublishAll()
+{
+    QMutexLocker locker(&settingsMutex);
+    settings.clear();
+}
+
+/*!
+    Submits an invocation of web method \a methodName, with \a parameters
+    (or raw \a data, if it is not empty), using its last published settings.
+    The result is passed to \a member of \a receiver. Can be called from any
+    thread. Returns the ID of the invocation, or -1 if the method has not
+    been published.
+  */
+int QWebWorkerPool::submit(const QString &methodName, const QMap<QString, QVariant> &parameters,
+                           const QByteArray &data, QObject *receiver, const char *member)
+{
+    QSharedPointer<const QWebMethodPrivate> snapshot;
+    {
+        QMutexLocker locker(&settingsMutex);
+        snapshot = settings.value(methodName);
+    }
+    if (snapshot.isNull())
+        return -1;
+
+    QWebInvocation *invocation = new QWebInvocation;
+    invocation->requestId = lastInvocationId.fetchAndAddOrdered(1) + 1;
+    invocation->settings = snapshot;
+    invocation->parameters = parameters;
+    invocation->data = data;
+    invocation->receiver = receiver;
+    // SLOT() adds a code in front of the signature, only the name is needed.
+    QByteArray signature(member);
+    if (!signature.isEmpty() && (signature.at(0) >= '0') && (signature.at(0) <= '9'))
+        signature.remove(0, 1);
+    invocation->member = signature.left(signature.indexOf('('));
+
+    int index = nextWorker.fetchAndAddRelaxed(1);
+    workers.at(int(uint(index) % uint(workers.size())))->enqueue(invocation);
+    return invocation->requestId;
+}
+
+/*!
+    \class QWebWorker
+    \internal
+    \brief Invokes web methods in a worker thread of QWebWorkerPool.
+
+    Worker keeps a copy of each web method it has been asked to invoke,
+    living in its own thread. Settings published by QWebWorkerPool::publish()
+    are applied to the copy before each call (see
+    QWebMethodPrivate::copySettings()).
+  */
+
+/*!
+    Constructs the worker.
+  */
+QWebWorker::QWebWorker() :
+    QObject(), wakeUpPending(0)
+{
+}
+
+/*!
+    Deletes invocations that have not been started.
+  */
+QWebWorker::~QWebWorker()
+{
+    QWebInvocation *invocation = 0;
+    while (queue.dequeue(&invocation))
+        delete invocation;
+}
+
+/*!
+    Adds the \a invocation to the queue of the worker. Can be called from any
+    thread. The worker is woken up only when it is not about to drain
+    the queue anyway, so bursts of invocations post a single event.
+  */
+void QWebWorker::enqueue(QWebInvocation *invocation)
+{
+    queue.enqueue(invocation);
+    if (wakeUpPending.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+}
+
+/*!
+    Starts all queued invocations. Runs in the worker thread.
+  */
+void QWebWorker::drain()
+{
+    // Invocations enqueued from now on post another wake up.
+    wakeUpPending.fetchAndStoreOrdered(0);
+
+    QWebInvocation *invocation = 0;
+    while (queue.dequeue(&invocation)) {
+        QWebMethod *method = methodFor(invocation);
+        // Empty parameters are set as well, or the last ones would be sent.
+        method->setParameters(invocation->parameters);
+
+        QWebMethodCall *call = method->invokeMethod(invocation->data);
+        if (!call) {
+            deliver(invocation, QByteArray(), method->errorInfo());
+            continue;
+        }
+
+        running.insert(call, invocation);
+        connect(call, SIGNAL(finished()), this, SLOT(callFinished()));
+    }
+}
+
+/*!
+    Aborts all calls, and stops the thread of the worker. Runs in the worker
+    thread.
+  */
+void QWebWorker::shutdown()
+{
+    qDeleteAll(running.values());
+    running.clear();
+    // Calls are children of their web methods.
+    qDeleteAll(clones.values());
+    clones.clear();
+    QThread::currentThread()->quit();
+}
+
+/*!
+    \internal
+
+    Delivers the result of a finished call.
+  */
+void QWebWorker::callFinished()
+{
+    QWebMethodCall *call = qobject_cast<QWebMethodCall *>(sender());
+    QWebInvocation *invocation = running.take(call);
+    if (!invocation)
+        return;
+
+    deliver(invocation, call->replyReadRaw(), call->errorInfo());
+}
+
+/*!
+    \internal
+
+    Returns copy of the web method of \a invocation, living in the worker
+    thread, with settings of the \a invocation.
+  */
+QWebMethod *QWebWorker::methodFor(const QWebInvocation *invocation)
+{
+    const QString &name = invocation->settings->m_methodName;
+    QWebMethod *clone = clones.value(name);
+    if (!clone) {
+        clone = new QWebMethod(this);
+        clones.insert(name, clone);
+    }
+
+    clone->d_func()->copySettings(invocation->settings.data());
+    return clone;
+}
+
+/*!
+    \internal
+
+    Passes \a reply and \a errorInfo of \a invocation to its receiver, which
+    gets them in its own thread. Deletes the \a invocation.
+  */
+void QWebWorker::deliver(QWebInvocation *invocation, const QByteArray &reply,
+                         const QString &errorInfo)
+{
+    if (invocation->receiver) {
+        QMetaObject::invokeMethod(invocation->receiver, invocation->member.constData(),
+                                  Qt::QueuedConnection,
+                                  Q_ARG(int, invocation->requestId),
+                                  Q_ARG(QByteArray, reply),
+                                  Q_ARG(QString, errorInfo));
+    }
+
+    delete invocation;
+}
@@ -185,6 +185,9 @@ void QWsdl::resetWsdl(const QString &newWsdl)
     d->errorMessage = QString();
     d->m_webServiceName = QString();
     d->m_hostUrl.setUrl(QString());
+    d->m_hostUrls.clear();
+    d->m_ports.clear();
+    d->bindingVerbs.clear();
     d->m_targetNamespace = QString();
     d->xmlReader.clear();
 
@@ -247,9 +250,10 @@ QString QWsdl::host() const
 
 /*!
     Returns web service's URL. If there is no valid URL in WSDL file,
-    path to this file is returned.
+    path to this file is returned. When WSDL lists several addresses,
+    the last one is returned.
 
-    \sa host()
+    \sa host(), hostUrls()
   */
 QUrl QWsdl::hostUrl() const
 {
@@ -260,6 +264,61 @@ QUrl QWsdl::hostUrl() const
         return QUrl(d->m_wsdlFilePath);
 }
 
+/*!
+    Returns addresses of all ports of the web service, in the order they
+    appear in WSDL (duplicates are skipped). Ports often differ in their
+    binding, use hostUrls(QWebMethod::Protocol, QWebMethod::HttpMethod)
+    to get addresses a method can be sent to.
+
+    \sa hostUrl()
+  */
+QList<QUrl> QWsdl::hostUrls() const
+{
+    Q_D(const QWsdl);
+    return d->m_hostUrls;
+}
+
+/*!
+    Returns addresses of those ports of the web service, that can be used
+    by a web method with \a protocol and \a httpMethod: ports with SOAP 1.0
+    or SOAP 1.2 binding for SOAP methods, and ports with HTTP binding (with
+    a matching verb, when it is given) for other protocols. Addresses are
+    in the order they appear in WSDL.
+
+    Only these addresses are replicas for the method, other ports accept
+    different messages, even when they are on the same host.
+
+    \sa hostUrl()
+  */
+QList<QUrl> QWsdl::hostUrls(QWebMethod::Protocol protocol,
+                            QWebMethod::HttpMethod httpMethod) const
+{
+    Q_D(const QWsdl);
+    QString verb;
+    if (httpMethod == QWebMethod::Get)
+        verb = QLatin1String("GET");
+    else if (httpMethod == QWebMethod::Post)
+        verb = QLatin1String("POST");
+
+    QList<QUrl> result;
+    for (int i = 0; i < d->m_ports.size(); ++i) {
+        const QString &binding = d->m_ports.at(i).second;
+        bool matches = false;
+        if (protocol & QWebMethod::Soap) {
+            matches = ((protocol & QWebMethod::Soap10) && (binding == QLatin1String("soap")))
+                    || ((protocol & QWebMethod::Soap12) && (binding == QLatin1String("soap12")));
+        } else if ((binding != QLatin1String("soap")) && (binding != QLatin1String("soap12"))) {
+            // Other protocols are sent over plain HTTP.
+            matches = verb.isEmpty() || (binding == verb) || (binding == QLatin1String("http"));
+        }
+
+        if (matches && !result.contains(d->m_ports.at(i).first))
+            result.append(d->m_ports.at(i).first);
+    }
+
+    return result;
+}
+
 /*!
     Returns target namespace specified in WSDL.
   */
@@ -300,6 +359,10 @@ bool QWsdl::isErrorState() const
 void QWsdl::fileReplyFinished(QNetworkReply *rply)
 {
     Q_D(QWsdl);
+    // Manager is shared, replies sent by other objects have to be skipped.
+    if (rply->request().originatingObject() != this)
+        return;
+
     QString replyString = d->convertReplyToUtf(QLatin1String(rply->readAll()));
     QFile file(QLatin1String("tempWsdl.asmx~"));
     d->m_wsdlFilePath = QLatin1String("tempWsdl.asmx~");
@@ -373,6 +436,8 @@ bool QWsdl::parse()
     }
 
     prepareFile();
+    if (d->errorState)
+        return false;
 
     QFile file(d->m_wsdlFilePath);
     if (!file.open(QFile::ReadOnly | QFile::Text)) {
@@ -417,6 +482,9 @@ bool QWsdl::parse()
 
     If the host path is not a local file, but URL, QWsdl will download
     it into a temporary file, then read, and delete at exit.
+
+    Download is blocking, but waits in a local event loop, and
+    gives up after 30 seconds.
   */
 void QWsdl::prepareFile()
 {
@@ -426,20 +494,23 @@ void QWsdl::prepareFile()
 
     if (!QFile::exists(d->m_wsdlFilePath) && filePath.isValid()) {
         d->m_hostUrl = filePath;
-        QNetworkAccessManager *manager = new QNetworkAccessManager();
-        QObject::connect(manager, SIGNAL(finished(QNetworkReply*)),
-                this, SLOT(fileReplyFinished(QNetworkReply*)));
-        manager->get(QNetworkRequest(filePath));
-
-        forever {
-            if (d->replyReceived == true) {
-                return;
-            } else {
-                QCoreApplication::instance()->processEvents();
-            }
+        // Manager is shared with web methods of this host.
+        QNetworkAccessManager *manager = QWebNetworkManagerPool::manager(filePath);
+        QNetworkRequest request(filePath);
+        request.setOriginatingObject(this);
+        QNetworkReply *reply = manager->get(request);
+
+        if (!QWebMethodPrivate::waitForSignal(reply, SIGNAL(finished()),
+                                              QWebMethodPrivate::DefaultTimeout)) {
+            reply->abort();
+            reply->deleteLater();
+            d->enterErrorState(QString(QLatin1String("Error: timed out while "
+                                                     "downloading WSDL file: ")
+                                       + d->m_wsdlFilePath));
+            return;
         }
 
-        delete manager;
+        fileReplyFinished(reply);
     }
 }
 
@@ -490,8 +561,7 @@ void QWsdlPrivate::readDefinitions()
             tagUsed.insert(QLatin1String("portType"), true);
             xmlReader.readNext();
         } else if (tempName == QLatin1String("binding")) {
-            if (!tagUsed.value(QLatin1String("binding")))
-                readBindings();
+            readBindings();
             tagUsed.insert(QLatin1String("binding"), true);
             xmlReader.readNext();
         } else if (tempName == QLatin1String("service")) {
@@ -748,8 +818,17 @@ void QWsdlPrivate::readPorts()
   */
 void QWsdlPrivate::readBindings()
 {
-//    qDebug() << "WSDL :binding tag not supported yet.";
-    xmlReader.readNext();
+    // Only verbs of HTTP bindings are read, so that ports can be matched
+    // with methods (see QWsdl::hostUrls()).
+    if (!xmlReader.isStartElement())
+        return;
+
+    if (xmlReader.namespaceUri() == QLatin1String("http://schemas.xmlsoap.org/wsdl/")) {
+        currentBinding = xmlReader.attributes().value(QLatin1String("name")).toString();
+    } else if (xmlReader.namespaceUri() == QLatin1String("http://schemas.xmlsoap.org/wsdl/http/")) {
+        bindingVerbs.insert(currentBinding, xmlReader.attributes().value(
+                                QLatin1String("verb")).toString().toUpper());
+    }
 }
 
 /*!
@@ -757,9 +836,10 @@ void QWsdlPrivate::readBindings()
   */
 void QWsdlPrivate::readService()
 {
-    // TODO: add different addresses for different message types.
+    // Every address is kept, with binding of its port. hostUrl() is the last one.
 //    qDebug() << "WSDL :service tag not supported yet.";
     QString tempName;
+    QString portBinding;
 
     while (!xmlReader.atEnd()) {
         tempName = xmlReader.name().toString();
@@ -778,11 +858,29 @@ void QWsdlPrivate::readService()
                         QLatin1String("name")).toString();
         }
 
+        if (xmlReader.isStartElement() && (tempName == QLatin1String("port"))) {
+            // Binding names are qualified with a namespace prefix.
+            portBinding = xmlReader.attributes().value(QLatin1String("binding")).toString();
+            portBinding = portBinding.mid(portBinding.indexOf(QLatin1Char(':')) + 1);
+        }
+
         if ((tempName == QLatin1String("address"))
                 && xmlReader.attributes().hasAttribute(
                     QLatin1String("location"))) {
             m_hostUrl.setUrl(xmlReader.attributes().value(
                                  QLatin1String("location")).toString());
+            if (!m_hostUrls.contains(m_hostUrl))
+                m_hostUrls.append(m_hostUrl);
+
+            QStringRef addressNamespace = xmlReader.namespaceUri();
+            QString binding;
+            if (addressNamespace == QLatin1String("http://schemas.xmlsoap.org/wsdl/soap/"))
+                binding = QLatin1String("soap");
+            else if (addressNamespace == QLatin1String("http://schemas.xmlsoap.org/wsdl/soap12/"))
+                binding = QLatin1String("soap12");
+            else
+                binding = bindingVerbs.value(portBinding, QLatin1String("http"));
+            m_ports.append(qMakePair(m_hostUrl, binding));
         }
 
         xmlReader.readNext();
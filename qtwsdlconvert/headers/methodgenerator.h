@@ -46,7 +46,6 @@ private:
 
     void assignAllParameters(QWebMethod *mtd, QTextStream &out);
     QString assignAllParameters(QWebMethod *mtd);
-    void addCustomCodeToConstructor(QString &sourceCode, QWebMethod *mtd, int &beginIndex);
 
     QMap<QString, QWebMethod *> *methods;
     QDir workingDir;
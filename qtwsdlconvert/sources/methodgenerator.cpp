@@ -25,7 +25,9 @@
     or subclassing QWebServiceMethod (depending on whether --subclass flag is set).
 
     Generation is based on templates located in ./qtwsdlconverter/templates (for
-    subclassed methods) and on real QWebMethod code (for non-subclassed methods).
+    subclassed methods). Non-subclassed methods are written directly: they
+    derive from QWebMethod, and link against QWebService library, instead of
+    copying its code (which depends on private classes of the library).
   */
 
 /*!
@@ -325,21 +327,12 @@ bool MethodGenerator::createSubclassedMethodSource(QWebMethod *mtd)
 //            tempS.chop(2);
             toInsert += tempS + "parent);" + flags->endLine();
         }
+        // Waits in a local event loop, with a timeout (no busy waiting).
         toInsert += flags->endLine() + flags->tab()
-                + "qsm.invokeMethod();" + flags->endLine()
-                + flags->tab() + "// TODO: ADD ERROR HANDLING!" + flags->endLine()
-                + flags->tab() + "forever" + flags->endLine()
-                + flags->tab() + "{" + flags->endLine()
-                + flags->tab() + flags->tab() + "if (qsm.isReplyReady())" + flags->endLine()
-                + flags->tab() + flags->tab() + flags->tab() + "return qsm.replyRead();"
-                + flags->endLine()
-                + flags->tab() + flags->tab() + "else" + flags->endLine()
-                + flags->tab() + flags->tab() + "{" + flags->endLine()
-                + flags->tab() + flags->tab() + flags->tab()
-                + "QCoreApplication::instance()->processEvents();"
-                + flags->endLine()
-                + flags->tab() + flags->tab() + "}" + flags->endLine()
-                + flags->tab() + "}" + flags->endLine()
+                + "QWebMethodCall *call = qsm.invokeMethod();" + flags->endLine()
+                + flags->tab() + "if (call && call->waitForFinished())" + flags->endLine()
+                + flags->tab() + flags->tab() + "return qsm.replyRead();" + flags->endLine()
+                + flags->tab() + "return QString();" + flags->endLine()
                 + "}";
 
         methodSource.insert(beginIndex, toInsert);
@@ -371,7 +364,9 @@ bool MethodGenerator::createSubclassedMethodSource(QWebMethod *mtd)
 /*!
     \internal
 
-    Creates a non-subclassed method header.
+    Creates a non-subclassed method header. The method class derives
+    from QWebMethod, and uses QWebService library for everything but
+    typed parameters.
   */
 bool MethodGenerator::createMethodHeader(QWebMethod *mtd)
 {
@@ -382,22 +377,9 @@ bool MethodGenerator::createMethodHeader(QWebMethod *mtd)
         return enterErrorState(QLatin1String("Error: could not open web method "
                                              "header file for writing."));
 
-    // Possible problem in case of multi-return.
-    QString mtdReplyName = mtd->returnValueName().first();
-
-    QString mtdReplyType;
     QString mtdParameters;
     {
-        // Create mtdReplyType
-        QMap<QString, QVariant> tempMap = mtd->returnValueNameType();
-
-        foreach (QString s, tempMap.keys()) {
-            mtdReplyType += tempMap.value(s).typeName();
-            break;
-        }
-
-        tempMap.clear();
-        tempMap = mtd->parameterNamesTypes();
+        QMap<QString, QVariant> tempMap = mtd->parameterNamesTypes();
 
         // Create mtdParameters (comma separated list)
         foreach (QString s, tempMap.keys()) {
@@ -406,85 +388,55 @@ bool MethodGenerator::createMethodHeader(QWebMethod *mtd)
         mtdParameters.chop(2);
     }
 
-    QString methodHeader = logic.mergeHeaders("../QWebService/headers/qwebmethod.h",
-                                         "../QWebService/headers/qwebmethod_p.h");
-
-    int beginIndex = 0;
-    int endIndex = 0;
-    // Replace QWebMethod with mtdName.
-    methodHeader.replace("QWebMethod", mtdName, Qt::CaseSensitive);
-
-    // Add constructor.
+    // ---------------------------------
+    // Begin writing:
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    // Might break on curious names
+    out << "#ifndef " << mtdName.toUpper() << "_H" << flags->endLine();
+    out << "#define " << mtdName.toUpper() << "_H" << flags->endLine();
+    out << flags->endLine();
+    out << "#include <QWebService>" << flags->endLine();
+    out << flags->endLine();
+    out << "class " << mtdName << " : public QWebMethod" << flags->endLine();
+    out << "{" << flags->endLine();
+    out << flags->tab() << "Q_OBJECT" << flags->endLine();
+    out << flags->endLine();
+    out << "public:" << flags->endLine();
+    out << flags->tab() << mtdName << "(QObject *parent = 0);" << flags->endLine();
     if (mtdParameters != QString()) {
-        beginIndex = methodHeader.indexOf("~") - 4;
-        methodHeader.insert(beginIndex,
-                             flags->tab() + mtdName + "(QObject *parent, "
-                             + mtdParameters + ");"
-                             + flags->endLine());
+        out << flags->tab() << mtdName << "(QObject *parent, " << mtdParameters << ");"
+            << flags->endLine();
     }
-
-    // Replace parameters list for setParameters().
-    beginIndex = methodHeader.indexOf("setParameters(") + 14;
-    endIndex = methodHeader.indexOf(");", beginIndex);
-    methodHeader.replace(beginIndex, endIndex - beginIndex, mtdParameters);
+    out << flags->endLine();
+    out << flags->tab() << "using QWebMethod::setParameters;" << flags->endLine();
+    out << flags->tab() << "void setParameters(" << mtdParameters << ");" << flags->endLine();
+    out << flags->tab() << "using QWebMethod::invokeMethod;" << flags->endLine();
 
     // Create asynchronous invokeMethod().
     if ((mtdParameters != QString()) && !(flags->flags() & Flags::CompactMode)
-                                   && (flags->flags() & Flags::Asynchronous)) {
-        beginIndex = methodHeader.indexOf("invokeMethod(");
-        endIndex = methodHeader.indexOf(");", beginIndex) + 2;
-        methodHeader.insert(endIndex,
-                             flags->endLine() + flags->tab()
-                             + "bool invokeMethod("
-                             + mtdParameters
-                             + ");" + flags->endLine());
+            && (flags->flags() & Flags::Asynchronous)) {
+        out << flags->tab() << "QWebMethodCall *invokeMethod(" << mtdParameters << ");"
+            << flags->endLine();
     }
 
     // Create synchronous static invokeMethod().
     if (!(flags->flags() & Flags::CompactMode)
-            && (flags->flags() & Flags::Synchronous))
-    {
-        beginIndex = methodHeader.indexOf("invokeMethod(");
-        endIndex = methodHeader.indexOf(");", beginIndex) + 2;
-        if (mtdParameters != QString()) {
-            methodHeader.insert(endIndex,
-                                 flags->tab()
-                                 + "QString static invokeMethod(QObject *parent, "
-                                 + mtdParameters
-                                 + ");" + flags->endLine());
-        } else {
-            methodHeader.insert(endIndex,
-                                 flags->tab()
-                                 + "QString static invokeMethod(QObject *parent"
-                                 + ");" + flags->endLine());
-        }
-    }
-
-    // Create parameters list in declarative form.
-    beginIndex = methodHeader.indexOf("};", endIndex) - 5;
-    methodHeader.insert(beginIndex,
-                         flags->tab() + "// -------------------------" + flags->endLine()
-                         + flags->tab() + "// Parameters:" + flags->endLine());
-    QMap<QString, QVariant> tempMap = mtd->parameterNamesTypes();
-    foreach (QString s, tempMap.keys()) {
-        beginIndex = methodHeader.indexOf("};", endIndex) - 5;
-        methodHeader.insert(beginIndex, flags->tab() + tempMap.value(s).typeName()
-                             + " " + s + ";" + flags->endLine());
+            && (flags->flags() & Flags::Synchronous)) {
+        out << flags->tab() << "QString static invokeMethod(QObject *parent";
+        if (mtdParameters != QString())
+            out << ", " << mtdParameters;
+        out << ");" << flags->endLine();
     }
-    beginIndex = methodHeader.indexOf("};", endIndex) - 5;
-    methodHeader.insert(beginIndex, flags->tab() + "// End of parameters" + flags->endLine()
-                         + flags->tab() + "// -------------------------" + flags->endLine());
 
-    // Begin writing:
-    QTextStream out(&file);
-//    out.setCodec("UTF-8");
-    // Might break on curious names
-    out << "#ifndef " << mtdName.toUpper() << "_H" << flags->endLine();
-    out << "#define " << mtdName.toUpper() << "_H" << flags->endLine();
     out << flags->endLine();
-    out << methodHeader;
+    out << "private:" << flags->endLine();
+    out << flags->tab() << "void configure();" << flags->endLine();
+    out << "};" << flags->endLine();
+    out << flags->endLine();
     out << "#endif // " << mtdName.toUpper() << "_H" << flags->endLine();
     // EOF (method header)
+    // ---------------------------------
 
     file.close();
     return true;
@@ -493,7 +445,8 @@ bool MethodGenerator::createMethodHeader(QWebMethod *mtd)
 /*!
     \internal
 
-    Creates a non-subclassed method source.
+    Creates a non-subclassed method source. Parameters are passed
+    to QWebMethod::setParameters(), which sends them.
   */
 bool MethodGenerator::createMethodSource(QWebMethod *mtd)
 {
@@ -504,192 +457,106 @@ bool MethodGenerator::createMethodSource(QWebMethod *mtd)
         return enterErrorState(QLatin1String("Error: could not open web method"
                                              "source file for writing."));
 
-    // Possible problem in case of multi-return.
-    QString mtdReplyName = mtd->returnValueName().first();
-
-    QString mtdReplyType;
     QString mtdParameters;
+    QString mtdArguments;
     {
-        QMap<QString, QVariant> tempMap = mtd->returnValueNameType();
-
-        foreach (QString s, tempMap.keys()) {
-            mtdReplyType += tempMap.value(s).typeName();
-            break;
-        }
-
-        tempMap.clear();
-        tempMap = mtd->parameterNamesTypes();
+        QMap<QString, QVariant> tempMap = mtd->parameterNamesTypes();
 
         foreach (QString s, tempMap.keys()) {
             mtdParameters += QString(tempMap.value(s).typeName())
                     + " " + s + ", ";
+            mtdArguments += s + ", ";
         }
         mtdParameters.chop(2);
+        mtdArguments.chop(2);
     }
 
-    QString methodSource = logic.stripFile(
-                logic.readFile("../QWebService/sources/qwebmethod.cpp"),
-                logic.Source);
+    // ---------------------------------
+    // Begin writing:
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    out << "#include \"";
+    if (!(flags->flags() & Flags::AllInOneDirStructure))
+        out << "../headers/";
+    out << mtdName << ".h\"" << flags->endLine();
+    out << flags->endLine();
 
-    int beginIndex = 0;
-    int endIndex = 0;
-    // Remove traces of QWebMethodPrivate.
-    methodSource.remove("Q_D(QWebMethod);");
-    methodSource.remove("Q_D(const QWebMethod);");
-    methodSource.remove("Q_Q(QWebMethod);");
-    methodSource.remove("Q_Q(const QWebMethod);");
-    methodSource.remove("d->");
-    methodSource.remove("q->");
-    methodSource.remove(", d_ptr(new QWebMethodPrivate)");
-    // Remove protected constructor.
-    beginIndex = methodSource.indexOf("QWebMethod::QWebMethod(QWebMethodPrivate");
-    endIndex = methodSource.indexOf("}", beginIndex) + 2;
-    methodSource.remove(beginIndex, endIndex - beginIndex);
-    methodSource.replace("QWebMethodPrivate", "QWebMethod");
-
-    // Replace QWebMethod with mtdName.
-    methodSource.replace("QWebMethod", mtdName, Qt::CaseSensitive);
-
-    // Add host info to all constructors.
-    addCustomCodeToConstructor(methodSource, mtd, beginIndex);
-    addCustomCodeToConstructor(methodSource, mtd, beginIndex);
-
-    // Add specialised constructor.
-    if (mtdParameters != QString()) {
-        beginIndex = methodSource.indexOf(mtdName + "::~") - 2;
-        QString tmp = mtdName + "::" + mtdName + "(QObject *parent, "
-                + mtdParameters + ") :" + flags->endLine()
-                + flags->tab() + "QObject(parent)" + flags->endLine()
-                + "{" + flags->endLine()
-                + assignAllParameters(mtd)
-                + flags->tab() + "setProtocol(" + flags->protocolString()
-                + ");" + flags->endLine()
-                + flags->tab() + "setHttpMethod("
-                + flags->httpMethodString() + ");" + flags->endLine()
-                + flags->tab() + "m_hostUrl.setHost(\"";
-        if (mtd->host() != QString())
-            tmp += mtd->host();
-        else
-            tmp+= mtd->targetNamespace();
-        tmp += "\");" + flags->endLine()
-                + "}" + flags->endLine();
+    // Constructors.
+    out << mtdName << "::" << mtdName << "(QObject *parent) :" << flags->endLine()
+        << flags->tab() << "QWebMethod(parent)" << flags->endLine()
+        << "{" << flags->endLine()
+        << flags->tab() << "configure();" << flags->endLine()
+        << "}" << flags->endLine() << flags->endLine();
 
-        methodSource.insert(beginIndex, tmp);
+    if (mtdParameters != QString()) {
+        out << mtdName << "::" << mtdName << "(QObject *parent, "
+            << mtdParameters << ") :" << flags->endLine()
+            << flags->tab() << "QWebMethod(parent)" << flags->endLine()
+            << "{" << flags->endLine()
+            << flags->tab() << "configure();" << flags->endLine()
+            << flags->tab() << "setParameters(" << mtdArguments << ");" << flags->endLine()
+            << "}" << flags->endLine() << flags->endLine();
     }
 
-    // Create setParameters() method.
-    beginIndex = methodSource.indexOf("::setParameters(") + 16;
-    endIndex = methodSource.indexOf("}", beginIndex) + 1;
-    methodSource.remove(beginIndex, endIndex - beginIndex);
-    methodSource.insert(beginIndex, mtdParameters + ")" + flags->endLine()
-                         + "{" + flags->endLine()
-                         + assignAllParameters(mtd)
-                         + "}" + flags->endLine() + flags->endLine());
+    // Typed setParameters().
+    out << "void " << mtdName << "::setParameters(" << mtdParameters << ")" << flags->endLine()
+        << "{" << flags->endLine()
+        << flags->tab() << "QMap<QString, QVariant> parameters;" << flags->endLine();
+    {
+        QMap<QString, QVariant> tempMap = mtd->parameterNamesTypes();
+
+        foreach (QString s, tempMap.keys()) {
+            out << flags->tab() << "parameters.insert(QLatin1String(\"" << s
+                << "\"), QVariant(" << s << "));" << flags->endLine();
+        }
+    }
+    out << flags->tab() << "QWebMethod::setParameters(parameters);" << flags->endLine()
+        << "}" << flags->endLine() << flags->endLine();
 
     // Create asynchronous invokeMethod(), which uses all parameters of a web method.
     if ((mtdParameters != QString())
             && !(flags->flags() & Flags::CompactMode)
             && (flags->flags() & Flags::Asynchronous)) {
-        // Finding end of a method just after last invokeMethod.
-        beginIndex = methodSource.indexOf("QString " + mtdName + "::replyRead()") - 2;
-        methodSource.insert(beginIndex, flags->endLine()
-                            + "bool " + mtdName + "::invokeMethod("
-                            + mtdParameters + ")" + flags->endLine()
-                            + "{" + flags->endLine()
-                            + assignAllParameters(mtd)
-                            + flags->tab() + "return invokeMethod();" + flags->endLine()
-                            + "}" + flags->endLine());
+        out << "QWebMethodCall *" << mtdName << "::invokeMethod("
+            << mtdParameters << ")" << flags->endLine()
+            << "{" << flags->endLine()
+            << flags->tab() << "setParameters(" << mtdArguments << ");" << flags->endLine()
+            << flags->tab() << "return invokeMethod();" << flags->endLine()
+            << "}" << flags->endLine() << flags->endLine();
     }
 
     // Create synchronous, static invokeMethod().
     if (!(flags->flags() & Flags::CompactMode)
             && (flags->flags() & Flags::Synchronous)) {
-        // Finding end of a method just after last invokeMethod.
-        beginIndex = methodSource.indexOf("QString " + mtdName + "::replyRead()") - 2;
-
-        QString body = "QString " + mtdName + "::invokeMethod(QObject *parent";
-        if (mtdParameters != QString()) {
-            body += ", " + mtdParameters;
-        }
-        body += ")" + flags->endLine() + "{" + flags->endLine()
-                + flags->tab() + mtdName + " qsm(parent);" + flags->endLine()
-                + flags->tab() + "qsm.setParameters(";
-
-        QString tempS;
-        QMap<QString, QVariant> tempMap = mtd->parameterNamesTypes();
-
-        foreach (QString s, tempMap.keys()) {
-            tempS += s + ", ";
-        }
-        tempS.chop(2);
-
-        // Add waiting loop.
-        body += tempS + ");" + flags->endLine()
-                + flags->tab() + "qsm.invokeMethod();" + flags->endLine()
-                + flags->tab() + "forever {" + flags->endLine()
-                + flags->tab() + flags->tab() + "if (qsm.isReplyReady()) {" + flags->endLine()
-                + flags->tab() + flags->tab() + flags->tab() + "return qsm.replyRead();" + flags->endLine()
-                + flags->tab() + flags->tab() + "} else {" + flags->endLine()
-                + flags->tab() + flags->tab() + flags->tab()
-                + "QCoreApplication::instance()->processEvents();" + flags->endLine()
-                + flags->tab() + flags->tab() + "}"  +flags->endLine()
-                + flags->tab() + "}" + flags->endLine()
-                + "}" + flags->endLine();
-        methodSource.insert(beginIndex, flags->endLine() + body);
-    }
-
-    // Add parameterNames() method.
-    beginIndex = methodSource.indexOf("::parameterNames() const") + 24;
-    endIndex = methodSource.indexOf("}", beginIndex);
-    methodSource.remove(beginIndex, endIndex - beginIndex);
-    { // Create new method body.
-        QString tmp = flags->endLine() + "{" + flags->endLine()
-                + flags->tab() + "QMap<QString, QVariant> parameters;";
-
-        QMap<QString, QVariant> tempMap = mtd->parameterNamesTypes();
-
-        foreach (QString s, tempMap.keys()) {
-            tmp += flags->tab() + "parameters.insert(\"" + s + "\", QVariant(";
-            QString tmpName = tempMap.value(s).typeName();
-            if (tmpName != QLatin1String("int"))
-                tmp += tmpName;
-            tmp += "(" + tempMap.value(s).toString() + ")));" + flags->endLine();
-        }
-        tmp += flags->tab() + "return (QStringList) parameters.keys();" + flags->endLine();
-        methodSource.insert(beginIndex, tmp);
-    }
-
-    // Add parameterNamesTypes() method.
-    beginIndex = methodSource.indexOf("::parameterNamesTypes() const") + 29;
-    endIndex = methodSource.indexOf("}", beginIndex);
-    methodSource.remove(beginIndex, endIndex - beginIndex);
-    { // Create new method body.
-        QString tmp = flags->endLine() + "{" + flags->endLine()
-                + flags->tab() + "QMap<QString, QVariant> parameters;";
-
-        QMap<QString, QVariant> tempMap = mtd->parameterNamesTypes();
-
-        foreach (QString s, tempMap.keys()) {
-            tmp += flags->tab() + "parameters.insert(\"" + s + "\", QVariant(";
-            QString tmpName = tempMap.value(s).typeName();
-            if (tmpName != QLatin1String("int"))
-                tmp += tmpName;
-            tmp += "(" + tempMap.value(s).toString() + ")));" + flags->endLine();
-        }
-        tmp += flags->tab() + "return parameters;" + flags->endLine();
-        methodSource.insert(beginIndex, tmp);
+        out << "/* STATIC */" << flags->endLine()
+            << "QString " << mtdName << "::invokeMethod(QObject *parent";
+        if (mtdParameters != QString())
+            out << ", " << mtdParameters;
+        // Wait for the reply in a local event loop, with a timeout.
+        out << ")" << flags->endLine()
+            << "{" << flags->endLine()
+            << flags->tab() << mtdName << " qsm(parent);" << flags->endLine()
+            << flags->tab() << "qsm.setParameters(" << mtdArguments << ");" << flags->endLine()
+            << flags->tab() << "QWebMethodCall *call = qsm.invokeMethod();" << flags->endLine()
+            << flags->tab() << "if (call && call->waitForFinished())" << flags->endLine()
+            << flags->tab() << flags->tab() << "return qsm.replyRead();" << flags->endLine()
+            << flags->tab() << "return QString();" << flags->endLine()
+            << "}" << flags->endLine() << flags->endLine();
     }
 
-    // ---------------------------------
-    // Begin writing:
-    QTextStream out(&file);
-    out.setCodec("UTF-8");
-    out << "#include \"";
-    if (!(flags->flags() & Flags::AllInOneDirStructure))
-        out << "../headers/";
-    out << mtdName << ".h\"" << flags->endLine();
-    out << flags->endLine();
-    out << methodSource;
+    // Host, protocol and names, taken from WSDL.
+    out << "void " << mtdName << "::configure()" << flags->endLine()
+        << "{" << flags->endLine()
+        << flags->tab() << "setHost(\"" << mtd->host() << "\");" << flags->endLine()
+        << flags->tab() << "setProtocol(" << flags->protocolString(false) << ");"
+        << flags->endLine()
+        << flags->tab() << "setHttpMethod(" << flags->httpMethodString() << ");"
+        << flags->endLine()
+        << flags->tab() << "setMethodName(\"" << mtd->methodName() << "\");"
+        << flags->endLine()
+        << flags->tab() << "setTargetNamespace(\"" << mtd->targetNamespace() << "\");"
+        << flags->endLine()
+        << "}" << flags->endLine();
     // EOF (method source)
     // ---------------------------------
 
@@ -758,27 +625,3 @@ QString MethodGenerator::assignAllParameters(QWebMethod *mtd)
 
     return result;
 }
-
-/*!
-  \internal
-
-  Inserts custom data to constructor. Used in create sources.
-  */
-void MethodGenerator::addCustomCodeToConstructor(QString &sourceCode,
-                                                  QWebMethod *mtd,
-                                                  int &beginIndex)
-{
-    beginIndex = sourceCode.indexOf("QObject(", beginIndex) + 15;
-    beginIndex = sourceCode.indexOf("}", beginIndex) - 1;
-    {
-        QString tmp = flags->endLine()
-                + flags->tab() + "m_hostUrl.setHost(\"";
-        if (mtd->host() != QString())
-            tmp += mtd->host();
-        else
-            tmp+= mtd->targetNamespace();
-        tmp += "\");" + flags->endLine();
-
-        sourceCode.insert(beginIndex, tmp);
-    }
-}
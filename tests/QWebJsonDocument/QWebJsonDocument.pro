@@ -0,0 +1,12 @@
+include(../../buildInfo.pri)
+
+QT += qtestlib
+CONFIG += qtestlib
+
+include(../../libraryIncludes.pri)
+
+DESTDIR = $${TESTS_DIRECTORY}/QWebJsonDocument
+OBJECTS_DIR = $${TESTS_DIRECTORY}/QWebJsonDocument
+MOC_DIR = $${TESTS_DIRECTORY}/QWebJsonDocument
+
+SOURCES += tst_qwebjsondocument.cpp
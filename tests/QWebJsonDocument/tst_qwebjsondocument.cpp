@@ -0,0 +1,150 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebJsonDocument test suite.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <qwebjsondocument.h>
+
+/*
+    This test checks QWebJsonDocument: values of all types, string escapes,
+    errors, and lazy reading of paths.
+  */
+class TestQWebJsonDocument : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void valuesTest();
+    void stringsTest();
+    void errorsTest();
+    void pathTest();
+};
+
+/*
+  Objects, arrays, numbers, literals.
+  */
+void TestQWebJsonDocument::valuesTest()
+{
+    QString errorString;
+    QVariant result = QWebJsonDocument::parse(
+                " { \"name\" : \"Queen\", \"members\": [\"Freddie\", \"Brian\"],\n"
+                "   \"founded\": 1970, \"rating\": -4.5e0, \"sales\": 300000000000,\n"
+                "   \"active\": false, \"label\": null, \"albums\": {}, \"tours\": [] } ",
+                &errorString);
+    QCOMPARE(errorString, QString());
+    QVariantMap band = result.toMap();
+    QCOMPARE(band.size(), int(9));
+    QCOMPARE(band.value("name"), QVariant(QString("Queen")));
+    QCOMPARE(band.value("members").toStringList(), QStringList() << "Freddie" << "Brian");
+    QCOMPARE(band.value("founded"), QVariant(1970));
+    QCOMPARE(band.value("rating"), QVariant(-4.5));
+    QCOMPARE(band.value("sales"), QVariant(qlonglong(300000000000LL)));
+    QCOMPARE(band.value("active"), QVariant(false));
+    QVERIFY(band.contains("label"));
+    QVERIFY(!band.value("label").isValid());
+    QCOMPARE(band.value("albums").type(), QVariant::Map);
+    QCOMPARE(band.value("tours").type(), QVariant::List);
+
+    QCOMPARE(QWebJsonDocument::parse("[1, [2, [3]]]").toList().at(1).toList().at(1),
+             QVariant(QVariantList() << 3));
+    QCOMPARE(QWebJsonDocument::parse("12345678901234567890").type(), QVariant::Double);
+}
+
+/*
+  Escapes, UTF-8 and surrogate pairs.
+  */
+void TestQWebJsonDocument::stringsTest()
+{
+    QCOMPARE(QWebJsonDocument::parse("\"a\\\"b\\\\c\\/d\\n\\t\"").toString(),
+             QString("a\"b\\c/d\n\t"));
+    QCOMPARE(QWebJsonDocument::parse("\"Za\xc5\xbc\xc3\xb3\xc5\x82\xc4\x87\"").toString(),
+             QString::fromUtf8("Za\xc5\xbc\xc3\xb3\xc5\x82\xc4\x87"));
+    QCOMPARE(QWebJsonDocument::parse("\"\\u017c \\ud83c\\udfb8\"").toString(),
+             QString::fromUtf8("\xc5\xbc \xf0\x9f\x8e\xb8"));
+    // Unpaired surrogate is replaced.
+    QCOMPARE(QWebJsonDocument::parse("\"\\ud83c!\"").toString(),
+             QString::fromUtf8("\xef\xbf\xbd!"));
+
+    // Strings longer than 8 bytes, with quotes and escapes anywhere.
+    QString long1 = QWebJsonDocument::parse("[\"0123456789abcdef\\\"0123456789\"]")
+            .toList().value(0).toString();
+    QCOMPARE(long1, QString("0123456789abcdef\"0123456789"));
+}
+
+/*
+  Structural errors are found by the index, others when values are read.
+  */
+void TestQWebJsonDocument::errorsTest()
+{
+    QStringList invalid;
+    invalid << "" << "   " << "{" << "[1, 2" << "[1, 2}" << "\"abc" << "{\"a\" 1}"
+            << "{\"a\": 1,}" << "[1,,2]" << "[1 2]" << "[01]" << "[1.]" << "[tru]"
+            << "{1: 2}" << "[\"\\x\"]" << "[1] 2";
+    foreach (const QString &json, invalid) {
+        QString errorString;
+        QVERIFY2(!QWebJsonDocument::parse(json.toUtf8(), &errorString).isValid(),
+                 qPrintable(json));
+        QVERIFY2(!errorString.isEmpty(), qPrintable(json));
+    }
+
+    QVERIFY(!QWebJsonDocument().isValid());
+    QVERIFY(!QWebJsonDocument("[1, 2").isValid());
+    QVERIFY(!QWebJsonDocument("[1, 2").errorString().isEmpty());
+    // Value errors are not structural.
+    QWebJsonDocument document("[1, tru]");
+    QCOMPARE(document.isValid(), bool(true));
+    QVERIFY(!document.toVariant().isValid());
+    QCOMPARE(document.value("[0]"), QVariant(1));
+
+    QByteArray deep(1000, '[');
+    deep += QByteArray(1000, ']');
+    QVERIFY(QWebJsonDocument(deep).isValid());
+    QVERIFY(!QWebJsonDocument::parse(deep).isValid());
+}
+
+/*
+  Values are found by path, without reading the rest.
+  */
+void TestQWebJsonDocument::pathTest()
+{
+    QWebJsonDocument json("{\"member\": {\"title\": \"Guru\", \"points\": 8120},"
+                          " \"posts\": [{\"id\": 1, \"tags\": [\"qt\"]},"
+                          " {\"id\": 2, \"tags\": [\"json\", \"rest\"]}],"
+                          " \"caf\\u00e9\": true}");
+    QVERIFY(json.isValid());
+    QCOMPARE(json.value("member.points"), QVariant(8120));
+    QCOMPARE(json.value("member.title"), QVariant(QString("Guru")));
+    QCOMPARE(json.value("posts[1].id"), QVariant(2));
+    QCOMPARE(json.value("posts[1].tags[1]"), QVariant(QString("rest")));
+    QCOMPARE(json.value("posts").toList().size(), int(2));
+    QCOMPARE(json.value(QString::fromUtf8("caf\xc3\xa9")), QVariant(true));
+    QCOMPARE(json.value("").toMap().size(), int(3));
+
+    QVERIFY(json.contains("posts[0].tags"));
+    QVERIFY(!json.contains("posts[2]"));
+    QVERIFY(!json.contains("member.name"));
+    QVERIFY(!json.contains("member[0]"));
+    QVERIFY(!json.contains("posts.id"));
+    QVERIFY(!json.value("posts[x]").isValid());
+
+    // Copies share the index.
+    QWebJsonDocument copy = json;
+    QCOMPARE(copy.value("posts[0].id"), QVariant(1));
+    QCOMPARE(copy.data(), json.data());
+}
+
+QTEST_MAIN(TestQWebJsonDocument)
+#include "tst_qwebjsondocument.moc"
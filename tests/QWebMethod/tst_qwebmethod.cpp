@@ -16,7 +16,194 @@
 ****************************************************************************/
 
 #include <QtTest/QtTest>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
 #include <qwebmethod.h>
+#include <qwebservice.h>
+#include <qwebnetworkmanagerpool_p.h>
+#include <qwebcontentcodec_p.h>
+#include <qwebtimerqueue_p.h>
+#include <qwebratelimit_p.h>
+#include <qwebcircuitbreaker_p.h>
+#include <qwebconnectionwarmer_p.h>
+#include <qwebmpscqueue_p.h>
+#include <qwebuploaddevice_p.h>
+#include <qwebreplybuffer_p.h>
+
+/**
+  Counts invocations of its slot, used to test QWebTimerQueue.
+  */
+class TimerReceiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    TimerReceiver(QList<int> *firedList, int receiverId) :
+        QObject(), fired(firedList), id(receiverId) {}
+
+    QList<int> *fired;
+    int id;
+
+public slots:
+    void fire() { fired->append(id); }
+};
+
+/**
+  Enqueues a range of numbers from its own thread, used to test QWebMpscQueue.
+  */
+class QueueProducer : public QThread
+{
+public:
+    QueueProducer(QWebMpscQueue<int> *target, int firstValue, int valueCount) :
+        QThread(), queue(target), first(firstValue), count(valueCount) {}
+
+    QWebMpscQueue<int> *queue;
+    int first;
+    int count;
+
+protected:
+    void run()
+    {
+        for (int i = first; i < first + count; ++i)
+            queue->enqueue(i);
+    }
+};
+
+/**
+  Submits a call of a web service from its own thread.
+  */
+class CallSubmitter : public QThread
+{
+public:
+    CallSubmitter(QWebService *target, const QString &methodName, QObject *resultReceiver) :
+        QThread(), service(target), name(methodName), receiver(resultReceiver), id(0) {}
+
+    QWebService *service;
+    QString name;
+    QObject *receiver;
+    int id;
+
+protected:
+    void run()
+    {
+        id = service->submit(name, QMap<QString, QVariant>(), receiver,
+                             SLOT(resultReady(int,QByteArray,QString)));
+    }
+};
+
+/**
+  Collects results of calls made by worker threads of QWebService.
+  */
+class ResultReceiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    ResultReceiver() : QObject() {}
+
+    QList<int> ids;
+    QList<QByteArray> replies;
+    QStringList errors;
+    QList<QThread *> threads;
+
+public slots:
+    void resultReady(int requestId, const QByteArray &reply, const QString &errorInfo)
+    {
+        ids.append(requestId);
+        replies.append(reply);
+        errors.append(errorInfo);
+        threads.append(QThread::currentThread());
+    }
+};
+
+/**
+  Minimal HTTP server, used to test QWebMethod without the Internet connection.
+  Replies to every request with the same body, and additional headers.
+  */
+class LocalHttpServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    LocalHttpServer(const QByteArray &replyBody) :
+        QTcpServer(), body(replyBody), requestCount(0), connectionCount(0),
+        failuresLeft(0), stallsLeft(0)
+    {
+        connect(this, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
+        listen(QHostAddress::LocalHost);
+    }
+
+    QUrl url() const
+    {
+        return QUrl(QString("http://127.0.0.1:%1/service.asmx").arg(serverPort()));
+    }
+
+    QByteArray body;
+    QByteArray headers;
+    QByteArray lastRequest;
+    int requestCount;
+    int connectionCount;
+    // Number of requests, that will be answered with 503 status.
+    int failuresLeft;
+    // Number of requests, that will not be answered at all.
+    int stallsLeft;
+
+private slots:
+    void acceptConnection()
+    {
+        while (hasPendingConnections()) {
+            QTcpSocket *socket = nextPendingConnection();
+            ++connectionCount;
+            connect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+            connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+        }
+    }
+
+    void readRequest()
+    {
+        QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+        QByteArray request = socket->property("request").toByteArray() + socket->readAll();
+        socket->setProperty("request", request);
+
+        int headerEnd = request.indexOf("\r\n\r\n");
+        if (headerEnd == -1)
+            return;
+
+        int contentLength = 0;
+        foreach (const QByteArray &line, request.left(headerEnd).split('\n')) {
+            if (line.toLower().startsWith("content-length:"))
+                contentLength = line.mid(15).trimmed().toInt();
+        }
+
+        if (request.size() < headerEnd + 4 + contentLength)
+            return;
+
+        socket->setProperty("request", QByteArray());
+        lastRequest = request;
+        ++requestCount;
+
+        if (stallsLeft > 0) {
+            --stallsLeft;
+            return;
+        }
+
+        if (failuresLeft > 0) {
+            --failuresLeft;
+            socket->write("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n");
+            return;
+        }
+
+        socket->write("HTTP/1.1 200 OK\r\nContent-Type: text/xml\r\n" + headers
+                      + "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n");
+        // Replies to HEAD requests have no body.
+        if (request.startsWith("HEAD "))
+            return;
+
+        // Written in pieces, so that the client can receive them separately.
+        for (int i = 0; i < body.size(); i += 4096)
+            socket->write(body.mid(i, 4096));
+    }
+};
 
 /**
   This test checks QWebMethod in operation (requires Internet connection or a working local web service)
@@ -31,6 +218,31 @@ private slots:
     void settersTest();
     void qpropertyTest();
     void asynchronousSendingTest();
+    void managerPoolTest();
+    void callHandleTest();
+    void waitForFinishedTest();
+    void replyRoutingTest();
+    void streamingTest();
+    void codecTest();
+    void compressionTest();
+    void timerQueueTest();
+    void timeoutTest();
+    void cancelTest();
+    void retryPolicyTest();
+    void retryTest();
+    void circuitBreakerTest();
+    void rateLimitTest();
+    void hedgingTest();
+    void loadBalancerTest();
+    void warmUpTest();
+    void mpscQueueTest();
+    void workerThreadsTest();
+    void batchTest();
+    void responseCacheTest();
+    void coalescingTest();
+    void requestTemplateTest();
+    void streamingUploadTest();
+    void replySpillTest();
 
 private:
     void defaultGettersTest(QWebMethod *msg);
@@ -176,6 +388,1506 @@ void TestQWebMethod::asynchronousSendingTest()
     delete method;
 }
 
+/*
+  Checks whether web methods share network managers per host and credentials.
+  */
+void TestQWebMethod::managerPoolTest()
+{
+    QUrl host("http://www.currencyserver.de/webservice/currencyserverwebservice.asmx");
+    QUrl otherPath("http://www.currencyserver.de/webservice/other.asmx");
+    QUrl otherHost("http://www.daenet.de/webservices/CurrencyServer");
+
+    QNetworkAccessManager *manager = QWebNetworkManagerPool::manager(host);
+    QCOMPARE(QWebNetworkManagerPool::manager(host), manager);
+    QCOMPARE(QWebNetworkManagerPool::manager(otherPath), manager);
+    QVERIFY(QWebNetworkManagerPool::manager(otherHost) != manager);
+    QVERIFY(QWebNetworkManagerPool::manager(host, "user", "pass") != manager);
+    QCOMPARE(QWebNetworkManagerPool::manager(host, "user", "pass"),
+             QWebNetworkManagerPool::manager(host, "user", "pass"));
+    QVERIFY(QWebNetworkManagerPool::manager(host, "user", "other")
+            != QWebNetworkManagerPool::manager(host, "user", "pass"));
+    QVERIFY(QWebNetworkManagerPool::count() >= 4);
+}
+
+/*
+  Checks whether concurrent invocations are represented by separate calls.
+  Uses a local port that refuses connections, so it does not need Internet.
+  */
+void TestQWebMethod::callHandleTest()
+{
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(QUrl("http://127.0.0.1:1/service.asmx"));
+    method->setMethodName("getProviderList");
+
+    QMap<QString, QVariant> tmpP;
+    tmpP.insert("symbol", QVariant("NOK"));
+    method->setParameters(tmpP);
+    QWebMethodCall *first = method->invokeMethod();
+    tmpP.insert("symbol", QVariant("EUR"));
+    method->setParameters(tmpP);
+    QWebMethodCall *second = method->invokeMethod();
+
+    QVERIFY(first != 0);
+    QVERIFY(second != 0);
+    first->setAutoDelete(false);
+    second->setAutoDelete(false);
+    QVERIFY(first->requestId() != second->requestId());
+    QCOMPARE(first->method(), method);
+    QVERIFY(first->requestData().contains("NOK"));
+    QVERIFY(second->requestData().contains("EUR"));
+
+    for (int i = 0; (i < 50) && !(first->isFinished() && second->isFinished()); i++)
+        QTest::qWait(100);
+
+    QCOMPARE(first->isFinished(), bool(true));
+    QCOMPARE(second->isFinished(), bool(true));
+    QCOMPARE(first->error(), QWebMethodCall::NetworkError);
+    QCOMPARE(second->error(), QWebMethodCall::NetworkError);
+    QVERIFY(first->networkReply() == 0);
+
+    delete method;
+}
+
+/*
+  Checks blocking wait for a call: both a refused connection, and a server
+  that accepts the connection, but never replies.
+  */
+void TestQWebMethod::waitForFinishedTest()
+{
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(QUrl("http://127.0.0.1:1/service.asmx"));
+    method->setMethodName("getProviderList");
+
+    QWebMethodCall *call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->error(), QWebMethodCall::NetworkError);
+
+    QTcpServer stalledServer;
+    QVERIFY(stalledServer.listen(QHostAddress::LocalHost));
+    method->setHost(QUrl(QString("http://127.0.0.1:%1/service.asmx")
+                         .arg(stalledServer.serverPort())));
+
+    call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QTime timer;
+    timer.start();
+    QCOMPARE(call->waitForFinished(300), bool(false));
+    QVERIFY(timer.elapsed() < 5000);
+    QCOMPARE(call->isFinished(), bool(true));
+    QCOMPARE(call->error(), QWebMethodCall::TimeoutError);
+    QVERIFY(call->networkReply() == 0);
+
+    delete method;
+}
+
+/*
+  Checks that each reply is delivered once, and to its own call only,
+  no matter how many calls have been made by the web method.
+  */
+void TestQWebMethod::replyRoutingTest()
+{
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(QUrl("http://127.0.0.1:1/service.asmx"));
+    method->setMethodName("getProviderList");
+    QSignalSpy methodSpy(method, SIGNAL(replyReady(QByteArray)));
+
+    const int callCount = 5;
+    QList<QWebMethodCall *> calls;
+    QList<QSignalSpy *> callSpies;
+    for (int i = 0; i < callCount; ++i) {
+        QWebMethodCall *call = method->invokeMethod();
+        call->setAutoDelete(false);
+        calls.append(call);
+        callSpies.append(new QSignalSpy(call, SIGNAL(finished())));
+    }
+
+    foreach (QWebMethodCall *call, calls)
+        QCOMPARE(call->waitForFinished(5000), bool(true));
+
+    QCOMPARE(methodSpy.count(), callCount);
+    foreach (QSignalSpy *spy, callSpies)
+        QCOMPARE(spy->count(), int(1));
+
+    qDeleteAll(callSpies);
+    delete method;
+}
+
+/*
+  Checks streaming of a reply to a device, and in chunk signals.
+  */
+void TestQWebMethod::streamingTest()
+{
+    QByteArray body;
+    for (int i = 0; i < 10000; ++i)
+        body.append("<item>" + QByteArray::number(i) + "</item>");
+    LocalHttpServer server(body);
+    QVERIFY(server.isListening());
+
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(server.url());
+    method->setMethodName("getProviderList");
+    QCOMPARE(method->isStreamingEnabled(), bool(false));
+
+    QBuffer device;
+    device.open(QIODevice::WriteOnly);
+    method->setStreamDevice(&device);
+    QCOMPARE(method->isStreamingEnabled(), bool(true));
+    QVERIFY(method->streamDevice() == &device);
+    QSignalSpy methodSpy(method, SIGNAL(replyChunkReady(QByteArray)));
+
+    QWebMethodCall *call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QSignalSpy callSpy(call, SIGNAL(chunkReady(QByteArray)));
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->isErrorState(), bool(false));
+
+    QCOMPARE(device.data(), body);
+    QVERIFY(callSpy.count() > 0);
+    QCOMPARE(callSpy.count(), methodSpy.count());
+    QByteArray chunks;
+    for (int i = 0; i < callSpy.count(); ++i)
+        chunks.append(callSpy.at(i).at(0).toByteArray());
+    QCOMPARE(chunks, body);
+    // Streamed replies are not stored.
+    QVERIFY(call->replyReadRaw().isEmpty());
+
+    // Device that cannot be written to aborts the call.
+    device.close();
+    call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->error(), QWebMethodCall::DeviceError);
+
+    // Back to normal mode.
+    method->setStreamDevice(0);
+    method->setStreamingEnabled(false);
+    call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->replyReadRaw(), body);
+
+    delete method;
+}
+
+/*
+  Checks compression, and inflating of data delivered in small pieces.
+  */
+void TestQWebMethod::codecTest()
+{
+    QByteArray data;
+    for (int i = 0; i < 2000; ++i)
+        data.append("<symbol>NOK</symbol>");
+
+    QCOMPARE(QWebContentCodec::encoding("gzip"), QWebContentCodec::Gzip);
+    QCOMPARE(QWebContentCodec::encoding(" Deflate"), QWebContentCodec::Deflate);
+    QCOMPARE(QWebContentCodec::encoding("identity"), QWebContentCodec::Identity);
+
+    QByteArray compressed = QWebContentCodec::gzip(data);
+    QVERIFY(!compressed.isEmpty());
+    QVERIFY(compressed.size() < data.size());
+
+    QWebContentCodec codec;
+    QByteArray inflated;
+    codec.begin(QWebContentCodec::Gzip);
+    for (int i = 0; i < compressed.size(); i += 7)
+        QVERIFY(codec.inflate(compressed.mid(i, 7), &inflated));
+    QCOMPARE(inflated, data);
+
+    // qCompress() produces a zlib stream, preceded by 4 bytes of length.
+    inflated.clear();
+    codec.begin(QWebContentCodec::Deflate);
+    QVERIFY(codec.inflate(qCompress(data).mid(4), &inflated));
+    QCOMPARE(inflated, data);
+
+    inflated.clear();
+    codec.begin(QWebContentCodec::Gzip);
+    QCOMPARE(codec.inflate(QByteArray("not compressed at all"), &inflated), bool(false));
+    QVERIFY(!codec.errorString().isEmpty());
+}
+
+/*
+  Checks compression of requests, and inflating of replies.
+  */
+void TestQWebMethod::compressionTest()
+{
+    QByteArray body;
+    for (int i = 0; i < 5000; ++i)
+        body.append("<rate>" + QByteArray::number(i % 10) + "</rate>");
+    LocalHttpServer server(QWebContentCodec::gzip(body));
+    server.headers = "Content-Encoding: gzip\r\n";
+    QVERIFY(server.isListening());
+
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(server.url());
+    method->setMethodName("getProviderList");
+    QCOMPARE(method->isCompressionEnabled(), bool(false));
+    method->setCompressionEnabled(true);
+    method->setCompressionThreshold(16);
+    QCOMPARE(method->compressionThreshold(), int(16));
+
+    QMap<QString, QVariant> tmpP;
+    tmpP.insert("symbol", QVariant(QString(2000, QLatin1Char('x'))));
+    method->setParameters(tmpP);
+
+    QWebMethodCall *call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->isErrorState(), bool(false));
+    QCOMPARE(call->replyReadRaw(), body);
+
+    QVERIFY(server.lastRequest.contains("Content-Encoding: gzip"));
+    QVERIFY(server.lastRequest.toLower().contains("accept-encoding: gzip, deflate"));
+    QCOMPARE(method->requestBytes(), qint64(call->requestData().size()));
+    QVERIFY(method->requestBytesSent() < method->requestBytes());
+    QCOMPARE(method->replyBytes(), qint64(body.size()));
+    QCOMPARE(method->replyBytesReceived(), qint64(server.body.size()));
+
+    method->resetByteCounters();
+    QCOMPARE(method->replyBytes(), qint64(0));
+
+    // Inflating works in streaming mode, too.
+    QBuffer device;
+    device.open(QIODevice::WriteOnly);
+    method->setStreamDevice(&device);
+    call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(device.data(), body);
+
+    // Broken compressed reply.
+    method->setStreamDevice(0);
+    method->setStreamingEnabled(false);
+    server.body = body;
+    call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->error(), QWebMethodCall::DecodingError);
+
+    // Compressed reply cut off before the end of its stream.
+    QByteArray compressed = QWebContentCodec::gzip(body);
+    server.body = compressed.left(compressed.size() / 2);
+    call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->error(), QWebMethodCall::DecodingError);
+
+    delete method;
+}
+
+/*
+  Checks ordering, cancelling and skipping of deleted receivers in the timer queue.
+  */
+void TestQWebMethod::timerQueueTest()
+{
+    QWebTimerQueue *queue = QWebTimerQueue::instance();
+    QVERIFY(queue == QWebTimerQueue::instance());
+    int initialCount = queue->count();
+
+    QList<int> fired;
+    QList<TimerReceiver *> receivers;
+    QList<int> ids;
+    for (int i = 0; i < 100; ++i) {
+        receivers.append(new TimerReceiver(&fired, i));
+        // Scheduled in reverse order of their deadlines.
+        ids.append(queue->schedule(200 + 5 * (99 - i), receivers.last(), "fire"));
+    }
+    QCOMPARE(queue->count(), initialCount + 100);
+
+    QCOMPARE(queue->cancel(ids.at(10)), bool(true));
+    QCOMPARE(queue->cancel(ids.at(10)), bool(false));
+    delete receivers.takeAt(20);
+
+    QTest::qWait(1000);
+    QCOMPARE(queue->count(), initialCount);
+    QCOMPARE(fired.size(), int(98));
+    // Earliest deadline first.
+    QCOMPARE(fired.first(), int(99));
+    QCOMPARE(fired.last(), int(0));
+    QVERIFY(!fired.contains(10));
+    QVERIFY(!fired.contains(20));
+
+    qDeleteAll(receivers);
+}
+
+/*
+  Checks per-method and per-call timeouts, using a server that never replies.
+  */
+void TestQWebMethod::timeoutTest()
+{
+    QTcpServer stalledServer;
+    QVERIFY(stalledServer.listen(QHostAddress::LocalHost));
+
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(QUrl(QString("http://127.0.0.1:%1/service.asmx")
+                         .arg(stalledServer.serverPort())));
+    method->setMethodName("getProviderList");
+    QCOMPARE(method->timeout(), int(0));
+    method->setTimeout(200);
+    QCOMPARE(method->timeout(), int(200));
+    QSignalSpy errorSpy(method, SIGNAL(errorEncountered(QString)));
+
+    QWebMethodCall *call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->timeout(), int(200));
+    QTime timer;
+    timer.start();
+    // Call times out by itself, long before waitForFinished() would give up.
+    QCOMPARE(call->waitForFinished(10000), bool(true));
+    QVERIFY(timer.elapsed() < 5000);
+    QCOMPARE(call->error(), QWebMethodCall::TimeoutError);
+    QCOMPARE(errorSpy.count(), int(1));
+
+    // Per-call deadline overrides the one of the method.
+    method->setTimeout(0);
+    call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->timeout(), int(0));
+    call->setTimeout(100);
+    QCOMPARE(call->waitForFinished(10000), bool(true));
+    QCOMPARE(call->error(), QWebMethodCall::TimeoutError);
+
+    delete method;
+}
+
+/*
+  Checks cancelling single calls and all calls of a web method.
+  */
+void TestQWebMethod::cancelTest()
+{
+    QTcpServer stalledServer;
+    QVERIFY(stalledServer.listen(QHostAddress::LocalHost));
+
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(QUrl(QString("http://127.0.0.1:%1/service.asmx")
+                         .arg(stalledServer.serverPort())));
+    method->setMethodName("getProviderList");
+
+    QWebMethodCall *single = method->invokeMethod();
+    single->setAutoDelete(false);
+    QSignalSpy finishedSpy(single, SIGNAL(finished()));
+    single->abort();
+    QCOMPARE(single->isFinished(), bool(true));
+    QCOMPARE(single->error(), QWebMethodCall::CancelledError);
+    QCOMPARE(finishedSpy.count(), int(1));
+    // Second abort does nothing.
+    single->abort();
+    QCOMPARE(finishedSpy.count(), int(1));
+
+    QList<QWebMethodCall *> calls;
+    for (int i = 0; i < 3; ++i) {
+        calls.append(method->invokeMethod());
+        calls.last()->setAutoDelete(false);
+    }
+
+    method->cancelAll();
+    foreach (QWebMethodCall *call, calls) {
+        QCOMPARE(call->isFinished(), bool(true));
+        QCOMPARE(call->error(), QWebMethodCall::CancelledError);
+        QVERIFY(call->networkReply() == 0);
+    }
+
+    delete method;
+}
+
+/*
+  Checks defaults of retry policy, and bounds of its delays.
+  */
+void TestQWebMethod::retryPolicyTest()
+{
+    QWebRetryPolicy disabled;
+    QCOMPARE(disabled.isEnabled(), bool(false));
+    QCOMPARE(disabled.maxAttempts(), int(1));
+
+    QWebRetryPolicy policy(4, 100, 1000);
+    QCOMPARE(policy.isEnabled(), bool(true));
+    QCOMPARE(policy.shouldRetry(QNetworkReply::ConnectionRefusedError, 0), bool(true));
+    QCOMPARE(policy.shouldRetry(QNetworkReply::NoError, 503), bool(true));
+    QCOMPARE(policy.shouldRetry(QNetworkReply::ContentNotFoundError, 404), bool(false));
+
+    // Copies are independent.
+    QWebRetryPolicy copy(policy);
+    copy.setMaxAttempts(2);
+    QCOMPARE(policy.maxAttempts(), int(4));
+
+    QSet<int> delays;
+    int delay = 0;
+    for (int i = 0; i < 200; ++i) {
+        delay = policy.nextDelay(delay);
+        QVERIFY(delay >= 100);
+        QVERIFY(delay <= 1000);
+        delays.insert(delay);
+    }
+    // Jitter makes delays differ.
+    QVERIFY(delays.size() > 10);
+}
+
+/*
+  Checks retrying of failed calls, and that only idempotent methods are retried.
+  */
+void TestQWebMethod::retryTest()
+{
+    LocalHttpServer server("<ok/>");
+    QVERIFY(server.isListening());
+
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(server.url());
+    method->setMethodName("getProviderList");
+    method->setRetryPolicy(QWebRetryPolicy(3, 10, 50));
+    QCOMPARE(method->isIdempotent(), bool(false));
+
+    server.failuresLeft = 2;
+    QWebMethodCall *call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->isErrorState(), bool(false));
+    QCOMPARE(call->attempts(), int(1));
+    QCOMPARE(server.requestCount, int(1));
+
+    method->setIdempotent(true);
+    server.requestCount = 0;
+    server.failuresLeft = 2;
+    call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->isErrorState(), bool(false));
+    QCOMPARE(call->attempts(), int(3));
+    QCOMPARE(call->replyReadRaw(), QByteArray("<ok/>"));
+    QCOMPARE(server.requestCount, int(3));
+
+    // Attempts run out.
+    server.requestCount = 0;
+    server.failuresLeft = 5;
+    call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->error(), QWebMethodCall::NetworkError);
+    QCOMPARE(call->attempts(), int(3));
+    QCOMPARE(server.requestCount, int(3));
+
+    delete method;
+}
+
+/*
+  Checks opening, half-opening and closing of the circuit of a failing host.
+  */
+void TestQWebMethod::circuitBreakerTest()
+{
+    QWebCircuitBreaker::Settings settings;
+    settings.windowSize = 4;
+    settings.minimumCalls = 2;
+    settings.failureRateThreshold = 50;
+    settings.openDuration = 300;
+    QWebCircuitBreaker::setSettings(settings);
+    QCOMPARE(QWebCircuitBreaker::settings().windowSize, int(4));
+
+    LocalHttpServer server("<ok/>");
+    QVERIFY(server.isListening());
+    QCOMPARE(QWebCircuitBreaker::state(server.url()), QWebCircuitBreaker::Closed);
+
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(server.url());
+    method->setMethodName("getProviderList");
+    QCOMPARE(method->isCircuitBreakerEnabled(), bool(false));
+    method->setCircuitBreakerEnabled(true);
+
+    server.failuresLeft = 100;
+    for (int i = 0; i < 2; ++i) {
+        QWebMethodCall *call = method->invokeMethod();
+        call->setAutoDelete(false);
+        QCOMPARE(call->waitForFinished(5000), bool(true));
+        QCOMPARE(call->error(), QWebMethodCall::NetworkError);
+    }
+    QCOMPARE(QWebCircuitBreaker::state(server.url()), QWebCircuitBreaker::Open);
+
+    // Open circuit fails fast, without contacting the server.
+    QWebMethodCall *call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QSignalSpy finishedSpy(call, SIGNAL(finished()));
+    QCOMPARE(call->isFinished(), bool(false));
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->error(), QWebMethodCall::CircuitOpenError);
+    QCOMPARE(finishedSpy.count(), int(1));
+    QCOMPARE(server.requestCount, int(2));
+
+    // After open period, a successful trial call closes the circuit.
+    QTest::qWait(350);
+    QCOMPARE(QWebCircuitBreaker::state(server.url()), QWebCircuitBreaker::HalfOpen);
+    server.failuresLeft = 0;
+    call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->isErrorState(), bool(false));
+    QCOMPARE(QWebCircuitBreaker::state(server.url()), QWebCircuitBreaker::Closed);
+
+    // Restore defaults for other tests.
+    method->setCircuitBreakerEnabled(false);
+    QWebCircuitBreaker::reset();
+    QWebCircuitBreaker::setSettings(QWebCircuitBreaker::Settings());
+    delete method;
+}
+
+/*
+  Checks token buckets, queueing and rejecting of calls above the limit.
+  */
+void TestQWebMethod::rateLimitTest()
+{
+    QWebRateLimit disabled;
+    QCOMPARE(disabled.isEnabled(), bool(false));
+    QWebRateLimit limit(10, 2);
+    QCOMPARE(limit.isEnabled(), bool(true));
+    QCOMPARE(limit.burst(), int(2));
+    QCOMPARE(limit.maxDelay(), int(-1));
+
+    // Burst is available at once, next tokens are reserved in advance.
+    QWebTokenBucket bucket(limit);
+    QCOMPARE(bucket.reserve(), int(0));
+    QCOMPARE(bucket.reserve(), int(0));
+    int delay = bucket.reserve();
+    QVERIFY(delay > 50 && delay <= 100);
+    QVERIFY(bucket.reserve() > delay);
+
+    QWebTokenBucket rejecting(QWebRateLimit(1, 1, 0));
+    QCOMPARE(rejecting.reserve(), int(0));
+    QCOMPARE(rejecting.reserve(), int(-1));
+    rejecting.refund();
+    QCOMPARE(rejecting.reserve(), int(0));
+
+    LocalHttpServer server("<ok/>");
+    QVERIFY(server.isListening());
+
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(server.url());
+    method->setMethodName("getProviderList");
+    QCOMPARE(method->rateLimit().isEnabled(), bool(false));
+
+    // Queueing: 6 calls, 2 at once, then 10 per second.
+    method->setRateLimit(limit);
+    QCOMPARE(method->rateLimit().callsPerSecond(), double(10));
+    QElapsedTimer elapsed;
+    elapsed.start();
+    QList<QWebMethodCall *> calls;
+    for (int i = 0; i < 6; ++i) {
+        QWebMethodCall *call = method->invokeMethod();
+        call->setAutoDelete(false);
+        calls.append(call);
+    }
+    QCOMPARE(calls.last()->networkReply(), (QNetworkReply *) 0);
+    foreach (QWebMethodCall *call, calls) {
+        QCOMPARE(call->waitForFinished(5000), bool(true));
+        QCOMPARE(call->isErrorState(), bool(false));
+    }
+    QVERIFY(elapsed.elapsed() >= 350);
+    QCOMPARE(server.requestCount, int(6));
+    qDeleteAll(calls);
+
+    // Rejecting: second call would have to wait.
+    method->setRateLimit(QWebRateLimit(1, 1, 0));
+    QWebMethodCall *call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QWebMethodCall *rejected = method->invokeMethod();
+    rejected->setAutoDelete(false);
+    QCOMPARE(rejected->waitForFinished(5000), bool(true));
+    QCOMPARE(rejected->error(), QWebMethodCall::RateLimitedError);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->isErrorState(), bool(false));
+    QCOMPARE(server.requestCount, int(7));
+    delete call;
+    delete rejected;
+
+    // Host limit applies to all methods, cancelled calls return their tokens.
+    method->setRateLimit(QWebRateLimit());
+    QWebRateLimit::setHostLimit(server.url(), QWebRateLimit(1, 1));
+    QCOMPARE(QWebRateLimit::hostLimit(server.url()).burst(), int(1));
+    call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QWebMethodCall *waiting = method->invokeMethod();
+    waiting->setAutoDelete(false);
+    waiting->abort();
+    QCOMPARE(waiting->error(), QWebMethodCall::CancelledError);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(8));
+    delete call;
+    delete waiting;
+
+    QWebRateLimit::setHostLimit(server.url(), QWebRateLimit());
+    QCOMPARE(QWebRateLimit::hostLimit(server.url()).isEnabled(), bool(false));
+    delete method;
+}
+
+/*
+  Checks that a stalled request is hedged, within the budget.
+  */
+void TestQWebMethod::hedgingTest()
+{
+    LocalHttpServer server("<ok/>");
+    QVERIFY(server.isListening());
+
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(server.url());
+    method->setMethodName("getProviderList");
+    QCOMPARE(method->isHedgingEnabled(), bool(false));
+    QCOMPARE(method->hedgingDelay(), int(0));
+    QCOMPARE(method->hedgingBudget(), int(10));
+    QCOMPARE(method->latencyPercentile(95), int(-1));
+
+    // Latency percentile needs enough samples.
+    for (int i = 0; i < 20; ++i) {
+        QWebMethodCall *call = method->invokeMethod();
+        QCOMPARE(call->waitForFinished(5000), bool(true));
+    }
+    QVERIFY(method->latencyPercentile(95) >= 0);
+    QVERIFY(method->latencyPercentile(50) <= method->latencyPercentile(95));
+
+    // SOAP methods are not idempotent by default, so they are not hedged.
+    method->setHedgingEnabled(true);
+    method->setHedgingDelay(100);
+    method->setHedgingBudget(100);
+    method->setIdempotent(true);
+
+    server.stallsLeft = 1;
+    QWebMethodCall *call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->isErrorState(), bool(false));
+    QCOMPARE(call->replyReadRaw(), QByteArray("<ok/>"));
+    QCOMPARE(method->hedgedRequests(), int(1));
+    QCOMPARE(method->hedgesWon(), int(1));
+    QCOMPARE(server.requestCount, int(22));
+    delete call;
+
+    // Fast replies are not hedged.
+    call = method->invokeMethod();
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QTest::qWait(150);
+    QCOMPARE(method->hedgedRequests(), int(1));
+
+    // Duplicates need a rate limit token right away, they are not queued.
+    method->setRateLimit(QWebRateLimit(1, 1));
+    server.stallsLeft = 1;
+    call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(300), bool(false));
+    QCOMPARE(method->hedgedRequests(), int(1));
+    delete call;
+    method->setRateLimit(QWebRateLimit());
+
+    // Used up budget stops hedging.
+    method->setHedgingBudget(0);
+    server.stallsLeft = 1;
+    call = method->invokeMethod();
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(300), bool(false));
+    QCOMPARE(call->error(), QWebMethodCall::TimeoutError);
+    QCOMPARE(method->hedgedRequests(), int(1));
+    delete call;
+
+    delete method;
+}
+
+/*
+  Checks balancing strategies, and spreading calls of a web service.
+  */
+void TestQWebMethod::loadBalancerTest()
+{
+    QUrl a("http://127.0.0.1:1/a.asmx");
+    QUrl b("http://127.0.0.1:2/b.asmx");
+    QUrl c("http://127.0.0.1:3/c.asmx");
+
+    QWebLoadBalancer roundRobin(QList<QUrl>() << a << b << c);
+    QCOMPARE(roundRobin.strategy(), QWebLoadBalancer::RoundRobin);
+    QCOMPARE(roundRobin.acquire(), a);
+    QCOMPARE(roundRobin.acquire(), b);
+    QCOMPARE(roundRobin.acquire(), c);
+    QCOMPARE(roundRobin.acquire(), a);
+    QCOMPARE(roundRobin.outstanding(a), int(2));
+    roundRobin.release(a, 10);
+    QCOMPARE(roundRobin.outstanding(a), int(1));
+    QCOMPARE(roundRobin.latency(a), double(10));
+
+    QWebLoadBalancer leastOutstanding(QList<QUrl>() << a << b, QWebLoadBalancer::LeastOutstanding);
+    QUrl first = leastOutstanding.acquire();
+    QUrl second = leastOutstanding.acquire();
+    QVERIFY(first != second);
+    leastOutstanding.release(b, 5);
+    QCOMPARE(leastOutstanding.acquire(), b);
+
+    // Slow endpoint loses every comparison.
+    QWebLoadBalancer twoChoices(QList<QUrl>() << a << b, QWebLoadBalancer::PowerOfTwoChoices);
+    twoChoices.acquire();
+    twoChoices.acquire();
+    twoChoices.release(a, 500);
+    twoChoices.release(b, 5);
+    for (int i = 0; i < 10; ++i) {
+        QCOMPARE(twoChoices.acquire(), b);
+        twoChoices.release(b, 5);
+    }
+
+    // Endpoints with an open circuit are skipped.
+    QWebCircuitBreaker::Settings settings;
+    settings.windowSize = 2;
+    settings.minimumCalls = 2;
+    QWebCircuitBreaker::setSettings(settings);
+    QString key = QWebCircuitBreakerPrivate::key(a);
+    for (int i = 0; i < 2; ++i) {
+        QVERIFY(QWebCircuitBreakerPrivate::acquire(key));
+        QWebCircuitBreakerPrivate::release(key, QWebCircuitBreakerPrivate::Failure, 1);
+    }
+    QCOMPARE(QWebCircuitBreaker::state(a), QWebCircuitBreaker::Open);
+    QWebLoadBalancer skipping(QList<QUrl>() << a << b);
+    for (int i = 0; i < 4; ++i)
+        QCOMPARE(skipping.acquire(), b);
+    QWebCircuitBreaker::reset();
+    QWebCircuitBreaker::setSettings(QWebCircuitBreaker::Settings());
+
+    // Web service spreads calls across its endpoints.
+    LocalHttpServer firstServer("<first/>");
+    LocalHttpServer secondServer("<second/>");
+    QVERIFY(firstServer.isListening() && secondServer.isListening());
+
+    QWebService *service = new QWebService(this);
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(firstServer.url());
+    method->setMethodName("getProviderList");
+    service->addMethod("getProviderList", method);
+    QCOMPARE(service->loadBalancer(), (QWebLoadBalancer *) 0);
+    service->setLoadBalancer(new QWebLoadBalancer(QList<QUrl>()
+                                                  << firstServer.url() << secondServer.url()));
+
+    for (int i = 0; i < 4; ++i) {
+        QWebMethodCall *call = method->invokeMethod();
+        QCOMPARE(call->waitForFinished(5000), bool(true));
+        QCOMPARE(call->isErrorState(), bool(false));
+    }
+    QCOMPARE(firstServer.requestCount, int(2));
+    QCOMPARE(secondServer.requestCount, int(2));
+    QCOMPARE(service->loadBalancer()->outstanding(firstServer.url()), int(0));
+
+    service->setLoadBalancer(0);
+    QWebMethodCall *call = method->invokeMethod();
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(firstServer.requestCount, int(3));
+
+    service->removeMethod("getProviderList");
+    delete service;
+}
+
+/*
+  Checks that web service resolves its hosts and opens connections
+  before the first call.
+  */
+void TestQWebMethod::warmUpTest()
+{
+    QWebHostCache::clear();
+    QCOMPARE(QWebHostCache::isFresh("127.0.0.1"), bool(false));
+
+    LocalHttpServer server("<ok/>");
+    QVERIFY(server.isListening());
+
+    QWebService *service = new QWebService(this);
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(server.url());
+    method->setMethodName("getProviderList");
+    service->addMethod("getProviderList", method);
+    QCOMPARE(service->warmConnections(), int(0));
+
+    service->setWarmConnections(2);
+    QCOMPARE(service->warmConnections(), int(2));
+    for (int i = 0; (i < 100) && (server.requestCount < 2); ++i)
+        QTest::qWait(20);
+    QCOMPARE(server.requestCount, int(2));
+    QCOMPARE(server.connectionCount, int(2));
+    QVERIFY(server.lastRequest.startsWith("HEAD "));
+    QVERIFY(QWebHostCache::isFresh("127.0.0.1"));
+
+    // Calls reuse warm connections.
+    QWebMethodCall *call = method->invokeMethod();
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->isErrorState(), bool(false));
+    QCOMPARE(server.connectionCount, int(2));
+
+    // Resolved hosts expire.
+    QWebHostCache::setTimeToLive(50);
+    QWebHostCache::clear();
+    service->warmUp();
+    for (int i = 0; (i < 100) && (server.requestCount < 5); ++i)
+        QTest::qWait(20);
+    QCOMPARE(server.requestCount, int(5));
+    QTest::qWait(100);
+    QCOMPARE(QWebHostCache::isFresh("127.0.0.1"), bool(false));
+    QWebHostCache::setTimeToLive(QWebHostCache::DefaultTimeToLive);
+
+    service->removeMethod("getProviderList");
+    delete service;
+}
+
+void TestQWebMethod::mpscQueueTest()
+{
+    QWebMpscQueue<int> queue;
+    int value = -1;
+    QCOMPARE(queue.isEmpty(), bool(true));
+    QCOMPARE(queue.dequeue(&value), bool(false));
+
+    queue.enqueue(1);
+    queue.enqueue(2);
+    QCOMPARE(queue.isEmpty(), bool(false));
+    QCOMPARE(queue.dequeue(&value), bool(true));
+    QCOMPARE(value, int(1));
+    QCOMPARE(queue.dequeue(&value), bool(true));
+    QCOMPARE(value, int(2));
+    QCOMPARE(queue.isEmpty(), bool(true));
+
+    // Many producers at once: nothing is lost, and order of each producer
+    // is kept.
+    const int producerCount = 4;
+    const int valueCount = 10000;
+    QList<QueueProducer *> producers;
+    for (int i = 0; i < producerCount; ++i)
+        producers.append(new QueueProducer(&queue, i * valueCount, valueCount));
+    foreach (QueueProducer *producer, producers)
+        producer->start();
+
+    QVector<int> lastValues(producerCount, -1);
+    int received = 0;
+    QTime timer;
+    timer.start();
+    while ((received < producerCount * valueCount) && (timer.elapsed() < 10000)) {
+        if (!queue.dequeue(&value)) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+
+        int producer = value / valueCount;
+        QVERIFY(value > lastValues.at(producer));
+        lastValues[producer] = value;
+        ++received;
+    }
+
+    foreach (QueueProducer *producer, producers)
+        producer->wait();
+    qDeleteAll(producers);
+    QCOMPARE(received, int(producerCount * valueCount));
+    QCOMPARE(queue.isEmpty(), bool(true));
+}
+
+void TestQWebMethod::workerThreadsTest()
+{
+    LocalHttpServer server("<ok/>");
+    QVERIFY(server.isListening());
+
+    QWebService *service = new QWebService(this);
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(server.url());
+    method->setMethodName("getProviderList");
+    service->addMethod("getProviderList", method);
+
+    ResultReceiver receiver;
+    QMap<QString, QVariant> params;
+    params.insert("country", "Poland");
+    QCOMPARE(service->workerThreads(), int(0));
+    QCOMPARE(service->submit("getProviderList", params, &receiver,
+                             SLOT(resultReady(int,QByteArray,QString))), int(-1));
+
+    service->setWorkerThreads(2);
+    QCOMPARE(service->workerThreads(), int(2));
+    QCOMPARE(service->submit("noSuchMethod", params, &receiver,
+                             SLOT(resultReady(int,QByteArray,QString))), int(-1));
+
+    QList<int> ids;
+    for (int i = 0; i < 6; ++i) {
+        int id = service->submit("getProviderList", params, &receiver,
+                                 SLOT(resultReady(int,QByteArray,QString)));
+        QVERIFY(id > 0);
+        QVERIFY(!ids.contains(id));
+        ids.append(id);
+    }
+
+    for (int i = 0; (i < 250) && (receiver.ids.size() < ids.size()); ++i)
+        QTest::qWait(20);
+    QCOMPARE(receiver.ids.size(), ids.size());
+    foreach (int id, ids)
+        QVERIFY(receiver.ids.contains(id));
+    foreach (const QByteArray &reply, receiver.replies)
+        QCOMPARE(reply, QByteArray("<ok/>"));
+    foreach (const QString &error, receiver.errors)
+        QVERIFY(error.isEmpty());
+    // Results come in the thread of the receiver.
+    foreach (QThread *thread, receiver.threads)
+        QCOMPARE(thread, QThread::currentThread());
+    QCOMPARE(server.requestCount, int(6));
+    QVERIFY(server.lastRequest.contains("Poland"));
+
+    // Empty parameters replace those of the previous call.
+    int id = service->submit("getProviderList", QMap<QString, QVariant>(), &receiver,
+                             SLOT(resultReady(int,QByteArray,QString)));
+    QVERIFY(id > 0);
+    ids.append(id);
+    for (int i = 0; (i < 250) && (receiver.ids.size() < ids.size()); ++i)
+        QTest::qWait(20);
+    QCOMPARE(server.requestCount, int(7));
+    QVERIFY(!server.lastRequest.contains("Poland"));
+
+    // Other threads use the settings published by the thread of the service.
+    CallSubmitter submitter(service, "getProviderList", &receiver);
+    submitter.start();
+    QVERIFY(submitter.wait(5000));
+    QVERIFY(submitter.id > 0);
+    ids.append(submitter.id);
+    for (int i = 0; (i < 250) && (receiver.ids.size() < ids.size()); ++i)
+        QTest::qWait(20);
+    QCOMPARE(server.requestCount, int(8));
+    CallSubmitter unknown(service, "noSuchMethod", &receiver);
+    unknown.start();
+    QVERIFY(unknown.wait(5000));
+    QCOMPARE(unknown.id, int(-1));
+
+    // Spilled replies are still readable, when their calls are gone.
+    server.body = QByteArray("<ok>") + QByteArray(4000, 'a') + QByteArray("</ok>");
+    method->setReplySpillThreshold(1024);
+    id = service->submit("getProviderList", params, &receiver,
+                         SLOT(resultReady(int,QByteArray,QString)));
+    QVERIFY(id > 0);
+    ids.append(id);
+    for (int i = 0; (i < 250) && (receiver.ids.size() < ids.size()); ++i)
+        QTest::qWait(20);
+    QTest::qWait(50);
+    QCOMPARE(receiver.replies.last(), server.body);
+    method->setReplySpillThreshold(0);
+
+    // Calls left running are aborted when workers stop.
+    server.stallsLeft = 1;
+    QVERIFY(service->submit("getProviderList", params, &receiver,
+                            SLOT(resultReady(int,QByteArray,QString))) > 0);
+    for (int i = 0; (i < 100) && (server.requestCount < 10); ++i)
+        QTest::qWait(20);
+    service->setWorkerThreads(0);
+    QCOMPARE(service->workerThreads(), int(0));
+    QTest::qWait(50);
+    QCOMPARE(receiver.ids.size(), ids.size());
+
+    service->removeMethod("getProviderList");
+    delete service;
+}
+
+void TestQWebMethod::batchTest()
+{
+    LocalHttpServer server("<ok/>");
+    QVERIFY(server.isListening());
+
+    QWebService *service = new QWebService(this);
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(server.url());
+    method->setMethodName("getBandDescription");
+    service->addMethod("getBandDescription", method);
+
+    QList<QWebBatchItem> items;
+    for (int i = 0; i < 10; ++i) {
+        QMap<QString, QVariant> params;
+        params.insert("bandName", QString("band%1").arg(i));
+        items.append(qMakePair(QString("getBandDescription"), params));
+    }
+    items.append(qMakePair(QString("noSuchMethod"), QMap<QString, QVariant>()));
+
+    QWebBatch *batch = service->invokeBatch(items, 3, QWebBatch::Ordered);
+    QSignalSpy itemSpy(batch, SIGNAL(itemFinished(int,QByteArray,QString)));
+    QSignalSpy finishedSpy(batch, SIGNAL(finished()));
+    QCOMPARE(batch->size(), int(11));
+    QCOMPARE(batch->maxConcurrent(), int(3));
+    QCOMPARE(batch->order(), QWebBatch::Ordered);
+    // Nothing is sent before control returns to the event loop.
+    QCOMPARE(batch->runningCount(), int(0));
+
+    QCOMPARE(batch->waitForFinished(5000), bool(true));
+    QCOMPARE(batch->isFinished(), bool(true));
+    QCOMPARE(finishedSpy.count(), int(1));
+    QCOMPARE(itemSpy.count(), int(11));
+    for (int i = 0; i < itemSpy.count(); ++i)
+        QCOMPARE(itemSpy.at(i).at(0).toInt(), int(i));
+    QCOMPARE(batch->finishedCount(), int(11));
+    QCOMPARE(batch->errorCount(), int(1));
+    QCOMPARE(batch->reply(0), QByteArray("<ok/>"));
+    QVERIFY(batch->errorInfo(0).isEmpty());
+    QVERIFY(!batch->errorInfo(10).isEmpty());
+    QCOMPARE(server.requestCount, int(10));
+    // Concurrency limit keeps the number of connections down.
+    QVERIFY(server.connectionCount <= 3);
+    delete batch;
+
+    // Items without parameters do not send those of the previous item.
+    QList<QWebBatchItem> emptyItems;
+    emptyItems.append(items.at(0));
+    emptyItems.append(qMakePair(QString("getBandDescription"), QMap<QString, QVariant>()));
+    batch = service->invokeBatch(emptyItems, 1);
+    QCOMPARE(batch->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(12));
+    QVERIFY(!server.lastRequest.contains("band0"));
+    delete batch;
+
+    // Parameters of the method itself are left alone.
+    QMap<QString, QVariant> own;
+    own.insert("bandName", QString("own"));
+    method->setParameters(own);
+    batch = service->invokeBatch(items.mid(0, 2), 1);
+    QCOMPARE(batch->waitForFinished(5000), bool(true));
+    QCOMPARE(method->parameterNamesTypes(), own);
+    QCOMPARE(method->invokeMethod()->waitForFinished(5000), bool(true));
+    QVERIFY(server.lastRequest.contains("own"));
+    QCOMPARE(server.requestCount, int(15));
+    method->setParameters(QMap<QString, QVariant>());
+    delete batch;
+
+    // Aborting fails items that have not been sent.
+    server.stallsLeft = 2;
+    batch = service->invokeBatch(items.mid(0, 6), 2);
+    QSignalSpy abortedSpy(batch, SIGNAL(finished()));
+    for (int i = 0; (i < 100) && (server.requestCount < 17); ++i)
+        QTest::qWait(20);
+    QCOMPARE(batch->runningCount(), int(2));
+    batch->abort();
+    QCOMPARE(batch->isFinished(), bool(true));
+    QCOMPARE(abortedSpy.count(), int(1));
+    QCOMPARE(batch->errorCount(), int(6));
+    QCOMPARE(server.requestCount, int(17));
+    delete batch;
+
+    // Empty batch finishes too.
+    batch = service->invokeBatch(QList<QWebBatchItem>());
+    QCOMPARE(batch->waitForFinished(1000), bool(true));
+    delete batch;
+
+    service->removeMethod("getBandDescription");
+    delete service;
+}
+
+void TestQWebMethod::responseCacheTest()
+{
+    QWebResponseCache::clear();
+    QWebResponseCache::resetCounters();
+    QCOMPARE(QWebResponseCache::maxSize(), int(QWebResponseCache::DefaultMaxSize));
+    QCOMPARE(QWebResponseCache::isCompressionEnabled(), bool(false));
+
+    LocalHttpServer server("<genres>rock</genres>");
+    QVERIFY(server.isListening());
+
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(server.url());
+    method->setMethodName("getGenreList");
+    QCOMPARE(method->cacheTimeToLive(), int(0));
+    method->setCacheTimeToLive(200);
+    QCOMPARE(method->cacheTimeToLive(), int(200));
+
+    QWebMethodCall *call = method->invokeMethod();
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(1));
+    QCOMPARE(QWebResponseCache::misses(), int(1));
+    QCOMPARE(QWebResponseCache::count(), int(1));
+
+    // Hit is answered without network traffic, once control returns
+    // to the event loop.
+    QSignalSpy replySpy(method, SIGNAL(replyReady(QByteArray)));
+    call = method->invokeMethod();
+    QVERIFY(call != 0);
+    QCOMPARE(call->isFinished(), bool(false));
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->isErrorState(), bool(false));
+    QCOMPARE(call->replyReadRaw(), QByteArray("<genres>rock</genres>"));
+    QCOMPARE(replySpy.count(), int(1));
+    QCOMPARE(method->replyReadRaw(), QByteArray("<genres>rock</genres>"));
+    QCOMPARE(server.requestCount, int(1));
+    QCOMPARE(QWebResponseCache::hits(), int(1));
+
+    // Different parameters have a different key.
+    QMap<QString, QVariant> params;
+    params.insert("genre", "metal");
+    method->setParameters(params);
+    QCOMPARE(method->invokeMethod()->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(2));
+    QCOMPARE(method->invokeMethod()->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(2));
+    QCOMPARE(QWebResponseCache::count(), int(2));
+
+    // Replies of other users, and of other protocols, are not shared.
+    method->setCredentials("user", "secret");
+    QCOMPARE(method->invokeMethod()->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(3));
+    method->setCredentials(QString(), QString());
+    method->setProtocol(QWebMethod::Soap10);
+    QCOMPARE(method->invokeMethod()->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(4));
+    method->setProtocol(QWebMethod::Soap12);
+    QCOMPARE(method->invokeMethod()->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(4));
+    QCOMPARE(QWebResponseCache::count(), int(4));
+
+    // Replies expire.
+    QTest::qWait(250);
+    QCOMPARE(method->invokeMethod()->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(5));
+    QCOMPARE(QWebResponseCache::hits(), int(3));
+    QCOMPARE(QWebResponseCache::misses(), int(5));
+
+    // Compressed replies take less memory, and are inflated on hits.
+    QWebResponseCache::clear();
+    QWebResponseCache::setCompressionEnabled(true);
+    server.body = QByteArray("<band>") + QByteArray(4000, 'a') + QByteArray("</band>");
+    QCOMPARE(method->invokeMethod()->waitForFinished(5000), bool(true));
+    QVERIFY(QWebResponseCache::size() < server.body.size());
+    call = method->invokeMethod();
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->replyReadRaw(), server.body);
+    QCOMPARE(server.requestCount, int(6));
+    QWebResponseCache::setCompressionEnabled(false);
+
+    // Least recently used replies are evicted first.
+    QWebResponseCache::clear();
+    QWebResponseCache::setMaxSize(2 * server.body.size() + 10);
+    for (int i = 0; i < 3; ++i) {
+        params.insert("genre", QString::number(i));
+        method->setParameters(params);
+        QCOMPARE(method->invokeMethod()->waitForFinished(5000), bool(true));
+    }
+    QCOMPARE(QWebResponseCache::count(), int(2));
+    QCOMPARE(server.requestCount, int(9));
+    params.insert("genre", QString::number(0));
+    method->setParameters(params);
+    QCOMPARE(method->invokeMethod()->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(10));
+    params.insert("genre", QString::number(2));
+    method->setParameters(params);
+    QCOMPARE(method->invokeMethod()->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(10));
+
+    QWebResponseCache::setMaxSize(QWebResponseCache::DefaultMaxSize);
+    QWebResponseCache::clear();
+    QWebResponseCache::resetCounters();
+    delete method;
+}
+
+void TestQWebMethod::coalescingTest()
+{
+    LocalHttpServer server("<bands>Queen</bands>");
+    QVERIFY(server.isListening());
+
+    QWebService *service = new QWebService(this);
+    QWebMethod *first = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    first->setHost(server.url());
+    first->setMethodName("getBandsList");
+    QWebMethod *second = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    second->setHost(server.url());
+    second->setMethodName("getBandsList");
+    service->addMethod("first", first);
+    service->addMethod("second", second);
+    QCOMPARE(service->isCoalescingEnabled(), bool(false));
+    service->setCoalescingEnabled(true);
+    QCOMPARE(first->isCoalescingEnabled(), bool(true));
+    QCOMPARE(second->isCoalescingEnabled(), bool(true));
+
+    // Identical calls, made while the first one is in flight, share its request.
+    QList<QWebMethodCall *> calls;
+    calls.append(first->invokeMethod());
+    calls.append(first->invokeMethod());
+    calls.append(second->invokeMethod());
+    QSignalSpy secondSpy(second, SIGNAL(replyReady(QByteArray)));
+    foreach (QWebMethodCall *call, calls)
+        call->setAutoDelete(false);
+    foreach (QWebMethodCall *call, calls)
+        QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(1));
+    foreach (QWebMethodCall *call, calls) {
+        QCOMPARE(call->isErrorState(), bool(false));
+        QCOMPARE(call->replyReadRaw(), QByteArray("<bands>Queen</bands>"));
+    }
+    QCOMPARE(first->coalescedCalls(), int(1));
+    QCOMPARE(second->coalescedCalls(), int(1));
+    QCOMPARE(secondSpy.count(), int(1));
+    qDeleteAll(calls);
+    calls.clear();
+
+    // Finished calls are not waited for.
+    QCOMPARE(first->invokeMethod()->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(2));
+
+    // Different parameters are different calls.
+    QMap<QString, QVariant> params;
+    params.insert("genre", "rock");
+    second->setParameters(params);
+    calls.append(first->invokeMethod());
+    calls.append(second->invokeMethod());
+    foreach (QWebMethodCall *call, calls)
+        call->setAutoDelete(false);
+    foreach (QWebMethodCall *call, calls)
+        QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(4));
+    qDeleteAll(calls);
+    calls.clear();
+
+    // Calls of other users are different calls too.
+    second->setParameters(QMap<QString, QVariant>());
+    second->setCredentials("user", "secret");
+    calls.append(first->invokeMethod());
+    calls.append(second->invokeMethod());
+    foreach (QWebMethodCall *call, calls)
+        call->setAutoDelete(false);
+    foreach (QWebMethodCall *call, calls)
+        QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(6));
+    QCOMPARE(second->coalescedCalls(), int(1));
+    qDeleteAll(calls);
+    calls.clear();
+
+    // Waiting calls get the error of the call they wait for.
+    server.failuresLeft = 1;
+    calls.append(first->invokeMethod());
+    calls.append(first->invokeMethod());
+    foreach (QWebMethodCall *call, calls)
+        call->setAutoDelete(false);
+    foreach (QWebMethodCall *call, calls)
+        QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(server.requestCount, int(7));
+    QCOMPARE(calls.at(0)->isErrorState(), bool(true));
+    QCOMPARE(calls.at(1)->isErrorState(), bool(true));
+    QCOMPARE(calls.at(1)->error(), calls.at(0)->error());
+    qDeleteAll(calls);
+    calls.clear();
+
+    // Deleting the call that is waited for makes a waiting call send
+    // its own request.
+    server.stallsLeft = 1;
+    QWebMethodCall *leader = first->invokeMethod();
+    QWebMethodCall *follower = first->invokeMethod();
+    follower->setAutoDelete(false);
+    delete leader;
+    QCOMPARE(follower->isFinished(), bool(false));
+    QCOMPARE(follower->waitForFinished(5000), bool(true));
+    QCOMPARE(follower->isErrorState(), bool(false));
+    QCOMPARE(follower->replyReadRaw(), QByteArray("<bands>Queen</bands>"));
+    delete follower;
+
+    // So does cancelling it, and other calls wait for the new one.
+    server.stallsLeft = 1;
+    leader = first->invokeMethod();
+    leader->setAutoDelete(false);
+    calls.append(first->invokeMethod());
+    calls.append(second->invokeMethod());
+    foreach (QWebMethodCall *call, calls)
+        call->setAutoDelete(false);
+    leader->abort();
+    QCOMPARE(leader->error(), QWebMethodCall::CancelledError);
+    foreach (QWebMethodCall *call, calls)
+        QCOMPARE(call->waitForFinished(5000), bool(true));
+    foreach (QWebMethodCall *call, calls) {
+        QCOMPARE(call->isErrorState(), bool(false));
+        QCOMPARE(call->replyReadRaw(), QByteArray("<bands>Queen</bands>"));
+    }
+    delete leader;
+    qDeleteAll(calls);
+    calls.clear();
+
+    // Waiting calls are cancelled with the calls of their web method.
+    server.stallsLeft = 1;
+    leader = first->invokeMethod();
+    follower = second->invokeMethod();
+    leader->setAutoDelete(false);
+    follower->setAutoDelete(false);
+    second->cancelAll();
+    QCOMPARE(follower->isFinished(), bool(true));
+    QCOMPARE(follower->error(), QWebMethodCall::CancelledError);
+    QCOMPARE(leader->isFinished(), bool(false));
+    delete follower;
+    follower = second->invokeMethod();
+    follower->setAutoDelete(false);
+    service->cancelAll();
+    QCOMPARE(leader->error(), QWebMethodCall::CancelledError);
+    QCOMPARE(follower->error(), QWebMethodCall::CancelledError);
+    delete leader;
+    delete follower;
+
+    service->removeMethod("first");
+    service->removeMethod("second");
+    delete service;
+}
+
+void TestQWebMethod::requestTemplateTest()
+{
+    LocalHttpServer server("<ok/>");
+    QVERIFY(server.isListening());
+
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(server.url());
+    method->setMethodName("getBandName");
+    method->setTargetNamespace("http://tempuri.org/");
+    QMap<QString, QVariant> params;
+    params.insert("bandId", "7");
+    method->setParameters(params);
+
+    QWebMethodCall *first = method->invokeMethod();
+    first->setAutoDelete(false);
+    QCOMPARE(first->waitForFinished(5000), bool(true));
+    QVERIFY(server.lastRequest.contains("<getBandName xmlns=\"http://tempuri.org/\">"));
+    QVERIFY(server.lastRequest.contains("<bandId>7</bandId>"));
+    QVERIFY(server.lastRequest.toLower().contains("content-type: application/soap+xml"));
+
+    // Body made for the same parameters is reused.
+    method->setParameters(params);
+    QWebMethodCall *second = method->invokeMethod();
+    second->setAutoDelete(false);
+    QCOMPARE(second->waitForFinished(5000), bool(true));
+    QCOMPARE(second->requestData(), first->requestData());
+    QVERIFY(second->requestData().constData() == first->requestData().constData());
+
+    // Same value of a different type is a different parameter.
+    params.insert("bandId", 7);
+    method->setParameters(params);
+    QWebMethodCall *third = method->invokeMethod();
+    third->setAutoDelete(false);
+    QVERIFY(third->requestData().constData() != first->requestData().constData());
+    QCOMPARE(third->waitForFinished(5000), bool(true));
+
+    // Template is compiled again when the method changes.
+    method->setMethodName("getBandDescription");
+    QCOMPARE(method->invokeMethod()->waitForFinished(5000), bool(true));
+    QVERIFY(server.lastRequest.contains("<getBandDescription xmlns="));
+    QVERIFY(!server.lastRequest.contains("getBandName"));
+
+    method->setProtocol(QWebMethod::Http);
+    QCOMPARE(method->invokeMethod()->waitForFinished(5000), bool(true));
+    QVERIFY(server.lastRequest.toLower().contains(
+                "content-type: application/x-www-form-urlencoded\r\n"));
+    QVERIFY(server.lastRequest.endsWith("bandId=7"));
+
+    delete first;
+    delete second;
+    delete third;
+    delete method;
+}
+
+void TestQWebMethod::streamingUploadTest()
+{
+    // Composite device reads, and seeks through, all three parts.
+    QBuffer content;
+    content.setData("0123456789");
+    content.open(QIODevice::ReadOnly);
+    content.seek(2);
+    QWebUploadDevice device("<a>", &content, "</a>");
+    QCOMPARE(device.isSequential(), bool(false));
+    QCOMPARE(device.size(), qint64(15));
+    QCOMPARE(device.read(5), QByteArray("<a>23"));
+    QCOMPARE(device.readAll(), QByteArray("456789</a>"));
+    QCOMPARE(device.atEnd(), bool(true));
+    QVERIFY(device.seek(1));
+    QCOMPARE(device.read(4), QByteArray("a>23"));
+    QVERIFY(device.seek(12));
+    QCOMPARE(device.readAll(), QByteArray("/a>"));
+    QVERIFY(device.reset());
+    QCOMPARE(device.readAll(), QByteArray("<a>23456789</a>"));
+
+    LocalHttpServer server("<ok/>");
+    QVERIFY(server.isListening());
+
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(server.url());
+    method->setMethodName("uploadFile");
+    method->setTargetNamespace("http://tempuri.org/");
+    method->setRetryPolicy(QWebRetryPolicy(2, 10, 50));
+    method->setIdempotent(true);
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QByteArray data = "<data>" + QByteArray(256 * 1024, 'x') + "</data>";
+    file.write(data);
+    file.seek(0);
+
+    // Failed request is sent again, from the beginning of the file.
+    server.failuresLeft = 1;
+    QWebMethodCall *call = method->invokeMethod(&file);
+    QVERIFY(call != 0);
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->isErrorState(), bool(false));
+    QCOMPARE(call->attempts(), int(2));
+    QCOMPARE(call->replyReadRaw(), QByteArray("<ok/>"));
+
+    QByteArray request = server.lastRequest;
+    QByteArray body = request.mid(request.indexOf("\r\n\r\n") + 4);
+    QVERIFY(body.startsWith("<?xml"));
+    QVERIFY(body.contains("<uploadFile xmlns=\"http://tempuri.org/\">" + data
+                          + "</uploadFile>"));
+    QVERIFY(request.toLower().contains(
+                "content-length: " + QByteArray::number(body.size()) + "\r\n"));
+    QCOMPARE(method->requestBytesSent(), qint64(2 * body.size()));
+
+    // Unreadable device is refused.
+    QCOMPARE(method->invokeMethod((QIODevice *) 0), (QWebMethodCall *) 0);
+    QCOMPARE(method->isErrorState(), bool(true));
+
+    delete call;
+    delete method;
+}
+
+void TestQWebMethod::replySpillTest()
+{
+    // Buffer moves to a file once it grows past the threshold.
+    QWebReplyBuffer buffer(8);
+    QVERIFY(buffer.append("0123"));
+    QCOMPARE(buffer.isSpilled(), bool(false));
+    QVERIFY(buffer.append("456789"));
+    QCOMPARE(buffer.isSpilled(), bool(true));
+    QCOMPARE(buffer.size(), qint64(10));
+
+    QByteArray data;
+    QWebReplyMapping mapping;
+    QVERIFY(buffer.take(&data, &mapping));
+    QCOMPARE(data, QByteArray("0123456789"));
+    QVERIFY(!mapping.isNull());
+    QCOMPARE(buffer.size(), qint64(0));
+    QString fileName = mapping->fileName();
+    QVERIFY(QFile::exists(fileName));
+    data = QByteArray();
+    mapping.clear();
+    QVERIFY(!QFile::exists(fileName));
+
+    // Small replies stay in memory.
+    QVERIFY(buffer.append("abc"));
+    QVERIFY(buffer.take(&data, &mapping));
+    QCOMPARE(data, QByteArray("abc"));
+    QVERIFY(mapping.isNull());
+
+    QByteArray body(300 * 1024, 'r');
+    LocalHttpServer server(body);
+    QVERIFY(server.isListening());
+
+    QWebMethod *method = new QWebMethod(0, QWebMethod::Soap12, QWebMethod::Post);
+    method->setHost(server.url());
+    method->setMethodName("getBigReport");
+    QCOMPARE(method->replySpillThreshold(), qint64(0));
+    method->setReplySpillThreshold(64 * 1024);
+    QCOMPARE(method->replySpillThreshold(), qint64(64 * 1024));
+
+    QSignalSpy methodSpy(method, SIGNAL(replyReady(QByteArray)));
+    QWebMethodCall *call = method->invokeMethod();
+    QSignalSpy callSpy(call, SIGNAL(replyReady(QByteArray)));
+    call->setAutoDelete(false);
+    QCOMPARE(call->waitForFinished(5000), bool(true));
+    QCOMPARE(call->isErrorState(), bool(false));
+    QCOMPARE(call->replyReadRaw(), body);
+    QByteArray callReply = call->replyReadRaw();
+
+    // Web method keeps the reply mapped after the call is gone.
+    delete call;
+    QByteArray methodReply = method->replyReadRaw();
+    QCOMPARE(methodReply, body);
+    QCOMPARE(method->replyReadJson().data(), body);
+
+    // Replies handed out are copies, valid after the mapping is gone.
+    delete method;
+    QCOMPARE(callReply, body);
+    QCOMPARE(methodReply, body);
+    QCOMPARE(callSpy.count(), int(1));
+    QCOMPARE(callSpy.at(0).at(0).toByteArray(), body);
+    QCOMPARE(methodSpy.count(), int(1));
+    QCOMPARE(methodSpy.at(0).at(0).toByteArray(), body);
+}
+
 void TestQWebMethod::defaultGettersTest(QWebMethod *method)
 {
     QCOMPARE(method->isErrorState(), bool(false));
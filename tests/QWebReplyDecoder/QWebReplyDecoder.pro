@@ -0,0 +1,12 @@
+include(../../buildInfo.pri)
+
+QT += qtestlib
+CONFIG += qtestlib
+
+include(../../libraryIncludes.pri)
+
+DESTDIR = $${TESTS_DIRECTORY}/QWebReplyDecoder
+OBJECTS_DIR = $${TESTS_DIRECTORY}/QWebReplyDecoder
+MOC_DIR = $${TESTS_DIRECTORY}/QWebReplyDecoder
+
+SOURCES += tst_qwebreplydecoder.cpp
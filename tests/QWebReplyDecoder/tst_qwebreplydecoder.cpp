@@ -0,0 +1,270 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWebReplyDecoder test suite.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <qwebreplydecoder_p.h>
+
+/*
+    This test checks QWebReplyDecoder: typed values, namespaces, arrays
+    and faults. Benchmarks compare it with substring search, which
+    QWebMethod::replyReadParsed() used before.
+  */
+class TestQWebReplyDecoder : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void genericTest();
+    void typedTest();
+    void namespaceTest();
+    void arrayTest();
+    void errorTest();
+    void decoderBenchmark_data();
+    void decoderBenchmark();
+
+private:
+    QByteArray envelope(const QByteArray &response);
+    QVariant substringParse(const QByteArray &reply, const QString &methodName,
+                            const QMap<QString, QVariant> &returnValue);
+};
+
+/*
+  Returns \a response wrapped in a SOAP 1.2 envelope.
+  */
+QByteArray TestQWebReplyDecoder::envelope(const QByteArray &response)
+{
+    return "<?xml version=\"1.0\" encoding=\"utf-8\"?>\r\n"
+           "<soap:Envelope xmlns:soap=\"http://www.w3.org/2003/05/soap-envelope\" "
+           "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">"
+           "<soap:Header><getBandNameResponse>header</getBandNameResponse></soap:Header>"
+           "<soap:Body>" + response + "</soap:Body></soap:Envelope>";
+}
+
+/*
+  Without a schema, text becomes QString, and children become QVariantMap.
+  */
+void TestQWebReplyDecoder::genericTest()
+{
+    QMap<QString, QVariant> none;
+    QByteArray reply = envelope("<getBandNameResponse xmlns=\"http://tempuri.org/\">"
+                                "<getBandNameResult>Queen &amp; co</getBandNameResult>"
+                                "</getBandNameResponse>");
+    QCOMPARE(QWebReplyDecoder::decode(reply, "http://tempuri.org/", none),
+             QVariant(QString("Queen & co")));
+
+    reply = "<band><name>Queen</name><member>Freddie</member><member>Brian</member>"
+            "<label xsi:nil=\"true\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"/>"
+            "</band>";
+    QVariantMap band = QWebReplyDecoder::decode(reply, QString(), none).toMap();
+    QCOMPARE(band.value("name"), QVariant(QString("Queen")));
+    QCOMPARE(band.value("member").toList().size(), int(2));
+    QCOMPARE(band.value("member").toList().at(1), QVariant(QString("Brian")));
+    QVERIFY(band.contains("label"));
+    QVERIFY(!band.value("label").isValid());
+}
+
+/*
+  Values are converted to the declared types.
+  */
+void TestQWebReplyDecoder::typedTest()
+{
+    QMap<QString, QVariant> schema;
+    schema.insert("count", int());
+    schema.insert("rating", double());
+    schema.insert("active", true);
+    schema.insert("founded", QDateTime());
+    schema.insert("name", QString());
+    schema.insert("logo", QByteArray());
+
+    QByteArray reply = envelope("<getBandResponse xmlns=\"http://tempuri.org/\">"
+                                "<getBandResult><count> 4 </count><rating>4.5</rating>"
+                                "<active>false</active>"
+                                "<founded>1970-06-27T12:30:00</founded>"
+                                "<name>Queen</name><logo>UXVlZW4=</logo>"
+                                "</getBandResult></getBandResponse>");
+    QString errorString;
+    QVariantList values = QWebReplyDecoder::decode(reply, "http://tempuri.org/", schema,
+                                                   &errorString).toList();
+    QCOMPARE(errorString, QString());
+    // Ordered by name: active, count, founded, logo, name, rating.
+    QCOMPARE(values.size(), int(6));
+    QCOMPARE(values.at(0), QVariant(false));
+    QCOMPARE(values.at(1), QVariant(4));
+    QCOMPARE(values.at(2).toDateTime(), QDateTime(QDate(1970, 6, 27), QTime(12, 30)));
+    QCOMPARE(values.at(3), QVariant(QByteArray("Queen")));
+    QCOMPARE(values.at(4), QVariant(QString("Queen")));
+    QCOMPARE(values.at(5), QVariant(4.5));
+
+    // Single value is returned directly, missing one is invalid.
+    QMap<QString, QVariant> single;
+    single.insert("count", int());
+    QCOMPARE(QWebReplyDecoder::decode(reply, QString(), single), QVariant(4));
+    single.clear();
+    single.insert("members", int());
+    QVERIFY(!QWebReplyDecoder::decode(reply, QString(), single).isValid());
+}
+
+/*
+  Prefixes do not matter, namespaces do.
+  */
+void TestQWebReplyDecoder::namespaceTest()
+{
+    QMap<QString, QVariant> schema;
+    schema.insert("bandName", QString());
+
+    QByteArray reply = envelope("<m:getBandNameResponse xmlns:m=\"http://tempuri.org/\" "
+                                "xmlns:o=\"http://other.org/\">"
+                                "<o:bandName>Other</o:bandName>"
+                                "<m:bandName>Queen</m:bandName>"
+                                "</m:getBandNameResponse>");
+    QCOMPARE(QWebReplyDecoder::decode(reply, "http://tempuri.org/", schema),
+             QVariant(QString("Queen")));
+    // Without a target namespace, the first element wins.
+    QCOMPARE(QWebReplyDecoder::decode(reply, QString(), schema),
+             QVariant(QString("Other")));
+}
+
+/*
+  Arrays are read from children, or from repeated elements.
+  */
+void TestQWebReplyDecoder::arrayTest()
+{
+    QMap<QString, QVariant> schema;
+    schema.insert("members", QStringList());
+    QByteArray reply = envelope("<getMembersResponse><members>"
+                                "<string>Freddie</string><string>Brian</string>"
+                                "<string>Roger</string></members></getMembersResponse>");
+    QCOMPARE(QWebReplyDecoder::decode(reply, QString(), schema).toStringList(),
+             QStringList() << "Freddie" << "Brian" << "Roger");
+
+    schema.clear();
+    schema.insert("album", QVariantList());
+    reply = "<albums><album>Queen</album><album>Jazz</album></albums>";
+    QVariantList albums = QWebReplyDecoder::decode(reply, QString(), schema).toList();
+    QCOMPARE(albums.size(), int(2));
+    QCOMPARE(albums.at(1), QVariant(QString("Jazz")));
+}
+
+/*
+  Malformed replies and SOAP faults are errors.
+  */
+void TestQWebReplyDecoder::errorTest()
+{
+    QMap<QString, QVariant> none;
+    QString errorString;
+    QVERIFY(!QWebReplyDecoder::decode("<a><b></a>", QString(), none, &errorString).isValid());
+    QVERIFY(!errorString.isEmpty());
+
+    errorString.clear();
+    QVERIFY(!QWebReplyDecoder::decode(QByteArray(), QString(), none, &errorString).isValid());
+    QVERIFY(!errorString.isEmpty());
+
+    QByteArray fault = "<soap:Envelope xmlns:soap=\"http://schemas.xmlsoap.org/soap/envelope/\">"
+                       "<soap:Body><soap:Fault><faultcode>soap:Server</faultcode>"
+                       "<faultstring>Band not found</faultstring></soap:Fault>"
+                       "</soap:Body></soap:Envelope>";
+    QVERIFY(!QWebReplyDecoder::decode(fault, QString(), none, &errorString).isValid());
+    QCOMPARE(errorString, QString("SOAP fault: Band not found"));
+}
+
+/*
+  Compares decoding a reply with 10 000 elements with QWebReplyDecoder,
+  and with substring search, with 100 return values declared. Decoding
+  of an array of 10 000 items is measured too (substring search cannot
+  read arrays).
+  */
+void TestQWebReplyDecoder::decoderBenchmark_data()
+{
+    QTest::addColumn<bool>("array");
+    QTest::addColumn<bool>("substring");
+
+    QTest::newRow("10k elements, substring search") << false << true;
+    QTest::newRow("10k elements, decoder") << false << false;
+    QTest::newRow("10k array items, decoder") << true << false;
+}
+
+void TestQWebReplyDecoder::decoderBenchmark()
+{
+    QFETCH(bool, array);
+    QFETCH(bool, substring);
+
+    QByteArray response = "<getReportResponse xmlns=\"http://tempuri.org/\"><items>";
+    QMap<QString, QVariant> schema;
+    for (int i = 0; i < 10000; ++i) {
+        QByteArray name = array ? QByteArray("int")
+                                : "value" + QByteArray::number(i).rightJustified(5, '0');
+        response += "<" + name + ">" + QByteArray::number(i) + "</" + name + ">";
+        if (!array && ((i % 100) == 0))
+            schema.insert(name, int());
+    }
+    response += "</items></getReportResponse>";
+    if (array)
+        schema.insert("items", QVariantList());
+    QByteArray reply = envelope(response);
+
+    QVariant result;
+    if (substring) {
+        QBENCHMARK {
+            result = substringParse(reply, "getReport", schema);
+        }
+    } else {
+        QBENCHMARK {
+            result = QWebReplyDecoder::decode(reply, "http://tempuri.org/", schema);
+        }
+        QCOMPARE(result.toList().size(), array ? int(10000) : int(100));
+    }
+}
+
+/*
+  Reply parsed the way QWebMethod::replyReadParsed() used to parse it,
+  for comparison: one scan of the reply for every return value.
+  */
+QVariant TestQWebReplyDecoder::substringParse(const QByteArray &reply,
+                                              const QString &methodName,
+                                              const QMap<QString, QVariant> &returnValue)
+{
+    QString replyString(reply);
+    replyString.replace(QLatin1String("&lt;"), QLatin1String("<"));
+    replyString.replace(QLatin1String("&gt;"), QLatin1String(">"));
+
+    QString tempBegin = QLatin1String("<") + methodName;
+    int replyBeginIndex = replyString.indexOf(tempBegin) + tempBegin.length();
+    QString tempFinish = QLatin1String("</") + methodName;
+    int replyFinishIndex = replyString.indexOf(tempFinish, replyBeginIndex);
+    if (replyFinishIndex == -1)
+        replyFinishIndex = replyString.length();
+    QString replyCore = replyString.mid(replyBeginIndex, replyFinishIndex - replyBeginIndex);
+
+    QStringList returnsSplitted;
+    foreach (QString s, returnValue.keys()) {
+        if (replyCore.contains(s)) {
+            int tempIndex = replyCore.indexOf(s);
+            int tempBeginIndex = replyCore.indexOf(">", tempIndex) + 1;
+            tempIndex = replyCore.indexOf("</", tempBeginIndex);
+            returnsSplitted.append(replyCore.mid(tempBeginIndex,
+                                                 tempBeginIndex - tempIndex).trimmed());
+        }
+    }
+
+    QList<QVariant> parsedReturns;
+    foreach (const QString &value, returnsSplitted)
+        parsedReturns.append(QVariant(value.toInt()));
+    return parsedReturns;
+}
+
+QTEST_MAIN(TestQWebReplyDecoder)
+#include "tst_qwebreplydecoder.moc"
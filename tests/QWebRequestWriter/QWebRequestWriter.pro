@@ -0,0 +1,12 @@
+include(../../buildInfo.pri)
+
+QT += qtestlib
+CONFIG += qtestlib
+
+include(../../libraryIncludes.pri)
+
+DESTDIR = $${TESTS_DIRECTORY}/QWebRequestWriter
+OBJECTS_DIR = $${TESTS_DIRECTORY}/QWebRequestWriter
+MOC_DIR = $${TESTS_DIRECTORY}/QWebRequestWriter
+
+SOURCES += tst_qwebrequestwriter.cpp
@@ -0,0 +1,460 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Tomasz Siekierda
+** All rights reserved.
+** Contact: Tomasz Siekierda (sierdzio@gmail.com)
+**
+** This file is part of the QWsdl test suite.
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.txt included in the packaging of this
+** file. Please review the following information to ensure the GNU Lesser
+** General Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <qwebrequestwriter_p.h>
+
+/*
+    This test checks QWebRequestWriter: UTF-8 encoding, escaping, and request
+    bodies of all protocols. Benchmarks compare it with building the body
+    by QString concatenation, which the writer has replaced.
+  */
+class TestQWebRequestWriter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void utf8Test();
+    void escapingTest();
+    void soapTest();
+    void soapNestedTest();
+    void httpTest();
+    void jsonTest();
+    void jsonNestedTest();
+    void serializerBenchmark_data();
+    void serializerBenchmark();
+    void jsonBenchmark_data();
+    void jsonBenchmark();
+
+private:
+    QMap<QString, QVariant> parameterSet(int totalSize);
+    QByteArray concatenatedBody(const QString &methodName, const QString &targetNamespace,
+                                const QMap<QString, QVariant> &parameters);
+    QVariantMap jsonDocument(int totalSize);
+    QString concatenatedJson(const QVariant &value);
+};
+
+/*
+  Checks that text outside of Latin-1 survives, and that sizes are exact.
+  */
+void TestQWebRequestWriter::utf8Test()
+{
+    QString text = QString::fromUtf8("Za\xc5\xbc\xc3\xb3\xc5\x82\xc4\x87 \xe6\x97\xa5\xe6\x9c\xac "
+                                     "\xf0\x9f\x8e\xb8");
+    QCOMPARE(QWebRequestWriter::toUtf8(text, QWebRequestWriter::NoEscaping), text.toUtf8());
+    QCOMPARE(QWebRequestWriter::utf8Size(text, QWebRequestWriter::NoEscaping),
+             text.toUtf8().size());
+
+    // Unpaired surrogates are replaced.
+    QString broken;
+    broken.append(QChar(0xd800));
+    broken.append(QLatin1Char('a'));
+    QCOMPARE(QWebRequestWriter::toUtf8(broken, QWebRequestWriter::NoEscaping),
+             QByteArray("\xef\xbf\xbd" "a"));
+    QCOMPARE(QWebRequestWriter::toUtf8(QString(), QWebRequestWriter::XmlEscaping),
+             QByteArray());
+}
+
+/*
+  Checks escaping used by each of the protocols.
+  */
+void TestQWebRequestWriter::escapingTest()
+{
+    QString text = QLatin1String("a<b>&\"c\"\n");
+    QCOMPARE(QWebRequestWriter::toUtf8(text, QWebRequestWriter::XmlEscaping),
+             QByteArray("a&lt;b&gt;&amp;&quot;c&quot;\n"));
+    QCOMPARE(QWebRequestWriter::toUtf8(text, QWebRequestWriter::JsonEscaping),
+             QByteArray("a<b>&\\\"c\\\"\\n"));
+    QCOMPARE(QWebRequestWriter::toUtf8(QString(QChar(0x01)), QWebRequestWriter::JsonEscaping),
+             QByteArray("\\u0001"));
+    QCOMPARE(QWebRequestWriter::toUtf8(QString::fromUtf8("a b&c=\xc5\xbc~"),
+                                       QWebRequestWriter::FormEscaping),
+             QByteArray("a+b%26c%3D%C5%BC~"));
+
+    QList<QWebRequestWriter::Escaping> escapings;
+    escapings << QWebRequestWriter::NoEscaping << QWebRequestWriter::XmlEscaping
+              << QWebRequestWriter::JsonEscaping << QWebRequestWriter::FormEscaping;
+    foreach (QWebRequestWriter::Escaping escaping, escapings) {
+        QCOMPARE(QWebRequestWriter::utf8Size(text, escaping),
+                 QWebRequestWriter::toUtf8(text, escaping).size());
+    }
+}
+
+/*
+  Checks SOAP envelope.
+  */
+void TestQWebRequestWriter::soapTest()
+{
+    QMap<QString, QVariant> params;
+    params.insert("bandName", QString::fromUtf8("Motörhead & co"));
+    params.insert("year", 1975);
+
+    QByteArray body = QWebRequestWriter::write(QWebMethod::Soap12, "getBandDescription",
+                                               "http://tempuri.org/", params);
+    QVERIFY(body.startsWith("<?xml version=\"1.0\" encoding=\"utf-8\"?>"));
+    QVERIFY(body.contains("<soap12:Envelope "));
+    QVERIFY(body.contains("\t<getBandDescription xmlns=\"http://tempuri.org/\">\r\n"));
+    QVERIFY(body.contains(QString::fromUtf8("<bandName>Motörhead &amp; co</bandName>").toUtf8()));
+    QVERIFY(body.contains("<year>1975</year>"));
+    QVERIFY(body.contains("\t</getBandDescription>\r\n"));
+    QVERIFY(body.endsWith("</soap12:Envelope>"));
+    QVERIFY(body.indexOf("bandName") < body.indexOf("year"));
+
+    // Size is known before anything is written.
+    QByteArray prefix = QWebRequestWriter::prefix(QWebMethod::Soap12, "getBandDescription",
+                                                  "http://tempuri.org/");
+    QByteArray suffix = QWebRequestWriter::suffix(QWebMethod::Soap12, "getBandDescription");
+    QVERIFY(body.startsWith(prefix));
+    QVERIFY(body.endsWith(suffix));
+    QCOMPARE(body.size(), prefix.size() + suffix.size()
+             + QWebRequestWriter::parametersSize(QWebMethod::Soap12, params));
+
+    body = QWebRequestWriter::write(QWebMethod::Soap10, "getBandDescription",
+                                    "http://tempuri.org/", QMap<QString, QVariant>());
+    QVERIFY(body.contains("<soap:Body>"));
+    QVERIFY(body.endsWith("</soap:Envelope>"));
+
+    // Plain XML has no envelope.
+    body = QWebRequestWriter::write(QWebMethod::Xml, "getBandDescription",
+                                    "http://tempuri.org/", params);
+    QVERIFY(body.startsWith("\t\t<bandName>"));
+    QVERIFY(!body.contains("getBandDescription"));
+}
+
+/*
+  Checks form encoded parameters.
+  */
+/*
+  Checks that maps become nested elements and lists repeated elements,
+  inside the method element which declares the target namespace.
+  */
+void TestQWebRequestWriter::soapNestedTest()
+{
+    QVariantMap address;
+    address.insert("city", "London");
+    address.insert("street", "Logan Place <1>");
+    QVariantMap member;
+    member.insert("address", address);
+    member.insert("name", "Freddie");
+    member.insert("instruments", QStringList() << "vocals" << "piano");
+
+    QMap<QString, QVariant> params;
+    params.insert("member", member);
+    params.insert("albums", QVariantList() << "Queen" << 1973);
+    params.insert("matrix", QVariantList() << QVariant(QVariantList() << 1 << 2)
+                  << QVariant(QStringList() << "3"));
+    params.insert("empty", QVariantMap());
+
+    QByteArray parameters("\t\t<albums>Queen</albums>\r\n"
+                          "\t\t<albums>1973</albums>\r\n"
+                          "\t\t<empty></empty>\r\n"
+                          "\t\t<matrix>\r\n"
+                          "\t\t\t<item>1</item>\r\n"
+                          "\t\t\t<item>2</item>\r\n"
+                          "\t\t</matrix>\r\n"
+                          "\t\t<matrix>\r\n"
+                          "\t\t\t<item>3</item>\r\n"
+                          "\t\t</matrix>\r\n"
+                          "\t\t<member>\r\n"
+                          "\t\t\t<address>\r\n"
+                          "\t\t\t\t<city>London</city>\r\n"
+                          "\t\t\t\t<street>Logan Place &lt;1&gt;</street>\r\n"
+                          "\t\t\t</address>\r\n"
+                          "\t\t\t<instruments>vocals</instruments>\r\n"
+                          "\t\t\t<instruments>piano</instruments>\r\n"
+                          "\t\t\t<name>Freddie</name>\r\n"
+                          "\t\t</member>\r\n");
+    QCOMPARE(QWebRequestWriter::write(QWebMethod::Xml, "getBand", QString(), params),
+             parameters);
+    QCOMPARE(QWebRequestWriter::parametersSize(QWebMethod::Soap12, params), parameters.size());
+
+    QByteArray body = QWebRequestWriter::write(QWebMethod::Soap12, "getBand",
+                                               "http://tempuri.org/", params);
+    QCOMPARE(body, QWebRequestWriter::prefix(QWebMethod::Soap12, "getBand", "http://tempuri.org/")
+             + parameters + QWebRequestWriter::suffix(QWebMethod::Soap12, "getBand"));
+
+    // The body is well formed, and nested elements are in the target namespace.
+    QXmlStreamReader reader(body);
+    int qualified = 0;
+    while (!reader.atEnd()) {
+        if (reader.readNext() == QXmlStreamReader::StartElement
+                && reader.namespaceUri() == QLatin1String("http://tempuri.org/")) {
+            ++qualified;
+        }
+    }
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+    QCOMPARE(qualified, 16);
+}
+
+void TestQWebRequestWriter::httpTest()
+{
+    QMap<QString, QVariant> params;
+    params.insert("country", QString::fromUtf8("Espa\xc3\xb1" "a"));
+    params.insert("city", "San Sebastian");
+    QCOMPARE(QWebRequestWriter::write(QWebMethod::Http, "getCity", QString(), params),
+             QByteArray("city=San+Sebastian&country=Espa%C3%B1a"));
+    QCOMPARE(QWebRequestWriter::write(QWebMethod::Http, "getCity", QString(),
+                                      QMap<QString, QVariant>()),
+             QByteArray());
+}
+
+/*
+  Checks JSON object, with numbers, booleans and strings.
+  */
+void TestQWebRequestWriter::jsonTest()
+{
+    QMap<QString, QVariant> params;
+    params.insert("name", QString::fromUtf8("\"Queen\"\n\xe2\x99\x9b"));
+    params.insert("members", 4);
+    params.insert("active", false);
+    params.insert("rating", 4.5);
+    params.insert("label", QVariant());
+    QCOMPARE(QWebRequestWriter::write(QWebMethod::Json, "getBand", QString(), params),
+             QString::fromUtf8("{\"active\":false,\"label\":null,\"members\":4,"
+                               "\"name\":\"\\\"Queen\\\"\\n\xe2\x99\x9b\",\"rating\":4.5}").toUtf8());
+    QCOMPARE(QWebRequestWriter::write(QWebMethod::Json, "getBand", QString(),
+                                      QMap<QString, QVariant>()),
+             QByteArray("{}"));
+}
+
+/*
+  Checks that maps, hashes and lists are written recursively, that integers
+  keep all their digits, and that numbers which JSON cannot hold become null.
+  */
+void TestQWebRequestWriter::jsonNestedTest()
+{
+    QVariantMap member;
+    member.insert("name", "Freddie");
+    member.insert("instruments", QStringList() << "vocals" << "piano");
+    QVariantHash tour;
+    tour.insert("year", 1986);
+    QVariantList members;
+    members << member << QVariantList() << QVariantMap() << QVariant();
+
+    QMap<QString, QVariant> params;
+    params.insert("members", members);
+    params.insert("tour", tour);
+    QCOMPARE(QWebRequestWriter::write(QWebMethod::Json, "getBand", QString(), params),
+             QByteArray("{\"members\":[{\"instruments\":[\"vocals\",\"piano\"],"
+                        "\"name\":\"Freddie\"},[],{},null],\"tour\":{\"year\":1986}}"));
+
+    QCOMPARE(QWebRequestWriter::toJson(Q_INT64_C(-9223372036854775807) - 1),
+             QByteArray("-9223372036854775808"));
+    QCOMPARE(QWebRequestWriter::toJson(Q_UINT64_C(18446744073709551615)),
+             QByteArray("18446744073709551615"));
+    QCOMPARE(QWebRequestWriter::toJson(0), QByteArray("0"));
+    QCOMPARE(QWebRequestWriter::toJson(-0.25), QByteArray("-0.25"));
+    QCOMPARE(QWebRequestWriter::toJson(qInf()), QByteArray("null"));
+    QCOMPARE(QWebRequestWriter::toJson(qQNaN()), QByteArray("null"));
+    QCOMPARE(QWebRequestWriter::toJson(QString("")), QByteArray("\"\""));
+    QCOMPARE(QWebRequestWriter::toJson(QVariantList() << true << QString("a\tb")),
+             QByteArray("[true,\"a\\tb\"]"));
+
+    // The reply parser has to read back what the writer wrote.
+    QVariantMap document = jsonDocument(4096);
+    QByteArray json = QWebRequestWriter::toJson(document);
+    QCOMPARE(json.size(), QWebRequestWriter::jsonSize(document));
+    QCOMPARE(QWebRequestWriter::toJson(QWebJsonDocument::parse(json)), json);
+    // And it writes what the concatenation it replaced did.
+    QCOMPARE(QWebRequestWriter::write(QWebMethod::Json, "getBands", QString(), document),
+             concatenatedJson(document).toUtf8());
+}
+
+/*
+  Compares serializing a SOAP 1.2 request with QWebRequestWriter,
+  and with QString concatenation, for parameter sets of 1 KB and 1 MB
+  (the latter when QWEBSERVICE_BIG_BENCHMARKS is set). Run with -callgrind
+  to compare instructions, including those spent in memory allocation.
+  */
+void TestQWebRequestWriter::serializerBenchmark_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<bool>("concatenation");
+
+    QTest::newRow("1 KB, concatenation") << 1024 << true;
+    QTest::newRow("1 KB, writer") << 1024 << false;
+    if (qgetenv("QWEBSERVICE_BIG_BENCHMARKS").isEmpty())
+        return;
+
+    QTest::newRow("1 MB, concatenation") << 1024 * 1024 << true;
+    QTest::newRow("1 MB, writer") << 1024 * 1024 << false;
+}
+
+void TestQWebRequestWriter::serializerBenchmark()
+{
+    QFETCH(int, size);
+    QFETCH(bool, concatenation);
+
+    QMap<QString, QVariant> params = parameterSet(size);
+    QByteArray body;
+    if (concatenation) {
+        QBENCHMARK {
+            body = concatenatedBody("getBandDescription", "http://tempuri.org/", params);
+        }
+    } else {
+        QBENCHMARK {
+            body = QWebRequestWriter::write(QWebMethod::Soap12, "getBandDescription",
+                                            "http://tempuri.org/", params);
+        }
+    }
+
+    QVERIFY(body.size() >= size);
+}
+
+/*
+  Compares writing nested JSON documents of 100 B and 10 KB with
+  QWebRequestWriter, and with recursive QString concatenation. Documents
+  of 1 MB and 10 MB are added when QWEBSERVICE_BIG_BENCHMARKS is set,
+  they take too long for every test run.
+  */
+void TestQWebRequestWriter::jsonBenchmark_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<bool>("concatenation");
+
+    QTest::newRow("100 B, concatenation") << 100 << true;
+    QTest::newRow("100 B, writer") << 100 << false;
+    QTest::newRow("10 KB, concatenation") << 10 * 1024 << true;
+    QTest::newRow("10 KB, writer") << 10 * 1024 << false;
+    if (qgetenv("QWEBSERVICE_BIG_BENCHMARKS").isEmpty())
+        return;
+
+    QTest::newRow("1 MB, concatenation") << 1024 * 1024 << true;
+    QTest::newRow("1 MB, writer") << 1024 * 1024 << false;
+    QTest::newRow("10 MB, concatenation") << 10 * 1024 * 1024 << true;
+    QTest::newRow("10 MB, writer") << 10 * 1024 * 1024 << false;
+}
+
+void TestQWebRequestWriter::jsonBenchmark()
+{
+    QFETCH(int, size);
+    QFETCH(bool, concatenation);
+
+    QMap<QString, QVariant> params = jsonDocument(size);
+    QByteArray body;
+    if (concatenation) {
+        QBENCHMARK {
+            body = concatenatedJson(params).toUtf8();
+        }
+    } else {
+        QBENCHMARK {
+            body = QWebRequestWriter::write(QWebMethod::Json, "getBands", QString(), params);
+        }
+    }
+
+    // Both write the same document, see jsonNestedTest().
+    QVERIFY(!body.isEmpty());
+}
+
+/*
+  Returns parameters taking about \a totalSize bytes, 64 bytes each.
+  */
+QMap<QString, QVariant> TestQWebRequestWriter::parameterSet(int totalSize)
+{
+    QMap<QString, QVariant> params;
+    QString value(48, QLatin1Char('x'));
+    for (int i = 0; i < totalSize / 64; ++i)
+        params.insert(QString("param%1").arg(i, 10, 10, QLatin1Char('0')), value);
+    return params;
+}
+
+/*
+  Returns a JSON document taking about \a totalSize bytes: a list
+  of band objects, about 100 bytes each.
+  */
+QVariantMap TestQWebRequestWriter::jsonDocument(int totalSize)
+{
+    QVariantList bands;
+    for (int i = 0; i < qMax(totalSize / 100, 1); ++i) {
+        QVariantMap band;
+        band.insert("id", i);
+        band.insert("name", QString("Band \"%1\"").arg(i));
+        band.insert("genres", QStringList() << "rock" << "pop");
+        band.insert("rating", 4.5);
+        band.insert("active", (i % 2) == 0);
+        band.insert("label", QVariant());
+        bands.append(band);
+    }
+
+    QVariantMap document;
+    document.insert("bands", bands);
+    return document;
+}
+
+/*
+  JSON built by recursive QString concatenation, for comparison. Handles
+  only what jsonDocument() generates.
+  */
+QString TestQWebRequestWriter::concatenatedJson(const QVariant &value)
+{
+    QString result;
+    if (value.type() == QVariant::Map) {
+        QVariantMap map = value.toMap();
+        foreach (const QString &key, map.keys()) {
+            result += (result.isEmpty() ? QLatin1String("{\"") : QLatin1String(",\""))
+                    + key + QLatin1String("\":") + concatenatedJson(map.value(key));
+        }
+        return result.isEmpty() ? QString(QLatin1String("{}")) : (result + QLatin1Char('}'));
+    } else if (value.type() == QVariant::List || value.type() == QVariant::StringList) {
+        foreach (const QVariant &item, value.toList()) {
+            result += (result.isEmpty() ? QLatin1String("[") : QLatin1String(","))
+                    + concatenatedJson(item);
+        }
+        return result.isEmpty() ? QString(QLatin1String("[]")) : (result + QLatin1Char(']'));
+    } else if (value.type() == QVariant::String) {
+        result = value.toString();
+        result.replace(QLatin1String("\\"), QLatin1String("\\\\"));
+        result.replace(QLatin1String("\""), QLatin1String("\\\""));
+        return QLatin1Char('"') + result + QLatin1Char('"');
+    } else if (value.isNull()) {
+        return QLatin1String("null");
+    }
+    return value.toString();
+}
+
+/*
+  SOAP 1.2 body built the way QWebMethod used to build it, for comparison.
+  */
+QByteArray TestQWebRequestWriter::concatenatedBody(const QString &methodName,
+                                                   const QString &targetNamespace,
+                                                   const QMap<QString, QVariant> &parameters)
+{
+    QString endl = QLatin1String("\r\n");
+    QString header = QString(QLatin1String("<?xml version=\"1.0\" encoding=\"utf-8\"?> ")
+                     + endl + QLatin1String(" <soap12:Envelope "
+                     "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
+                     "xmlns:xsd=\"http://www.w3.org/2001/XMLSchema\" "
+                     "xmlns:soap12=\"http://www.w3.org/2003/05/soap-envelope\"> ") + endl +
+                     QLatin1String(" <soap12:Body> ") + endl);
+    QString footer = QString(QLatin1String("</soap12:Body> ") + endl
+                             + QLatin1String("</soap12:Envelope>"));
+    QString body = QString(QLatin1String("\t<") + methodName + QLatin1String(" xmlns=\"")
+                           + targetNamespace + QLatin1String("\"> ") + endl);
+
+    foreach (const QString currentKey, parameters.keys()) {
+        QVariant qv = parameters.value(currentKey);
+        body += QString(QLatin1String("\t\t<") + currentKey + QLatin1String(">")
+                        + qv.toString() + QLatin1String("</") + currentKey
+                        + QLatin1String("> ") + endl);
+    }
+
+    body += QString(QLatin1String("\t</") + methodName + QLatin1String("> ") + endl);
+    return QString(header + body + footer).toLatin1();
+}
+
+QTEST_MAIN(TestQWebRequestWriter)
+#include "tst_qwebrequestwriter.moc"
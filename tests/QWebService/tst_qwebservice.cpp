@@ -16,6 +16,7 @@
 ****************************************************************************/
 
 #include <QtTest/QtTest>
+#include <QtNetwork/QTcpServer>
 #include <qwebservice.h>
 
 /**
@@ -32,6 +33,9 @@ private slots:
     void settersTest();
     void qpropertyTest();
     void methodManagementTest();
+    void cancelAllTest();
+    void rateLimitTest();
+    void methodSettingsTest();
 };
 
 /*
@@ -186,5 +190,107 @@ void TestQWebService::methodManagementTest()
     delete reader;
 }
 
+/*
+  Tests cancelling calls of a single web method, and of all methods.
+  */
+void TestQWebService::cancelAllTest()
+{
+    QTcpServer stalledServer;
+    QVERIFY(stalledServer.listen(QHostAddress::LocalHost));
+    QUrl url(QString("http://127.0.0.1:%1/service.asmx").arg(stalledServer.serverPort()));
+
+    QWebService *service = new QWebService(this);
+    QWebMethod *first = new QWebMethod(url);
+    QWebMethod *second = new QWebMethod(url);
+    service->addMethod("first", first);
+    service->addMethod("second", second);
+
+    QWebMethodCall *firstCall = first->invokeMethod();
+    firstCall->setAutoDelete(false);
+    QWebMethodCall *secondCall = second->invokeMethod();
+    secondCall->setAutoDelete(false);
+
+    service->cancelAll("first");
+    QCOMPARE(firstCall->error(), QWebMethodCall::CancelledError);
+    QCOMPARE(secondCall->isFinished(), bool(false));
+
+    service->cancelAll();
+    QCOMPARE(secondCall->error(), QWebMethodCall::CancelledError);
+
+    service->removeMethod("first");
+    service->removeMethod("second");
+    delete service;
+}
+
+/*
+  Checks that rate limit of the service is shared by its methods.
+  */
+void TestQWebService::rateLimitTest()
+{
+    QTcpServer stalledServer;
+    QVERIFY(stalledServer.listen(QHostAddress::LocalHost));
+    QUrl url(QString("http://127.0.0.1:%1/service.asmx").arg(stalledServer.serverPort()));
+
+    QWebService *service = new QWebService(this);
+    QCOMPARE(service->rateLimit().isEnabled(), bool(false));
+    QWebMethod *first = new QWebMethod(url);
+    service->addMethod("first", first);
+    service->setRateLimit(QWebRateLimit(1, 1, 0));
+    // Methods added later share the limit, too.
+    QWebMethod *second = new QWebMethod(url);
+    service->addMethod("second", second);
+    QCOMPARE(service->rateLimit().maxDelay(), int(0));
+
+    QWebMethodCall *firstCall = first->invokeMethod();
+    firstCall->setAutoDelete(false);
+    QWebMethodCall *secondCall = second->invokeMethod();
+    secondCall->setAutoDelete(false);
+    QCOMPARE(secondCall->waitForFinished(5000), bool(true));
+    QCOMPARE(secondCall->error(), QWebMethodCall::RateLimitedError);
+    QCOMPARE(firstCall->isFinished(), bool(false));
+
+    service->cancelAll();
+    service->removeMethod("first");
+    service->removeMethod("second");
+    delete service;
+}
+
+/*
+  Checks that the service sets only settings set on it explicitly, and
+  does not override settings of methods.
+  */
+void TestQWebService::methodSettingsTest()
+{
+    QWebService *service = new QWebService(this);
+    QWebMethod *configured = new QWebMethod(QUrl("http://127.0.0.1/service.asmx"));
+    configured->setCompressionEnabled(true);
+    configured->setCoalescingEnabled(true);
+    QWebMethod *plain = new QWebMethod(QUrl("http://127.0.0.1/service.asmx"));
+
+    // Service settings were never set, so nothing is changed.
+    service->addMethod("configured", configured);
+    service->addMethod("plain", plain);
+    QCOMPARE(configured->isCompressionEnabled(), bool(true));
+    QCOMPARE(configured->isCoalescingEnabled(), bool(true));
+
+    service->setCompressionEnabled(false);
+    service->setCircuitBreakerEnabled(true);
+    service->setRetryPolicy(QWebRetryPolicy(3, 10, 50));
+    QCOMPARE(configured->isCompressionEnabled(), bool(true));
+    QCOMPARE(configured->isCircuitBreakerEnabled(), bool(true));
+    QCOMPARE(configured->retryPolicy().maxAttempts(), int(3));
+    QCOMPARE(plain->isCompressionEnabled(), bool(false));
+    QCOMPARE(plain->isCircuitBreakerEnabled(), bool(true));
+
+    // Methods keep their settings when service settings are pushed again.
+    service->setCoalescingEnabled(false);
+    QCOMPARE(configured->isCoalescingEnabled(), bool(true));
+    QCOMPARE(plain->isCoalescingEnabled(), bool(false));
+
+    service->removeMethod("configured");
+    service->removeMethod("plain");
+    delete service;
+}
+
 QTEST_MAIN(TestQWebService)
 #include "tst_qwebservice.moc"
@@ -33,6 +33,7 @@ private slots:
     void gettersTest();
     void settersTest();
     void qpropertyTest();
+    void servicePortsTest();
 };
 
 /*
@@ -62,6 +63,8 @@ void TestQWsdl::gettersTest()
 
     QCOMPARE(wsdl.host(), QString("http://localhost:1304/band_ws.asmx"));
     QCOMPARE(wsdl.hostUrl(), QUrl("http://localhost:1304/band_ws.asmx"));
+    // SOAP 1.1 and SOAP 1.2 ports share the address.
+    QCOMPARE(wsdl.hostUrls().size(), int(1));
     QCOMPARE(wsdl.wsdlFile(), QString("../../../examples/wsdl/band_ws.asmx"));
     QCOMPARE(wsdl.webServiceName(), QString("band_ws"));
     QCOMPARE(wsdl.targetNamespace(), QString("http://tempuri.org/"));
@@ -173,6 +176,41 @@ void TestQWsdl::qpropertyTest()
     delete wsdl;
 }
 
+/*
+  Checks that addresses of all service ports are kept.
+  */
+void TestQWsdl::servicePortsTest()
+{
+    QFile original("../../../examples/wsdl/band_ws.asmx");
+    QVERIFY(original.open(QIODevice::ReadOnly));
+    QByteArray content = original.readAll();
+    original.close();
+    content.replace("<soap12:address location=\"http://localhost:1304/band_ws.asmx\"",
+                    "<soap12:address location=\"http://localhost:1305/band_ws.asmx\"");
+
+    QString path = QDir::tempPath() + "/tst_qwsdl_ports.asmx";
+    QFile replicated(path);
+    QVERIFY(replicated.open(QIODevice::WriteOnly));
+    replicated.write(content);
+    replicated.close();
+
+    QWsdl wsdl(path, this);
+    QCOMPARE(wsdl.isErrorState(), bool(false));
+    QCOMPARE(wsdl.hostUrls().size(), int(2));
+    QCOMPARE(wsdl.hostUrls().at(0), QUrl("http://localhost:1304/band_ws.asmx"));
+    QCOMPARE(wsdl.hostUrls().at(1), QUrl("http://localhost:1305/band_ws.asmx"));
+    QCOMPARE(wsdl.hostUrl(), QUrl("http://localhost:1305/band_ws.asmx"));
+
+    // Ports are matched with methods by their binding.
+    QCOMPARE(wsdl.hostUrls(QWebMethod::Soap12).size(), int(1));
+    QCOMPARE(wsdl.hostUrls(QWebMethod::Soap12).at(0), QUrl("http://localhost:1305/band_ws.asmx"));
+    QCOMPARE(wsdl.hostUrls(QWebMethod::Soap10).size(), int(1));
+    QCOMPARE(wsdl.hostUrls(QWebMethod::Soap10).at(0), QUrl("http://localhost:1304/band_ws.asmx"));
+    QCOMPARE(wsdl.hostUrls(QWebMethod::Json).size(), int(0));
+
+    QFile::remove(path);
+}
+
 QTEST_MAIN(TestQWsdl)
 #include "tst_qwsdl.moc"
 
@@ -7,5 +7,8 @@ SUBDIRS += \
     QWebMethod \
     QWebServiceMethod \
     QWsdl \
+    QWebRequestWriter \
+    QWebReplyDecoder \
+    QWebJsonDocument \
     qtwsdlconvert
 